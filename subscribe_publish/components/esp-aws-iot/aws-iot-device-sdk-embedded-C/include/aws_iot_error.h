@@ -38,6 +38,10 @@ extern "C" {
  * Values greater than 0 are specific non-error return codes
  */
 typedef enum {
+	/** Returned when none of the tracked reported fields changed and no update was published */
+			SHADOW_NO_CHANGED_FIELDS = 8,
+	/** Returned when a wait for incoming data was interrupted by a wakeup request */
+			NETWORK_WAIT_INTERRUPTED = 7,
 	/** Returned when the Network physical layer is connected */
 			NETWORK_PHYSICAL_LAYER_CONNECTED = 6,
 	/** Returned when the Network is manually disconnected */
@@ -78,7 +82,7 @@ typedef enum {
 			NETWORK_SSL_READ_ERROR = -12,
 	/** Returned when the Network is disconnected and reconnect is either disabled or physical layer is disconnected */
 			NETWORK_DISCONNECTED_ERROR = -13,
-	/** Returned when the Network is disconnected and the reconnect attempt has timed out */
+	/** Returned when the Network is disconnected and the reconnect attempt has timed out. Auto-reconnect retries indefinitely and no longer returns it */
 			NETWORK_RECONNECT_TIMED_OUT_ERROR = -14,
 	/** Returned when the Network is already connected and a connection attempt is made */
 			NETWORK_ALREADY_CONNECTED_ERROR = -15,
@@ -156,7 +160,13 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** The maximum number of outstanding asynchronous QoS1 publishes has been reached */
+			MQTT_MAX_INFLIGHT_PUBLISH_REACHED_ERROR = -53,
+	/** The offline publish queue has no room left for the message */
+			MQTT_OFFLINE_QUEUE_FULL_ERROR = -54,
+	/** The server refused one or more topic filters of a batched subscribe */
+			MQTT_SUBSCRIBE_REJECTED_ERROR = -55
 } IoT_Error_t;
 
 #ifdef __cplusplus
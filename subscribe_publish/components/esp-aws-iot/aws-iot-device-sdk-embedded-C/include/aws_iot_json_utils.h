@@ -19,6 +19,8 @@
  *
  * json_utils provides JSON parsing utilities for use with the IoT SDK.
  * Underlying JSON parsing relies on the Jasmine JSON parser.
+ * The functions only read the bytes covered by the given token, the JSON string
+ * does not have to be null terminated.
  *
  */
 
@@ -56,6 +56,7 @@ extern "C" {
 /* Platform specific implementation header files */
 #include "network_interface.h"
 #include "timer_interface.h"
+#include "byte_store_interface.h"
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 #include "threads_interface.h"
@@ -178,6 +179,8 @@ typedef struct {
 	uint32_t mqttCommandTimeout_ms;			///< Timeout for MQTT blocking calls. In milliseconds
 	uint32_t tlsHandshakeTimeout_ms;		///< TLS handshake timeout.  In milliseconds
 	bool isSSLHostnameVerify;			///< Client should perform server certificate hostname validation
+	const int *pTlsCipherSuites;			///< Zero terminated list of IANA TLS cipher suite numbers in order of preference, NULL for the TLS library defaults
+	const uint16_t *pTlsCurves;			///< Zero terminated list of IANA TLS named curve numbers in order of preference, NULL for the TLS library defaults
 	iot_disconnect_handler disconnectHandler;	///< Callback to be invoked upon connection loss
 	void *disconnectHandlerData;			///< Data to pass as argument when disconnect handler is called
 #ifdef _ENABLE_THREAD_SUPPORT_
@@ -189,9 +192,9 @@ extern const IoT_Client_Init_Params iotClientInitParamsDefault;
 
 /** Default initializer for client */
 #ifdef _ENABLE_THREAD_SUPPORT_
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, false }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, NULL, NULL, false }
 #else
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, NULL, NULL }
 #endif
 
 /**
@@ -222,11 +225,43 @@ typedef enum _ClientState {
  *
  * Defining a TYPE for definition of application callback function pointers.
  * Used to send incoming data to the application
+ * The payload is read in place in the RX buffer and a null byte always follows it, at
+ * pParams->payload + pParams->payloadLen, so a text payload can be used as a string.
  *
  */
 typedef void (*pApplicationHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
 									  IoT_Publish_Message_Params *pParams, void *pClientData);
 
+/**
+ * @brief Application Streaming Callback Handler Type
+ *
+ * Defining a TYPE for definition of application streaming callback function pointers.
+ * Used to send incoming data to the application in chunks as it is read from the network,
+ * so that messages larger than the RX buffer can be received.
+ * pParams->payload and pParams->payloadLen describe the current chunk only, payloadOffset is
+ * the position of that chunk within the message and payloadTotalLen the full payload length.
+ * A chunk with payloadOffset + pParams->payloadLen == payloadTotalLen is the last one.
+ *
+ */
+typedef void (*pApplicationStreamHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+											IoT_Publish_Message_Params *pParams, size_t payloadOffset,
+											size_t payloadTotalLen, void *pClientData);
+
+/**
+ * @brief Subscribe Batch Entry Type
+ *
+ * Defining a type for one topic filter of a batched subscribe.
+ * The topic name and handler data are not copied, they must remain valid for the duration of the subscription.
+ *
+ */
+typedef struct {
+	const char *pTopicName; ///< Topic filter to subscribe to
+	uint16_t topicNameLen; ///< Length of topic filter
+	QoS qos; ///< Requested Quality of Service
+	pApplicationHandler_t pApplicationHandler; ///< Application function to invoke for messages on this filter
+	void *pApplicationHandlerData; ///< Context to pass to application handler
+} IoT_Subscribe_Topic_Params;
+
 /**
  * @brief MQTT Message Handler
  *
@@ -240,9 +275,137 @@ typedef struct _MessageHandlers {
 	char resubscribed; ///< Whether this handler was successfully resubscribed in the reconnect workflow
 	QoS qos; ///< QoS of subscription
 	pApplicationHandler_t pApplicationHandler; ///< Application function to invoke
+	pApplicationStreamHandler_t pApplicationStreamHandler; ///< Application streaming function to invoke, used instead of pApplicationHandler when set
 	void *pApplicationHandlerData; ///< Context to pass to application handler
+	uint16_t nextHandler; ///< Index of the next handler subscribed with the same topic filter
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/**
+ * @brief Sentinel index marking the absence of a topic trie node or message handler
+ */
+#define AWS_IOT_MQTT_TOPIC_TRIE_NONE 0xFFFFu
+
+/**
+ * @brief MQTT Topic Trie Node
+ *
+ * Defining a type for one level of a subscribed topic filter.
+ * Nodes are allocated from a fixed pool in ClientData and linked by index, the level
+ * text is not copied but refers into the topic filter of one of the handlers below the node.
+ *
+ */
+typedef struct _TopicTrieNode {
+	const char *pLevel; ///< Text of this topic level, not NULL terminated
+	uint16_t levelLen; ///< Length of the topic level
+	uint16_t anchorHandler; ///< Index of the handler whose topic filter pLevel points into
+	uint16_t parent; ///< Index of the parent node
+	uint16_t firstChild; ///< Index of the first child node
+	uint16_t nextSibling; ///< Index of the next sibling node, or of the next free node while unused
+	uint16_t firstHandler; ///< Index of the first handler subscribed with the filter ending at this node
+} TopicTrieNode;
+
+/**
+ * @brief Asynchronous Publish Completion Handler Type
+ *
+ * Defining a TYPE for definition of asynchronous publish completion callback function pointers.
+ * Invoked from the context of yield with SUCCESS once the PUBACK for the message is received,
+ * or with MQTT_REQUEST_TIMEOUT_ERROR if the command timeout elapses first. A reconnect with a clean session
+ * completes the messages still waiting with NETWORK_DISCONNECTED_ERROR.
+ *
+ */
+typedef void (*pPublishCompleteHandler_t)(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t status,
+										  void *pCompleteHandlerData);
+
+/**
+ * @brief Publish Payload Reader Type
+ *
+ * Defining a TYPE for definition of streaming publish payload reader function pointers.
+ * Called while the PUBLISH is being written to fill pBuffer with exactly bufferLen bytes of
+ * payload, starting at payloadOffset. Anything other than SUCCESS aborts the publish.
+ *
+ */
+typedef IoT_Error_t (*pPublishPayloadReader_t)(AWS_IoT_Client *pClient, unsigned char *pBuffer, size_t bufferLen,
+											   size_t payloadOffset, void *pReaderData);
+
+/**
+ * @brief MQTT In-flight Publish
+ *
+ * Defining a type for an asynchronous QoS1 publish awaiting its PUBACK.
+ * The topic and payload are not copied, they are owned by the application until completion.
+ *
+ */
+typedef struct _InflightPublish {
+	uint16_t packetId; ///< Packet identifier of the outstanding publish, 0 when this slot is free
+	const char *pTopicName; ///< Topic name of the outstanding publish
+	uint16_t topicNameLen; ///< Length of topic name
+	IoT_Publish_Message_Params params; ///< Message parameters of the outstanding publish
+	Timer ackTimer; ///< Time allowed for the PUBACK to be received
+	pPublishCompleteHandler_t pCompleteHandler; ///< Application function to invoke on completion
+	void *pCompleteHandlerData; ///< Context to pass to completion handler
+} InflightPublish;
+
+/**
+ * @brief Offline Queue Drop Handler Type
+ *
+ * Defining a TYPE for definition of offline queue drop callback function pointers.
+ * Invoked from the context of yield when a queued message is removed from the offline
+ * queue without being delivered, because sending it failed with status for a reason
+ * other than the connection. The topic and payload are only valid during the call.
+ *
+ */
+typedef void (*pOfflineQueueDropHandler_t)(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										   IoT_Publish_Message_Params *pParams, IoT_Error_t status,
+										   void *pDropHandlerData);
+
+/**
+ * @brief Reconnect Policy
+ *
+ * Chooses how long auto-reconnect waits before each attempt. When nextWait is NULL the
+ * client uses decorrelated jitter: each wait is drawn between AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
+ * and three times the previous wait, capped at AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL.
+ *
+ */
+typedef struct {
+	uint32_t (*nextWait)(void *pPolicyData, uint32_t previousWait_ms); ///< Wait in ms before the next attempt, previousWait_ms is 0 for the first attempt after a disconnect
+	void *pPolicyData; ///< Context passed to nextWait
+} IoT_Reconnect_Policy;
+
+#define AWS_IOT_MQTT_RECONNECT_LATENCY_BUCKETS 10 ///< Buckets of the reconnect latency histogram, the last one holds reconnects of 256 seconds or more
+
+/**
+ * @brief Reconnect Statistics
+ *
+ * Counts the automatic reconnects of a client and how long they took, from the detection
+ * of the disconnect to the end of the resubscribe.
+ *
+ */
+typedef struct {
+	uint32_t attemptCount; ///< Reconnect attempts made by auto-reconnect
+	uint32_t reconnectCount; ///< Reconnects auto-reconnect completed
+	uint32_t lastLatency_ms; ///< Time the last completed reconnect took
+	uint32_t maxLatency_ms; ///< Longest time a completed reconnect took
+	uint32_t latencyHistogram[AWS_IOT_MQTT_RECONNECT_LATENCY_BUCKETS]; ///< Completed reconnects, bucket 0 counts those under a second and bucket i those from 2^(i-1) to 2^i seconds
+} IoT_Reconnect_Stats;
+
+/**
+ * @brief MQTT Offline Queue
+ *
+ * Defining a type for the ring buffer of QoS1 messages published while the client was disconnected.
+ * Messages are stored with their topic, in order, and drained once the client has reconnected.
+ *
+ */
+typedef struct _OfflineQueue {
+	unsigned char *pBuffer; ///< Ring buffer provided by the application, NULL while the queue is disabled
+	size_t bufferSize; ///< Size of the ring buffer
+	size_t head; ///< Offset of the oldest queued message
+	size_t used; ///< Number of bytes of the ring buffer in use
+	uint32_t count; ///< Number of queued messages, including those sent and awaiting their PUBACK
+	uint32_t unsentCount; ///< Number of queued messages which still have to be sent
+	IoT_Byte_Store store; ///< Persistent backing, read and write are NULL when the queue is RAM only
+	pOfflineQueueDropHandler_t pDropHandler; ///< Application function told about messages dropped from the queue, may be NULL
+	void *pDropHandlerData; ///< Context to pass to the drop handler
+	Timer drainTimer; ///< Paces the messages sent from the queue after a reconnect
+} OfflineQueue;
+
 /**
  * @brief MQTT Client Status
  *
@@ -254,6 +417,9 @@ typedef struct _ClientStatus {
 	ClientState clientState; ///< The current state of the client's state machine
 	bool isPingOutstanding; ///< Whether this client is waiting for a ping response
 	bool isAutoReconnectEnabled; ///< Whether auto-reconnect is enabled for this client
+	bool isSessionPresent; ///< Whether the server resumed a persistent session on the last connect
+	bool isLinkUpReported; ///< Whether the application reported the network link back since the last reconnect attempt, guarded by state_change_mutex
+	bool isReconnectTimed; ///< Whether reconnectLatencyTimer runs for the current disconnect
 } ClientStatus;
 
 /**
@@ -270,8 +436,11 @@ typedef struct _ClientData {
 	uint32_t packetTimeoutMs; ///< Timeout for reading incoming packets from the network
 	uint32_t commandTimeoutMs; ///< Timeout for processing outgoing MQTT packets
 	uint16_t keepAliveInterval; ///< Maximum interval between control packets
-	uint32_t currentReconnectWaitInterval; ///< Current backoff period for reconnect
+	uint32_t currentReconnectWaitInterval; ///< Current backoff period for reconnect, 0 until the first wait after a disconnect is chosen
 	uint32_t counterNetworkDisconnected; ///< How many times this client detected a disconnection
+	IoT_Reconnect_Policy reconnectPolicy; ///< Chooses the backoff period, nextWait is NULL for decorrelated jitter
+	uint32_t reconnectJitterState; ///< Random state of the decorrelated jitter, 0 until it is seeded from the client ID
+	IoT_Reconnect_Stats reconnectStats; ///< Automatic reconnects and their latency
 
 	/* The below values are initialized with the
 	 * lengths of the TX/RX buffers and never modified
@@ -287,11 +456,17 @@ typedef struct _ClientData {
 	IoT_Mutex_t state_change_mutex; ///< Mutex protecting the client's state machine
 	IoT_Mutex_t tls_read_mutex; ///< Mutex protecting incoming data
 	IoT_Mutex_t tls_write_mutex; ///< Mutex protecting outgoing data
+	IoT_Mutex_t offline_queue_mutex; ///< Mutex protecting the offline publish queue
 #endif
 
 	IoT_Client_Connect_Params options; ///< Options passed when the client was initialized
 
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Callbacks for incoming messages
+	InflightPublish inflightPublishes[AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH]; ///< Asynchronous QoS1 publishes awaiting PUBACK
+	uint16_t inflightPublishCount; ///< Number of occupied entries in inflightPublishes
+	OfflineQueue offlineQueue; ///< QoS1 messages published while disconnected
+	TopicTrieNode topicTrieNodes[AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES]; ///< Index of subscribed topic filters, node 0 is the root
+	uint16_t topicTrieFreeNode; ///< Head of the list of unused topic trie nodes
 	iot_disconnect_handler disconnectHandler; ///< Callback when a disconnection is detected
 	void *disconnectHandlerData; ///< Context for disconnect handler
 } ClientData;
@@ -306,6 +481,7 @@ struct _Client {
 	Timer pingReqTimer;		///< Timer to keep track of when to send next PINGREQ
 	Timer pingRespTimer;	///< Timer to ensure that PINGRESP is received timely
 	Timer reconnectDelayTimer; ///< Timer for backoff on reconnect
+	Timer reconnectLatencyTimer; ///< Started when a disconnect is detected, measures how long the reconnect takes
 
 	ClientStatus clientStatus; ///< Client state information
 	ClientData clientData; ///< Client context
@@ -316,12 +492,17 @@ struct _Client {
  * @functionpage{aws_iot_mqtt_get_next_packet_id,mqtt,get_next_packet_id}
  * @functionpage{aws_iot_mqtt_set_connect_params,mqtt,set_connect_params}
  * @functionpage{aws_iot_mqtt_is_client_connected,mqtt,is_client_connected}
+ * @functionpage{aws_iot_mqtt_is_session_present,mqtt,is_session_present}
  * @functionpage{aws_iot_mqtt_get_client_state,mqtt,get_client_state}
  * @functionpage{aws_iot_is_autoreconnect_enabled,mqtt,is_autoreconnect_enabled}
  * @functionpage{aws_iot_mqtt_set_disconnect_handler,mqtt,set_disconnect_handler}
  * @functionpage{aws_iot_mqtt_autoreconnect_set_status,mqtt,autoreconnect_set_status}
+ * @functionpage{aws_iot_mqtt_autoreconnect_set_policy,mqtt,autoreconnect_set_policy}
+ * @functionpage{aws_iot_mqtt_autoreconnect_link_up,mqtt,autoreconnect_link_up}
  * @functionpage{aws_iot_mqtt_get_network_disconnected_count,mqtt,get_network_disconnected_count}
  * @functionpage{aws_iot_mqtt_reset_network_disconnected_count,mqtt,reset_network_disconnected_count}
+ * @functionpage{aws_iot_mqtt_get_reconnect_stats,mqtt,get_reconnect_stats}
+ * @functionpage{aws_iot_mqtt_reset_reconnect_stats,mqtt,reset_reconnect_stats}
  */
 
 /**
@@ -389,6 +570,24 @@ IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, const IoT_C
 bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient);
 /* @[declare_mqtt_is_client_connected] */
 
+/**
+ * @brief Determine if the server resumed a persistent session on the last connect.
+ *
+ * This function returns the session present flag of the last accepted CONNACK. It
+ * is only ever set for connections made with `isCleanSession` disabled. When it is
+ * set, the server still holds the subscriptions of the previous session, so they are
+ * not sent again on reconnect, and any unacknowledged QoS 1 publishes have been
+ * retransmitted with the DUP flag set. When it is clear, those publishes have been
+ * sent again as new messages.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return true if the last connect resumed a session; false otherwise.
+ */
+/* @[declare_mqtt_is_session_present] */
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_is_session_present] */
+
 /**
  * @brief Get the current state of the MQTT client context.
  *
@@ -459,6 +658,45 @@ IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_dis
 IoT_Error_t aws_iot_mqtt_autoreconnect_set_status(AWS_IoT_Client *pClient, bool newStatus);
 /* @[declare_mqtt_autoreconnect_set_status] */
 
+/**
+ * @brief Replace the policy choosing the wait before each auto-reconnect attempt.
+ *
+ * The policy takes effect at the next wait it is asked for. The default policy
+ * draws each wait with decorrelated jitter, seeded from the client ID, so devices
+ * that lost the same server do not come back at the same time.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pPolicy Policy to copy, NULL restores the default policy
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter; otherwise, always
+ * returns SUCCESS.
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_autoreconnect_set_policy] */
+IoT_Error_t aws_iot_mqtt_autoreconnect_set_policy(AWS_IoT_Client *pClient, const IoT_Reconnect_Policy *pPolicy);
+/* @[declare_mqtt_autoreconnect_set_policy] */
+
+/**
+ * @brief Report that the network link of the device is back.
+ *
+ * If auto-reconnect is waiting to retry, the next call to @ref mqtt_function_yield
+ * attempts the reconnect straight away and the backoff starts again from the
+ * first wait. Nothing is done while the client is connected.
+ *
+ * This function may be called from another thread than the one calling
+ * @ref mqtt_function_yield, for example from the link up event of the network
+ * interface. A yield waiting for data is woken up, see @ref mqtt_function_yield_wakeup.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter, a mutex error if
+ * the client state could not be locked; otherwise, returns SUCCESS.
+ */
+/* @[declare_mqtt_autoreconnect_link_up] */
+IoT_Error_t aws_iot_mqtt_autoreconnect_link_up(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_autoreconnect_link_up] */
+
 /**
  * @brief Get the current number of disconnects detected by an MQTT client context.
  *
@@ -484,6 +722,33 @@ uint32_t aws_iot_mqtt_get_network_disconnected_count(AWS_IoT_Client *pClient);
 void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient);
 /* @[declare_mqtt_reset_network_disconnected_count] */
 
+/**
+ * @brief Get the reconnect statistics of an MQTT client context.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[out] pStats Set to the automatic reconnects made since the client was created
+ * (or since the last call to @ref mqtt_function_reset_reconnect_stats).
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter; otherwise, always
+ * returns SUCCESS.
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_get_reconnect_stats] */
+IoT_Error_t aws_iot_mqtt_get_reconnect_stats(AWS_IoT_Client *pClient, IoT_Reconnect_Stats *pStats);
+/* @[declare_mqtt_get_reconnect_stats] */
+
+/**
+ * @brief Reset the reconnect statistics of an MQTT client context to zero.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_reset_reconnect_stats] */
+void aws_iot_mqtt_reset_reconnect_stats(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_reset_reconnect_stats] */
+
 #ifdef __cplusplus
 }
 #endif
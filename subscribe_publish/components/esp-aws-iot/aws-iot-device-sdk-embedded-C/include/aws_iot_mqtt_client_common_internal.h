@@ -49,6 +49,9 @@ extern "C" {
 
 #include "aws_iot_mqtt_client_interface.h"
 
+/* Longest reconnect the latency timer can measure, about 24 days */
+#define AWS_IOT_MQTT_RECONNECT_LATENCY_TIMER_MS 0x7FFFFFFFU
+
 /** Types of MQTT messages */
 typedef enum msgTypes {
 	UNKNOWN = -1,
@@ -74,6 +77,9 @@ typedef enum msgTypes {
 #define MQTT_HEADER_FIELD_QOS(_byte)	((_byte & (3 << 1)) >> 1) /**< QoS */
 #define MQTT_HEADER_FIELD_RETAIN(_byte)	((_byte & (1 << 0)) >> 0) /**< Retain flag */
 
+/* Largest value the remaining length field can encode (MQTT 3.1.1 - 2.2.3) */
+#define MQTT_MAX_REMAINING_LENGTH 268435455u
+
 /**
  * Bitfields for the MQTT header byte.
  */
@@ -105,6 +111,12 @@ void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *s
 
 IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient );
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_send_packet_with_payload(AWS_IoT_Client *pClient, size_t headerLength,
+														   const unsigned char *pPayload, size_t payloadLen,
+														   Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_send_packet_with_reader(AWS_IoT_Client *pClient, size_t headerLength,
+														  size_t payloadLen, pPublishPayloadReader_t pPayloadReader,
+														  void *pReaderData, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType);
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t txBufLen,
@@ -117,6 +129,30 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
+IoT_Error_t aws_iot_mqtt_internal_enter_pending_reconnect(AWS_IoT_Client *pClient);
+
+bool aws_iot_mqtt_internal_complete_inflight_publish(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_expire_inflight_publishes(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_fail_inflight_publishes(AWS_IoT_Client *pClient, IoT_Error_t status);
+IoT_Error_t aws_iot_mqtt_internal_replay_inflight_publishes(AWS_IoT_Client *pClient, bool isSessionPresent);
+IoT_Error_t aws_iot_mqtt_internal_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+												IoT_Publish_Message_Params *pParams,
+												pPublishCompleteHandler_t pCompleteHandler, void *pCompleteHandlerData);
+
+bool aws_iot_mqtt_internal_offline_queue_is_enabled(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_offline_queue_push(AWS_IoT_Client *pClient, const char *pTopicName,
+													 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams);
+uint32_t aws_iot_mqtt_internal_offline_queue_drain_wait_ms(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_offline_queue_drain(AWS_IoT_Client *pClient);
+
+/* Number of words in a bitmap holding one bit per message handler */
+#define AWS_IOT_MQTT_HANDLER_BITMAP_WORDS ((AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 31) / 32)
+
+void aws_iot_mqtt_internal_topic_trie_init(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_topic_trie_insert(AWS_IoT_Client *pClient, uint16_t handlerIndex);
+void aws_iot_mqtt_internal_topic_trie_remove(AWS_IoT_Client *pClient, uint16_t handlerIndex);
+void aws_iot_mqtt_internal_topic_trie_match(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+											uint32_t *pMatchedHandlers);
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 
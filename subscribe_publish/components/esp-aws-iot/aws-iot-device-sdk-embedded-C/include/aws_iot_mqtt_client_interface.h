@@ -66,21 +66,35 @@ extern "C" {
  * - @functionname{mqtt_function_free}
  * - @functionname{mqtt_function_connect}
  * - @functionname{mqtt_function_publish}
+ * - @functionname{mqtt_function_publish_async}
+ * - @functionname{mqtt_function_publish_stream}
+ * - @functionname{mqtt_function_offline_queue_init}
+ * - @functionname{mqtt_function_offline_queue_count}
+ * - @functionname{mqtt_function_offline_queue_set_drop_handler}
  * - @functionname{mqtt_function_subscribe}
+ * - @functionname{mqtt_function_subscribe_stream}
+ * - @functionname{mqtt_function_subscribe_batch}
  * - @functionname{mqtt_function_resubscribe}
  * - @functionname{mqtt_function_unsubscribe}
+ * - @functionname{mqtt_function_unsubscribe_batch}
  * - @functionname{mqtt_function_disconnect}
  * - @functionname{mqtt_function_yield}
+ * - @functionname{mqtt_function_yield_wakeup}
  * - @functionname{mqtt_function_attempt_reconnect}
  * - @functionname{mqtt_function_get_next_packet_id}
  * - @functionname{mqtt_function_set_connect_params}
  * - @functionname{mqtt_function_is_client_connected}
+ * - @functionname{mqtt_function_is_session_present}
  * - @functionname{mqtt_function_get_client_state}
  * - @functionname{mqtt_function_is_autoreconnect_enabled}
  * - @functionname{mqtt_function_set_disconnect_handler}
  * - @functionname{mqtt_function_autoreconnect_set_status}
+ * - @functionname{mqtt_function_autoreconnect_set_policy}
+ * - @functionname{mqtt_function_autoreconnect_link_up}
  * - @functionname{mqtt_function_get_network_disconnected_count}
  * - @functionname{mqtt_function_reset_network_disconnected_count}
+ * - @functionname{mqtt_function_get_reconnect_stats}
+ * - @functionname{mqtt_function_reset_reconnect_stats}
  */
 
 /**
@@ -88,11 +102,20 @@ extern "C" {
  * @functionpage{aws_iot_mqtt_free,mqtt,free}
  * @functionpage{aws_iot_mqtt_connect,mqtt,connect}
  * @functionpage{aws_iot_mqtt_publish,mqtt,publish}
+ * @functionpage{aws_iot_mqtt_publish_async,mqtt,publish_async}
+ * @functionpage{aws_iot_mqtt_publish_stream,mqtt,publish_stream}
+ * @functionpage{aws_iot_mqtt_offline_queue_init,mqtt,offline_queue_init}
+ * @functionpage{aws_iot_mqtt_offline_queue_count,mqtt,offline_queue_count}
+ * @functionpage{aws_iot_mqtt_offline_queue_set_drop_handler,mqtt,offline_queue_set_drop_handler}
  * @functionpage{aws_iot_mqtt_subscribe,mqtt,subscribe}
+ * @functionpage{aws_iot_mqtt_subscribe_stream,mqtt,subscribe_stream}
+ * @functionpage{aws_iot_mqtt_subscribe_batch,mqtt,subscribe_batch}
  * @functionpage{aws_iot_mqtt_resubscribe,mqtt,resubscribe}
  * @functionpage{aws_iot_mqtt_unsubscribe,mqtt,unsubscribe}
+ * @functionpage{aws_iot_mqtt_unsubscribe_batch,mqtt,unsubscribe_batch}
  * @functionpage{aws_iot_mqtt_disconnect,mqtt,disconnect}
  * @functionpage{aws_iot_mqtt_yield,mqtt,yield}
+ * @functionpage{aws_iot_mqtt_yield_wakeup,mqtt,yield_wakeup}
  * @functionpage{aws_iot_mqtt_attempt_reconnect,mqtt,attempt_reconnect}
  */
 
@@ -101,7 +124,8 @@ extern "C" {
  *
  * This function should be called before any other MQTT function to initialize
  * a new MQTT client context. Once the client context is no longer needed,
- * @ref mqtt_function_free should be called.
+ * @ref mqtt_function_free should be called. A context initialized before must
+ * be freed before it is initialized again.
  *
  * @param[in] pClient MQTT client context to initialize
  * @param[in] pInitParams The MQTT connection parameters
@@ -115,8 +139,9 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 /**
  * @brief Clean up an MQTT client context that is no longer needed.
  *
- * This function will free up resources used by an MQTT client context. It should
- * only be called when that context is no longer needed.
+ * This function will free up resources used by an MQTT client context, including
+ * those the TLS layer keeps across reconnects. It should only be called when that
+ * context is disconnected and no longer needed.
  *
  * @param[in] pClient MQTT client context that was previously initialized by
  * @ref mqtt_function_init
@@ -166,6 +191,138 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 								 IoT_Publish_Message_Params *pParams);
 /* @[declare_mqtt_publish] */
 
+/**
+ * @brief Publish an MQTT message to a topic without waiting for its PUBACK.
+ *
+ * This function sends an MQTT message to the server and returns as soon as the
+ * message is passed to the TLS layer. For a QoS 1 message, the packet identifier
+ * is recorded in the client's in-flight table, which holds up to
+ * #AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH outstanding messages. The completion handler
+ * is invoked from @ref mqtt_function_yield when the matching PUBACK arrives, or
+ * with `MQTT_REQUEST_TIMEOUT_ERROR` once the command timeout elapses without one.
+ * Messages still waiting when the client reconnects with a clean session are
+ * completed with `NETWORK_DISCONNECTED_ERROR` from the connect, the new session
+ * knows none of them. A persistent session sends them again instead.
+ *
+ * A QoS 0 message is sent exactly as by @ref mqtt_function_publish and the
+ * completion handler is not invoked.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopicName Topic name to publish to
+ * @param[in] topicNameLen Length of the topic name
+ * @param[in,out] pParams Publish message parameters. The assigned packet identifier
+ * is written to `pParams->id`.
+ * @param[in] pCompleteHandler Callback invoked when the publish completes. May be NULL.
+ * @param[in] pCompleteHandlerData Data passed to the callback
+ *
+ * @return `MQTT_MAX_INFLIGHT_PUBLISH_REACHED_ERROR` if the in-flight table is full;
+ * otherwise `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @attention The `pTopicName` and `pParams->payload` buffers are not copied. They must
+ * remain valid until the completion handler is invoked.
+ */
+/* @[declare_mqtt_publish_async] */
+IoT_Error_t aws_iot_mqtt_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams,
+									   pPublishCompleteHandler_t pCompleteHandler, void *pCompleteHandlerData);
+/* @[declare_mqtt_publish_async] */
+
+/**
+ * @brief Publish an MQTT message whose payload is supplied in chunks.
+ *
+ * This function behaves like @ref mqtt_function_publish, except that the payload
+ * is not passed in `pParams->payload`. The PUBLISH header is written with the final
+ * length taken from `pParams->payloadLen`, then the payload reader is called to fill
+ * the TX buffer with consecutive chunks of at most #AWS_IOT_MQTT_TX_BUF_LEN bytes, each
+ * written to the network before the next one is requested. Payloads are therefore
+ * not limited by the size of the TX buffer.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopicName Topic name to publish to
+ * @param[in] topicNameLen Length of the topic name
+ * @param[in,out] pParams Publish message parameters. `pParams->payload` is ignored.
+ * @param[in] pPayloadReader Callback filling each chunk of the payload
+ * @param[in] pReaderData Data passed to the callback
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @note The command timeout applies to each chunk. If the reader fails, the error it
+ * returned is passed back and the PUBLISH is left incomplete on the connection, which
+ * must then be closed with @ref mqtt_function_disconnect and reconnected.
+ */
+/* @[declare_mqtt_publish_stream] */
+IoT_Error_t aws_iot_mqtt_publish_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										IoT_Publish_Message_Params *pParams, pPublishPayloadReader_t pPayloadReader,
+										void *pReaderData);
+/* @[declare_mqtt_publish_stream] */
+
+/**
+ * @brief Enable the offline queue for QoS1 publishes.
+ *
+ * Once enabled, @ref mqtt_function_publish called with a QoS1 message while the
+ * client is disconnected by an error (including while auto-reconnect is pending)
+ * copies the message into the queue and returns `SUCCESS`, instead of failing with
+ * `NETWORK_DISCONNECTED_ERROR`. After the client has reconnected,
+ * @ref mqtt_function_yield sends the queued messages in order, at most one every
+ * `AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS` and never more than the in-flight
+ * table allows. A message leaves the queue when its PUBACK is received and is sent
+ * again if the PUBACK does not arrive in time.
+ *
+ * With a store, the queue is reloaded from it by this call and every change is
+ * written to it, so queued messages survive a reboot. A message whose PUBACK was not
+ * received before the reboot is sent again.
+ *
+ * @param[in] pClient MQTT client context, initialized with @ref mqtt_function_init
+ * @param[in] pBuffer Ring buffer for the queued messages, owned by the client from now on.
+ * Each message takes 8 bytes plus its topic and payload.
+ * @param[in] bufferSize Size of the ring buffer. A store must keep 20 bytes more than this.
+ * @param[in] pStore Persistent store mirroring the queue, NULL to keep it in RAM only
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @note Messages published with @ref mqtt_function_publish_stream or
+ * @ref mqtt_function_publish_async are never queued. A queued message is rejected with
+ * `MQTT_OFFLINE_QUEUE_FULL_ERROR` when the queue has no room left for it.
+ */
+/* @[declare_mqtt_offline_queue_init] */
+IoT_Error_t aws_iot_mqtt_offline_queue_init(AWS_IoT_Client *pClient, unsigned char *pBuffer, size_t bufferSize,
+											const IoT_Byte_Store *pStore);
+/* @[declare_mqtt_offline_queue_init] */
+
+/**
+ * @brief Number of messages in the offline queue.
+ *
+ * Includes the messages sent after the reconnect which are still awaiting their PUBACK.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return Number of queued messages, 0 if the queue is not enabled
+ */
+/* @[declare_mqtt_offline_queue_count] */
+uint32_t aws_iot_mqtt_offline_queue_count(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_offline_queue_count] */
+
+/**
+ * @brief Be told about messages dropped from the offline queue.
+ *
+ * A queued message which cannot be sent after the reconnect for a reason other than
+ * the connection, such as a topic or payload too large for the client buffers, is
+ * removed from the queue. The handler is then called with the message and the error
+ * which prevented it from being sent. The handler is kept by
+ * @ref mqtt_function_offline_queue_init.
+ *
+ * @param[in] pClient MQTT client context, initialized with @ref mqtt_function_init
+ * @param[in] pDropHandler Function to call for each dropped message, NULL to stop being told
+ * @param[in] pDropHandlerData Context passed to the handler
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ */
+/* @[declare_mqtt_offline_queue_set_drop_handler] */
+IoT_Error_t aws_iot_mqtt_offline_queue_set_drop_handler(AWS_IoT_Client *pClient,
+														pOfflineQueueDropHandler_t pDropHandler,
+														void *pDropHandlerData);
+/* @[declare_mqtt_offline_queue_set_drop_handler] */
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -195,6 +352,67 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData);
 /* @[declare_mqtt_subscribe] */
 
+/**
+ * @brief Subscribe to an MQTT topic and receive its messages in chunks.
+ *
+ * This function behaves like @ref mqtt_function_subscribe, except that messages
+ * are passed to a streaming callback. Messages that fit in the RX buffer are
+ * delivered in a single call with a payload offset of 0. Messages larger than
+ * the RX buffer, which would otherwise be dropped, are delivered in chunks of at
+ * most the free space left in the RX buffer after the topic, in order, as they
+ * are read from the network.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopicName Topic for subscription
+ * @param[in] topicNameLen Length of topic
+ * @param[in] qos Quality of service for subscription
+ * @param[in] pApplicationStreamHandler Callback function for chunks of incoming
+ * messages that arrive on this subscription
+ * @param[in] pApplicationHandlerData Data passed to the callback
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @attention The `pTopicName` parameter is not copied. It must remain valid for the duration
+ * of the subscription (until @ref mqtt_function_unsubscribe) is called.
+ *
+ * @note The chunk buffer is reused for the next chunk once the callback returns,
+ * the callback must copy or consume the data it needs. A QoS 1 message is only
+ * acknowledged once its last chunk has been delivered. MQTT APIs cannot be
+ * called from the callback of a chunked message.
+ */
+/* @[declare_mqtt_subscribe_stream] */
+IoT_Error_t aws_iot_mqtt_subscribe_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  QoS qos, pApplicationStreamHandler_t pApplicationStreamHandler,
+										  void *pApplicationHandlerData);
+/* @[declare_mqtt_subscribe_stream] */
+
+/**
+ * @brief Subscribe to several MQTT topics at once.
+ *
+ * This function behaves like @ref mqtt_function_subscribe for every entry of
+ * `pTopics`, but sends all topic filters in a single MQTT subscribe packet and
+ * waits for a single SUBACK, so that subscribing to many topics costs one
+ * round trip.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopics Topic filters to subscribe to, with their callbacks
+ * @param[in] topicCount Number of entries in `pTopics`
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @note All topic filters must fit in the TX buffer together, otherwise
+ * `MQTT_TX_BUFFER_TOO_SHORT_ERROR` is returned and nothing is subscribed.
+ * If the server refuses some of the topic filters, only those are left
+ * without a handler and `MQTT_SUBSCRIBE_REJECTED_ERROR` is returned.
+ *
+ * @attention The topic names of `pTopics` are not copied. They must remain valid for the
+ * duration of the subscriptions, the `pTopics` array itself is not kept.
+ */
+/* @[declare_mqtt_subscribe_batch] */
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Topic_Params *pTopics,
+										 uint32_t topicCount);
+/* @[declare_mqtt_subscribe_batch] */
+
 /**
  * @brief Resubscribe to topic filter subscriptions in a previous MQTT session.
  *
@@ -204,6 +422,8 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  *
  * @note This function does not need to be called after @ref mqtt_function_attempt_reconnect
  * or if auto-reconnect is enabled.
+ * It does not need to be called either when @ref mqtt_function_is_session_present
+ * reports that the server resumed a persistent session, which still holds the subscriptions.
  *
  * @param[in] pClient MQTT client context
  *
@@ -230,6 +450,27 @@ IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_unsubscribe(AWS_IoT_Client *pClient, const char *pTopicFilter, uint16_t topicFilterLen);
 /* @[declare_mqtt_unsubscribe] */
 
+/**
+ * @brief Unsubscribe from several MQTT topic filters at once.
+ *
+ * This function behaves like @ref mqtt_function_unsubscribe for every topic
+ * filter, but sends them all in a single MQTT unsubscribe packet.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopicFilters Topic filters of the subscriptions to remove
+ * @param[in] pTopicFilterLens Lengths of the topic filters
+ * @param[in] count Number of topic filters
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @note Every topic filter must be subscribed and all of them must fit in the
+ * TX buffer together, otherwise nothing is sent.
+ */
+/* @[declare_mqtt_unsubscribe_batch] */
+IoT_Error_t aws_iot_mqtt_unsubscribe_batch(AWS_IoT_Client *pClient, const char **pTopicFilters,
+										   uint16_t *pTopicFilterLens, uint32_t count);
+/* @[declare_mqtt_unsubscribe_batch] */
+
 /**
  * @brief Disconnect an MQTT session.
  *
@@ -264,9 +505,14 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient);
  * - @ref mqtt_autoreconnect (if enabled) <br>
  * If the client detects a disconnect, the reconnection will be performed in this function.
  *
+ * When the network layer supports it, this function sleeps on the socket between
+ * events instead of polling it, waking up when data arrives, when a keep-alive or
+ * PUBACK deadline is reached or when @ref mqtt_function_yield_wakeup is called.
+ *
  * @param[in] pClient MQTT client context
  * @param[in] timeout_ms Amount of time to yield. This function will return to the caller
- * after AT LEAST this amount of thime has passed.
+ * after AT LEAST this amount of thime has passed, unless it is woken up early by
+ * @ref mqtt_function_yield_wakeup.
  *
  * @return `IoT_Error_t`: See `aws_iot_error.h`
  * @return If this call results a negative value, assume the MQTT connection has dropped.
@@ -277,12 +523,31 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms);
 /* @[declare_mqtt_yield] */
 
+/**
+ * @brief Make a blocked yield return to its caller early.
+ *
+ * Meant to be called from another thread, for example when it has queued work
+ * for the thread running @ref mqtt_function_yield. If no yield is in progress,
+ * the next one returns as soon as it has processed the data already available.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ * @return `FAILURE` if the network layer cannot be woken up.
+ */
+/* @[declare_mqtt_yield_wakeup] */
+IoT_Error_t aws_iot_mqtt_yield_wakeup(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_yield_wakeup] */
+
 /**
  * @brief Attempt to reconnect with the MQTT server.
  *
  * This function makes a single reconnect attempt with the server. If the
  * reconnection is successful, subscriptions from the client's previous
- * session are restored as well.
+ * session are restored as well, unless the server resumed a persistent session
+ * that still holds them. In that case the unacknowledged QoS 1 publishes are
+ * retransmitted with the DUP flag set instead. Otherwise they are sent again
+ * as new messages.
  *
  * If this function fails, the client's state is set to `CLIENT_STATE_PENDING_RECONNECT`.
  *
@@ -291,8 +556,8 @@ IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms);
  * @return `IoT_Error_t`: See `aws_iot_error.h`
  *
  * @note Generally, it is not necessary to call this function if @ref mqtt_autoreconnect
- * is enabled. This function may still be called to initiate a reconnect attempt when
- * auto-reconnect has exhausted all attempts.
+ * is enabled, it keeps retrying until the client is reconnected. To retry straight
+ * away when the network link is known to be back, use @ref mqtt_function_autoreconnect_link_up.
  */
 /* @[declare_mqtt_attempt_reconnect] */
 IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient);
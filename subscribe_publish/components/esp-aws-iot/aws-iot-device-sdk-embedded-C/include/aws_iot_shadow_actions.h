@@ -22,9 +22,10 @@ extern "C" {
 
 #include "aws_iot_shadow_interface.h"
 
-IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions_t action,
-										   const char *pJsonDocumentToBeSent, size_t jsonSize, fpActionCallback_t callback,
-										   void *pCallbackContext, uint32_t timeout_seconds, bool isSticky);
+IoT_Error_t aws_iot_shadow_internal_action(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										   ShadowActions_t action, const char *pJsonDocumentToBeSent, size_t jsonSize,
+										   fpActionCallback_t callback, void *pCallbackContext,
+										   uint32_t timeout_seconds, bool isSticky);
 
 #ifdef __cplusplus
 }
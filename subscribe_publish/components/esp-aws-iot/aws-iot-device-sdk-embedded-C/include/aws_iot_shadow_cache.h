@@ -0,0 +1,33 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef SRC_SHADOW_AWS_IOT_SHADOW_CACHE_H_
+#define SRC_SHADOW_AWS_IOT_SHADOW_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_shadow_interface.h"
+
+void initShadowCache(AWS_IoT_Shadow_Context *pShadow);
+void cacheShadowDocument(AWS_IoT_Shadow_Context *pShadow, const char *pDocument, size_t length, uint32_t version);
+void cacheShadowDelta(AWS_IoT_Shadow_Context *pShadow, const char *pDelta, size_t length, uint32_t version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_SHADOW_AWS_IOT_SHADOW_CACHE_H_ */
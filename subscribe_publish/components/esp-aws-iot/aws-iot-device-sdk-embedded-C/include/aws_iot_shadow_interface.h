@@ -38,6 +38,7 @@ extern "C" {
  *
  */
 #include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_json_utils.h"
 #include "aws_iot_shadow_json_data.h"
 
 /*!
@@ -73,6 +74,7 @@ typedef struct {
 	const char *pMqttClientId; ///< Currently the Shadow uses MQTT to connect and it is important to ensure we have unique client id
 	uint16_t mqttClientIdLen; ///< Currently the Shadow uses MQTT to connect and it is important to ensure we have unique client id
 	pApplicationHandler_t deleteActionHandler;	///< Callback to be invoked when Thing shadow for this device is deleted
+	bool enablePersistentAckSubscriptions; ///< Subscribe once at connect to the accepted/rejected topics of all actions on this Thing and keep them
 } ShadowConnectParameters_t;
 
 /*!
@@ -98,31 +100,38 @@ extern const ShadowConnectParameters_t ShadowConnectParametersDefault;
 *
 * This function will free up memory that was dynamically allocated for the client. 
 *
-* @param pClient MQTT Client that was previously created by calling aws_iot_shadow_init
+* @param pShadow Shadow client whose MQTT Client was previously initialized by calling aws_iot_shadow_init
 * @return An IoT Error Type defining successful/failed freeing
 */
-IoT_Error_t aws_iot_shadow_free(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_shadow_free(AWS_IoT_Shadow_Context *pShadow);
 
 /**
  * @brief Initialize the Thing Shadow before use
  *
  * This function takes care of initializing the internal book-keeping data structures and initializing the IoT client.
  *
+ * @param pShadow Shadow client to initialize
  * @param pClient A new MQTT Client to be used as the protocol layer. Will be initialized with pParams.
+ * @param pParams Shadow Initialization parameters like the host and TLS cert location
  * @return An IoT Error Type defining successful/failed Initialization
  */
-IoT_Error_t aws_iot_shadow_init(AWS_IoT_Client *pClient, const ShadowInitParameters_t *pParams);
+IoT_Error_t aws_iot_shadow_init(AWS_IoT_Shadow_Context *pShadow, AWS_IoT_Client *pClient,
+								const ShadowInitParameters_t *pParams);
 
 /**
  * @brief Connect to the AWS IoT Thing Shadow service over MQTT
  *
  * This function does the TLSv1.2 handshake and establishes the MQTT connection
  *
- * @param pClient	MQTT Client used as the protocol layer
+ * If \c enablePersistentAckSubscriptions is set, it also subscribes to $aws/things/{thingName}/shadow/+/accepted
+ * and $aws/things/{thingName}/shadow/+/rejected. Get, update and delete actions on this Thing then neither
+ * subscribe, wait nor un-subscribe, the request is a single publish and the response is routed by action.
+ *
+ * @param pShadow	Shadow client initialized with aws_iot_shadow_init
  * @param pParams	Shadow Conenction parameters like TLS cert location
  * @return An IoT Error Type defining successful/failed Connection
  */
-IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Client *pClient, const ShadowConnectParameters_t *pParams);
+IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Shadow_Context *pShadow, const ShadowConnectParameters_t *pParams);
 
 /**
  * @brief Yield function to let the background tasks of MQTT and Shadow
@@ -131,21 +140,21 @@ IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Client *pClient, const ShadowConnectP
  * It also ensures the expired requests of Shadow actions are cleared and Timeout callback is executed.
  * @note All callbacks ever used in the SDK will be executed in the context of this function.
  *
- * @param pClient	MQTT Client used as the protocol layer
+ * @param pShadow	Shadow client to yield to
  * @param timeout	in milliseconds, This is the maximum time the yield function will wait for a message and/or read the messages from the TLS buffer
  * @return An IoT Error Type defining successful/failed Yield
  */
-IoT_Error_t aws_iot_shadow_yield(AWS_IoT_Client *pClient, uint32_t timeout);
+IoT_Error_t aws_iot_shadow_yield(AWS_IoT_Shadow_Context *pShadow, uint32_t timeout);
 
 /**
  * @brief Disconnect from the AWS IoT Thing Shadow service over MQTT
  *
  * This will close the underlying TCP connection, MQTT connection will also be closed
  *
- * @param pClient	MQTT Client used as the protocol layer
+ * @param pShadow	Shadow client to disconnect
  * @return An IoT Error Type defining successful/failed disconnect status
  */
-IoT_Error_t aws_iot_shadow_disconnect(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_shadow_disconnect(AWS_IoT_Shadow_Context *pShadow);
 
 /**
  * @brief Thing Shadow Acknowledgment enum
@@ -154,7 +163,8 @@ IoT_Error_t aws_iot_shadow_disconnect(AWS_IoT_Client *pClient);
  *
  */
 typedef enum {
-	SHADOW_ACK_TIMEOUT, SHADOW_ACK_REJECTED, SHADOW_ACK_ACCEPTED
+	SHADOW_ACK_TIMEOUT, SHADOW_ACK_REJECTED, SHADOW_ACK_ACCEPTED,
+	SHADOW_ACK_CACHED ///< Document of the cache of aws_iot_shadow_get_cached(), may be older than the shadow
 } Shadow_Ack_Status_t;
 
 /**
@@ -176,13 +186,212 @@ typedef enum {
  * @param pThingName Thing Name of the response received
  * @param action The response of the action
  * @param status Informs if the action was Accepted/Rejected or Timed out
- * @param pReceivedJsonDocument Received JSON document
+ * @param pReceivedJsonDocument Received JSON document, null terminated. It points into the MQTT RX buffer and is only
+ * valid until the callback returns. NULL when the status is SHADOW_ACK_TIMEOUT
  * @param pContextData the void* data passed in during the action call(update, get or delete)
  *
  */
 typedef void (*fpActionCallback_t)(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
 								   const char *pReceivedJsonDocument, void *pContextData);
 
+#define MAX_TOPICS_AT_ANY_GIVEN_TIME 2*MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME
+
+/**
+ * @brief Accepted and rejected routes of the 3 actions, followed by those of the wildcard subscriptions
+ */
+#define SHADOW_ACK_ROUTE_COUNT 8
+
+/**
+ * @brief Response expected for a Shadow action that was published with a client token
+ *
+ * The records are kept in an open addressed table indexed by \c key, the sequence number of the client token.
+ */
+typedef struct {
+	char clientTokenID[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+	uint32_t key;
+	char thingName[MAX_SIZE_OF_THING_NAME];
+	ShadowActions_t action;
+	fpActionCallback_t callback;
+	void *pCallbackContext;
+	bool isFree;
+	Timer timer;
+} ToBeReceivedAckRecord_t;
+
+/**
+ * @brief Key registered on the delta topic with aws_iot_shadow_register_delta()
+ */
+typedef struct {
+	const char *pKey;
+	const char *pLeafKey;	///< Last segment of pKey when it is a path, pKey otherwise
+	size_t keyLen;	///< Length of pLeafKey
+	uint8_t pathDepth;	///< Number of segments of pKey
+	char pathSeparator;	///< '.' for dotted paths, '/' for JSON pointers
+	void *pStruct;
+	jsonStructCallback_t callback;
+	bool isFree;
+} JsonTokenTable_t;
+
+/**
+ * @brief Accepted or rejected topic subscribed to for Shadow action responses
+ */
+typedef struct {
+	char Topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	uint8_t count;
+	bool isFree;
+	bool isSticky;
+} SubscriptionRecord_t;
+
+/**
+ * @brief Number kept by ReportedFieldRecord_t
+ */
+typedef union {
+	int64_t integer;	///< Integer and boolean values
+	double floating;	///< Float and double values
+} ReportedFieldValue_t;
+
+/**
+ * @brief Reported field registered with aws_iot_shadow_register_reported() and its last reported value
+ *
+ * Numbers are kept as they are, strings and objects as a copy of their text. A text of MAX_SHADOW_REPORTED_TEXT_LENGTH
+ * bytes or more is not kept and is sent with every update.
+ */
+typedef struct {
+	jsonStruct_t *pStruct;	///< Field of the application
+	ReportedFieldValue_t lastValue;	///< Value accepted by the service
+	ReportedFieldValue_t pendingValue;	///< Value sent in the update waiting for its response
+	char lastText[MAX_SHADOW_REPORTED_TEXT_LENGTH];	///< String or object accepted by the service
+	char pendingText[MAX_SHADOW_REPORTED_TEXT_LENGTH];	///< String or object in the update waiting for its response
+	bool isPendingTextKept;	///< pendingText holds the whole string or object
+	bool isReported;	///< lastValue or lastText holds a value that was accepted
+	uint8_t update;	///< Index in reportedUpdates of the last update the field was sent in, or one of the states of shadow_records.c
+} ReportedFieldRecord_t;
+
+/**
+ * @brief Number of updates of aws_iot_shadow_update_changed() that can wait for their response at the same time
+ */
+#define SHADOW_REPORTED_UPDATE_COUNT 4
+
+/**
+ * @brief Update sent with aws_iot_shadow_update_changed(), passed as the context of its response callback
+ */
+typedef struct {
+	AWS_IoT_Shadow_Context *pShadow;	///< Shadow client that sent the update
+	fpActionCallback_t callback;	///< Callback of the caller, may be NULL
+	void *pContextData;	///< Context of the callback of the caller
+	bool isFree;
+} ShadowReportedUpdate_t;
+
+/**
+ * @brief Number of coalesced updates that can wait for their response at the same time
+ */
+#define SHADOW_COALESCED_BATCH_COUNT 4
+
+/**
+ * @brief Coalesced update sent with aws_iot_shadow_update_coalesced(), passed as the context of its response callback
+ */
+typedef struct {
+	AWS_IoT_Shadow_Context *pShadow;	///< Shadow client that sent the update
+	bool isFree;
+} ShadowCoalescedBatch_t;
+
+/**
+ * @brief Caller of aws_iot_shadow_update_coalesced() waiting for the response of the update its fields went out in
+ */
+typedef struct {
+	fpActionCallback_t callback;
+	void *pContextData;
+	uint8_t batch;	///< Index in coalescedBatches of the update that was sent, or one of the states of shadow_records.c
+} ShadowCoalescedCaller_t;
+
+/**
+ * @brief Handler data of an accepted/rejected subscription, classifies the responses received on it
+ */
+typedef struct {
+	AWS_IoT_Shadow_Context *pShadow;	///< Shadow client that subscribed
+	ShadowActions_t action;	///< Action of the topic, unused for the wildcard subscriptions
+	Shadow_Ack_Status_t status;	///< SHADOW_ACK_ACCEPTED or SHADOW_ACK_REJECTED
+	bool isAnyAction;	///< Subscription to the +/accepted or +/rejected wildcard, the action is read from the topic
+} ShadowAckRoute_t;
+
+/**
+ * @brief Header of the shadow document cache, kept at offset 0 of the store and followed by the cache buffer
+ */
+typedef struct {
+	uint32_t magic;	///< Identifies a header that was written by this version of the cache
+	char thingName[MAX_SIZE_OF_THING_NAME];	///< Thing the cached documents belong to
+	uint32_t documentVersion;	///< Version of the cached get/accepted document
+	uint32_t documentLength;	///< Length of the cached document, 0 when there is none
+	uint32_t deltaVersion;	///< Version of the cached delta, newer than the document
+	uint32_t deltaLength;	///< Length of the cached delta, 0 when there is none
+} ShadowCacheHeader_t;
+
+/**
+ * @brief Parser state for the Shadow JSON documents, passed to the JSON helpers as pJsonHandler
+ */
+typedef struct {
+	jsmn_parser parser;
+	jsmntok_t tokens[MAX_JSON_TOKEN_EXPECTED];
+} ShadowJsonHandler_t;
+
+/**
+ * @brief Shadow client instance
+ *
+ * Holds all the book-keeping of one Shadow client: the MQTT client it runs on, the Thing Name and client id given
+ * at connect, the pending acknowledgments, the response subscriptions, the delta keys and the receive buffer.
+ * Every aws_iot_shadow_* call takes the instance it acts on, so several instances can run side by side on their own
+ * MQTT clients and threads. A single instance is not thread safe and should be driven by one thread at a time.
+ *
+ * The struct is sized for the limits in aws_iot_config.h and is best given static storage.
+ */
+struct _ShadowContext {
+	AWS_IoT_Client *pMqttClient;	///< MQTT client used as the protocol layer, set by aws_iot_shadow_init()
+
+	char myThingName[MAX_SIZE_OF_THING_NAME];	///< Thing Name given at connect
+	char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];	///< MQTT client id given at connect, prefix of the client tokens
+	uint32_t clientTokenNum;	///< Sequence number of the next client token
+
+	ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];	///< Responses being waited for
+	uint8_t ackWaitListCount;	///< Number of records used in AckWaitList
+	SubscriptionRecord_t SubscriptionList[MAX_TOPICS_AT_ANY_GIVEN_TIME];	///< Response topics subscribed to
+	ShadowAckRoute_t ackRoutes[SHADOW_ACK_ROUTE_COUNT];	///< Handler data of the response subscriptions
+
+	char allAcceptedTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];	///< Wildcard accepted topic of the persistent ack subscriptions
+	char allRejectedTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];	///< Wildcard rejected topic of the persistent ack subscriptions
+	bool allActionAcksSubscribedFlag;	///< The persistent ack subscriptions are in place
+	char deleteAcceptedTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];	///< Topic of the delete action handler
+
+	char shadowDeltaTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];	///< Delta topic of the Thing given at connect
+	JsonTokenTable_t tokenTable[MAX_JSON_TOKEN_EXPECTED];	///< Keys registered on the delta topic
+	uint32_t tokenTableIndex;	///< Number of entries used in tokenTable
+	uint16_t deltaKeyOrder[MAX_JSON_TOKEN_EXPECTED];	///< Indices of tokenTable sorted by leaf key length, then leaf key
+	uint16_t deltaKeyPath[MAX_JSON_TOKEN_EXPECTED / 2];	///< Tokens of the keys enclosing the key being dispatched
+	bool deltaKeyDispatched[MAX_JSON_TOKEN_EXPECTED];	///< Entries of tokenTable already given a value by the current delta
+	bool deltaTopicSubscribedFlag;	///< The delta topic is subscribed to
+
+	ReportedFieldRecord_t reportedFields[MAX_SHADOW_REPORTED_FIELDS];	///< Fields tracked by aws_iot_shadow_update_changed
+	uint32_t reportedFieldsCount;	///< Number of entries used in reportedFields
+	ShadowReportedUpdate_t reportedUpdates[SHADOW_REPORTED_UPDATE_COUNT];	///< Updates of tracked fields waiting for their response
+
+	jsonStruct_t coalescedFields[MAX_SHADOW_COALESCED_FIELDS];	///< Fields of the coalesced update being collected, one per key
+	uint32_t coalescedFieldsCount;	///< Number of entries used in coalescedFields
+	ShadowCoalescedCaller_t coalescedCallers[MAX_SHADOW_COALESCED_CALLBACKS];	///< Callers waiting on coalesced updates
+	ShadowCoalescedBatch_t coalescedBatches[SHADOW_COALESCED_BATCH_COUNT];	///< Coalesced updates waiting for their response
+	uint8_t coalescedTimeoutSec;	///< Longest response timeout asked for by the callers of the update being collected
+	bool coalescedPersistentSubscribe;	///< A caller of the update being collected asked for persistent subscriptions
+	Timer coalesceTimer;	///< End of the window of the update being collected
+	char coalescedJsonDocument[AWS_IOT_MQTT_TX_BUF_LEN];	///< Document of the coalesced update being sent
+
+	IoT_Byte_Store cacheStore;	///< Persistent backing of the document cache, read and write are NULL when RAM only
+	char *pCacheBuffer;	///< Buffer of the document cache provided by the application, NULL while the cache is disabled
+	size_t cacheBufferSize;	///< Size of pCacheBuffer
+	ShadowCacheHeader_t cacheHeader;	///< Versions and lengths of the documents in pCacheBuffer
+
+	uint32_t shadowJsonVersionNum;	///< Last version received for the Thing given at connect
+	bool shadowDiscardOldDeltaFlag;	///< Ignore deltas whose version is not newer than shadowJsonVersionNum
+
+	ShadowJsonHandler_t jsonHandler;	///< Parser state used on the received documents, in place in the MQTT RX buffer
+};
+
 /**
  * @brief This function is the one used to perform an Update action to a Thing Name's Shadow.
  *
@@ -197,7 +406,9 @@ typedef void (*fpActionCallback_t)(const char *pThingName, ShadowActions_t actio
  * 4. In the \c aws_iot_shadow_yield() function the response will be handled. In case of timeout or if the response is received, the subscription to shadow response topics are un-subscribed from.
  *    On the contrary if the persistent subscription is set to true then the un-subscribe will not be done. The topics will always be listened to.
  *
- * @param pClient	MQTT Client used as the protocol layer
+ * Steps 1, 2 and the un-subscribe are skipped for the Thing Name given at connect when the persistent ack subscriptions are enabled.
+ *
+ * @param pShadow	Shadow client used to send the update and track the response
  * @param pThingName Thing Name of the shadow that needs to be Updated
  * @param pJsonString The update action expects a JSON document to send. The JSON String should be a null terminated string. This JSON document should adhere to the AWS IoT Thing Shadow specification. To help in the process of creating this document- SDK provides apis in \c aws_iot_shadow_json_data.h
  * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
@@ -206,7 +417,7 @@ typedef void (*fpActionCallback_t)(const char *pThingName, ShadowActions_t actio
  * @param isPersistentSubscribe As mentioned above, every  time if a device updates the same shadow then this should be set to true to avoid repeated subscription and unsubscription. If the Thing Name is one off update then this should be set to false
  * @return An IoT Error Type defining successful/failed update action
  */
-IoT_Error_t aws_iot_shadow_update(AWS_IoT_Client *pClient, const char *pThingName, char *pJsonString,
+IoT_Error_t aws_iot_shadow_update(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, char *pJsonString,
 								  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds,
 								  bool isPersistentSubscribe);
 
@@ -216,7 +427,7 @@ IoT_Error_t aws_iot_shadow_update(AWS_IoT_Client *pClient, const char *pThingNam
  * One use of this function is usually to get the config of a device at boot up.
  * It is similar to the Update function internally except it does not take a JSON document as the input. The entire JSON document will be sent over the accepted topic
  *
- * @param pClient	MQTT Client used as the protocol layer
+ * @param pShadow	Shadow client used to send the get and track the response
  * @param pThingName Thing Name of the JSON document that is needed
  * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
  * @param pContextData This is an extra parameter that could be passed along with the callback. It should be set to NULL if not used
@@ -224,7 +435,7 @@ IoT_Error_t aws_iot_shadow_update(AWS_IoT_Client *pClient, const char *pThingNam
  * @param isPersistentSubscribe As mentioned above, every  time if a device gets the same Sahdow (JSON document) then this should be set to true to avoid repeated subscription and un-subscription. If the Thing Name is one off get then this should be set to false
  * @return An IoT Error Type defining successful/failed get action
  */
-IoT_Error_t aws_iot_shadow_get(AWS_IoT_Client *pClient, const char *pThingName, fpActionCallback_t callback,
+IoT_Error_t aws_iot_shadow_get(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, fpActionCallback_t callback,
 							   void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscribe);
 
 /**
@@ -233,7 +444,7 @@ IoT_Error_t aws_iot_shadow_get(AWS_IoT_Client *pClient, const char *pThingName,
  * This is not a very common use case for  device. It is generally the responsibility of the accompanying app to do the delete.
  * It is similar to the Update function internally except it does not take a JSON document as the input. The Thing Shadow referred by the ThingName will be deleted.
  *
- * @param pClient MQTT Client used as the protocol layer
+ * @param pShadow Shadow client used to send the delete and track the response
  * @param pThingName Thing Name of the Shadow that should be deleted
  * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
  * @param pContextData This is an extra parameter that could be passed along with the callback. It should be set to NULL if not used
@@ -241,62 +452,192 @@ IoT_Error_t aws_iot_shadow_get(AWS_IoT_Client *pClient, const char *pThingName,
  * @param isPersistentSubscribe As mentioned above, every  time if a device deletes the same Shadow (JSON document) then this should be set to true to avoid repeated subscription and un-subscription. If the Thing Name is one off delete then this should be set to false
  * @return An IoT Error Type defining successful/failed delete action
  */
-IoT_Error_t aws_iot_shadow_delete(AWS_IoT_Client *pClient, const char *pThingName, fpActionCallback_t callback,
+IoT_Error_t aws_iot_shadow_delete(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, fpActionCallback_t callback,
 								  void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscriptions);
 
 /**
- * @brief This function is used to listen on the delta topic of #AWS_IOT_MY_THING_NAME mentioned in the aws_iot_config.h file.
+ * @brief This function is used to listen on the delta topic of the Thing Name given to aws_iot_shadow_connect().
  *
  * Any time a delta is published the Json document will be delivered to the pStruct->cb. If you don't want the parsing done by the SDK then use the jsonStruct_t key set to "state". A good example of this is displayed in the sample_apps/shadow_console_echo.c
  *
- * @param pClient MQTT Client used as the protocol layer
+ * The key may also be a path to a nested value, either dotted ("config.radio.txPower") or a JSON pointer
+ * ("/config/radio/txPower", without ~0/~1 escapes). Like a single key, a path matches at any depth of the delta, so
+ * it does not have to start at "state". All paths are resolved in one walk over the delta that is already parsed.
+ *
+ * The delta is parsed in place in the MQTT RX buffer, the value given to pStruct->cb points into it and is only valid
+ * until the callback returns. An action that has to subscribe reads into that buffer, so it should not be started
+ * from the callback unless its subscriptions are persistent.
+ *
+ * @param pShadow Shadow client listening on the delta topic
  * @param pStruct The struct used to parse JSON value
  * @return An IoT Error Type defining successful/failed delta registering
  */
-IoT_Error_t aws_iot_shadow_register_delta(AWS_IoT_Client *pClient, jsonStruct_t *pStruct);
+IoT_Error_t aws_iot_shadow_register_delta(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct);
+
+/**
+ * @brief Track a reported field, so that aws_iot_shadow_update_changed() only sends it when its value changed
+ *
+ * The jsonStruct_t and the data it points to must stay valid while the Shadow client is used.
+ *
+ * @param pShadow Shadow client tracking the field
+ * @param pStruct Key, type and data of the field
+ * @return An IoT Error Type, FAILURE when MAX_SHADOW_REPORTED_FIELDS fields are already tracked
+ */
+IoT_Error_t aws_iot_shadow_register_reported(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct);
+
+/**
+ * @brief Update the reported state with the tracked fields whose value changed since they were last sent
+ *
+ * The document is built in pJsonDocument and published like aws_iot_shadow_update(). The values sent become the last
+ * reported ones when the update is accepted, a field stays changed while its update waits for its response and after
+ * it was rejected or timed out. forceFullReport resends every field, for example to resynchronize the whole reported
+ * state after a reconnect.
+ *
+ * @param pShadow Shadow client tracking the fields
+ * @param pThingName Thing Name of the shadow that needs to be Updated
+ * @param pJsonDocument Buffer in which the update document is built
+ * @param maxSizeOfJsonDocument Size of pJsonDocument
+ * @param floatEpsilon Float and double fields that moved by this much or less are not sent
+ * @param forceFullReport Send every tracked field, changed or not
+ * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
+ * @param pContextData This is an extra parameter that could be passed along with the callback. It should be set to NULL if not used
+ * @param timeout_seconds It is the time the SDK will wait for the response on either accepted/rejected before declaring timeout on the action
+ * @param isPersistentSubscribe As in aws_iot_shadow_update()
+ * @return An IoT Error Type, SHADOW_NO_CHANGED_FIELDS when nothing changed and nothing was published, FAILURE when
+ * SHADOW_REPORTED_UPDATE_COUNT updates already wait for their response
+ */
+IoT_Error_t aws_iot_shadow_update_changed(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										  char *pJsonDocument, size_t maxSizeOfJsonDocument, double floatEpsilon,
+										  bool forceFullReport, fpActionCallback_t callback, void *pContextData,
+										  uint8_t timeout_seconds, bool isPersistentSubscribe);
+
+/**
+ * @brief Merge field changes into a single update of the reported state of the Thing given at connect
+ *
+ * Instead of publishing right away, the fields are collected for SHADOW_COALESCE_WINDOW_MS from the first change.
+ * A field given again replaces the earlier one with the same key, so the last writer wins. The update is sent from
+ * aws_iot_shadow_yield() once the window ends, or right away when MAX_SHADOW_COALESCED_FIELDS distinct fields or
+ * MAX_SHADOW_COALESCED_CALLBACKS waiting callers would be exceeded. Each caller's callback is then invoked with the
+ * response of the update its fields went out in, or with SHADOW_ACK_TIMEOUT when that update could not be published.
+ * Fields whose document does not fit in AWS_IOT_MQTT_TX_BUF_LEN are not sent and stay collected, a later change of
+ * the same keys replaces them.
+ *
+ * The values are read when the update is built, so the data the jsonStruct_t entries point to must stay valid until
+ * then. The jsonStruct_t entries themselves are copied.
+ *
+ * @param pShadow Shadow client collecting the update
+ * @param pFields Fields to report
+ * @param fieldCount Number of entries in pFields
+ * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
+ * @param pContextData This is an extra parameter that could be passed along with the callback. It should be set to NULL if not used
+ * @param timeout_seconds It is the time the SDK will wait for the response on either accepted/rejected before declaring timeout on the action. The update waits for the longest time asked for by its callers
+ * @param isPersistentSubscribe As in aws_iot_shadow_update()
+ * @return An IoT Error Type, FAILURE when the fields or the callback do not fit even after sending the update being
+ * collected, SHADOW_JSON_BUFFER_TRUNCATED when that update had to be sent but its document does not fit
+ */
+IoT_Error_t aws_iot_shadow_update_coalesced(AWS_IoT_Shadow_Context *pShadow, const jsonStruct_t *pFields,
+											uint32_t fieldCount, fpActionCallback_t callback, void *pContextData,
+											uint8_t timeout_seconds, bool isPersistentSubscribe);
+
+/**
+ * @brief Send the coalesced update being collected without waiting for the end of its window
+ *
+ * @param pShadow Shadow client collecting the update
+ * @return An IoT Error Type defining successful/failed update action, SUCCESS when there was nothing to send,
+ * SHADOW_JSON_BUFFER_TRUNCATED when the document does not fit and the fields stay collected
+ */
+IoT_Error_t aws_iot_shadow_flush_coalesced(AWS_IoT_Shadow_Context *pShadow);
+
+/**
+ * @brief Keep the last shadow document of the Thing given at connect, in RAM and optionally in a persistent store
+ *
+ * The cache holds the last document received on get/accepted and the last delta received after it. Both are written
+ * to the store as they arrive, a delta replaces the previous one since every delta carries the complete difference.
+ * A cache found in the store is loaded here, so this is usually called after aws_iot_shadow_init() on every boot.
+ *
+ * The buffer holds both documents and their terminating null bytes, SHADOW_MAX_SIZE_OF_RX_BUFFER * 2 always fits.
+ * A document that does not fit is not cached.
+ *
+ * @param pShadow Shadow client whose documents are cached
+ * @param pStore Persistent backing of the cache, NULL to keep it in RAM only. The struct is copied
+ * @param pCacheBuffer Buffer of the cache, must stay valid while the Shadow client is used
+ * @param cacheBufferSize Size of pCacheBuffer
+ * @return An IoT Error Type defining successful/failed operation. An empty or unreadable store is not an error
+ */
+IoT_Error_t aws_iot_shadow_enable_cache(AWS_IoT_Shadow_Context *pShadow, const IoT_Byte_Store *pStore,
+										char *pCacheBuffer, size_t cacheBufferSize);
+
+/**
+ * @brief Get the shadow document of the Thing given at connect, answering first from the cache
+ *
+ * When the cache holds a document of this Thing and no response or delta with a newer version than the cache has
+ * been received, the callback is invoked before this function returns with SHADOW_ACK_CACHED and the cached
+ * document, and a delta cached after the document is applied to the keys registered with
+ * aws_iot_shadow_register_delta(). The last received version is set to the version of the cache, so deltas that
+ * are not newer are discarded.
+ *
+ * The cache may have been written long before, for example before a reboot, so the document is always fetched as
+ * well, like aws_iot_shadow_get(). The callback is invoked a second time with the response, which refreshes the
+ * cache.
+ *
+ * @param pShadow Shadow client with a cache enabled by aws_iot_shadow_enable_cache()
+ * @param callback This is the callback that will be used to inform the caller of the response from the AWS IoT Shadow service.Callback could be set to NULL if response is not important
+ * @param pContextData This is an extra parameter that could be passed along with the callback. It should be set to NULL if not used
+ * @param timeout_seconds It is the time the SDK will wait for the response on either accepted/rejected before declaring timeout on the action
+ * @param isPersistentSubscribe As in aws_iot_shadow_get()
+ * @return An IoT Error Type defining successful/failed get action
+ */
+IoT_Error_t aws_iot_shadow_get_cached(AWS_IoT_Shadow_Context *pShadow, fpActionCallback_t callback,
+									  void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscribe);
 
 /**
  * @brief Reset the last received version number to zero.
  * This will be useful if the Thing Shadow is deleted and would like to to reset the local version
+ * @param pShadow Shadow client tracking the version
  * @return no return values
  *
  */
-void aws_iot_shadow_reset_last_received_version(void);
+void aws_iot_shadow_reset_last_received_version(AWS_IoT_Shadow_Context *pShadow);
 
 /**
- * @brief Version of a document is received with every accepted/rejected and the SDK keeps track of the last received version of the JSON document of #AWS_IOT_MY_THING_NAME shadow
+ * @brief Version of a document is received with every accepted/rejected and the SDK keeps track of the last received version of the JSON document of the shadow of the Thing Name given at connect
  *
  * One exception to this version tracking is that, the SDK will ignore the version from update/accepted topic. Rest of the responses will be scanned to update the version number.
  * Accepting version change for update/accepted may cause version conflicts for delta message if the update message is received before the delta.
  *
+ * @param pShadow Shadow client tracking the version
  * @return version number of the last received response
  *
  */
-uint32_t aws_iot_shadow_get_last_received_version(void);
+uint32_t aws_iot_shadow_get_last_received_version(AWS_IoT_Shadow_Context *pShadow);
 
 /**
  * @brief Enable the ignoring of delta messages with old version number
  *
  * As we use MQTT underneath, there could be more than 1 of the same message if we use QoS 0. To avoid getting called for the same message, this functionality should be enabled. All the old message will be ignored
+ *
+ * @param pShadow Shadow client receiving the delta messages
  */
-void aws_iot_shadow_enable_discard_old_delta_msgs(void);
+void aws_iot_shadow_enable_discard_old_delta_msgs(AWS_IoT_Shadow_Context *pShadow);
 
 /**
  * @brief Disable the ignoring of delta messages with old version number
+ *
+ * @param pShadow Shadow client receiving the delta messages
  */
-void aws_iot_shadow_disable_discard_old_delta_msgs(void);
+void aws_iot_shadow_disable_discard_old_delta_msgs(AWS_IoT_Shadow_Context *pShadow);
 
 /**
  * @brief This function is used to enable or disable autoreconnect
  *
  * Any time a disconnect happens the underlying MQTT client attempts to reconnect if this is set to true
  *
- * @param pClient MQTT Client used as the protocol layer
+ * @param pShadow Shadow client whose MQTT Client should reconnect
  * @param newStatus The new status to set the autoreconnect option to
  *
  * @return An IoT Error Type defining successful/failed operation
  */
-IoT_Error_t aws_iot_shadow_set_autoreconnect_status(AWS_IoT_Client *pClient, bool newStatus);
+IoT_Error_t aws_iot_shadow_set_autoreconnect_status(AWS_IoT_Shadow_Context *pShadow, bool newStatus);
 
 #ifdef __cplusplus
 }
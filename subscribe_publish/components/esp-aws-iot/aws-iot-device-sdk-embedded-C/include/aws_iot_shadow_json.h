@@ -31,16 +31,27 @@ bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJson
 bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
 									 jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition);
 
-IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize);
+int32_t nextJsonKeyIndex(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, int32_t index);
 
-IoT_Error_t aws_iot_shadow_internal_delete_request_json(char *pBuffer, size_t bufferSize);
+void updateValueOfJsonKey(const char *pJsonDocument, void *pJsonHandler, int32_t keyIndex, jsonStruct_t *pDataStruct,
+						  uint32_t *pDataLength, int32_t *pDataPosition);
 
-void resetClientTokenSequenceNum(void);
+IoT_Error_t aws_iot_shadow_internal_get_request_json(AWS_IoT_Shadow_Context *pShadow, char *pBuffer,
+													 size_t bufferSize);
 
+IoT_Error_t aws_iot_shadow_internal_delete_request_json(AWS_IoT_Shadow_Context *pShadow, char *pBuffer,
+														size_t bufferSize);
 
-bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize);
+void resetClientTokenSequenceNum(AWS_IoT_Shadow_Context *pShadow);
 
-bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtractedClientToken, size_t clientTokenSize);
+
+bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler);
+
+bool extractClientToken(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, char *pExtractedClientToken,
+						size_t clientTokenSize);
+
+bool extractParsedClientToken(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
+							  char *pExtractedClientToken, size_t clientTokenSize);
 
 bool extractVersionNumber(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, uint32_t *pVersionNumber);
 
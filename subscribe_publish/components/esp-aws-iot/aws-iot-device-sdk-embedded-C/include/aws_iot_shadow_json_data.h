@@ -33,6 +33,11 @@ extern "C" {
  */
 typedef struct jsonStruct jsonStruct_t;
 
+/**
+ * @brief Shadow client instance, defined in \c aws_iot_shadow_interface.h
+ */
+typedef struct _ShadowContext AWS_IoT_Shadow_Context;
+
 /**
  * @brief Every JSON name value can have a callback. The callback should follow this signature
  */
@@ -124,24 +129,93 @@ IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJson
  * @note Ensure the size of the Buffer is enough to hold the entire JSON Document. If the finalized section is not invoked then the JSON doucment will not be valid
  *
  *
+ * @param pShadow Shadow client whose client id and sequence number make up the client token
  * @param pJsonDocument The JSON Document filled in this char buffer
  * @param maxSizeOfJsonDocument maximum size of the pJsonDocument that can be used to fill the JSON document
  * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
  */
-IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument);
+IoT_Error_t aws_iot_finalize_json_document(AWS_IoT_Shadow_Context *pShadow, char *pJsonDocument,
+										   size_t maxSizeOfJsonDocument);
 
 /**
  * @brief Fill the given buffer with client token for tracking the Repsonse.
  *
- * This function will add the AWS_IOT_MQTT_CLIENT_ID with a sequence number. Every time this function is used the sequence number gets incremented
+ * This function will add the MQTT client id given at connect with a sequence number. Every time this function is used the sequence number of pShadow gets incremented
  *
  *
+ * @param pShadow Shadow client whose client id and sequence number make up the client token
  * @param pBufferToBeUpdatedWithClientToken buffer to be updated with the client token string
  * @param maxSizeOfJsonDocument maximum size of the pBufferToBeUpdatedWithClientToken that can be used
  * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
  */
 
-IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument);
+IoT_Error_t aws_iot_fill_with_client_token(AWS_IoT_Shadow_Context *pShadow, char *pBufferToBeUpdatedWithClientToken,
+										   size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Cursor over a JSON document being built
+ *
+ * The writer remembers where the document ends, so appending a value does not measure the document again. As with
+ * aws_iot_shadow_add_reported, every value is followed by a comma that the closing brace replaces, the document is
+ * kept null terminated and can be passed to aws_iot_finalize_json_document at any point.
+ * The first error is kept and makes the later calls return it without writing.
+ */
+typedef struct {
+	char *pBuffer;	///< JSON document being built
+	size_t size;	///< Size of pBuffer
+	size_t length;	///< Length of the document, where the next value is written
+	IoT_Error_t error;	///< First error met while writing
+} ShadowJsonWriter_t;
+
+/**
+ * @brief Start a JSON document with the writer, same as aws_iot_shadow_init_json_document
+ *
+ * @param pWriter Writer to set up
+ * @param pJsonDocument The JSON Document filled in this char buffer
+ * @param maxSizeOfJsonDocument maximum size of the pJsonDocument that can be used to fill the JSON document
+ * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_writer_init(ShadowJsonWriter_t *pWriter, char *pJsonDocument,
+											size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Continue a null terminated JSON document with the writer, measuring it once
+ *
+ * @param pWriter Writer to set up
+ * @param pJsonDocument The JSON Document built so far
+ * @param maxSizeOfJsonDocument maximum size of the pJsonDocument that can be used to fill the JSON document
+ * @return An IoT Error Type defining if the buffer was null or already full
+ */
+IoT_Error_t aws_iot_shadow_json_writer_resume(ShadowJsonWriter_t *pWriter, char *pJsonDocument,
+											  size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Open a section of the state, "reported" or "desired"
+ *
+ * @param pWriter Writer of the document
+ * @param pSectionName Name of the section
+ * @return An IoT Error Type defining if the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_writer_begin_section(ShadowJsonWriter_t *pWriter, const char *pSectionName);
+
+/**
+ * @brief Add the key and the value of a jsonStruct_t to the open section
+ *
+ * Integers are formatted without snprintf, floats and doubles with the fewest digits that read back as the same value.
+ *
+ * @param pWriter Writer of the document
+ * @param pStruct Key and value to add
+ * @return An IoT Error Type defining if the key or value was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_writer_add(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct);
+
+/**
+ * @brief Close the section opened by aws_iot_shadow_json_writer_begin_section
+ *
+ * @param pWriter Writer of the document
+ * @return An IoT Error Type defining if the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_writer_end_section(ShadowJsonWriter_t *pWriter);
 
 #ifdef __cplusplus
 }
@@ -25,28 +25,42 @@ extern "C" {
 #include "aws_iot_shadow_interface.h"
 #include "aws_iot_config.h"
 
+void initializeRecords(AWS_IoT_Shadow_Context *pShadow);
+void restartRecords(AWS_IoT_Shadow_Context *pShadow);
+bool isSubscriptionPresent(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action);
+IoT_Error_t subscribeToShadowActionAcks(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										ShadowActions_t action, bool isSticky);
+IoT_Error_t subscribeToAllShadowActionAcks(AWS_IoT_Shadow_Context *pShadow);
+bool isAllShadowActionAcksSubscribed(AWS_IoT_Shadow_Context *pShadow, const char *pThingName);
+void incrementSubscriptionCnt(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
+							  bool isSticky);
 
-extern uint32_t shadowJsonVersionNum;
-extern bool shadowDiscardOldDeltaFlag;
-
-extern char myThingName[MAX_SIZE_OF_THING_NAME];
-extern uint16_t myThingNameLen;
-extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
-extern uint16_t mqttClientIDLen;
-
-void initializeRecords(AWS_IoT_Client *pClient);
-bool isSubscriptionPresent(const char *pThingName, ShadowActions_t action);
-IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t action, bool isSticky);
-void incrementSubscriptionCnt(const char *pThingName, ShadowActions_t action, bool isSticky);
-
-IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action, const char *pJsonDocumentToBeSent);
-void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
+IoT_Error_t publishToShadowAction(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
+								  const char *pJsonDocumentToBeSent);
+bool addToAckWaitList(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
 					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
 					  uint32_t timeout_seconds);
-bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex);
-void HandleExpiredResponseCallbacks(void);
-void initDeltaTokens(void);
-IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct);
+bool isAckWaitListFull(AWS_IoT_Shadow_Context *pShadow);
+void HandleExpiredResponseCallbacks(AWS_IoT_Shadow_Context *pShadow);
+void initDeltaTokens(AWS_IoT_Shadow_Context *pShadow);
+IoT_Error_t registerJsonTokenOnDelta(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct);
+void initReportedFields(AWS_IoT_Shadow_Context *pShadow);
+IoT_Error_t registerReportedField(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct);
+IoT_Error_t startReportedUpdate(AWS_IoT_Shadow_Context *pShadow, fpActionCallback_t callback, void *pContextData,
+								ShadowReportedUpdate_t **ppUpdate);
+uint32_t addChangedReportedFields(ShadowReportedUpdate_t *pUpdate, ShadowJsonWriter_t *pWriter, double floatEpsilon,
+								  bool forceFullReport);
+void cancelReportedUpdate(ShadowReportedUpdate_t *pUpdate);
+void reportedUpdateCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							const char *pReceivedJsonDocument, void *pContextData);
+void dispatchShadowDelta(AWS_IoT_Shadow_Context *pShadow, const char *pJsonDocument, int32_t tokenCount);
+void initCoalescedUpdates(AWS_IoT_Shadow_Context *pShadow);
+IoT_Error_t addCoalescedFields(AWS_IoT_Shadow_Context *pShadow, const jsonStruct_t *pFields, uint32_t fieldCount,
+							   fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds,
+							   bool isPersistentSubscribe);
+IoT_Error_t startCoalescedBatch(AWS_IoT_Shadow_Context *pShadow, ShadowCoalescedBatch_t **ppBatch);
+void coalescedUpdateCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							 const char *pReceivedJsonDocument, void *pContextData);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file byte_store_interface.h
+ * @brief Persistent byte store interface definition
+ *
+ * Defines the store behind the features which keep their state across a reboot: the MQTT offline publish queue
+ * and the shadow document cache. Each mirrors its buffer into the store at fixed offsets, so any medium which can
+ * rewrite a byte range in place can be used: a file, a wear levelled flash partition or a file on one.
+ * Starting point for porting these features to the storage of a new platform.
+ */
+
+#ifndef __BYTE_STORE_INTERFACE_H_
+#define __BYTE_STORE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "aws_iot_error.h"
+
+/**
+ * @brief Byte Store
+ *
+ * The users of a store write the data they cover before the header that makes it valid, and check that header
+ * when they read the store back. Bytes that were never written may read as anything.
+ */
+typedef struct {
+	IoT_Error_t (*read)(void *pStoreData, size_t offset, unsigned char *pBuffer, size_t len); ///< Read len bytes at offset
+	IoT_Error_t (*write)(void *pStoreData, size_t offset, const unsigned char *pBuffer, size_t len); ///< Durably write len bytes at offset, in the order of the calls
+	void *pStoreData; ///< Context passed to the store functions
+} IoT_Byte_Store;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BYTE_STORE_INTERFACE_H_
@@ -55,8 +55,21 @@ typedef struct {
 	uint16_t DestinationPort;            ///< Integer defining the connection port of the MQTT service.
 	uint32_t timeout_ms;                ///< Unsigned integer defining the TLS handshake timeout value in milliseconds.
 	bool ServerVerificationFlag;        ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
+	const int *pCipherSuites;            ///< Zero terminated list of IANA cipher suite numbers offered in order of preference, NULL for the TLS library defaults. Not copied, must stay valid while the Network is in use.
+	const uint16_t *pCurves;            ///< Zero terminated list of IANA named curve numbers (e.g. 23 for P-256, 29 for X25519) in order of preference, NULL for the TLS library defaults.
 } TLSConnectParams;
 
+/**
+ * @brief Network Write Segment
+ *
+ * Defines a type describing one contiguous region of a gathered write.
+ * The data is not copied, it must stay valid until the write returns.
+ */
+typedef struct {
+	const unsigned char *pData;    ///< Pointer to the first byte of the segment
+	size_t len;                    ///< Number of bytes in the segment
+} IoT_Network_Segment;
+
 /**
  * @brief Network Structure
  *
@@ -67,6 +80,9 @@ struct Network {
 
 	IoT_Error_t (*read)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to read from the network
 	IoT_Error_t (*write)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write to the network
+	IoT_Error_t (*writev)(Network *, const IoT_Network_Segment *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write several segments to the network, may be NULL
+	IoT_Error_t (*waitForData)(Network *, Timer *);    ///< Function pointer pointing to the network function to block until data can be read, may be NULL
+	IoT_Error_t (*wakeup)(Network *);    ///< Function pointer pointing to the network function to interrupt a pending waitForData, may be NULL
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
 	IoT_Error_t (*destroy)(Network *);        ///< Function pointer pointing to the network function to destroy the network object
@@ -91,6 +107,10 @@ struct Network {
  * @param timeout_ms - The value to use for timeout of operation
  * @param ServerVerificationFlag - used to decide whether server verification is needed or not
  *
+ * Nothing already in the Network is read, it may hold any value. Each iot_tls_init is paired
+ * with an iot_tls_free: a Network initialized before must be released with iot_tls_free before
+ * it is initialized again, or what the first initialization kept is leaked.
+ *
  * @return IoT_Error_t - successful initialization or TLS error
  */
 IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
@@ -120,6 +140,22 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *TLSParams);
  */
 IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Write several segments to the network socket
+ *
+ * Sends the segments in order as one stream of bytes, without staging them in an
+ * intermediate buffer. Used by the MQTT client to send a serialized PUBLISH header
+ * followed by an application payload too large for its TX buffer.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @param IoT_Network_Segment pointer - array of segments to write to socket
+ * @param size_t - number of segments in the array
+ * @param Timer * - operation timer
+ * @param size_t - pointer to store the total number of bytes written
+ * @return IoT_Error_t - successful write or TLS error code
+ */
+IoT_Error_t iot_tls_writev(Network *, const IoT_Network_Segment *, size_t, Timer *, size_t *);
+
 /**
  * @brief Read bytes from the network socket
  *
@@ -132,6 +168,31 @@ IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *)
  */
 IoT_Error_t iot_tls_read(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Wait until data can be read from the network socket
+ *
+ * Blocks the calling thread without polling until the socket becomes readable,
+ * the timer expires or iot_tls_wakeup is called. Data already decrypted and
+ * buffered by the TLS layer counts as readable.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @param Timer * - time allowed for the wait
+ * @return IoT_Error_t - SUCCESS if data can be read, NETWORK_SSL_NOTHING_TO_READ if the timer expired,
+ *                       NETWORK_WAIT_INTERRUPTED on a wakeup request or TLS error code
+ */
+IoT_Error_t iot_tls_wait_for_data(Network *, Timer *);
+
+/**
+ * @brief Interrupt a pending wait for data
+ *
+ * Makes the current or the next call to iot_tls_wait_for_data return NETWORK_WAIT_INTERRUPTED.
+ * May be called from any thread.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @return IoT_Error_t - successful wakeup or error code
+ */
+IoT_Error_t iot_tls_wakeup(Network *);
+
 /**
  * @brief Disconnect from network socket
  *
@@ -150,6 +211,18 @@ IoT_Error_t iot_tls_disconnect(Network *pNetwork);
  */
 IoT_Error_t iot_tls_destroy(Network *pNetwork);
 
+/**
+ * @brief Release the TLS layer
+ *
+ * Called once the Network is not going to connect again, after iot_tls_destroy. Releases what
+ * iot_tls_init set up and what is kept across reconnects, the parsed credentials included.
+ * The Network needs iot_tls_init before it is used again.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface
+ * @return IoT_Error_t - successful cleanup or TLS error code
+ */
+IoT_Error_t iot_tls_free(Network *pNetwork);
+
 /**
  * @brief Check if TLS layer is still connected
  *
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file byte_store_file.c
+ * @brief Linux file backed byte store, for the MQTT offline publish queue and the shadow document cache.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "byte_store_file.h"
+
+static IoT_Error_t _byte_store_file_read(void *pStoreData, size_t offset, unsigned char *pBuffer, size_t len) {
+	ByteStoreFile *pFile = (ByteStoreFile *) pStoreData;
+	ssize_t ret;
+
+	while(len > 0U) {
+		ret = pread(pFile->fd, pBuffer, len, (off_t) offset);
+		if(0 > ret && EINTR == errno) {
+			continue;
+		}
+		if(0 > ret) {
+			return FAILURE;
+		}
+		/* Nothing was ever written past the end of the file, its users check the header covering those bytes */
+		if(0 == ret) {
+			memset(pBuffer, 0, len);
+			break;
+		}
+		pBuffer += ret;
+		offset += (size_t) ret;
+		len -= (size_t) ret;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _byte_store_file_write(void *pStoreData, size_t offset, const unsigned char *pBuffer,
+											 size_t len) {
+	ByteStoreFile *pFile = (ByteStoreFile *) pStoreData;
+	ssize_t ret;
+
+	while(len > 0U) {
+		ret = pwrite(pFile->fd, pBuffer, len, (off_t) offset);
+		if(0 > ret && EINTR == errno) {
+			continue;
+		}
+		if(0 >= ret) {
+			return FAILURE;
+		}
+		pBuffer += ret;
+		offset += (size_t) ret;
+		len -= (size_t) ret;
+	}
+
+	/* The users of the store write their data before the header which makes it valid,
+	 * each write has to reach the disk in that order */
+	if(0 != fdatasync(pFile->fd)) {
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t byte_store_file_open(ByteStoreFile *pFile, const char *pPath, IoT_Byte_Store *pStore) {
+	if(NULL == pFile || NULL == pPath || NULL == pStore) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pFile->fd = open(pPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if(0 > pFile->fd) {
+		return FAILURE;
+	}
+
+	pStore->read = _byte_store_file_read;
+	pStore->write = _byte_store_file_write;
+	pStore->pStoreData = pFile;
+
+	return SUCCESS;
+}
+
+IoT_Error_t byte_store_file_close(ByteStoreFile *pFile) {
+	int ret;
+
+	if(NULL == pFile) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(0 > pFile->fd) {
+		return SUCCESS;
+	}
+
+	ret = close(pFile->fd);
+	pFile->fd = -1;
+
+	return (0 == ret) ? SUCCESS : FAILURE;
+}
+
+#ifdef __cplusplus
+}
+#endif
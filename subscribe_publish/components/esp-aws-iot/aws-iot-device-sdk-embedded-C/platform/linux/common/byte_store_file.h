@@ -0,0 +1,65 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_BYTE_STORE_FILE_H_
+#define SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_BYTE_STORE_FILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file byte_store_file.h
+ * @brief File backed byte store, for the MQTT offline publish queue and the shadow document cache
+ */
+#include "byte_store_interface.h"
+
+/**
+ * definition of the file store. Platform specific
+ */
+typedef struct {
+	int fd; ///< Descriptor of the backing file, -1 when closed
+} ByteStoreFile;
+
+/**
+ * @brief Open (or create) the file backing a byte store
+ *
+ * Fills pStore with functions reading and writing the file, to be passed
+ * to aws_iot_mqtt_offline_queue_init or aws_iot_shadow_enable_cache. Every
+ * write is flushed to the disk before it returns. Bytes past the end of the
+ * file read as zero.
+ *
+ * @param pFile File store to open
+ * @param pPath Path of the backing file
+ * @param pStore Store to fill
+ *
+ * @return IoT_Error_t - SUCCESS or FAILURE if the file cannot be opened
+ */
+IoT_Error_t byte_store_file_open(ByteStoreFile *pFile, const char *pPath, IoT_Byte_Store *pStore);
+
+/**
+ * @brief Close the file backing a byte store
+ *
+ * @param pFile File store to close
+ *
+ * @return IoT_Error_t - SUCCESS or FAILURE
+ */
+IoT_Error_t byte_store_file_close(ByteStoreFile *pFile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_BYTE_STORE_FILE_H_ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_CONNECT_H_
+#define SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_CONNECT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file network_connect.h
+ * @brief TCP connect with a cache of resolved addresses
+ */
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "aws_iot_error.h"
+#include "timer_platform.h"
+
+#define NETWORK_CONNECT_MAX_ADDRESSES 4 ///< Addresses of a host kept in the cache, the others returned by the resolver are not tried
+
+/**
+ * @brief One resolved address, including the port
+ */
+typedef struct {
+	struct sockaddr_storage address;
+	socklen_t addressLength;
+} NetworkAddress;
+
+/**
+ * @brief Addresses resolved for one host and port
+ *
+ * Kept by the caller across connects, so a reconnect does not wait for the resolver.
+ */
+typedef struct {
+	const char *pHost; ///< Host the addresses were resolved for, NULL while the cache is empty
+	uint16_t port; ///< Port the addresses were resolved for
+	NetworkAddress addresses[NETWORK_CONNECT_MAX_ADDRESSES]; ///< Resolved addresses, alternating between address families
+	uint8_t addressCount; ///< Number of valid entries in addresses
+	uint8_t preferredIndex; ///< Address the last connection was made to, tried first
+	Timer expiry; ///< The host is resolved again once it expires
+} NetworkAddressCache;
+
+/**
+ * @brief Empty an address cache
+ *
+ * Must be called before the first network_connect with the cache.
+ *
+ * @param pCache Cache to empty
+ */
+void network_address_cache_init(NetworkAddressCache *pCache);
+
+/**
+ * @brief Open a TCP connection to a host
+ *
+ * The host is resolved when the cache does not hold its addresses or they are older than
+ * AWS_IOT_NET_DNS_CACHE_LIFETIME_SEC. The cache is matched on the pHost pointer, the string
+ * must not be changed in place between connects. Expired addresses are still used when the
+ * resolver fails.
+ *
+ * The address of the last connection is tried first. Each further address is tried when the
+ * previous attempts have failed or AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS after the last one
+ * was started, so an unreachable address does not hold up the others. The first attempt to
+ * complete is kept and the others are closed. The cache is emptied when no address accepts
+ * the connection.
+ *
+ * @param pCache Cache of the addresses of pHost
+ * @param pHost Host name or numeric address to connect to
+ * @param port Port to connect to
+ * @param timeout_ms Time allowed for the connection, not including the name resolution
+ * @param pFd Set to the connected socket, in blocking mode
+ *
+ * @return IoT_Error_t - SUCCESS, NETWORK_ERR_NET_UNKNOWN_HOST, NETWORK_ERR_NET_SOCKET_FAILED
+ *                       or NETWORK_ERR_NET_CONNECT_FAILED
+ */
+IoT_Error_t network_connect(NetworkAddressCache *pCache, const char *pHost, uint16_t port, uint32_t timeout_ms,
+							int *pFd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_CONNECT_H_ */
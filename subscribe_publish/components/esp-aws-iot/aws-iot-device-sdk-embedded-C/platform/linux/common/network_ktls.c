@@ -0,0 +1,263 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file network_ktls.c
+ * @brief Linux kernel TLS record layer offload.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/tls.h>
+
+#include "aws_iot_log.h"
+#include "network_ktls.h"
+
+/* Older C libraries do not know about kernel TLS */
+#ifndef SOL_TLS
+	#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+	#define TCP_ULP 31
+#endif
+
+#define NETWORK_KTLS_RECORD_ALERT 21
+#define NETWORK_KTLS_RECORD_APPLICATION_DATA 23
+
+/* Segments handed to one sendmsg, longer lists are sent in several calls */
+#define NETWORK_KTLS_SEND_BATCH 8
+
+IoT_Error_t network_ktls_attach(int fd) {
+	if(0 != setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+		IOT_DEBUG("Kernel TLS is not available, errno %d\n", errno);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t network_ktls_set_key(int fd, bool isTransmit, NetworkKtlsCipher cipher, const unsigned char *pKey,
+								 const unsigned char *pSalt, const unsigned char *pSequence) {
+	struct tls12_crypto_info_aes_gcm_128 info128;
+	struct tls12_crypto_info_aes_gcm_256 info256;
+	const void *pInfo;
+	socklen_t infoLength;
+	int ret;
+
+	if(NULL == pKey || NULL == pSalt || NULL == pSequence) {
+		return NULL_VALUE_ERROR;
+	}
+
+	/* TLS 1.2 GCM uses the record sequence number as the explicit part of the nonce, like mbedTLS does */
+	if(NETWORK_KTLS_AES_128_GCM == cipher) {
+		memset(&info128, 0, sizeof(info128));
+		info128.info.version = TLS_1_2_VERSION;
+		info128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+		memcpy(info128.key, pKey, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+		memcpy(info128.salt, pSalt, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+		memcpy(info128.iv, pSequence, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+		memcpy(info128.rec_seq, pSequence, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+		pInfo = &info128;
+		infoLength = sizeof(info128);
+	} else {
+		memset(&info256, 0, sizeof(info256));
+		info256.info.version = TLS_1_2_VERSION;
+		info256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+		memcpy(info256.key, pKey, TLS_CIPHER_AES_GCM_256_KEY_SIZE);
+		memcpy(info256.salt, pSalt, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+		memcpy(info256.iv, pSequence, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+		memcpy(info256.rec_seq, pSequence, TLS_CIPHER_AES_GCM_256_REC_SEQ_SIZE);
+		pInfo = &info256;
+		infoLength = sizeof(info256);
+	}
+
+	ret = setsockopt(fd, SOL_TLS, isTransmit ? TLS_TX : TLS_RX, pInfo, infoLength);
+
+	/* The key is copied by the kernel, do not leave it on the stack */
+	memset(&info128, 0, sizeof(info128));
+	memset(&info256, 0, sizeof(info256));
+
+	if(0 != ret) {
+		IOT_DEBUG("Kernel TLS refused the %s key, errno %d\n", isTransmit ? "transmit" : "receive", errno);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t network_ktls_send(int fd, const struct iovec *pSegments, size_t segmentCount, uint32_t timeout_ms,
+							  size_t *pSentLen) {
+	struct iovec batch[NETWORK_KTLS_SEND_BATCH];
+	struct msghdr msg;
+	struct pollfd pfd;
+	size_t index = 0, offset = 0, count, itr;
+	size_t sent;
+	ssize_t ret;
+
+	*pSentLen = 0;
+
+	while(index < segmentCount) {
+		count = 0;
+		for(itr = index; itr < segmentCount && count < NETWORK_KTLS_SEND_BATCH; itr++) {
+			batch[count].iov_base = (char *) pSegments[itr].iov_base + (itr == index ? offset : 0);
+			batch[count].iov_len = pSegments[itr].iov_len - (itr == index ? offset : 0);
+			count++;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = batch;
+		msg.msg_iovlen = count;
+		ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+		if(0 > ret) {
+			if(EINTR == errno) {
+				continue;
+			}
+			if(EAGAIN != errno && EWOULDBLOCK != errno) {
+				IOT_ERROR(" failed\n  ! sendmsg returned errno %d\n\n", errno);
+				return NETWORK_SSL_WRITE_ERROR;
+			}
+
+			pfd.fd = fd;
+			pfd.events = POLLOUT;
+			pfd.revents = 0;
+			ret = poll(&pfd, 1, (int) timeout_ms);
+			if(0 == ret) {
+				return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+			}
+			if(0 > ret && EINTR != errno) {
+				return NETWORK_SSL_WRITE_ERROR;
+			}
+			continue;
+		}
+
+		/* Move past what was accepted, a segment may have been sent in part */
+		sent = (size_t) ret;
+		*pSentLen += sent;
+		while(index < segmentCount && sent >= pSegments[index].iov_len - offset) {
+			sent -= pSegments[index].iov_len - offset;
+			index++;
+			offset = 0;
+		}
+		offset += sent;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t network_ktls_send_alert(int fd, uint8_t level, uint8_t description) {
+	unsigned char alert[2];
+	char control[CMSG_SPACE(sizeof(unsigned char))];
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *pCmsg;
+
+	alert[0] = level;
+	alert[1] = description;
+	iov.iov_base = alert;
+	iov.iov_len = sizeof(alert);
+
+	memset(&msg, 0, sizeof(msg));
+	memset(control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	pCmsg = CMSG_FIRSTHDR(&msg);
+	pCmsg->cmsg_level = SOL_TLS;
+	pCmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	pCmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+	*CMSG_DATA(pCmsg) = NETWORK_KTLS_RECORD_ALERT;
+	msg.msg_controllen = pCmsg->cmsg_len;
+
+	if((ssize_t) sizeof(alert) != sendmsg(fd, &msg, MSG_NOSIGNAL)) {
+		return NETWORK_SSL_WRITE_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t network_ktls_recv(int fd, unsigned char *pBuffer, size_t len, uint32_t timeout_ms, size_t *pReadLen) {
+	char control[CMSG_SPACE(sizeof(unsigned char))];
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *pCmsg;
+	struct pollfd pfd;
+	ssize_t ret;
+
+	*pReadLen = 0;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	ret = poll(&pfd, 1, (int) timeout_ms);
+	if(0 == ret || (0 > ret && EINTR == errno)) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+	if(0 > ret) {
+		IOT_ERROR(" failed\n  ! poll returned errno %d\n\n", errno);
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	iov.iov_base = pBuffer;
+	iov.iov_len = len;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ret = recvmsg(fd, &msg, MSG_DONTWAIT);
+	if(0 > ret) {
+		if(EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno) {
+			return NETWORK_SSL_NOTHING_TO_READ;
+		}
+		/* Includes records that fail to decrypt */
+		IOT_ERROR(" failed\n  ! recvmsg returned errno %d\n\n", errno);
+		return NETWORK_SSL_READ_ERROR;
+	}
+	if(0 == ret) {
+		IOT_DEBUG("Connection closed by the server\n");
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	/* Records other than application data come with their type, there is no handshake left to
+	 * process so only an alert is expected, and both close_notify and errors end the connection */
+	pCmsg = CMSG_FIRSTHDR(&msg);
+	if(NULL != pCmsg && SOL_TLS == pCmsg->cmsg_level && TLS_GET_RECORD_TYPE == pCmsg->cmsg_type &&
+	   NETWORK_KTLS_RECORD_APPLICATION_DATA != *CMSG_DATA(pCmsg)) {
+		if(NETWORK_KTLS_RECORD_ALERT == *CMSG_DATA(pCmsg) && 2 <= ret) {
+			IOT_DEBUG("Received TLS alert %u/%u\n", pBuffer[0], pBuffer[1]);
+		} else {
+			IOT_ERROR("Unexpected TLS record of type %u\n", *CMSG_DATA(pCmsg));
+		}
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	*pReadLen = (size_t) ret;
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_KTLS_H_
+#define SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_KTLS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file network_ktls.h
+ * @brief TLS 1.2 record layer offload to the Linux kernel
+ *
+ * Once a TLS library has completed the handshake on a TCP socket, its traffic keys can be
+ * handed to kernel TLS. Records are then encrypted by send and decrypted by recv, without
+ * copying the data through the TLS library.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "aws_iot_error.h"
+
+#define NETWORK_KTLS_KEY_MAX_LEN 32 ///< Longest write key, AES-256
+#define NETWORK_KTLS_SALT_LEN 4 ///< Implicit part of the AES-GCM nonce, the client or server write IV of the key block
+#define NETWORK_KTLS_SEQUENCE_LEN 8 ///< Length of a TLS record sequence number
+
+#define NETWORK_KTLS_ALERT_LEVEL_WARNING 1 ///< Alert level of close_notify
+#define NETWORK_KTLS_ALERT_CLOSE_NOTIFY 0 ///< Alert sent before closing the connection
+
+/**
+ * @brief Ciphers the kernel can take over
+ */
+typedef enum {
+	NETWORK_KTLS_AES_128_GCM, ///< 16 byte key
+	NETWORK_KTLS_AES_256_GCM ///< 32 byte key
+} NetworkKtlsCipher;
+
+/**
+ * @brief Attach kernel TLS to a connected socket
+ *
+ * The socket keeps working as plain TCP until keys are installed with network_ktls_set_key.
+ *
+ * @param fd Connected TCP socket
+ *
+ * @return IoT_Error_t - SUCCESS, or FAILURE when the kernel does not support TLS
+ */
+IoT_Error_t network_ktls_attach(int fd);
+
+/**
+ * @brief Install the traffic keys of one direction of a TLS 1.2 connection
+ *
+ * Records of that direction are handled by the kernel from then on, starting with the record
+ * numbered pSequence. A failed transmit key leaves the socket as it was, so the TLS library
+ * can go on handling the records.
+ *
+ * @param fd Socket kernel TLS was attached to
+ * @param isTransmit Whether the key protects the records sent, otherwise those received
+ * @param cipher Cipher of the negotiated cipher suite
+ * @param pKey Write key of the sending side, 16 or 32 bytes depending on cipher
+ * @param pSalt Write IV of the sending side, NETWORK_KTLS_SALT_LEN bytes
+ * @param pSequence Sequence number of the next record, NETWORK_KTLS_SEQUENCE_LEN bytes, big endian
+ *
+ * @return IoT_Error_t - SUCCESS, NULL_VALUE_ERROR, or FAILURE when the kernel refuses the key
+ */
+IoT_Error_t network_ktls_set_key(int fd, bool isTransmit, NetworkKtlsCipher cipher, const unsigned char *pKey,
+								 const unsigned char *pSalt, const unsigned char *pSequence);
+
+/**
+ * @brief Send application data
+ *
+ * The segments are gathered into records by the kernel. Waits for the socket to accept
+ * more data when it is non-blocking.
+ *
+ * @param fd Socket with a transmit key installed
+ * @param pSegments Data to send
+ * @param segmentCount Number of entries in pSegments
+ * @param timeout_ms Longest time to wait without any data being accepted
+ * @param pSentLen Set to the number of bytes sent, also on error
+ *
+ * @return IoT_Error_t - SUCCESS, NETWORK_SSL_WRITE_TIMEOUT_ERROR or NETWORK_SSL_WRITE_ERROR
+ */
+IoT_Error_t network_ktls_send(int fd, const struct iovec *pSegments, size_t segmentCount, uint32_t timeout_ms,
+							  size_t *pSentLen);
+
+/**
+ * @brief Send an alert record
+ *
+ * @param fd Socket with a transmit key installed
+ * @param level Alert level
+ * @param description Alert description
+ *
+ * @return IoT_Error_t - SUCCESS or NETWORK_SSL_WRITE_ERROR
+ */
+IoT_Error_t network_ktls_send_alert(int fd, uint8_t level, uint8_t description);
+
+/**
+ * @brief Receive application data
+ *
+ * Waits up to timeout_ms for a record, then returns what it holds, up to len bytes. Any
+ * record other than application data, such as an alert, ends the connection.
+ *
+ * @param fd Socket with a receive key installed
+ * @param pBuffer Buffer for the data
+ * @param len Size of pBuffer
+ * @param timeout_ms Longest time to wait for a record
+ * @param pReadLen Set to the number of bytes received
+ *
+ * @return IoT_Error_t - SUCCESS, NETWORK_SSL_NOTHING_TO_READ when nothing arrived in time,
+ *                       or NETWORK_SSL_READ_ERROR when the connection is closed or broken
+ */
+IoT_Error_t network_ktls_recv(int fd, unsigned char *pBuffer, size_t len, uint32_t timeout_ms, size_t *pReadLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_PROTOCOL_MQTT_AWS_IOT_EMBEDDED_CLIENT_WRAPPER_PLATFORM_LINUX_COMMON_NETWORK_KTLS_H_ */
@@ -19,6 +19,12 @@ extern "C" {
 
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include "aws_iot_config.h"
 
 #include <timer_platform.h>
@@ -29,6 +35,8 @@ extern "C" {
 #include "network_interface.h"
 #include "network_platform.h"
 
+#include "mbedtls/platform_util.h"
+
 
 /* This is the value used for ssl read timeout */
 #ifndef IOT_SSL_READ_TIMEOUT_MS
@@ -49,6 +57,14 @@ extern "C" {
 	#define IOT_SSL_READ_RETRY_TIMEOUT_MS 10
 #endif
 
+/* Whether connects hand the record layer to kernel TLS, see iot_tls_set_kernel_offload */
+#ifndef IOT_SSL_KERNEL_OFFLOAD
+	#define IOT_SSL_KERNEL_OFFLOAD false
+#endif
+
+/* Segments of iot_tls_writev handed to the kernel in one call when the records are offloaded */
+#define IOT_SSL_KERNEL_WRITEV_BATCH 4
+
 /* This defines the value of the debug buffer that gets allocated.
  * The value can be altered based on memory constraints
  */
@@ -78,6 +94,376 @@ static int _iot_tls_verify_cert(void *data, mbedtls_x509_crt *crt, int depth, ui
 	return 0;
 }
 
+static uint64_t _iot_tls_now_us(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+}
+
+/*
+ * Releases the session kept for resumption, the next connect performs a full handshake
+ */
+static void _iot_tls_discard_session(TLSDataParams *tlsDataParams) {
+	if(tlsDataParams->has_saved_session) {
+		mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+		tlsDataParams->has_saved_session = false;
+	}
+}
+
+/*
+ * Counts the handshake that just completed and keeps its session for the next connect.
+ */
+static void _iot_tls_save_session(TLSDataParams *tlsDataParams) {
+	int ret;
+
+	if(tlsDataParams->handshakeProfile.resumed) {
+		tlsDataParams->resumed_handshake_count++;
+		IOT_DEBUG("  . TLS session resumed\n");
+	} else {
+		tlsDataParams->full_handshake_count++;
+	}
+
+	_iot_tls_discard_session(tlsDataParams);
+	if((ret = mbedtls_ssl_get_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) != 0) {
+		IOT_DEBUG("  . mbedtls_ssl_get_session returned -0x%x, the next connect performs a full handshake\n", -ret);
+		mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+		return;
+	}
+	tlsDataParams->has_saved_session = true;
+}
+
+#if defined(MBEDTLS_SSL_EXPORT_KEYS)
+/*
+ * Keeps the key block derived by the handshake, for the write keys to be handed to kernel TLS.
+ * GCM suites have no MAC key and a 4 byte implicit nonce, the cipher itself is checked once
+ * the handshake is over
+ */
+static int _iot_tls_export_keys(void *p_expkey, const unsigned char *ms, const unsigned char *kb, size_t maclen,
+								size_t keylen, size_t ivlen) {
+	TLSDataParams *tlsDataParams = (TLSDataParams *) p_expkey;
+	((void) ms);
+
+	tlsDataParams->ktls_key_len = 0;
+	if(0 == maclen && NETWORK_KTLS_SALT_LEN == ivlen && NETWORK_KTLS_KEY_MAX_LEN >= keylen) {
+		memcpy(tlsDataParams->ktls_key_block, kb, 2 * keylen + 2 * ivlen);
+		tlsDataParams->ktls_key_len = keylen;
+	}
+
+	return 0;
+}
+#endif
+
+/*
+ * Installed as the send callback of mbedTLS once the kernel encrypts the records, anything
+ * mbedTLS would still send (an alert from mbedtls_ssl_read) would get the wrong sequence number
+ */
+static int _iot_tls_refuse_send(void *ctx, const unsigned char *buf, size_t len) {
+	((void) ctx);
+	((void) buf);
+	((void) len);
+
+	return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+/*
+ * Hands the records of a completed handshake to kernel TLS when the cipher suite and the
+ * kernel allow it, otherwise mbedTLS goes on handling them
+ */
+static void _iot_tls_install_kernel_keys(TLSDataParams *tlsDataParams) {
+	const mbedtls_ssl_ciphersuite_t *pSuite;
+	const unsigned char *pKeyBlock = tlsDataParams->ktls_key_block;
+	size_t keyLen = tlsDataParams->ktls_key_len;
+	NetworkKtlsCipher cipher;
+	int fd = tlsDataParams->server_fd.fd;
+
+	pSuite = mbedtls_ssl_ciphersuite_from_id(tlsDataParams->ssl.session->ciphersuite);
+	if(0 == keyLen || NULL == pSuite || MBEDTLS_SSL_MINOR_VERSION_3 != tlsDataParams->ssl.minor_ver) {
+		IOT_DEBUG("  . %s is not offloaded to kernel TLS\n", mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
+		return;
+	}
+	if(MBEDTLS_CIPHER_AES_128_GCM == pSuite->cipher && 16 == keyLen) {
+		cipher = NETWORK_KTLS_AES_128_GCM;
+	} else if(MBEDTLS_CIPHER_AES_256_GCM == pSuite->cipher && 32 == keyLen) {
+		cipher = NETWORK_KTLS_AES_256_GCM;
+	} else {
+		IOT_DEBUG("  . %s is not offloaded to kernel TLS\n", mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
+		return;
+	}
+
+	if(SUCCESS != network_ktls_attach(fd)) {
+		return;
+	}
+
+	/* The key block holds the client then the server write key, followed by their write IVs */
+	if(SUCCESS != network_ktls_set_key(fd, true, cipher, pKeyBlock, pKeyBlock + 2 * keyLen,
+									   tlsDataParams->ssl.cur_out_ctr)) {
+		return;
+	}
+	tlsDataParams->ktls_tx = true;
+	mbedtls_ssl_set_bio(&(tlsDataParams->ssl), &(tlsDataParams->server_fd), _iot_tls_refuse_send, NULL,
+						mbedtls_net_recv_timeout);
+
+	/* Records mbedTLS already read from the socket could not be handed over, it keeps receiving then */
+	if(0 == mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) && !mbedtls_ssl_check_pending(&(tlsDataParams->ssl))
+	   && SUCCESS == network_ktls_set_key(fd, false, cipher, pKeyBlock + keyLen,
+										  pKeyBlock + 2 * keyLen + NETWORK_KTLS_SALT_LEN, tlsDataParams->ssl.in_ctr)) {
+		tlsDataParams->ktls_rx = true;
+	}
+
+	IOT_DEBUG("  . Records offloaded to kernel TLS, sending%s\n", tlsDataParams->ktls_rx ? " and receiving" : "");
+}
+
+/*
+ * Seeds the random generator and parses the files recorded in pCredentials.
+ */
+static IoT_Error_t _iot_tls_parse_credentials(TLSCredentials *pCredentials) {
+	int ret = 0;
+	const char *pers = "aws_iot_tls_wrapper";
+
+	IOT_DEBUG("\n  . Seeding the random number generator...");
+	if((ret = mbedtls_ctr_drbg_seed(&(pCredentials->ctr_drbg), mbedtls_entropy_func, &(pCredentials->entropy),
+									(const unsigned char *) pers, strlen(pers))) != 0) {
+		IOT_ERROR(" failed\n  ! mbedtls_ctr_drbg_seed returned -0x%x\n", -ret);
+		return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+	}
+
+	IOT_DEBUG("  . Loading the CA root certificate ...");
+	ret = mbedtls_x509_crt_parse_file(&(pCredentials->cacert), pCredentials->pRootCALocation);
+	if(ret < 0) {
+		IOT_ERROR(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing root cert\n\n", -ret);
+		return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+	}
+	IOT_DEBUG(" ok (%d skipped)\n", ret);
+
+	IOT_DEBUG("  . Loading the client cert. and key...");
+	ret = mbedtls_x509_crt_parse_file(&(pCredentials->clicert), pCredentials->pDeviceCertLocation);
+	if(ret != 0) {
+		IOT_ERROR(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing device cert\n\n", -ret);
+		return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
+	}
+
+	ret = mbedtls_pk_parse_keyfile(&(pCredentials->pkey), pCredentials->pDevicePrivateKeyLocation, "");
+	if(ret != 0) {
+		IOT_ERROR(" failed\n  !  mbedtls_pk_parse_key returned -0x%x while parsing private key\n\n", -ret);
+		IOT_DEBUG(" path : %s ", pCredentials->pDevicePrivateKeyLocation);
+		return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
+	}
+	IOT_DEBUG(" ok\n");
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_load_credentials(TLSCredentials *pCredentials, const char *pRootCALocation,
+									 const char *pDeviceCertLocation, const char *pDevicePrivateKeyLocation) {
+	IoT_Error_t rc;
+
+	if(NULL == pCredentials || NULL == pRootCALocation || NULL == pDeviceCertLocation
+	   || NULL == pDevicePrivateKeyLocation) {
+		return NULL_VALUE_ERROR;
+	}
+
+	mbedtls_entropy_init(&(pCredentials->entropy));
+	mbedtls_ctr_drbg_init(&(pCredentials->ctr_drbg));
+	mbedtls_x509_crt_init(&(pCredentials->cacert));
+	mbedtls_x509_crt_init(&(pCredentials->clicert));
+	mbedtls_pk_init(&(pCredentials->pkey));
+	pCredentials->pRootCALocation = pRootCALocation;
+	pCredentials->pDeviceCertLocation = pDeviceCertLocation;
+	pCredentials->pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+
+	rc = _iot_tls_parse_credentials(pCredentials);
+	if(SUCCESS != rc) {
+		iot_tls_free_credentials(pCredentials);
+	}
+
+	return rc;
+}
+
+void iot_tls_free_credentials(TLSCredentials *pCredentials) {
+	if(NULL == pCredentials || NULL == pCredentials->pRootCALocation) {
+		return;
+	}
+
+	mbedtls_x509_crt_free(&(pCredentials->clicert));
+	mbedtls_x509_crt_free(&(pCredentials->cacert));
+	mbedtls_pk_free(&(pCredentials->pkey));
+	mbedtls_ctr_drbg_free(&(pCredentials->ctr_drbg));
+	mbedtls_entropy_free(&(pCredentials->entropy));
+	pCredentials->pRootCALocation = NULL;
+}
+
+IoT_Error_t iot_tls_set_credentials(Network *pNetwork, TLSCredentials *pCredentials) {
+	if(NULL == pNetwork || (NULL != pCredentials && NULL == pCredentials->pRootCALocation)) {
+		return NULL_VALUE_ERROR;
+	}
+
+	iot_tls_free_credentials(&(pNetwork->tlsDataParams.ownCredentials));
+	pNetwork->tlsDataParams.pCredentials = (NULL != pCredentials) ? pCredentials
+																   : &(pNetwork->tlsDataParams.ownCredentials);
+
+	return SUCCESS;
+}
+
+/*
+ * Loads the credentials named by the connect parameters, unless shared credentials are set
+ * or the same files were already loaded by a previous connect.
+ */
+static IoT_Error_t _iot_tls_load_own_credentials(Network *pNetwork) {
+	TLSCredentials *pOwn = &(pNetwork->tlsDataParams.ownCredentials);
+	TLSConnectParams *pParams = &(pNetwork->tlsConnectParams);
+
+	if(pOwn != pNetwork->tlsDataParams.pCredentials) {
+		return SUCCESS;
+	}
+
+	if(NULL != pOwn->pRootCALocation) {
+		if(pOwn->pRootCALocation == pParams->pRootCALocation
+		   && pOwn->pDeviceCertLocation == pParams->pDeviceCertLocation
+		   && pOwn->pDevicePrivateKeyLocation == pParams->pDevicePrivateKeyLocation) {
+			IOT_DEBUG("  . Reusing the parsed certificates and key\n");
+			return SUCCESS;
+		}
+		iot_tls_free_credentials(pOwn);
+	}
+
+	return iot_tls_load_credentials(pOwn, pParams->pRootCALocation, pParams->pDeviceCertLocation,
+									pParams->pDevicePrivateKeyLocation);
+}
+
+IoT_Error_t iot_tls_set_kernel_offload(Network *pNetwork, bool enable) {
+	if(NULL == pNetwork) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pNetwork->tlsDataParams.kernel_offload = enable;
+
+	return SUCCESS;
+}
+
+/*
+ * Restricts and orders the cipher suites and curves the handshake offers, as set in the connect parameters
+ */
+static IoT_Error_t _iot_tls_conf_policy(Network *pNetwork) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	const int *pSuite = pNetwork->tlsConnectParams.pCipherSuites;
+	const uint16_t *pCurve = pNetwork->tlsConnectParams.pCurves;
+	bool hasSuite = false;
+#if defined(MBEDTLS_ECP_C)
+	const mbedtls_ecp_curve_info *pCurveInfo;
+	size_t curveCount = 0;
+#endif
+
+	if(NULL != pSuite) {
+		/* mbedTLS leaves the suites it does not know out of the ClientHello */
+		for(; 0 != *pSuite; pSuite++) {
+			if(NULL != mbedtls_ssl_ciphersuite_from_id(*pSuite)) {
+				hasSuite = true;
+			} else {
+				IOT_WARN("Cipher suite 0x%04x is not supported by mbedTLS", *pSuite);
+			}
+		}
+		if(!hasSuite) {
+			IOT_ERROR(" failed\n  ! None of the cipher suites of the connect parameters is supported\n\n");
+			return SSL_CONNECTION_ERROR;
+		}
+		mbedtls_ssl_conf_ciphersuites(&(tlsDataParams->conf), pNetwork->tlsConnectParams.pCipherSuites);
+	}
+
+	if(NULL != pCurve) {
+#if defined(MBEDTLS_ECP_C)
+		/* The list also limits the curves accepted for ECDSA keys in the server certificate chain */
+		for(; 0 != *pCurve && curveCount < MBEDTLS_ECP_DP_MAX - 1; pCurve++) {
+			if(NULL != (pCurveInfo = mbedtls_ecp_curve_info_from_tls_id(*pCurve))) {
+				tlsDataParams->curve_list[curveCount++] = pCurveInfo->grp_id;
+			} else {
+				IOT_WARN("Curve %u is not supported by mbedTLS", *pCurve);
+			}
+		}
+		if(0 == curveCount) {
+			IOT_ERROR(" failed\n  ! None of the curves of the connect parameters is supported\n\n");
+			return SSL_CONNECTION_ERROR;
+		}
+		tlsDataParams->curve_list[curveCount] = MBEDTLS_ECP_DP_NONE;
+		mbedtls_ssl_conf_curves(&(tlsDataParams->conf), tlsDataParams->curve_list);
+#else
+		IOT_WARN("mbedTLS is built without MBEDTLS_ECP_C, the curves of the connect parameters are ignored");
+#endif
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_net_connect(Network *pNetwork) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	uint64_t start;
+	IoT_Error_t rc;
+
+	/* A connect starts a new profile, including the one retried without the saved session */
+	memset(&(tlsDataParams->handshakeProfile), 0, sizeof(tlsDataParams->handshakeProfile));
+
+	IOT_DEBUG("  . Connecting to %s/%d...", pNetwork->tlsConnectParams.pDestinationURL,
+			  pNetwork->tlsConnectParams.DestinationPort);
+	/* Resolves through the address cache and races the addresses, the socket comes back blocking */
+	start = _iot_tls_now_us();
+	rc = network_connect(&(tlsDataParams->addressCache), pNetwork->tlsConnectParams.pDestinationURL,
+						 pNetwork->tlsConnectParams.DestinationPort, pNetwork->tlsConnectParams.timeout_ms,
+						 &(tlsDataParams->server_fd.fd));
+	tlsDataParams->handshakeProfile.connect_us = (uint32_t) (_iot_tls_now_us() - start);
+	if(SUCCESS != rc) {
+		IOT_ERROR(" failed\n  ! network_connect returned %d\n\n", rc);
+		return rc;
+	} IOT_DEBUG(" ok\n");
+
+	return SUCCESS;
+}
+
+/*
+ * Runs the handshake one state at a time, as mbedtls_ssl_handshake does, timing each state for the profile
+ */
+static int _iot_tls_handshake(TLSDataParams *tlsDataParams) {
+	TLSHandshakeProfile *pProfile = &(tlsDataParams->handshakeProfile);
+	uint64_t start, stepStart, now;
+	int state;
+	int ret;
+
+	IOT_DEBUG("  . Performing the SSL/TLS handshake...");
+	start = _iot_tls_now_us();
+	/* The server skips its certificate only when it resumes the offered session, with TLS 1.2 and 1.3 alike */
+	pProfile->resumed = true;
+	while(MBEDTLS_SSL_HANDSHAKE_OVER != tlsDataParams->ssl.state) {
+		state = tlsDataParams->ssl.state;
+		if(MBEDTLS_SSL_SERVER_CERTIFICATE == state) {
+			pProfile->resumed = false;
+		}
+		stepStart = _iot_tls_now_us();
+		ret = mbedtls_ssl_handshake_step(&(tlsDataParams->ssl));
+		now = _iot_tls_now_us();
+		if(0 <= state && TLS_HANDSHAKE_STEP_COUNT > state) {
+			pProfile->step_us[state] += (uint32_t) (now - stepStart);
+		}
+		pProfile->handshake_us = (uint32_t) (now - start);
+		if(0 != ret && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+			IOT_ERROR(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret);
+			if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
+				IOT_ERROR("    Unable to verify the server's certificate. "
+							  "Either it is invalid,\n"
+							  "    or you didn't set ca_file or ca_path "
+							  "to an appropriate value.\n"
+							  "    Alternatively, you may want to use "
+							  "auth_mode=optional for testing purposes.\n");
+			}
+			return ret;
+		}
+	}
+
+	IOT_DEBUG(" ok\n    [ Handshake took %u us: server certificate %u, server key exchange %u, "
+			  "client key exchange %u, certificate verify %u ]\n", pProfile->handshake_us,
+			  pProfile->step_us[MBEDTLS_SSL_SERVER_CERTIFICATE], pProfile->step_us[MBEDTLS_SSL_SERVER_KEY_EXCHANGE],
+			  pProfile->step_us[MBEDTLS_SSL_CLIENT_KEY_EXCHANGE], pProfile->step_us[MBEDTLS_SSL_CERTIFICATE_VERIFY]);
+
+	return 0;
+}
+
 void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
 								 char *pDevicePrivateKeyLocation, char *pDestinationURL,
 								 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
@@ -95,16 +481,46 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
 	_iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
 								pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
+	pNetwork->tlsConnectParams.pCipherSuites = NULL;
+	pNetwork->tlsConnectParams.pCurves = NULL;
 
 	pNetwork->connect = iot_tls_connect;
 	pNetwork->read = iot_tls_read;
 	pNetwork->write = iot_tls_write;
+	pNetwork->writev = iot_tls_writev;
+	pNetwork->waitForData = iot_tls_wait_for_data;
+	pNetwork->wakeup = iot_tls_wakeup;
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
 	pNetwork->destroy = iot_tls_destroy;
 
 	pNetwork->tlsDataParams.flags = 0;
 
+	/* Loaded on the first connect */
+	pNetwork->tlsDataParams.ownCredentials.pRootCALocation = NULL;
+	pNetwork->tlsDataParams.pCredentials = &(pNetwork->tlsDataParams.ownCredentials);
+
+	network_address_cache_init(&(pNetwork->tlsDataParams.addressCache));
+
+	mbedtls_ssl_session_init(&(pNetwork->tlsDataParams.saved_session));
+	pNetwork->tlsDataParams.has_saved_session = false;
+	pNetwork->tlsDataParams.full_handshake_count = 0;
+	pNetwork->tlsDataParams.resumed_handshake_count = 0;
+
+	pNetwork->tlsDataParams.kernel_offload = IOT_SSL_KERNEL_OFFLOAD;
+	pNetwork->tlsDataParams.ktls_tx = false;
+	pNetwork->tlsDataParams.ktls_rx = false;
+	pNetwork->tlsDataParams.ktls_key_len = 0;
+	memset(&(pNetwork->tlsDataParams.handshakeProfile), 0, sizeof(pNetwork->tlsDataParams.handshakeProfile));
+
+	/* The wakeup descriptor outlives reconnects, so it is created here rather than in
+	 * iot_tls_connect, and closed by iot_tls_free. Without it waits still work but cannot
+	 * be interrupted */
+	pNetwork->tlsDataParams.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(0 > pNetwork->tlsDataParams.wakeup_fd) {
+		IOT_WARN("Unable to create the yield wakeup descriptor, errno %d", errno);
+	}
+
 	return SUCCESS;
 }
 
@@ -115,9 +531,9 @@ IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
 
 IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	int ret = 0;
-	const char *pers = "aws_iot_tls_wrapper";
 	TLSDataParams *tlsDataParams = NULL;
-	char portBuffer[6];
+	TLSCredentials *pCredentials = NULL;
+	bool sessionOffered = false;
 	char vrfy_buf[512];
 	const char *alpnProtocols[] = { "x-amzn-mqtt-ca", NULL };
 
@@ -129,73 +545,33 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 		return NULL_VALUE_ERROR;
 	}
 
+	tlsDataParams = &(pNetwork->tlsDataParams);
+
 	if(NULL != params) {
 		_iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
 									params->pDevicePrivateKeyLocation, params->pDestinationURL,
 									params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+		pNetwork->tlsConnectParams.pCipherSuites = params->pCipherSuites;
+		pNetwork->tlsConnectParams.pCurves = params->pCurves;
+		/* The saved session belongs to the previous server */
+		_iot_tls_discard_session(tlsDataParams);
 	}
 
-	tlsDataParams = &(pNetwork->tlsDataParams);
-
+	tlsDataParams->ktls_tx = false;
+	tlsDataParams->ktls_rx = false;
 	mbedtls_net_init(&(tlsDataParams->server_fd));
 	mbedtls_ssl_init(&(tlsDataParams->ssl));
 	mbedtls_ssl_config_init(&(tlsDataParams->conf));
-	mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
-	mbedtls_x509_crt_init(&(tlsDataParams->cacert));
-	mbedtls_x509_crt_init(&(tlsDataParams->clicert));
-	mbedtls_pk_init(&(tlsDataParams->pkey));
-
-	IOT_DEBUG("\n  . Seeding the random number generator...");
-	mbedtls_entropy_init(&(tlsDataParams->entropy));
-	if((ret = mbedtls_ctr_drbg_seed(&(tlsDataParams->ctr_drbg), mbedtls_entropy_func, &(tlsDataParams->entropy),
-									(const unsigned char *) pers, strlen(pers))) != 0) {
-		IOT_ERROR(" failed\n  ! mbedtls_ctr_drbg_seed returned -0x%x\n", -ret);
-		return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+	ret = _iot_tls_load_own_credentials(pNetwork);
+	if(SUCCESS != ret) {
+		return (IoT_Error_t) ret;
 	}
+	pCredentials = tlsDataParams->pCredentials;
 
-	IOT_DEBUG("  . Loading the CA root certificate ...");
-	ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->cacert), pNetwork->tlsConnectParams.pRootCALocation);
-	if(ret < 0) {
-		IOT_ERROR(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing root cert\n\n", -ret);
-		return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+	ret = _iot_tls_net_connect(pNetwork);
+	if(SUCCESS != ret) {
+		return (IoT_Error_t) ret;
 	}
-	IOT_DEBUG(" ok (%d skipped)\n", ret);
-
-	IOT_DEBUG("  . Loading the client cert. and key...");
-	ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->clicert), pNetwork->tlsConnectParams.pDeviceCertLocation);
-	if(ret != 0) {
-		IOT_ERROR(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing device cert\n\n", -ret);
-		return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
-	}
-
-	ret = mbedtls_pk_parse_keyfile(&(tlsDataParams->pkey), pNetwork->tlsConnectParams.pDevicePrivateKeyLocation, "");
-	if(ret != 0) {
-		IOT_ERROR(" failed\n  !  mbedtls_pk_parse_key returned -0x%x while parsing private key\n\n", -ret);
-		IOT_DEBUG(" path : %s ", pNetwork->tlsConnectParams.pDevicePrivateKeyLocation);
-		return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
-	}
-	IOT_DEBUG(" ok\n");
-	snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
-	IOT_DEBUG("  . Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
-	if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
-								  portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
-		IOT_ERROR(" failed\n  ! mbedtls_net_connect returned -0x%x\n\n", -ret);
-		switch(ret) {
-			case MBEDTLS_ERR_NET_SOCKET_FAILED:
-				return NETWORK_ERR_NET_SOCKET_FAILED;
-			case MBEDTLS_ERR_NET_UNKNOWN_HOST:
-				return NETWORK_ERR_NET_UNKNOWN_HOST;
-			case MBEDTLS_ERR_NET_CONNECT_FAILED:
-			default:
-				return NETWORK_ERR_NET_CONNECT_FAILED;
-		};
-	}
-
-	ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
-	if(ret != 0) {
-		IOT_ERROR(" failed\n  ! net_set_(non)block() returned -0x%x\n\n", -ret);
-		return SSL_CONNECTION_ERROR;
-	} IOT_DEBUG(" ok\n");
 
 	IOT_DEBUG("  . Setting up the SSL/TLS structure...");
 	if((ret = mbedtls_ssl_config_defaults(&(tlsDataParams->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
@@ -210,10 +586,21 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	} else {
 		mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
 	}
-	mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(tlsDataParams->ctr_drbg));
+	mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(pCredentials->ctr_drbg));
+	ret = _iot_tls_conf_policy(pNetwork);
+	if(SUCCESS != ret) {
+		return (IoT_Error_t) ret;
+	}
+	if(tlsDataParams->kernel_offload) {
+#if defined(MBEDTLS_SSL_EXPORT_KEYS)
+		mbedtls_ssl_conf_export_keys_cb(&(tlsDataParams->conf), _iot_tls_export_keys, tlsDataParams);
+#else
+		IOT_WARN("mbedTLS is built without MBEDTLS_SSL_EXPORT_KEYS, records are not offloaded to kernel TLS");
+#endif
+	}
 
-	mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(tlsDataParams->cacert), NULL);
-	if((ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(tlsDataParams->clicert), &(tlsDataParams->pkey))) !=
+	mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(pCredentials->cacert), NULL);
+	if((ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(pCredentials->clicert), &(pCredentials->pkey))) !=
 	   0) {
 		IOT_ERROR(" failed\n  ! mbedtls_ssl_conf_own_cert returned %d\n\n", ret);
 		return SSL_CONNECTION_ERROR;
@@ -243,24 +630,40 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 						mbedtls_net_recv_timeout);
 	IOT_DEBUG(" ok\n");
 
+	/* Offer the session of the last connection, the server falls back to a full handshake if it refuses it */
+	if(tlsDataParams->has_saved_session) {
+		if((ret = mbedtls_ssl_set_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) == 0) {
+			sessionOffered = true;
+		} else {
+			IOT_WARN("mbedtls_ssl_set_session returned -0x%x, performing a full handshake", -ret);
+			_iot_tls_discard_session(tlsDataParams);
+		}
+	}
+
 	IOT_DEBUG("\n\nSSL state connect : %d ", tlsDataParams->ssl.state);
-	IOT_DEBUG("  . Performing the SSL/TLS handshake...");
-	while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
-		if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-			IOT_ERROR(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret);
-			if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
-				IOT_ERROR("    Unable to verify the server's certificate. "
-							  "Either it is invalid,\n"
-							  "    or you didn't set ca_file or ca_path "
-							  "to an appropriate value.\n"
-							  "    Alternatively, you may want to use "
-							  "auth_mode=optional for testing purposes.\n");
-			}
+	ret = _iot_tls_handshake(tlsDataParams);
+	if(ret != 0 && sessionOffered) {
+		/* Some servers close the connection on a session they no longer know, retry once without it */
+		IOT_WARN("Resuming the TLS session failed, retrying with a full handshake");
+		_iot_tls_discard_session(tlsDataParams);
+		sessionOffered = false;
+
+		mbedtls_net_free(&(tlsDataParams->server_fd));
+		ret = _iot_tls_net_connect(pNetwork);
+		if(SUCCESS != ret) {
+			return (IoT_Error_t) ret;
+		}
+		if((ret = mbedtls_ssl_session_reset(&(tlsDataParams->ssl))) != 0) {
+			IOT_ERROR(" failed\n  ! mbedtls_ssl_session_reset returned -0x%x\n\n", -ret);
 			return SSL_CONNECTION_ERROR;
 		}
+		ret = _iot_tls_handshake(tlsDataParams);
+	}
+	if(ret != 0) {
+		return SSL_CONNECTION_ERROR;
 	}
 
-	IOT_DEBUG(" ok\n    [ Protocol is %s ]\n    [ Ciphersuite is %s ]\n", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
+	IOT_DEBUG("    [ Protocol is %s ]\n    [ Ciphersuite is %s ]\n", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
 		  mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
 	if((ret = mbedtls_ssl_get_record_expansion(&(tlsDataParams->ssl))) >= 0) {
 		IOT_DEBUG("    [ Record expansion is %d ]\n", ret);
@@ -285,6 +688,16 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 		ret = SUCCESS;
 	}
 
+	if(SUCCESS == ret) {
+		_iot_tls_save_session(tlsDataParams);
+		if(tlsDataParams->kernel_offload) {
+			_iot_tls_install_kernel_keys(tlsDataParams);
+		}
+	}
+	/* The kernel keeps its own copy of the keys */
+	mbedtls_platform_zeroize(tlsDataParams->ktls_key_block, sizeof(tlsDataParams->ktls_key_block));
+	tlsDataParams->ktls_key_len = 0;
+
 #ifdef ENABLE_IOT_DEBUG
 	if(mbedtls_ssl_get_peer_cert(&(tlsDataParams->ssl)) != NULL) {
 		IOT_DEBUG("  . Peer certificate information    ...\n");
@@ -314,6 +727,12 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	/* This variable is unused */
 	(void) timer;
 
+	if(pNetwork->tlsDataParams.ktls_tx) {
+		struct iovec segment = { pMsg, len };
+		return network_ktls_send(pNetwork->tlsDataParams.server_fd.fd, &segment, 1, IOT_SSL_WRITE_RETRY_TIMEOUT_MS,
+								 written_len);
+	}
+
 	/* The timer must be started in case no bytes are written on the first try */
 	init_timer(&writeTimer);
 	countdown_ms(&writeTimer, IOT_SSL_WRITE_RETRY_TIMEOUT_MS);
@@ -352,6 +771,92 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	return SUCCESS;
 }
 
+/*
+ * The kernel gathers the segments into records, without copying them through mbedTLS
+ */
+static IoT_Error_t _iot_tls_kernel_writev(Network *pNetwork, const IoT_Network_Segment *pSegments,
+										  size_t segmentCount, size_t *written_len) {
+	struct iovec batch[IOT_SSL_KERNEL_WRITEV_BATCH];
+	size_t batchCount, batchLen, sentLen;
+	IoT_Error_t rc = SUCCESS;
+
+	*written_len = 0U;
+	while(0U < segmentCount && SUCCESS == rc) {
+		batchLen = 0U;
+		for(batchCount = 0U; batchCount < segmentCount && batchCount < IOT_SSL_KERNEL_WRITEV_BATCH; batchCount++) {
+			batch[batchCount].iov_base = (void *) pSegments[batchCount].pData;
+			batch[batchCount].iov_len = pSegments[batchCount].len;
+			batchLen += pSegments[batchCount].len;
+		}
+
+		sentLen = 0U;
+		rc = network_ktls_send(pNetwork->tlsDataParams.server_fd.fd, batch, batchCount,
+							   IOT_SSL_WRITE_RETRY_TIMEOUT_MS, &sentLen);
+		*written_len += sentLen;
+		pSegments += batchCount;
+		segmentCount -= batchCount;
+	}
+
+	return rc;
+}
+
+IoT_Error_t iot_tls_writev(Network *pNetwork, const IoT_Network_Segment *pSegments, size_t segmentCount, Timer *timer,
+						   size_t *written_len) {
+	size_t itr;
+	size_t segmentLen;
+	IoT_Error_t rc = SUCCESS;
+
+	if(pNetwork->tlsDataParams.ktls_tx) {
+		return _iot_tls_kernel_writev(pNetwork, pSegments, segmentCount, written_len);
+	}
+
+	/* Each segment is handed to mbedtls_ssl_write in place, so a large payload
+	 * goes straight from the caller's buffer into the TLS records */
+	*written_len = 0U;
+	for(itr = 0U; itr < segmentCount && SUCCESS == rc; itr++) {
+		segmentLen = 0U;
+		rc = iot_tls_write(pNetwork, (unsigned char *) pSegments[itr].pData, pSegments[itr].len, timer, &segmentLen);
+		*written_len += segmentLen;
+	}
+
+	return rc;
+}
+
+/*
+ * Same timeouts as the mbedTLS path of iot_tls_read, with the records decrypted by the kernel
+ */
+static IoT_Error_t _iot_tls_kernel_read(Network *pNetwork, unsigned char *pMsg, size_t len, size_t *read_len) {
+	size_t rxLen = 0U;
+	size_t chunkLen;
+	IoT_Error_t rc;
+	Timer readTimer;
+
+	init_timer(&readTimer);
+	countdown_ms(&readTimer, IOT_SSL_READ_RETRY_TIMEOUT_MS);
+
+	while(len > 0U) {
+		rc = network_ktls_recv(pNetwork->tlsDataParams.server_fd.fd, pMsg, len, IOT_SSL_READ_TIMEOUT_MS, &chunkLen);
+		if(SUCCESS == rc) {
+			init_timer(&readTimer);
+			countdown_ms(&readTimer, IOT_SSL_READ_RETRY_TIMEOUT_MS);
+
+			rxLen += chunkLen;
+			pMsg += chunkLen;
+			len -= chunkLen;
+		} else if(NETWORK_SSL_NOTHING_TO_READ == rc) {
+			if(has_timer_expired(&readTimer)) {
+				*read_len = rxLen;
+				return (rxLen == 0U) ? NETWORK_SSL_NOTHING_TO_READ : NETWORK_SSL_READ_TIMEOUT_ERROR;
+			}
+		} else {
+			return rc;
+		}
+	}
+
+	*read_len = rxLen;
+	return SUCCESS;
+}
+
 IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
 	mbedtls_ssl_context *pSsl = &(pNetwork->tlsDataParams.ssl);
 	size_t rxLen = 0U;
@@ -364,6 +869,10 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	/* This variable is unused */
 	(void) timer;
 
+	if(pNetwork->tlsDataParams.ktls_rx) {
+		return _iot_tls_kernel_read(pNetwork, pMsg, len, read_len);
+	}
+
 	/* The timer must be started in case no bytes are read on the first try */
 	init_timer(&readTimer);
 	countdown_ms(&readTimer, IOT_SSL_READ_RETRY_TIMEOUT_MS);
@@ -406,9 +915,77 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_wait_for_data(Network *pNetwork, Timer *timer) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	struct pollfd fds[2];
+	nfds_t fdCount = 1;
+	uint64_t wakeups;
+	int ret;
+
+	/* Data already received by mbedTLS does not show up on the socket any more */
+	if(0 < mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) || mbedtls_ssl_check_pending(&(tlsDataParams->ssl))) {
+		return SUCCESS;
+	}
+
+	fds[0].fd = tlsDataParams->server_fd.fd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	if(0 <= tlsDataParams->wakeup_fd) {
+		fds[1].fd = tlsDataParams->wakeup_fd;
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+		fdCount = 2;
+	}
+
+	ret = poll(fds, fdCount, (int) left_ms(timer));
+	if(0 > ret) {
+		if(EINTR == errno) {
+			return NETWORK_SSL_NOTHING_TO_READ;
+		}
+		IOT_ERROR(" failed\n  ! poll returned errno %d\n\n", errno);
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	/* Hang ups and socket errors are left for iot_tls_read to report */
+	if(0 != fds[0].revents) {
+		return SUCCESS;
+	}
+
+	if(2 == fdCount && 0 != (fds[1].revents & POLLIN)) {
+		/* Reading an eventfd resets its counter, so several wakeups are seen as one */
+		if((ssize_t) sizeof(wakeups) != read(tlsDataParams->wakeup_fd, &wakeups, sizeof(wakeups))) {
+			IOT_WARN("Unable to clear the yield wakeup descriptor, errno %d", errno);
+		}
+		return NETWORK_WAIT_INTERRUPTED;
+	}
+
+	return NETWORK_SSL_NOTHING_TO_READ;
+}
+
+IoT_Error_t iot_tls_wakeup(Network *pNetwork) {
+	uint64_t wakeup = 1;
+
+	if(0 > pNetwork->tlsDataParams.wakeup_fd) {
+		return FAILURE;
+	}
+
+	if((ssize_t) sizeof(wakeup) != write(pNetwork->tlsDataParams.wakeup_fd, &wakeup, sizeof(wakeup))) {
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 	mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
 	int ret = 0;
+
+	if(pNetwork->tlsDataParams.ktls_tx) {
+		(void) network_ktls_send_alert(pNetwork->tlsDataParams.server_fd.fd, NETWORK_KTLS_ALERT_LEVEL_WARNING,
+									   NETWORK_KTLS_ALERT_CLOSE_NOTIFY);
+		return SUCCESS;
+	}
+
 	do {
 		ret = mbedtls_ssl_close_notify(ssl);
 	} while(ret == MBEDTLS_ERR_SSL_WANT_WRITE);
@@ -423,14 +1000,33 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 
 	mbedtls_net_free(&(tlsDataParams->server_fd));
+	tlsDataParams->ktls_tx = false;
+	tlsDataParams->ktls_rx = false;
+	mbedtls_platform_zeroize(tlsDataParams->ktls_key_block, sizeof(tlsDataParams->ktls_key_block));
+	tlsDataParams->ktls_key_len = 0;
 
-	mbedtls_x509_crt_free(&(tlsDataParams->clicert));
-	mbedtls_x509_crt_free(&(tlsDataParams->cacert));
-	mbedtls_pk_free(&(tlsDataParams->pkey));
+	/* The credentials are kept, a reconnect only sets up a new SSL context */
 	mbedtls_ssl_free(&(tlsDataParams->ssl));
 	mbedtls_ssl_config_free(&(tlsDataParams->conf));
-	mbedtls_ctr_drbg_free(&(tlsDataParams->ctr_drbg));
-	mbedtls_entropy_free(&(tlsDataParams->entropy));
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_free(Network *pNetwork) {
+	TLSDataParams *tlsDataParams = NULL;
+
+	if(NULL == pNetwork) {
+		return NULL_VALUE_ERROR;
+	}
+
+	/* Everything is left released, so a second call does nothing */
+	tlsDataParams = &(pNetwork->tlsDataParams);
+	_iot_tls_discard_session(tlsDataParams);
+	iot_tls_free_credentials(&(tlsDataParams->ownCredentials));
+	if(0 <= tlsDataParams->wakeup_fd) {
+		close(tlsDataParams->wakeup_fd);
+		tlsDataParams->wakeup_fd = -1;
+	}
 
 	return SUCCESS;
 }
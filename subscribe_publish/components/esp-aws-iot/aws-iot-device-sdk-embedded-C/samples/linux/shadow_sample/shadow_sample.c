@@ -183,6 +183,7 @@ int main(int argc, char **argv) {
 
 	// initialize the mqtt client
 	AWS_IoT_Client mqttClient;
+	static AWS_IoT_Shadow_Context shadowContext;
 
 	ShadowInitParameters_t sp = ShadowInitParametersDefault;
 	sp.pHost = HostAddress;
@@ -194,7 +195,7 @@ int main(int argc, char **argv) {
 	sp.disconnectHandler = NULL;
 
 	IOT_INFO("Shadow Init");
-	rc = aws_iot_shadow_init(&mqttClient, &sp);
+	rc = aws_iot_shadow_init(&shadowContext, &mqttClient, &sp);
 	if(SUCCESS != rc) {
 		IOT_ERROR("Shadow Connection Error");
 		return rc;
@@ -206,7 +207,7 @@ int main(int argc, char **argv) {
 	scp.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
 
 	IOT_INFO("Shadow Connect");
-	rc = aws_iot_shadow_connect(&mqttClient, &scp);
+	rc = aws_iot_shadow_connect(&shadowContext, &scp);
 	if(SUCCESS != rc) {
 		IOT_ERROR("Shadow Connection Error");
 		return rc;
@@ -217,13 +218,13 @@ int main(int argc, char **argv) {
 	 *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
 	 *  #AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL
 	 */
-	rc = aws_iot_shadow_set_autoreconnect_status(&mqttClient, true);
+	rc = aws_iot_shadow_set_autoreconnect_status(&shadowContext, true);
 	if(SUCCESS != rc) {
 		IOT_ERROR("Unable to set Auto Reconnect to true - %d", rc);
 		return rc;
 	}
 
-	rc = aws_iot_shadow_register_delta(&mqttClient, &windowActuator);
+	rc = aws_iot_shadow_register_delta(&shadowContext, &windowActuator);
 
 	if(SUCCESS != rc) {
 		IOT_ERROR("Shadow Register Delta Error");
@@ -232,7 +233,7 @@ int main(int argc, char **argv) {
 
 	// loop and publish a change in temperature
 	while(NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc) {
-		rc = aws_iot_shadow_yield(&mqttClient, 200);
+		rc = aws_iot_shadow_yield(&shadowContext, 200);
 		if(NETWORK_ATTEMPTING_RECONNECT == rc) {
 			sleep(1);
 			// If the client is attempting to reconnect we will skip the rest of the loop.
@@ -247,10 +248,10 @@ int main(int argc, char **argv) {
 			rc = aws_iot_shadow_add_reported(JsonDocumentBuffer, sizeOfJsonDocumentBuffer, 2, &temperatureHandler,
 											 &windowActuator);
 			if(SUCCESS == rc) {
-				rc = aws_iot_finalize_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
+				rc = aws_iot_finalize_json_document(&shadowContext, JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
 				if(SUCCESS == rc) {
 					IOT_INFO("Update Shadow: %s", JsonDocumentBuffer);
-					rc = aws_iot_shadow_update(&mqttClient, AWS_IOT_MY_THING_NAME, JsonDocumentBuffer,
+					rc = aws_iot_shadow_update(&shadowContext, AWS_IOT_MY_THING_NAME, JsonDocumentBuffer,
 											   ShadowUpdateStatusCallback, NULL, 4, true);
 				}
 			}
@@ -264,7 +265,7 @@ int main(int argc, char **argv) {
 	}
 
 	IOT_INFO("Disconnecting");
-	rc = aws_iot_shadow_disconnect(&mqttClient);
+	rc = aws_iot_shadow_disconnect(&shadowContext);
 
 	if(SUCCESS != rc) {
 		IOT_ERROR("Disconnect error %d", rc);
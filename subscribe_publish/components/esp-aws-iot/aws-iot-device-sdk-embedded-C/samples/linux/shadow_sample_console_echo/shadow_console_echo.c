@@ -65,6 +65,8 @@ static bool messageArrivedOnDelta = false;
  */
 static char stringToEchoDelta[SHADOW_MAX_SIZE_OF_RX_BUFFER];
 
+static AWS_IoT_Shadow_Context shadowContext;
+
 
 /**
  * @brief This function builds a full Shadow expected JSON document by putting the data in the reported section
@@ -83,7 +85,7 @@ static bool buildJSONForReported(char *pJsonDocument, size_t maxSizeOfJsonDocume
 
 	char tempClientTokenBuffer[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
 
-	if(aws_iot_fill_with_client_token(tempClientTokenBuffer, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE) != SUCCESS){
+	if(aws_iot_fill_with_client_token(&shadowContext, tempClientTokenBuffer, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE) != SUCCESS){
 		return false;
 	}
 
@@ -192,7 +194,7 @@ int main(int argc, char** argv) {
 	sp.disconnectHandler = NULL;
 
 	IOT_INFO("Shadow Init");
-	rc = aws_iot_shadow_init(&mqttClient, &sp);
+	rc = aws_iot_shadow_init(&shadowContext, &mqttClient, &sp);
 	if (SUCCESS != rc) {
 		IOT_ERROR("Shadow Connection Error");
 		return rc;
@@ -204,7 +206,7 @@ int main(int argc, char** argv) {
 	scp.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
 
 	IOT_INFO("Shadow Connect");
-	rc = aws_iot_shadow_connect(&mqttClient, &scp);
+	rc = aws_iot_shadow_connect(&shadowContext, &scp);
 	if (SUCCESS != rc) {
 		IOT_ERROR("Shadow Connection Error");
 		return rc;
@@ -215,7 +217,7 @@ int main(int argc, char** argv) {
 	 *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
 	 *  #AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL
 	 */
-	rc = aws_iot_shadow_set_autoreconnect_status(&mqttClient, true);
+	rc = aws_iot_shadow_set_autoreconnect_status(&shadowContext, true);
 	if(SUCCESS != rc){
 		IOT_ERROR("Unable to set Auto Reconnect to true - %d", rc);
 		return rc;
@@ -231,14 +233,14 @@ int main(int argc, char** argv) {
 	/*
 	 * Register the jsonStruct object
 	 */
-	rc = aws_iot_shadow_register_delta(&mqttClient, &deltaObject);
+	rc = aws_iot_shadow_register_delta(&shadowContext, &deltaObject);
 
 	// Now wait in the loop to receive any message sent from the console
 	while (NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc) {
 		/*
 		 * Lets check for the incoming messages for 200 ms.
 		 */
-		rc = aws_iot_shadow_yield(&mqttClient, 200);
+		rc = aws_iot_shadow_yield(&shadowContext, 200);
 
 		if (NETWORK_ATTEMPTING_RECONNECT == rc) {
 			sleep(1);
@@ -248,7 +250,7 @@ int main(int argc, char** argv) {
 
 		if (messageArrivedOnDelta) {
 			IOT_INFO("\nSending delta message back %s\n", stringToEchoDelta);
-			rc = aws_iot_shadow_update(&mqttClient, AWS_IOT_MY_THING_NAME, stringToEchoDelta, UpdateStatusCallback, NULL, 2, true);
+			rc = aws_iot_shadow_update(&shadowContext, AWS_IOT_MY_THING_NAME, stringToEchoDelta, UpdateStatusCallback, NULL, 2, true);
 			messageArrivedOnDelta = false;
 		}
 
@@ -261,7 +263,7 @@ int main(int argc, char** argv) {
 	}
 
 	IOT_INFO("Disconnecting");
-	rc = aws_iot_shadow_disconnect(&mqttClient);
+	rc = aws_iot_shadow_disconnect(&shadowContext);
 
 	if (SUCCESS != rc) {
 		IOT_ERROR("Disconnect error %d", rc);
@@ -32,9 +32,33 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
+#include <float.h>
 
 #include "aws_iot_log.h"
 
+/**
+ * Longest primitive the numeric parsers accept: -DBL_MAX written with "%f", that is a sign, the
+ * DBL_MAX_10_EXP + 1 digits of the integer part, the point and six decimals. Any value printed with
+ * "%f" or "%lf" fits, as do integers and the shorter "%g" and "%e" forms.
+ */
+#define JSON_PRIMITIVE_MAX_LEN (1 + (DBL_MAX_10_EXP + 1) + 1 + 6)
+
+/**
+ * sscanf reads its input up to a null byte, so the token is copied out first. The document does not have to be
+ * null terminated and a value is never read into the text that follows it.
+ */
+static bool copyPrimitiveToken(char *pBuf, const char *jsonString, jsmntok_t *token) {
+	size_t length = (size_t) (token->end - token->start);
+
+	if(0 == length || JSON_PRIMITIVE_MAX_LEN < length) {
+		return false;
+	}
+
+	memcpy(pBuf, jsonString + token->start, length);
+	pBuf[length] = '\0';
+	return true;
+}
+
 int8_t jsoneq(const char *json, jsmntok_t *tok, const char *s) {
 	if(tok->type == JSMN_STRING) {
 		if((int) strlen(s) == tok->end - tok->start) {
@@ -47,12 +71,15 @@ int8_t jsoneq(const char *json, jsmntok_t *tok, const char *s) {
 }
 
 IoT_Error_t parseUnsignedInteger32Value(uint32_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
-	if(('-' == (char) (jsonString[token->start])) || (1 != sscanf(jsonString + token->start, "%u", i))) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || ('-' == primitive[0])
+	   || (1 != sscanf(primitive, "%u", i))) {
 		IOT_WARN("Token was not an unsigned integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -61,12 +88,15 @@ IoT_Error_t parseUnsignedInteger32Value(uint32_t *i, const char *jsonString, jsm
 }
 
 IoT_Error_t parseUnsignedInteger16Value(uint16_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
-	if(('-' == (char) (jsonString[token->start])) || (1 != sscanf(jsonString + token->start, "%hu", i))) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || ('-' == primitive[0])
+	   || (1 != sscanf(primitive, "%hu", i))) {
 		IOT_WARN("Token was not an unsigned integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -75,13 +105,16 @@ IoT_Error_t parseUnsignedInteger16Value(uint16_t *i, const char *jsonString, jsm
 }
 
 IoT_Error_t parseUnsignedInteger8Value(uint8_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
 	uint32_t i_word;
-	if(('-' == (char) (jsonString[token->start])) || (1 != sscanf(jsonString + token->start, "%" SCNu32, &i_word))) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || ('-' == primitive[0])
+	   || (1 != sscanf(primitive, "%" SCNu32, &i_word))) {
 		IOT_WARN("Token was not an unsigned integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -95,12 +128,14 @@ IoT_Error_t parseUnsignedInteger8Value(uint8_t *i, const char *jsonString, jsmnt
 }
 
 IoT_Error_t parseInteger32Value(int32_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
-	if(1 != sscanf(jsonString + token->start, "%i", i)) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || 1 != sscanf(primitive, "%i", i)) {
 		IOT_WARN("Token was not an integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -109,13 +144,15 @@ IoT_Error_t parseInteger32Value(int32_t *i, const char *jsonString, jsmntok_t *t
 }
 
 IoT_Error_t parseInteger16Value(int16_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
 	int32_t i_word;
-	if(1 != sscanf(jsonString + token->start, "%" SCNi32, &i_word)) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || 1 != sscanf(primitive, "%" SCNi32, &i_word)) {
 		IOT_WARN("Token was not an integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -129,13 +166,15 @@ IoT_Error_t parseInteger16Value(int16_t *i, const char *jsonString, jsmntok_t *t
 }
 
 IoT_Error_t parseInteger8Value(int8_t *i, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not an integer");
 		return JSON_PARSE_ERROR;
 	}
 
 	int32_t i_word;
-	if(1 != sscanf(jsonString + token->start, "%" SCNi32, &i_word)) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || 1 != sscanf(primitive, "%" SCNi32, &i_word)) {
 		IOT_WARN("Token was not an integer.");
 		return JSON_PARSE_ERROR;
 	}
@@ -149,12 +188,14 @@ IoT_Error_t parseInteger8Value(int8_t *i, const char *jsonString, jsmntok_t *tok
 }
 
 IoT_Error_t parseFloatValue(float *f, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not a float.");
 		return JSON_PARSE_ERROR;
 	}
 
-	if(1 != sscanf(jsonString + token->start, "%f", f)) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || 1 != sscanf(primitive, "%f", f)) {
 		IOT_WARN("Token was not a float.");
 		return JSON_PARSE_ERROR;
 	}
@@ -163,12 +204,14 @@ IoT_Error_t parseFloatValue(float *f, const char *jsonString, jsmntok_t *token)
 }
 
 IoT_Error_t parseDoubleValue(double *d, const char *jsonString, jsmntok_t *token) {
+	char primitive[JSON_PRIMITIVE_MAX_LEN + 1];
+
 	if(token->type != JSMN_PRIMITIVE) {
 		IOT_WARN("Token was not a double.");
 		return JSON_PARSE_ERROR;
 	}
 
-	if(1 != sscanf(jsonString + token->start, "%lf", d)) {
+	if(!copyPrimitiveToken(primitive, jsonString, token) || 1 != sscanf(primitive, "%lf", d)) {
 		IOT_WARN("Token was not a double.");
 		return JSON_PARSE_ERROR;
 	}
@@ -181,9 +224,9 @@ IoT_Error_t parseBooleanValue(bool *b, const char *jsonString, jsmntok_t *token)
 		IOT_WARN("Token was not a primitive.");
 		return JSON_PARSE_ERROR;
 	}
-	if(strncmp(jsonString + token->start, "true", 4) == 0) {
+	if(4 == token->end - token->start && strncmp(jsonString + token->start, "true", 4) == 0) {
 		*b = true;
-	} else if(strncmp(jsonString + token->start, "false", 5) == 0) {
+	} else if(5 == token->end - token->start && strncmp(jsonString + token->start, "false", 5) == 0) {
 		*b = false;
 	} else {
 		IOT_WARN("Token was not a bool.");
@@ -206,7 +249,7 @@ IoT_Error_t parseStringValue(char *buf, size_t bufLen, const char *jsonString, j
 		return SHADOW_JSON_ERROR;
 	}
 
-	strncpy(buf, jsonString + token->start, stringLength);
+	memcpy(buf, jsonString + token->start, stringLength);
 	buf[stringLength] = '\0';
 
 	return SUCCESS;
@@ -164,6 +164,57 @@ IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState e
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Move an MQTT client from a connection error to the pending reconnect state
+ *
+ * Every path into CLIENT_STATE_PENDING_RECONNECT goes through here, so the reconnect
+ * latency is measured from the first one after the connection was lost, whether the
+ * loss was seen by a read, a publish, a ping or a failed connect. Retries of the same
+ * reconnect keep the running timer and a link up reported in the meantime.
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of state change
+ */
+IoT_Error_t aws_iot_mqtt_internal_enter_pending_reconnect(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc = FAILURE;
+#endif
+
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.state_change_mutex));
+	if(SUCCESS != threadRc) {
+		return threadRc;
+	}
+#endif
+	if(CLIENT_STATE_DISCONNECTED_ERROR == aws_iot_mqtt_get_client_state(pClient)) {
+		pClient->clientStatus.clientState = CLIENT_STATE_PENDING_RECONNECT;
+		if(!pClient->clientStatus.isReconnectTimed) {
+			countdown_ms(&(pClient->reconnectLatencyTimer), AWS_IOT_MQTT_RECONNECT_LATENCY_TIMER_MS);
+			pClient->clientStatus.isReconnectTimed = true;
+			pClient->clientStatus.isLinkUpReported = false;
+		}
+		rc = SUCCESS;
+	} else {
+		rc = MQTT_UNEXPECTED_CLIENT_STATE_ERROR;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.state_change_mutex));
+	if(SUCCESS == rc && SUCCESS != threadRc) {
+		rc = threadRc;
+	}
+#endif
+
+	FUNC_EXIT_RC(rc);
+}
+
 IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, const IoT_Client_Connect_Params *pNewConnectParams) {
 	FUNC_ENTRY;
 	if(NULL == pClient || NULL == pNewConnectParams) {
@@ -225,7 +276,21 @@ IoT_Error_t aws_iot_mqtt_free(AWS_IoT_Client *pClient)
 		}else{
 			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
 		}
+
+		if (rc == SUCCESS)
+		{
+			rc = aws_iot_thread_mutex_destroy(&(pClient->clientData.offline_queue_mutex));
+		}else{
+			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.offline_queue_mutex));
+		}
 	#endif
+
+		if (rc == SUCCESS)
+		{
+			rc = iot_tls_free(&(pClient->networkStack));
+		}else{
+			(void)iot_tls_free(&(pClient->networkStack));
+		}
 	}
 
     FUNC_EXIT_RC(rc);
@@ -247,15 +312,36 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
 		pClient->clientData.messageHandlers[i].topicName = NULL;
 		pClient->clientData.messageHandlers[i].pApplicationHandler = NULL;
+		pClient->clientData.messageHandlers[i].pApplicationStreamHandler = NULL;
 		pClient->clientData.messageHandlers[i].pApplicationHandlerData = NULL;
 		pClient->clientData.messageHandlers[i].qos = QOS0;
 	}
+	aws_iot_mqtt_internal_topic_trie_init(pClient);
+
+	for(i = 0; i < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++i) {
+		pClient->clientData.inflightPublishes[i].packetId = 0;
+		pClient->clientData.inflightPublishes[i].pCompleteHandler = NULL;
+		pClient->clientData.inflightPublishes[i].pCompleteHandlerData = NULL;
+	}
+	pClient->clientData.inflightPublishCount = 0;
+
+	/* Disabled until aws_iot_mqtt_offline_queue_init is called */
+	pClient->clientData.offlineQueue.pBuffer = NULL;
+	pClient->clientData.offlineQueue.count = 0;
+	pClient->clientData.offlineQueue.unsentCount = 0;
+	pClient->clientData.offlineQueue.pDropHandler = NULL;
+	pClient->clientData.offlineQueue.pDropHandlerData = NULL;
 
 	pClient->clientData.packetTimeoutMs = pInitParams->mqttPacketTimeout_ms;
 	pClient->clientData.commandTimeoutMs = pInitParams->mqttCommandTimeout_ms;
 	pClient->clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
 	pClient->clientData.readBufSize = AWS_IOT_MQTT_RX_BUF_LEN;
 	pClient->clientData.counterNetworkDisconnected = 0;
+	pClient->clientData.currentReconnectWaitInterval = 0;
+	pClient->clientData.reconnectPolicy.nextWait = NULL;
+	pClient->clientData.reconnectPolicy.pPolicyData = NULL;
+	pClient->clientData.reconnectJitterState = 0;
+	memset(&(pClient->clientData.reconnectStats), 0, sizeof(IoT_Reconnect_Stats));
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
 	pClient->clientData.nextPacketId = 1;
@@ -283,10 +369,20 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
 		FUNC_EXIT_RC(rc);
 	}
+	rc = aws_iot_thread_mutex_init(&(pClient->clientData.offline_queue_mutex));
+	if(SUCCESS != rc) {
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
+		FUNC_EXIT_RC(rc);
+	}
 #endif
 
 	pClient->clientStatus.isPingOutstanding = 0;
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
+	pClient->clientStatus.isSessionPresent = false;
+	pClient->clientStatus.isLinkUpReported = false;
+	pClient->clientStatus.isReconnectTimed = false;
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
 					  pInitParams->pDevicePrivateKeyLocation, pInitParams->pHostURL, pInitParams->port,
@@ -297,14 +393,18 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.offline_queue_mutex));
 		#endif
 		pClient->clientStatus.clientState = CLIENT_STATE_INVALID;
 		FUNC_EXIT_RC(rc);
 	}
+	pClient->networkStack.tlsConnectParams.pCipherSuites = pInitParams->pTlsCipherSuites;
+	pClient->networkStack.tlsConnectParams.pCurves = pInitParams->pTlsCurves;
 
 	init_timer(&(pClient->pingReqTimer));
 	init_timer(&(pClient->pingRespTimer));
 	init_timer(&(pClient->reconnectDelayTimer));
+	init_timer(&(pClient->reconnectLatencyTimer));
 
 	pClient->clientStatus.clientState = CLIENT_STATE_INITIALIZED;
 
@@ -353,6 +453,16 @@ bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient) {
 	FUNC_EXIT_RC(isConnected);
 }
 
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		IOT_WARN(" Client is null! ");
+		FUNC_EXIT_RC(false);
+	}
+
+	FUNC_EXIT_RC(pClient->clientStatus.isSessionPresent);
+}
+
 bool aws_iot_is_autoreconnect_enabled(AWS_IoT_Client *pClient) {
 	FUNC_ENTRY;
 	if(NULL == pClient) {
@@ -372,6 +482,21 @@ IoT_Error_t aws_iot_mqtt_autoreconnect_set_status(AWS_IoT_Client *pClient, bool
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+IoT_Error_t aws_iot_mqtt_autoreconnect_set_policy(AWS_IoT_Client *pClient, const IoT_Reconnect_Policy *pPolicy) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL == pPolicy) {
+		pClient->clientData.reconnectPolicy.nextWait = NULL;
+		pClient->clientData.reconnectPolicy.pPolicyData = NULL;
+	} else {
+		pClient->clientData.reconnectPolicy = *pPolicy;
+	}
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_disconnect_handler pDisconnectHandler,
 												void *pDisconnectHandlerData) {
 	FUNC_ENTRY;
@@ -392,6 +517,20 @@ void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient) {
 	pClient->clientData.counterNetworkDisconnected = 0;
 }
 
+IoT_Error_t aws_iot_mqtt_get_reconnect_stats(AWS_IoT_Client *pClient, IoT_Reconnect_Stats *pStats) {
+	FUNC_ENTRY;
+	if(NULL == pClient || NULL == pStats) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	*pStats = pClient->clientData.reconnectStats;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void aws_iot_mqtt_reset_reconnect_stats(AWS_IoT_Client *pClient) {
+	memset(&(pClient->clientData.reconnectStats), 0, sizeof(IoT_Reconnect_Stats));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -296,6 +296,44 @@ IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Write the start of writeBuf to the network
+ *
+ * The caller is responsible for holding the TLS write mutex.
+ *
+ * @param pClient MQTT client which holds the data
+ * @param length Number of bytes of writeBuf to send
+ * @param pTimer Amount of time allowed to send the data
+ *
+ * @return IoT_Error_t of send status
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_write_buf(AWS_IoT_Client *pClient, size_t length, Timer *pTimer) {
+	size_t sentLen, sent;
+	IoT_Error_t rc = FAILURE;
+
+	sentLen = 0;
+	sent = 0;
+
+	while(sent < length && !has_timer_expired(pTimer)) {
+		rc = pClient->networkStack.write(&(pClient->networkStack),
+						 &pClient->clientData.writeBuf[sent],
+						 (length - sent),
+						 pTimer,
+						 &sentLen);
+		if(SUCCESS != rc) {
+			/* there was an error writing the data */
+			break;
+		}
+		sent += sentLen;
+	}
+
+	if(sent == length) {
+		return SUCCESS;
+	}
+
+	return rc;
+}
+
 /**
  * @brief Send an MQTT packet on the network
  *
@@ -306,8 +344,6 @@ IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes
  * @return IoT_Error_t of send status
  */
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer) {
-
-	size_t sentLen, sent;
 	IoT_Error_t rc = FAILURE;
 
 #ifdef _ENABLE_THREAD_SUPPORT_
@@ -331,20 +367,102 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 	}
 #endif
 
+	rc = _aws_iot_mqtt_internal_write_buf(pClient, length, pTimer);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if((SUCCESS != threadRc) && ( SUCCESS == rc )) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Send a packet made of a header in writeBuf followed by a payload held elsewhere
+ *
+ * A payload that fits in writeBuf after the header is appended to it and the packet is sent
+ * with send_packet, in a single write. Splitting a small packet over two writes would send two
+ * TLS records, the second of which can be held back by Nagle's algorithm until the first is
+ * acknowledged. Only a larger payload is written as a second segment through writev, where the
+ * network layer provides it, so it is not limited by AWS_IOT_MQTT_TX_BUF_LEN.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param headerLength Length of the header serialized at the start of writeBuf
+ * @param pPayload Payload to send after the header
+ * @param payloadLen Length of the payload
+ * @param pTimer Timer for the send operation
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_send_packet_with_payload(AWS_IoT_Client *pClient, size_t headerLength,
+														   const unsigned char *pPayload, size_t payloadLen,
+														   Timer *pTimer) {
+	IoT_Network_Segment segments[2];
+	IoT_Network_Segment *pPending;
+	size_t pendingCount;
+	size_t sentLen, sent, length;
+	IoT_Error_t rc = FAILURE;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTimer || (NULL == pPayload && 0 != payloadLen)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(headerLength + payloadLen < pClient->clientData.writeBufSize) {
+		if(0 != payloadLen) {
+			memcpy(&pClient->clientData.writeBuf[headerLength], pPayload, payloadLen);
+		}
+		rc = aws_iot_mqtt_internal_send_packet(pClient, headerLength + payloadLen, pTimer);
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(NULL == pClient->networkStack.writev || headerLength >= pClient->clientData.writeBufSize) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	segments[0].pData = pClient->clientData.writeBuf;
+	segments[0].len = headerLength;
+	segments[1].pData = pPayload;
+	segments[1].len = payloadLen;
+	pPending = segments;
+	pendingCount = (0 != payloadLen) ? 2 : 1;
+
+	length = headerLength + payloadLen;
 	sentLen = 0;
 	sent = 0;
 
 	while(sent < length && !has_timer_expired(pTimer)) {
-		rc = pClient->networkStack.write(&(pClient->networkStack),
-						 &pClient->clientData.writeBuf[sent],
-						 (length - sent),
-						 pTimer,
-						 &sentLen);
+		rc = pClient->networkStack.writev(&(pClient->networkStack), pPending, pendingCount, pTimer, &sentLen);
 		if(SUCCESS != rc) {
 			/* there was an error writing the data */
 			break;
 		}
 		sent += sentLen;
+
+		/* Skip what was written before retrying with the remainder */
+		while(0 < pendingCount && sentLen >= pPending->len) {
+			sentLen -= pPending->len;
+			pPending++;
+			pendingCount--;
+		}
+		if(0 < pendingCount) {
+			pPending->pData += sentLen;
+			pPending->len -= sentLen;
+		}
 	}
 
 #ifdef _ENABLE_THREAD_SUPPORT_
@@ -355,14 +473,84 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 #endif
 
 	if(sent == length) {
-		/* record the fact that we have successfully sent the packet */
-		//countdown_sec(&c->pingTimer, c->clientData.keepAliveInterval);
 		FUNC_EXIT_RC(SUCCESS);
 	}
 
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Send a packet made of a header in writeBuf followed by a payload supplied by a reader
+ *
+ * The header is written first, then writeBuf is reused to pull the payload from the reader
+ * one chunk at a time, so the payload is not limited by AWS_IOT_MQTT_TX_BUF_LEN. The TLS write
+ * mutex is held for the whole packet so no other packet can be interleaved with it.
+ * The timer is restarted with the command timeout before each chunk.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param headerLength Length of the header serialized at the start of writeBuf
+ * @param payloadLen Length of the payload
+ * @param pPayloadReader Function filling writeBuf with the next chunk of payload
+ * @param pReaderData Context to pass to the reader
+ * @param pTimer Timer for the send operation
+ *
+ * @return An IoT Error Type defining successful/failed send, or the error returned by the reader
+ */
+IoT_Error_t aws_iot_mqtt_internal_send_packet_with_reader(AWS_IoT_Client *pClient, size_t headerLength,
+														  size_t payloadLen, pPublishPayloadReader_t pPayloadReader,
+														  void *pReaderData, Timer *pTimer) {
+	size_t payloadOffset, chunkLen;
+	IoT_Error_t rc = FAILURE;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTimer || NULL == pPayloadReader) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(headerLength >= pClient->clientData.writeBufSize) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	rc = _aws_iot_mqtt_internal_write_buf(pClient, headerLength, pTimer);
+
+	for(payloadOffset = 0; SUCCESS == rc && payloadOffset < payloadLen; payloadOffset += chunkLen) {
+		chunkLen = payloadLen - payloadOffset;
+		if(chunkLen > pClient->clientData.writeBufSize) {
+			chunkLen = pClient->clientData.writeBufSize;
+		}
+
+		rc = pPayloadReader(pClient, pClient->clientData.writeBuf, chunkLen, payloadOffset, pReaderData);
+		if(SUCCESS != rc) {
+			IOT_ERROR("Payload reader failed at offset %u, the PUBLISH was not completed", (unsigned int) payloadOffset);
+			break;
+		}
+
+		countdown_ms(pTimer, pClient->clientData.commandTimeoutMs);
+		rc = _aws_iot_mqtt_internal_write_buf(pClient, chunkLen, pTimer);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if((SUCCESS != threadRc) && ( SUCCESS == rc )) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	FUNC_EXIT_RC(rc);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient, size_t offset, size_t size, Timer *pTimer, size_t * read_len ) {
     IoT_Error_t rc;
     int byteToRead;
@@ -423,15 +611,227 @@ static IoT_Error_t _aws_iot_mqtt_internal_decode_packet_remaining_len(AWS_IoT_Cl
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Read a number of bytes from the network into the RX buffer
+ *
+ * Unlike _aws_iot_mqtt_internal_readWrapper this does not track readBufIndex, it is used
+ * for the parts of a packet that do not fit in the RX buffer.
+ *
+ * @param pClient MQTT client
+ * @param bufOffset Position in the RX buffer where the data is written
+ * @param len Number of bytes to read, bufOffset + len must not exceed the RX buffer size
+ * @param pTimer Amount of time allowed to read
+ *
+ * @return IoT_Error_t of read status
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_read_fully(AWS_IoT_Client *pClient, size_t bufOffset, size_t len,
+													 Timer *pTimer) {
+	size_t total_bytes_read, read_len;
+	IoT_Error_t rc;
+
+	total_bytes_read = 0;
+	rc = SUCCESS;
+	while(total_bytes_read < len && SUCCESS == rc) {
+		read_len = 0;
+		rc = pClient->networkStack.read(&(pClient->networkStack),
+										pClient->clientData.readBuf + bufOffset + total_bytes_read,
+										len - total_bytes_read, pTimer, &read_len);
+		total_bytes_read += read_len;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Discard the rest of a packet that does not fit in the RX buffer
+ *
+ * @param pClient MQTT client
+ * @param remainingLen Number of bytes of the packet still on the network
+ * @param pTimer Amount of time allowed to read
+ *
+ * @return MQTT_RX_BUFFER_TOO_SHORT_ERROR once the packet is discarded, otherwise the read error
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_drop_packet(AWS_IoT_Client *pClient, size_t remainingLen, Timer *pTimer) {
+	size_t bytes_to_be_read;
+	IoT_Error_t rc;
+
+	rc = SUCCESS;
+	while(0 < remainingLen && SUCCESS == rc) {
+		bytes_to_be_read = remainingLen;
+		if(bytes_to_be_read > pClient->clientData.readBufSize) {
+			bytes_to_be_read = pClient->clientData.readBufSize;
+		}
+		rc = _aws_iot_mqtt_internal_read_fully(pClient, 0, bytes_to_be_read, pTimer);
+		remainingLen -= bytes_to_be_read;
+	}
+
+	/* Check buffer was correctly emptied, otherwise, return error message. */
+	if(SUCCESS != rc) {
+		return rc;
+	}
+
+	aws_iot_mqtt_internal_flushBuffers(pClient);
+	return MQTT_RX_BUFFER_TOO_SHORT_ERROR;
+}
+
+static void _aws_iot_mqtt_internal_send_puback(AWS_IoT_Client *pClient, uint16_t packetId) {
+	uint32_t len;
+	IoT_Error_t rc;
+	Timer sendTimer;
+
+	len = 0;
+
+	/* Initialize timer for sending PUBACK. */
+	init_timer(&sendTimer);
+	countdown_ms(&sendTimer, pClient->clientData.commandTimeoutMs);
+
+	/* Generate and send a PUBACK. Warn if the PUBACK isn't sent; the server
+	will send the PUBLISH again in that case. */
+	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf,
+		pClient->clientData.writeBufSize, PUBACK, 0, packetId, &len);
+
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &sendTimer);
+
+		if(SUCCESS != rc) {
+			IOT_WARN("Failed to send PUBACK");
+		}
+	} else {
+		IOT_WARN("Failed to generate PUBACK");
+	}
+}
+
+/**
+ * @brief Deliver a PUBLISH that does not fit in the RX buffer to streaming handlers
+ *
+ * Called once the fixed header is read. The topic and packet identifier are read into
+ * the RX buffer, then the payload is read into the space left behind them one chunk at
+ * a time and passed to every matching streaming handler. Handlers registered through
+ * the regular subscribe API cannot take part and the packet is dropped if no streaming
+ * handler matches.
+ *
+ * The chunks are delivered while the network read is in progress, so the client state
+ * is left untouched and MQTT APIs called from the handlers are rejected.
+ *
+ * @param pClient MQTT client
+ * @param offset Length of the fixed header, already read into the RX buffer
+ * @param rem_len Remaining length of the packet
+ * @param pTimer Amount of time allowed to read the packet
+ *
+ * @return SUCCESS if the message was streamed, MQTT_RX_BUFFER_TOO_SHORT_ERROR if it was dropped,
+ * otherwise the read error
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_stream_publish(AWS_IoT_Client *pClient, size_t offset, size_t rem_len,
+														 Timer *pTimer) {
+	uint32_t matchedHandlers[AWS_IOT_MQTT_HANDLER_BITMAP_WORDS];
+	uint32_t word, bit;
+	MessageHandlers *pHandler;
+	IoT_Publish_Message_Params msg;
+	MQTTHeader header = {0};
+	char *pTopicName;
+	uint16_t topicNameLen;
+	size_t variableHeaderLen, payloadStart, payloadTotalLen, payloadOffset, read_len;
+	bool hasStreamHandler;
+	IoT_Error_t rc;
+
+	header.byte = pClient->clientData.readBuf[0];
+	msg.isDup = MQTT_HEADER_FIELD_DUP(header.byte);
+	msg.qos = (QoS) MQTT_HEADER_FIELD_QOS(header.byte);
+	msg.isRetained = MQTT_HEADER_FIELD_RETAIN(header.byte);
+	msg.id = 0;
+
+	/* The topic and packet identifier have to be kept in the RX buffer with room for the payload */
+	if(2 > rem_len || offset + 2 >= pClient->clientData.readBufSize) {
+		return _aws_iot_mqtt_internal_drop_packet(pClient, rem_len, pTimer);
+	}
+
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset, 2, pTimer, &read_len);
+	if(SUCCESS != rc || 2 != read_len) {
+		return FAILURE;
+	}
+
+	topicNameLen = (uint16_t) ((pClient->clientData.readBuf[offset] << 8) + pClient->clientData.readBuf[offset + 1]);
+	variableHeaderLen = 2 + (size_t) topicNameLen + ((QOS0 != msg.qos) ? 2 : 0);
+	if(variableHeaderLen > rem_len || offset + variableHeaderLen >= pClient->clientData.readBufSize) {
+		return _aws_iot_mqtt_internal_drop_packet(pClient, rem_len - 2, pTimer);
+	}
+
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset + 2, variableHeaderLen - 2, pTimer, &read_len);
+	if(SUCCESS != rc || (variableHeaderLen - 2) != read_len) {
+		return FAILURE;
+	}
+
+	pTopicName = (char *) (pClient->clientData.readBuf + offset + 2);
+	if(QOS0 != msg.qos) {
+		msg.id = (uint16_t) ((pClient->clientData.readBuf[offset + 2 + topicNameLen] << 8)
+							 + pClient->clientData.readBuf[offset + 3 + topicNameLen]);
+	}
+	payloadStart = offset + variableHeaderLen;
+	payloadTotalLen = rem_len - variableHeaderLen;
+
+	memset(matchedHandlers, 0, sizeof(matchedHandlers));
+	aws_iot_mqtt_internal_topic_trie_match(pClient, pTopicName, topicNameLen, matchedHandlers);
+
+	/* Only keep the handlers that accept chunks */
+	hasStreamHandler = false;
+	for(word = 0; word < AWS_IOT_MQTT_HANDLER_BITMAP_WORDS; ++word) {
+		for(bit = 0; 0 != matchedHandlers[word] && bit < 32; ++bit) {
+			pHandler = &pClient->clientData.messageHandlers[word * 32 + bit];
+			if(NULL == pHandler->pApplicationStreamHandler) {
+				matchedHandlers[word] &= ~((uint32_t) 1 << bit);
+			}
+		}
+		if(0 != matchedHandlers[word]) {
+			hasStreamHandler = true;
+		}
+	}
+
+	if(!hasStreamHandler) {
+		IOT_WARN("No streaming handler for a message larger than the RX buffer, dropping it");
+		return _aws_iot_mqtt_internal_drop_packet(pClient, payloadTotalLen, pTimer);
+	}
+
+	for(payloadOffset = 0; payloadOffset < payloadTotalLen; payloadOffset += msg.payloadLen) {
+		msg.payloadLen = payloadTotalLen - payloadOffset;
+		if(msg.payloadLen > pClient->clientData.readBufSize - payloadStart) {
+			msg.payloadLen = pClient->clientData.readBufSize - payloadStart;
+		}
+
+		rc = _aws_iot_mqtt_internal_read_fully(pClient, payloadStart, msg.payloadLen, pTimer);
+		if(SUCCESS != rc) {
+			return rc;
+		}
+		msg.payload = pClient->clientData.readBuf + payloadStart;
+
+		for(word = 0; word < AWS_IOT_MQTT_HANDLER_BITMAP_WORDS; ++word) {
+			for(bit = 0; bit < 32; ++bit) {
+				if(0 == (matchedHandlers[word] & ((uint32_t) 1 << bit))) {
+					continue;
+				}
+				pHandler = &pClient->clientData.messageHandlers[word * 32 + bit];
+				pHandler->pApplicationStreamHandler(pClient, pTopicName, topicNameLen, &msg, payloadOffset,
+													payloadTotalLen, pHandler->pApplicationHandlerData);
+			}
+		}
+	}
+
+	aws_iot_mqtt_internal_flushBuffers(pClient);
+
+	/* Acknowledge only once the whole message has been handed over */
+	if(QOS1 == msg.qos) {
+		_aws_iot_mqtt_internal_send_puback(pClient, msg.id);
+	}
+
+	return SUCCESS;
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType) {
-	size_t rem_len, total_bytes_read, bytes_to_be_read, read_len;
+	size_t rem_len, read_len;
 	IoT_Error_t rc;
     size_t offset = 0;
 	MQTTHeader header = {0};
 
 	rem_len = 0;
-	total_bytes_read = 0;
-	bytes_to_be_read = 0;
 	read_len = 0;
 
     rc = _aws_iot_mqtt_internal_readWrapper( pClient, offset, 1, pTimer, &read_len );
@@ -448,32 +848,20 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 		return rc;
 	}
 
-	/* if the buffer is too short then the message will be dropped silently */
+	/* if the buffer is too short then the message will be dropped silently,
+	 * unless it is a PUBLISH that streaming handlers can take in chunks */
 	if((rem_len + offset) >= pClient->clientData.readBufSize) {
-		bytes_to_be_read = pClient->clientData.readBufSize;
-		do {
-			rc = pClient->networkStack.read(&(pClient->networkStack), pClient->clientData.readBuf, bytes_to_be_read,
-											pTimer, &read_len);
-			if(SUCCESS == rc) {
-				total_bytes_read += read_len;
-				if((rem_len - total_bytes_read) >= pClient->clientData.readBufSize) {
-					bytes_to_be_read = pClient->clientData.readBufSize;
-				} else {
-					bytes_to_be_read = rem_len - total_bytes_read;
-				}
-			}
-		} while(total_bytes_read < rem_len && SUCCESS == rc);
+		header.byte = pClient->clientData.readBuf[0];
+		if(PUBLISH != MQTT_HEADER_FIELD_TYPE(header.byte)) {
+			return _aws_iot_mqtt_internal_drop_packet(pClient, rem_len, pTimer);
+		}
 
-        /* Check buffer was correctly emptied, otherwise, return error message. */
-        if ( total_bytes_read == rem_len )
-        {
-            aws_iot_mqtt_internal_flushBuffers( pClient );
-            return MQTT_RX_BUFFER_TOO_SHORT_ERROR;
-        }
-        else
-        {
-            return rc;
-        }
+		rc = _aws_iot_mqtt_internal_stream_publish(pClient, offset, rem_len, pTimer);
+		if(SUCCESS == rc) {
+			/* Already delivered, nothing left for cycle_read to handle */
+			*pPacketType = 0;
+		}
+		return rc;
 	}
 
 	/* 3. read the rest of the buffer using a callback to supply the rest of the data */
@@ -492,49 +880,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 	FUNC_EXIT_RC(rc);
 }
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pTopicName, uint16_t topicNameLen) {
-
-	char *curf, *curn, *curn_end;
-
-	if(NULL == pTopicFilter || NULL == pTopicName) {
-		return false;
-	}
-
-	curf = pTopicFilter;
-	curn = pTopicName;
-	curn_end = curn + topicNameLen;
-
-	while(*curf && (curn < curn_end)) {
-		if(*curn == '/' && *curf != '/') {
-			break;
-		}
-		if(*curf != '+' && *curf != '#' && *curf != *curn) {
-			break;
-		}
-		if(*curf == '+') {
-			/* skip until we meet the next separator, or end of string */
-			char *nextpos = curn + 1;
-			while(nextpos < curn_end && *nextpos != '/')
-				nextpos = ++curn + 1;
-		} else if(*curf == '#') {
-			/* skip until end of string */
-			curn = curn_end - 1;
-		}
-
-		curf++;
-		curn++;
-	};
-
-	return (curn == curn_end) && (*curf == '\0');
-}
-
 static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName,
 														  uint16_t topicNameLen,
 														  IoT_Publish_Message_Params *pMessageParams) {
-	uint32_t itr;
+	uint32_t matchedHandlers[AWS_IOT_MQTT_HANDLER_BITMAP_WORDS];
+	uint32_t word, bit;
+	MessageHandlers *pHandler;
 	IoT_Error_t rc;
 	ClientState clientState;
 
@@ -550,19 +901,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
 
-	/* Find the right message handler - indexed by topic */
-	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
-		if(NULL != pClient->clientData.messageHandlers[itr].topicName) {
-			if(((topicNameLen == pClient->clientData.messageHandlers[itr].topicNameLen)
-				&&
-				(strncmp(pTopicName, (char *) pClient->clientData.messageHandlers[itr].topicName, topicNameLen) == 0))
-			   || _aws_iot_mqtt_internal_is_topic_matched((char *) pClient->clientData.messageHandlers[itr].topicName,
-														  pTopicName, topicNameLen)) {
-				if(NULL != pClient->clientData.messageHandlers[itr].pApplicationHandler) {
-					pClient->clientData.messageHandlers[itr].pApplicationHandler(pClient, pTopicName, topicNameLen,
-																				 pMessageParams,
-																				 pClient->clientData.messageHandlers[itr].pApplicationHandlerData);
-				}
+	/* Collect the matching handlers before invoking any of them, a callback may
+	 * unsubscribe and reshape the topic trie while the others are pending */
+	memset(matchedHandlers, 0, sizeof(matchedHandlers));
+	aws_iot_mqtt_internal_topic_trie_match(pClient, pTopicName, topicNameLen, matchedHandlers);
+
+	for(word = 0; word < AWS_IOT_MQTT_HANDLER_BITMAP_WORDS; ++word) {
+		for(bit = 0; 0 != matchedHandlers[word] && bit < 32; ++bit) {
+			if(0 == (matchedHandlers[word] & ((uint32_t) 1 << bit))) {
+				continue;
+			}
+			matchedHandlers[word] &= ~((uint32_t) 1 << bit);
+
+			pHandler = &pClient->clientData.messageHandlers[word * 32 + bit];
+			if(NULL == pHandler->topicName) {
+				continue;
+			}
+			if(NULL != pHandler->pApplicationStreamHandler) {
+				/* The whole message fits in the RX buffer, hand it over as a single chunk */
+				pHandler->pApplicationStreamHandler(pClient, pTopicName, topicNameLen, pMessageParams, 0,
+													pMessageParams->payloadLen, pHandler->pApplicationHandlerData);
+			} else if(NULL != pHandler->pApplicationHandler) {
+				pHandler->pApplicationHandler(pClient, pTopicName, topicNameLen, pMessageParams,
+											  pHandler->pApplicationHandlerData);
 			}
 		}
 	}
@@ -574,16 +935,13 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient) {
 	char *topicName;
 	uint16_t topicNameLen;
-	uint32_t len;
 	IoT_Error_t rc;
 	IoT_Publish_Message_Params msg;
-	Timer sendTimer;
 
 	FUNC_ENTRY;
 
 	topicName = NULL;
 	topicNameLen = 0;
-	len = 0;
 
 	rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
 												   &msg.id, &topicName, &topicNameLen,
@@ -595,26 +953,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 		FUNC_EXIT_RC(rc);
 	}
 
+	/* Packets that do not leave a byte spare in the RX buffer are streamed, there is always room for the null */
+	((unsigned char *) msg.payload)[msg.payloadLen] = '\0';
+
 	/* Send acknowledgement of QoS 1 message. */
 	if(QOS1 == msg.qos) {
-		/* Initialize timer for sending PUBACK. */
-		init_timer(&sendTimer);
-		countdown_ms(&sendTimer, pClient->clientData.commandTimeoutMs);
-
-		/* Generate and send a PUBACK. Warn if the PUBACK isn't sent; the server
-		will send the PUBLISH again in that case. */
-		rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf,
-			pClient->clientData.writeBufSize, PUBACK, 0, msg.id, &len);
-
-		if(SUCCESS == rc) {
-			rc = aws_iot_mqtt_internal_send_packet(pClient, len, &sendTimer);
-
-			if(SUCCESS != rc) {
-				IOT_WARN("Failed to send PUBACK");
-			}
-		} else {
-			IOT_WARN("Failed to generate PUBACK");
-		}
+		_aws_iot_mqtt_internal_send_puback(pClient, msg.id);
 	}
 
 	rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
@@ -670,8 +1014,16 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 	}
 
 	switch(*pPacketType) {
-		case CONNACK:
+		case 0:
+			/* PUBLISH streamed to the application while it was read */
+			break;
 		case PUBACK:
+			/* Asynchronous publishes are completed here and not forwarded to a blocking caller */
+			if(aws_iot_mqtt_internal_complete_inflight_publish(pClient)) {
+				*pPacketType = 0;
+			}
+			break;
+		case CONNACK:
 		case SUBACK:
 		case UNSUBACK:
 			/* SDK is blocking, these responses will be forwarded to calling function to process */
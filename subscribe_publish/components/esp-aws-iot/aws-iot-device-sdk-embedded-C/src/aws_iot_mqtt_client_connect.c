@@ -387,6 +387,19 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	/* A resumed session still holds the unacknowledged QoS1 messages, retransmit them before anything else.
+	 * A new persistent session knows none of them, they are published again as new messages. A clean session
+	 * drops them, their completion handlers decide whether to publish them again. */
+	pClient->clientStatus.isSessionPresent = (1 == sessionPresent) ? true : false;
+	if(pClient->clientData.options.isCleanSession) {
+		aws_iot_mqtt_internal_fail_inflight_publishes(pClient, NETWORK_DISCONNECTED_ERROR);
+	} else {
+		rc = aws_iot_mqtt_internal_replay_inflight_publishes(pClient, pClient->clientStatus.isSessionPresent);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
 	/* Ensure that a ping request is sent after keepAliveInterval. */
 	pClient->clientStatus.isPingOutstanding = false;
 	countdown_sec(&pClient->pingReqTimer, pClient->clientData.keepAliveInterval);
@@ -435,6 +448,8 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
 		}
 		aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTING, CLIENT_STATE_DISCONNECTED_ERROR);
 	} else {
+		/* The next connection loss starts a new reconnect latency measurement */
+		pClient->clientStatus.isReconnectTimed = false;
 		aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTING, CLIENT_STATE_CONNECTED_IDLE);
 	}
 
@@ -521,6 +536,7 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient) {
 
 IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 	IoT_Error_t rc;
+	uint32_t itr;
 
 	FUNC_ENTRY;
 
@@ -535,7 +551,7 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 
 		/* If still disconnected handle disconnect */
 		if(CLIENT_STATE_CONNECTED_IDLE != aws_iot_mqtt_get_client_state(pClient)) {
-			aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR, CLIENT_STATE_PENDING_RECONNECT);
+			aws_iot_mqtt_internal_enter_pending_reconnect(pClient);
 			FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 		}
 	}
@@ -547,6 +563,14 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		}
 	}
 
+	/* The server kept the subscriptions of a resumed session, there is nothing to resubscribe */
+	if(pClient->clientStatus.isSessionPresent) {
+		for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+			pClient->clientData.messageHandlers[itr].resubscribed = 1;
+		}
+		FUNC_EXIT_RC(NETWORK_RECONNECTED);
+	}
+
 	rc = aws_iot_mqtt_resubscribe(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
@@ -0,0 +1,528 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_offline_queue.c
+ * @brief MQTT client store-and-forward queue for QoS1 messages published while disconnected
+ *
+ * Messages are appended to a ring buffer provided by the application, each one stored
+ * contiguously with its topic so that it can be sent straight from the ring. Once the
+ * client has reconnected, yield sends them in order as asynchronous publishes, so the
+ * in-flight table bounds how many are awaiting a PUBACK. A message leaves the queue
+ * only once it has been acknowledged. When a store is given, every change to the ring
+ * is mirrored into it and the queue is reloaded from it on the next start.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client_common_internal.h"
+
+/* Record layout: type, flags, topic length (2), payload length (4), topic, payload */
+#define OFFLINE_RECORD_HEADER_LEN 8
+#define OFFLINE_RECORD_PUBLISH 'P'
+/* Marks the unused end of the ring when a record did not fit there */
+#define OFFLINE_RECORD_WRAP 'W'
+
+#define OFFLINE_RECORD_FLAG_RETAINED 0x01u
+/* Only kept in RAM, a reloaded queue sends every message again */
+#define OFFLINE_RECORD_FLAG_SENT 0x02u
+#define OFFLINE_RECORD_FLAG_ACKED 0x04u
+
+/* Store layout: magic, ring size, head, used bytes, message count, then the ring itself */
+#define OFFLINE_STORE_MAGIC 0x4F514231u
+#define OFFLINE_STORE_HEADER_LEN 20
+
+static void _offline_queue_write_uint32(unsigned char *pBuf, uint32_t value) {
+	pBuf[0] = (unsigned char) (value >> 24);
+	pBuf[1] = (unsigned char) (value >> 16);
+	pBuf[2] = (unsigned char) (value >> 8);
+	pBuf[3] = (unsigned char) value;
+}
+
+static uint32_t _offline_queue_read_uint32(const unsigned char *pBuf) {
+	return ((uint32_t) pBuf[0] << 24) | ((uint32_t) pBuf[1] << 16) | ((uint32_t) pBuf[2] << 8) | (uint32_t) pBuf[3];
+}
+
+static uint16_t _offline_record_topic_len(const unsigned char *pRecord) {
+	return (uint16_t) ((pRecord[2] << 8) | pRecord[3]);
+}
+
+static size_t _offline_record_len(const unsigned char *pRecord) {
+	return OFFLINE_RECORD_HEADER_LEN + _offline_record_topic_len(pRecord) + _offline_queue_read_uint32(&pRecord[4]);
+}
+
+/**
+ * @brief Move the head past the unused end of the ring, if it has reached it
+ *
+ * Only valid while the queue holds at least one message.
+ */
+static void _offline_queue_skip_unused_end(OfflineQueue *pQueue) {
+	if(pQueue->head >= pQueue->bufferSize || OFFLINE_RECORD_WRAP == pQueue->pBuffer[pQueue->head]) {
+		pQueue->used -= pQueue->bufferSize - pQueue->head;
+		pQueue->head = 0;
+	}
+}
+
+static bool _offline_queue_has_store(const OfflineQueue *pQueue) {
+	return (NULL != pQueue->store.read && NULL != pQueue->store.write);
+}
+
+/**
+ * @brief Write the ring position to the store. Called after the records themselves were written,
+ * this is the point at which a change to the queue becomes persistent.
+ */
+static IoT_Error_t _offline_queue_store_header(OfflineQueue *pQueue) {
+	unsigned char header[OFFLINE_STORE_HEADER_LEN];
+
+	if(!_offline_queue_has_store(pQueue)) {
+		return SUCCESS;
+	}
+
+	_offline_queue_write_uint32(&header[0], OFFLINE_STORE_MAGIC);
+	_offline_queue_write_uint32(&header[4], (uint32_t) pQueue->bufferSize);
+	_offline_queue_write_uint32(&header[8], (uint32_t) pQueue->head);
+	_offline_queue_write_uint32(&header[12], (uint32_t) pQueue->used);
+	_offline_queue_write_uint32(&header[16], pQueue->count);
+
+	return pQueue->store.write(pQueue->store.pStoreData, 0, header, OFFLINE_STORE_HEADER_LEN);
+}
+
+static IoT_Error_t _offline_queue_store_bytes(OfflineQueue *pQueue, size_t offset, size_t len) {
+	if(!_offline_queue_has_store(pQueue)) {
+		return SUCCESS;
+	}
+
+	return pQueue->store.write(pQueue->store.pStoreData, OFFLINE_STORE_HEADER_LEN + offset, &(pQueue->pBuffer[offset]),
+							   len);
+}
+
+/**
+ * @brief Load the queue from its store, leaving it empty if the store holds no valid queue
+ *
+ * The records are walked once to check that they fit the recorded ring position,
+ * so a store written with another ring size or only partially written is discarded.
+ */
+static bool _offline_queue_load(OfflineQueue *pQueue) {
+	unsigned char header[OFFLINE_STORE_HEADER_LEN];
+	size_t head, used, offset, recordLen, walked;
+	uint32_t count, itr;
+
+	if(SUCCESS != pQueue->store.read(pQueue->store.pStoreData, 0, header, OFFLINE_STORE_HEADER_LEN)) {
+		return false;
+	}
+
+	head = _offline_queue_read_uint32(&header[8]);
+	used = _offline_queue_read_uint32(&header[12]);
+	count = _offline_queue_read_uint32(&header[16]);
+	if(OFFLINE_STORE_MAGIC != _offline_queue_read_uint32(&header[0]) ||
+	   pQueue->bufferSize != _offline_queue_read_uint32(&header[4]) || head >= pQueue->bufferSize ||
+	   used > pQueue->bufferSize) {
+		return false;
+	}
+
+	if(0 == count) {
+		return (0 == used);
+	}
+
+	if(SUCCESS != pQueue->store.read(pQueue->store.pStoreData, OFFLINE_STORE_HEADER_LEN, pQueue->pBuffer,
+									 pQueue->bufferSize)) {
+		return false;
+	}
+
+	offset = head;
+	walked = 0;
+	for(itr = 0; itr < count; itr++) {
+		if(OFFLINE_RECORD_WRAP == pQueue->pBuffer[offset]) {
+			walked += pQueue->bufferSize - offset;
+			offset = 0;
+		}
+		if(OFFLINE_RECORD_PUBLISH != pQueue->pBuffer[offset] ||
+		   OFFLINE_RECORD_HEADER_LEN > pQueue->bufferSize - offset) {
+			return false;
+		}
+		recordLen = _offline_record_len(&(pQueue->pBuffer[offset]));
+		if(recordLen > pQueue->bufferSize - offset || walked + recordLen > used) {
+			return false;
+		}
+		pQueue->pBuffer[offset + 1] &= OFFLINE_RECORD_FLAG_RETAINED;
+		walked += recordLen;
+		offset += recordLen;
+		if(offset == pQueue->bufferSize) {
+			offset = 0;
+		}
+	}
+
+	if(walked != used) {
+		return false;
+	}
+
+	pQueue->head = head;
+	pQueue->used = used;
+	pQueue->count = count;
+	pQueue->unsentCount = count;
+
+	return true;
+}
+
+IoT_Error_t aws_iot_mqtt_offline_queue_init(AWS_IoT_Client *pClient, unsigned char *pBuffer, size_t bufferSize,
+											const IoT_Byte_Store *pStore) {
+	OfflineQueue *pQueue;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(OFFLINE_RECORD_HEADER_LEN >= bufferSize || 0xFFFFFFFFu < (uint64_t) bufferSize) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	if(NULL != pStore && (NULL == pStore->read || NULL == pStore->write)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pQueue = &(pClient->clientData.offlineQueue);
+
+	/* Messages awaiting their PUBACK are referenced by the in-flight table */
+	if(NULL != pQueue->pBuffer && pQueue->count != pQueue->unsentCount) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	pQueue->pBuffer = pBuffer;
+	pQueue->bufferSize = bufferSize;
+	pQueue->head = 0;
+	pQueue->used = 0;
+	pQueue->count = 0;
+	pQueue->unsentCount = 0;
+	pQueue->store.read = NULL;
+	pQueue->store.write = NULL;
+	pQueue->store.pStoreData = NULL;
+	init_timer(&(pQueue->drainTimer));
+
+	if(NULL != pStore) {
+		pQueue->store = *pStore;
+		if(!_offline_queue_load(pQueue)) {
+			IOT_DEBUG("No valid offline queue in store, starting empty");
+			if(SUCCESS != _offline_queue_store_header(pQueue)) {
+				pQueue->pBuffer = NULL;
+				FUNC_EXIT_RC(FAILURE);
+			}
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint32_t aws_iot_mqtt_offline_queue_count(AWS_IoT_Client *pClient) {
+	if(NULL == pClient || NULL == pClient->clientData.offlineQueue.pBuffer) {
+		return 0;
+	}
+	return pClient->clientData.offlineQueue.count;
+}
+
+IoT_Error_t aws_iot_mqtt_offline_queue_set_drop_handler(AWS_IoT_Client *pClient,
+														pOfflineQueueDropHandler_t pDropHandler,
+														void *pDropHandlerData) {
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient->clientData.offlineQueue.pDropHandler = pDropHandler;
+	pClient->clientData.offlineQueue.pDropHandlerData = pDropHandlerData;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+bool aws_iot_mqtt_internal_offline_queue_is_enabled(AWS_IoT_Client *pClient) {
+	return (NULL != pClient->clientData.offlineQueue.pBuffer);
+}
+
+/**
+ * @brief Append a message to the offline queue
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters, only QoS1 messages are queued
+ *
+ * @return SUCCESS once the message is queued (and stored), MQTT_OFFLINE_QUEUE_FULL_ERROR if it does not fit
+ */
+IoT_Error_t aws_iot_mqtt_internal_offline_queue_push(AWS_IoT_Client *pClient, const char *pTopicName,
+													 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
+	OfflineQueue *pQueue = &(pClient->clientData.offlineQueue);
+	size_t recordLen, tail, wrapLen, offset;
+	unsigned char *pRecord;
+	IoT_Error_t rc = SUCCESS;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	FUNC_ENTRY;
+
+	if(NULL == pParams->payload && 0 != pParams->payloadLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Fixed header, topic and packet id must fit the TX buffer when the message is sent */
+	if((size_t) topicNameLen + 9 > pClient->clientData.writeBufSize) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	recordLen = OFFLINE_RECORD_HEADER_LEN + topicNameLen + pParams->payloadLen;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.offline_queue_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	if(0 == pQueue->count) {
+		pQueue->head = 0;
+		pQueue->used = 0;
+	}
+
+	/* Records are kept contiguous, if one does not fit at the end of the ring
+	 * the end is marked unused and the record goes to the start */
+	tail = (pQueue->head + pQueue->used) % pQueue->bufferSize;
+	wrapLen = 0;
+	if(0 != pQueue->used && tail <= pQueue->head) {
+		if(recordLen > pQueue->head - tail) {
+			rc = MQTT_OFFLINE_QUEUE_FULL_ERROR;
+		}
+	} else if(recordLen > pQueue->bufferSize - tail) {
+		wrapLen = pQueue->bufferSize - tail;
+		if(recordLen > pQueue->head) {
+			rc = MQTT_OFFLINE_QUEUE_FULL_ERROR;
+		}
+	}
+
+	if(SUCCESS == rc) {
+		offset = (0 == wrapLen) ? tail : 0;
+		pRecord = &(pQueue->pBuffer[offset]);
+		pRecord[0] = OFFLINE_RECORD_PUBLISH;
+		pRecord[1] = pParams->isRetained ? OFFLINE_RECORD_FLAG_RETAINED : 0;
+		pRecord[2] = (unsigned char) (topicNameLen >> 8);
+		pRecord[3] = (unsigned char) topicNameLen;
+		_offline_queue_write_uint32(&pRecord[4], (uint32_t) pParams->payloadLen);
+		memcpy(&pRecord[OFFLINE_RECORD_HEADER_LEN], pTopicName, topicNameLen);
+		if(0 != pParams->payloadLen) {
+			memcpy(&pRecord[OFFLINE_RECORD_HEADER_LEN + topicNameLen], pParams->payload, pParams->payloadLen);
+		}
+		if(0 != wrapLen) {
+			pQueue->pBuffer[tail] = OFFLINE_RECORD_WRAP;
+		}
+
+		rc = _offline_queue_store_bytes(pQueue, offset, recordLen);
+		if(SUCCESS == rc && 0 != wrapLen) {
+			rc = _offline_queue_store_bytes(pQueue, tail, 1);
+		}
+
+		if(SUCCESS == rc) {
+			pQueue->used += wrapLen + recordLen;
+			pQueue->count++;
+			pQueue->unsentCount++;
+			rc = _offline_queue_store_header(pQueue);
+			if(SUCCESS != rc) {
+				/* The message is still queued in RAM, it will be lost on a reboot only */
+				IOT_WARN("Failed to store the offline queue position, error %d", rc);
+				rc = SUCCESS;
+			}
+		}
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.offline_queue_mutex));
+#endif
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Completion handler of messages sent from the offline queue
+ *
+ * Acknowledged messages leave the queue once every older message has been acknowledged too,
+ * so the queue always holds a contiguous run of messages. A message which was not acknowledged
+ * in time, or was dropped by a clean session, is sent again.
+ */
+static void _offline_queue_publish_complete(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t status,
+											void *pCompleteHandlerData) {
+	OfflineQueue *pQueue = &(pClient->clientData.offlineQueue);
+	unsigned char *pRecord = (unsigned char *) pCompleteHandlerData;
+	size_t recordLen;
+	bool removed = false;
+	IoT_Error_t rc;
+
+	IOT_UNUSED(packetId);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Must not be skipped, block whatever the client lock setting */
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.offline_queue_mutex));
+#endif
+
+	pRecord[1] &= (unsigned char) ~OFFLINE_RECORD_FLAG_SENT;
+	if(SUCCESS == status) {
+		pRecord[1] |= OFFLINE_RECORD_FLAG_ACKED;
+	} else {
+		pQueue->unsentCount++;
+	}
+
+	while(0 != pQueue->count) {
+		_offline_queue_skip_unused_end(pQueue);
+		pRecord = &(pQueue->pBuffer[pQueue->head]);
+		if(0 == (pRecord[1] & OFFLINE_RECORD_FLAG_ACKED)) {
+			break;
+		}
+		recordLen = _offline_record_len(pRecord);
+		pQueue->head += recordLen;
+		pQueue->used -= recordLen;
+		pQueue->count--;
+		removed = true;
+	}
+
+	if(0 == pQueue->count) {
+		pQueue->head = 0;
+		pQueue->used = 0;
+	}
+
+	if(removed) {
+		rc = _offline_queue_store_header(pQueue);
+		if(SUCCESS != rc) {
+			IOT_WARN("Failed to store the offline queue position, error %d", rc);
+		}
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.offline_queue_mutex));
+#endif
+}
+
+/**
+ * @brief Time until the offline queue has its next message to send
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return Milliseconds until the next message is due, UINT32_MAX if nothing can be sent
+ */
+uint32_t aws_iot_mqtt_internal_offline_queue_drain_wait_ms(AWS_IoT_Client *pClient) {
+	OfflineQueue *pQueue = &(pClient->clientData.offlineQueue);
+
+	if(NULL == pQueue->pBuffer || 0 == pQueue->unsentCount ||
+	   AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH <= pClient->clientData.inflightPublishCount) {
+		return UINT32_MAX;
+	}
+
+	return left_ms(&(pQueue->drainTimer));
+}
+
+/**
+ * @brief Send the oldest unsent message of the offline queue
+ *
+ * Called from yield while the client is connected. At most one message is sent every
+ * AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS and only while the in-flight table has
+ * a free entry, so a reconnect is not followed by a burst which the broker throttles.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return SUCCESS, or the network error which prevented the message from being sent
+ */
+IoT_Error_t aws_iot_mqtt_internal_offline_queue_drain(AWS_IoT_Client *pClient) {
+	OfflineQueue *pQueue = &(pClient->clientData.offlineQueue);
+	IoT_Publish_Message_Params params;
+	unsigned char *pRecord = NULL;
+	size_t offset;
+	uint32_t itr;
+	uint16_t topicNameLen;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(0 != aws_iot_mqtt_internal_offline_queue_drain_wait_ms(pClient)) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	if(SUCCESS != aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.offline_queue_mutex))) {
+		/* A publish is being queued, try again on the next pass */
+		FUNC_EXIT_RC(SUCCESS);
+	}
+#endif
+
+	offset = pQueue->head;
+	for(itr = 0; itr < pQueue->count; itr++) {
+		if(offset >= pQueue->bufferSize || OFFLINE_RECORD_WRAP == pQueue->pBuffer[offset]) {
+			offset = 0;
+		}
+		if(0 == (pQueue->pBuffer[offset + 1] & (OFFLINE_RECORD_FLAG_SENT | OFFLINE_RECORD_FLAG_ACKED))) {
+			pRecord = &(pQueue->pBuffer[offset]);
+			pRecord[1] |= OFFLINE_RECORD_FLAG_SENT;
+			pQueue->unsentCount--;
+			break;
+		}
+		offset += _offline_record_len(&(pQueue->pBuffer[offset]));
+	}
+
+	if(NULL == pRecord) {
+		/* Queueing updates the count under the same lock */
+		pQueue->unsentCount = 0;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.offline_queue_mutex));
+#endif
+
+	if(NULL == pRecord) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	/* Sent straight from the ring, the record stays in place until its PUBACK arrives */
+	topicNameLen = _offline_record_topic_len(pRecord);
+	params.qos = QOS1;
+	params.isRetained = (0 != (pRecord[1] & OFFLINE_RECORD_FLAG_RETAINED));
+	params.id = 0;
+	params.payload = &pRecord[OFFLINE_RECORD_HEADER_LEN + topicNameLen];
+	params.payloadLen = _offline_queue_read_uint32(&pRecord[4]);
+
+	rc = aws_iot_mqtt_internal_publish_async(pClient, (const char *) &pRecord[OFFLINE_RECORD_HEADER_LEN], topicNameLen,
+											 &params, _offline_queue_publish_complete, pRecord);
+	countdown_ms(&(pQueue->drainTimer), AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS);
+
+	if(NETWORK_SSL_WRITE_ERROR == rc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == rc || MUTEX_LOCK_ERROR == rc) {
+		/* Sent again once the connection is back */
+		_offline_queue_publish_complete(pClient, 0, rc, pRecord);
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(SUCCESS != rc) {
+		IOT_ERROR("Dropping message which cannot be sent from the offline queue, error %d", rc);
+		if(NULL != pQueue->pDropHandler) {
+			pQueue->pDropHandler(pClient, (const char *) &pRecord[OFFLINE_RECORD_HEADER_LEN], topicNameLen, &params, rc,
+								 pQueue->pDropHandlerData);
+		}
+		/* Released like an acknowledged message, so it does not block those behind it */
+		_offline_queue_publish_complete(pClient, 0, SUCCESS, pRecord);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -69,8 +69,10 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
 }
 
 /**
-  * Serializes the supplied publish data into the supplied buffer, ready for sending
-  * @param pTxBuf the buffer into which the packet will be serialized
+  * Serializes the fixed and variable header of the supplied publish data into the supplied buffer.
+  * The payload is not serialized here, it is sent after the header by aws_iot_mqtt_internal_send_packet_with_payload
+  * or aws_iot_mqtt_internal_send_packet_with_reader
+  * @param pTxBuf the buffer into which the header will be serialized
   * @param txBufLen the length in bytes of the supplied buffer
   * @param dup uint8_t - the MQTT dup flag
   * @param qos QoS - the MQTT QoS value
@@ -78,38 +80,42 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
   * @param packetId uint16_t - the MQTT packet identifier
   * @param pTopicName char * - the MQTT topic in the publish
   * @param topicNameLen uint16_t - the length of the Topic Name
-  * @param pPayload byte buffer - the MQTT publish payload
   * @param payloadLen size_t - the length of the MQTT payload
-  * @param pSerializedLen uint32_t - pointer to the variable that stores serialized len
+  * @param pSerializedLen uint32_t - pointer to the variable that stores serialized header len
   *
   * @return An IoT Error Type defining successful/failed call
   */
-static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish_header(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
 															QoS qos, uint8_t retained, uint16_t packetId,
 															const char *pTopicName, uint16_t topicNameLen,
-															const unsigned char *pPayload, size_t payloadLen,
-															uint32_t *pSerializedLen) {
+															size_t payloadLen, uint32_t *pSerializedLen) {
 	unsigned char *ptr;
 	uint32_t rem_len;
 	IoT_Error_t rc;
 	MQTTHeader header = {0};
 
 	FUNC_ENTRY;
-	if(NULL == pTxBuf || NULL == pPayload || NULL == pSerializedLen) {
+	if(NULL == pTxBuf || NULL == pSerializedLen) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
 	ptr = pTxBuf;
 	rem_len = 0;
 
-	rem_len += (uint32_t) (topicNameLen + payloadLen + 2);
+	rem_len += (uint32_t) (topicNameLen + 2);
 	if(qos > 0) {
 		rem_len += 2; /* packetId */
 	}
+	/* Only the header has to fit in the buffer */
 	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) > txBufLen) {
 		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 	}
 
+	if(payloadLen > MQTT_MAX_REMAINING_LENGTH - rem_len) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+	rem_len += (uint32_t) payloadLen;
+
 	rc = aws_iot_mqtt_internal_init_header(&header, PUBLISH, qos, dup, retained);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
@@ -124,9 +130,6 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 		aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
 	}
 
-	memcpy(ptr, pPayload, payloadLen);
-	ptr += payloadLen;
-
 	*pSerializedLen = (uint32_t) (ptr - pTxBuf);
 
 	FUNC_EXIT_RC(SUCCESS);
@@ -184,18 +187,21 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
  * @note Call is blocking.  In the case of a QoS 0 message the function returns
  * after the message was successfully passed to the TLS layer.  In the case of QoS 1
  * the function returns after the receipt of the PUBACK control packet.
- * This is the internal function which is called by the publish API to perform the operation.
+ * This is the internal function which is called by the publish APIs to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
  *
  * @param pClient Reference to the IoT Client
  * @param pTopicName Topic Name to publish to
  * @param topicNameLen Length of the topic name
  * @param pParams Pointer to Publish Message parameters
+ * @param pPayloadReader Function supplying the payload in chunks, NULL to send pParams->payload
+ * @param pReaderData Context to pass to the reader
  *
  * @return An IoT Error Type defining successful/failed publish
  */
 static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const char *pTopicName,
-												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
+												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+												  pPublishPayloadReader_t pPayloadReader, void *pReaderData) {
 	Timer timer;
 	uint32_t len = 0;
 	uint16_t packet_id;
@@ -204,6 +210,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 
 	FUNC_ENTRY;
 
+	if(NULL == pPayloadReader && NULL == pParams->payload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
@@ -211,16 +221,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
 	}
 
-	rc = _aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+	rc = _aws_iot_mqtt_internal_serialize_publish_header(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
 												  pParams->qos, pParams->isRetained, pParams->id, pTopicName,
-												  topicNameLen, (unsigned char *) pParams->payload,
-												  pParams->payloadLen, &len);
+												  topicNameLen, pParams->payloadLen, &len);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* send the publish packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+	/* send the publish packet, the payload is written from the caller's buffer or pulled from the reader */
+	if(NULL != pPayloadReader) {
+		rc = aws_iot_mqtt_internal_send_packet_with_reader(pClient, len, pParams->payloadLen, pPayloadReader,
+														   pReaderData, &timer);
+	} else {
+		rc = aws_iot_mqtt_internal_send_packet_with_payload(pClient, len, (unsigned char *) pParams->payload,
+															pParams->payloadLen, &timer);
+	}
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -242,8 +257,168 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Validate the client state and run the internal blocking publish
+ *
+ * Shared by the publish and streaming publish APIs.
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+static IoT_Error_t _aws_iot_mqtt_publish_with_reader(AWS_IoT_Client *pClient, const char *pTopicName,
+													 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+													 pPublishPayloadReader_t pPayloadReader, void *pReaderData) {
+	IoT_Error_t rc, pubRc;
+	ClientState clientState;
+
+	FUNC_ENTRY;
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		/* With the offline queue enabled, QoS1 messages are kept until the connection is back */
+		if((CLIENT_STATE_PENDING_RECONNECT == clientState || CLIENT_STATE_DISCONNECTED_ERROR == clientState) &&
+		   QOS1 == pParams->qos && NULL == pPayloadReader && aws_iot_mqtt_internal_offline_queue_is_enabled(pClient)) {
+			rc = aws_iot_mqtt_internal_offline_queue_push(pClient, pTopicName, topicNameLen, pParams);
+			FUNC_EXIT_RC(rc);
+		}
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams, pPayloadReader, pReaderData);
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
+	if(SUCCESS == pubRc && SUCCESS != rc) {
+		pubRc = rc;
+	}
+
+	FUNC_EXIT_RC(pubRc);
+}
+
 IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								 IoT_Publish_Message_Params *pParams) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || 0 == topicNameLen || NULL == pParams) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = _aws_iot_mqtt_publish_with_reader(pClient, pTopicName, topicNameLen, pParams, NULL, NULL);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_publish_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										IoT_Publish_Message_Params *pParams, pPublishPayloadReader_t pPayloadReader,
+										void *pReaderData) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || 0 == topicNameLen || NULL == pParams || NULL == pPayloadReader) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = _aws_iot_mqtt_publish_with_reader(pClient, pTopicName, topicNameLen, pParams, pPayloadReader, pReaderData);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Publish an MQTT message on a topic without waiting for the PUBACK
+ *
+ * Called to publish an MQTT message on a topic.
+ * @note Call returns once the message was successfully passed to the TLS layer.
+ * In the case of QoS 1 the message is recorded in the in-flight table and completed
+ * from aws_iot_mqtt_internal_cycle_read when the PUBACK control packet is received.
+ * This is the internal function which is called by the publish_async API and by the offline queue
+ * to perform the operation. Not meant to be called directly as it doesn't do validations or client state changes
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters
+ * @param pCompleteHandler Callback to invoke when the QoS 1 publish completes
+ * @param pCompleteHandlerData Context to pass to the completion callback
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_mqtt_internal_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+												IoT_Publish_Message_Params *pParams,
+												pPublishCompleteHandler_t pCompleteHandler, void *pCompleteHandlerData) {
+	Timer timer;
+	uint32_t len = 0;
+	uint32_t itr;
+	InflightPublish *pEntry = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pParams->payload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(QOS1 == pParams->qos) {
+		for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+			if(0 == pClient->clientData.inflightPublishes[itr].packetId) {
+				pEntry = &(pClient->clientData.inflightPublishes[itr]);
+				break;
+			}
+		}
+
+		if(NULL == pEntry) {
+			FUNC_EXIT_RC(MQTT_MAX_INFLIGHT_PUBLISH_REACHED_ERROR);
+		}
+
+		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
+	}
+
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	rc = _aws_iot_mqtt_internal_serialize_publish_header(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+												  pParams->qos, pParams->isRetained, pParams->id, pTopicName,
+												  topicNameLen, pParams->payloadLen, &len);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* send the publish packet, the payload is written from the caller's buffer */
+	rc = aws_iot_mqtt_internal_send_packet_with_payload(pClient, len, (unsigned char *) pParams->payload,
+														pParams->payloadLen, &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Track the QoS1 message until its PUBACK is received or the command timeout elapses */
+	if(NULL != pEntry) {
+		pEntry->packetId = pParams->id;
+		pEntry->pTopicName = pTopicName;
+		pEntry->topicNameLen = topicNameLen;
+		pEntry->params = *pParams;
+		pEntry->pCompleteHandler = pCompleteHandler;
+		pEntry->pCompleteHandlerData = pCompleteHandlerData;
+		init_timer(&(pEntry->ackTimer));
+		countdown_ms(&(pEntry->ackTimer), pClient->clientData.commandTimeoutMs);
+		pClient->clientData.inflightPublishCount++;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams,
+									   pPublishCompleteHandler_t pCompleteHandler, void *pCompleteHandlerData) {
 	IoT_Error_t rc, pubRc;
 	ClientState clientState;
 
@@ -267,7 +442,8 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 		FUNC_EXIT_RC(rc);
 	}
 
-	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams);
+	pubRc = aws_iot_mqtt_internal_publish_async(pClient, pTopicName, topicNameLen, pParams, pCompleteHandler,
+												pCompleteHandlerData);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
 	if(SUCCESS == pubRc && SUCCESS != rc) {
@@ -277,6 +453,182 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 	FUNC_EXIT_RC(pubRc);
 }
 
+/**
+ * @brief Release an in-flight publish slot and invoke its completion handler
+ *
+ * The slot is released before the handler runs so the handler may start the next publish.
+ * As for message handlers, a connected client is in the WAIT_FOR_CB_RETURN state for the duration of the call.
+ * A disconnected client keeps its state.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pEntry In-flight entry to complete
+ * @param status Completion status reported to the handler
+ */
+static void _aws_iot_mqtt_internal_release_inflight_publish(AWS_IoT_Client *pClient, InflightPublish *pEntry,
+															IoT_Error_t status) {
+	pPublishCompleteHandler_t pCompleteHandler = pEntry->pCompleteHandler;
+	void *pCompleteHandlerData = pEntry->pCompleteHandlerData;
+	uint16_t packetId = pEntry->packetId;
+	ClientState clientState;
+
+	pEntry->packetId = 0;
+	pClient->clientData.inflightPublishCount--;
+
+	if(NULL == pCompleteHandler) {
+		return;
+	}
+
+	/* Expired while disconnected */
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		pCompleteHandler(pClient, packetId, status, pCompleteHandlerData);
+		return;
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
+	pCompleteHandler(pClient, packetId, status, pCompleteHandlerData);
+	aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
+}
+
+/**
+ * @brief Complete the in-flight publish acknowledged by the PUBACK in the read buffer
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return true if the PUBACK belonged to an asynchronous publish and was consumed,
+ *         false if it should be forwarded to a blocking publish call
+ */
+bool aws_iot_mqtt_internal_complete_inflight_publish(AWS_IoT_Client *pClient) {
+	uint16_t packetId;
+	unsigned char dup, type;
+	uint32_t itr;
+
+	if(0 == pClient->clientData.inflightPublishCount) {
+		return false;
+	}
+
+	if(SUCCESS != aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packetId, pClient->clientData.readBuf,
+														pClient->clientData.readBufSize)) {
+		return false;
+	}
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		if(packetId == pClient->clientData.inflightPublishes[itr].packetId) {
+			_aws_iot_mqtt_internal_release_inflight_publish(pClient, &(pClient->clientData.inflightPublishes[itr]),
+															SUCCESS);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Fail every in-flight publish whose PUBACK did not arrive within the command timeout
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_expire_inflight_publishes(AWS_IoT_Client *pClient) {
+	uint32_t itr;
+
+	if(0 == pClient->clientData.inflightPublishCount) {
+		return;
+	}
+
+	/* Messages of a persistent session are kept while disconnected and replayed on reconnect */
+	if(!pClient->clientData.options.isCleanSession && !aws_iot_mqtt_is_client_connected(pClient)) {
+		return;
+	}
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		if(0 != pClient->clientData.inflightPublishes[itr].packetId &&
+		   has_timer_expired(&(pClient->clientData.inflightPublishes[itr].ackTimer))) {
+			IOT_WARN("PUBACK not received for packet id %u", pClient->clientData.inflightPublishes[itr].packetId);
+			_aws_iot_mqtt_internal_release_inflight_publish(pClient, &(pClient->clientData.inflightPublishes[itr]),
+															MQTT_REQUEST_TIMEOUT_ERROR);
+		}
+	}
+}
+
+/**
+ * @brief Fail every in-flight publish
+ *
+ * Used when a clean session starts, the server will not acknowledge the messages of the previous one.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param status Completion status reported to the handlers
+ */
+void aws_iot_mqtt_internal_fail_inflight_publishes(AWS_IoT_Client *pClient, IoT_Error_t status) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH && 0 != pClient->clientData.inflightPublishCount; ++itr) {
+		if(0 != pClient->clientData.inflightPublishes[itr].packetId) {
+			_aws_iot_mqtt_internal_release_inflight_publish(pClient, &(pClient->clientData.inflightPublishes[itr]),
+															status);
+		}
+	}
+}
+
+/**
+ * @brief Send every in-flight publish again after a reconnect
+ *
+ * Only for a persistent session. When it was resumed each message is sent again with its original packet id
+ * and the DUP flag set, as required by MQTT v3.1.1 Specification 4.4. When the server started a new
+ * session it holds none of them, they are published as new messages with the DUP flag clear.
+ * The acknowledgement timer of each entry is restarted.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param isSessionPresent true if the server resumed the session
+ *
+ * @return An IoT Error Type defining successful/failed retransmission
+ */
+IoT_Error_t aws_iot_mqtt_internal_replay_inflight_publishes(AWS_IoT_Client *pClient, bool isSessionPresent) {
+	uint8_t dup = isSessionPresent ? 1 : 0;
+	Timer timer;
+	uint32_t len = 0;
+	uint32_t itr;
+	InflightPublish *pEntry;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(0 == pClient->clientData.inflightPublishCount) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		pEntry = &(pClient->clientData.inflightPublishes[itr]);
+		if(0 == pEntry->packetId) {
+			continue;
+		}
+
+		init_timer(&timer);
+		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+		rc = _aws_iot_mqtt_internal_serialize_publish_header(pClient->clientData.writeBuf,
+															 pClient->clientData.writeBufSize, dup, pEntry->params.qos,
+															 pEntry->params.isRetained, pEntry->packetId,
+															 pEntry->pTopicName, pEntry->topicNameLen,
+															 pEntry->params.payloadLen, &len);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+
+		rc = aws_iot_mqtt_internal_send_packet_with_payload(pClient, len, (unsigned char *) pEntry->params.payload,
+															pEntry->params.payloadLen, &timer);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+
+		IOT_DEBUG("Replayed publish with packet id %u, DUP %u", pEntry->packetId, dup);
+		pEntry->params.isDup = dup;
+		init_timer(&(pEntry->ackTimer));
+		countdown_ms(&(pEntry->ackTimer), pClient->clientData.commandTimeoutMs);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 /**
   * Deserializes the supplied (wire) buffer into publish data
   * @param dup returned uint8_t - the MQTT dup flag
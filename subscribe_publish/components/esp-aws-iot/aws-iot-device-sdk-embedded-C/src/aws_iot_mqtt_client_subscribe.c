@@ -41,6 +41,49 @@ extern "C" {
 
 #include "aws_iot_mqtt_client_common_internal.h"
 
+/* SUBSCRIBE payload bytes for one topic filter: length, topic and requested QoS */
+#define SUBSCRIBE_ENTRY_LEN(topicNameLen) ((uint32_t) (topicNameLen) + 2 + 1)
+
+/* SUBACK return code of a topic filter refused by the server, MQTT3.1.1 specification 3.9.3 */
+#define SUBACK_RETURN_CODE_FAILURE 0x80
+
+/**
+  * Serializes the fixed header and packet identifier of a subscribe packet, the topic
+  * filters are written after it by the caller
+  * @param pPtr pointer to the write position, advanced past the written data
+  * @param txBufLen the length in bytes of the buffer pPtr points into
+  * @param dup unsigned char - the MQTT dup flag
+  * @param packetId uint16_t - the MQTT packet identifier
+  * @param remLen - remaining length of the packet, including packet identifier and all topic filters
+  *
+  * @return An IoT Error Type defining successful/failed operation
+  */
+static IoT_Error_t _aws_iot_mqtt_serialize_subscribe_header(unsigned char **pPtr, size_t txBufLen,
+															unsigned char dup, uint16_t packetId, uint32_t remLen) {
+	IoT_Error_t rc;
+	MQTTHeader header = {0};
+
+	FUNC_ENTRY;
+
+	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(remLen) > txBufLen) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	rc = aws_iot_mqtt_internal_init_header(&header, SUBSCRIBE, QOS1, dup, 0);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	/* write header */
+	aws_iot_mqtt_internal_write_char(pPtr, header.byte);
+
+	/* write remaining length */
+	*pPtr += aws_iot_mqtt_internal_write_len_to_buffer(*pPtr, remLen);
+
+	aws_iot_mqtt_internal_write_uint_16(pPtr, packetId);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 /**
   * Serializes the supplied subscribe data into the supplied buffer, ready for sending
   * @param pTxBuf the buffer into which the packet will be serialized
@@ -62,7 +105,6 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 	unsigned char *ptr;
 	uint32_t itr, rem_len;
 	IoT_Error_t rc;
-	MQTTHeader header = {0};
 
 	FUNC_ENTRY;
 	if(NULL == pTxBuf || NULL == pSerializedLen) {
@@ -73,24 +115,13 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 	rem_len = 2; /* packetId */
 
 	for(itr = 0; itr < topicCount; ++itr) {
-		rem_len += (uint32_t) (pTopicNameLenList[itr] + 2 + 1); /* topic + length + req_qos */
+		rem_len += SUBSCRIBE_ENTRY_LEN(pTopicNameLenList[itr]);
 	}
 
-	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) > txBufLen) {
-		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
-	}
-
-	rc = aws_iot_mqtt_internal_init_header(&header, SUBSCRIBE, QOS1, dup, 0);
+	rc = _aws_iot_mqtt_serialize_subscribe_header(&ptr, txBufLen, dup, packetId, rem_len);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
-	/* write header */
-	aws_iot_mqtt_internal_write_char(&ptr, header.byte);
-
-	/* write remaining length */
-	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len);
-
-	aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
 
 	for(itr = 0; itr < topicCount; ++itr) {
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicNameList[itr], pTopicNameLenList[itr]);
@@ -105,16 +136,16 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 /**
   * Deserializes the supplied (wire) buffer into suback data
   * @param pPacketId returned integer - the MQTT packet identifier
-  * @param maxExpectedQoSCount - the maximum number of members allowed in the grantedQoSs array
-  * @param pGrantedQoSCount returned uint32_t - number of members in the grantedQoSs array
-  * @param pGrantedQoSs returned array of QoS type - the granted qualities of service
+  * @param pGrantedQoSCount returned uint32_t - number of return codes in the SUBACK
+  * @param ppGrantedQoSs returned pointer to the return codes inside pRxBuf, one per topic filter
+  *        in the order of the SUBSCRIBE. Each is the granted QoS or SUBACK_RETURN_CODE_FAILURE
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   *
   * @return An IoT Error Type defining successful/failed operation
   */
-static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_t maxExpectedQoSCount,
-													uint32_t *pGrantedQoSCount, QoS *pGrantedQoSs,
+static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_t *pGrantedQoSCount,
+													const unsigned char **ppGrantedQoSs,
 													unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curData, *endData;
 	uint32_t decodedLen, readBytesLen;
@@ -122,7 +153,7 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 	MQTTHeader header = {0};
 
 	FUNC_ENTRY;
-	if(NULL == pPacketId || NULL == pGrantedQoSCount || NULL == pGrantedQoSs) {
+	if(NULL == pPacketId || NULL == pGrantedQoSCount || NULL == ppGrantedQoSs) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
@@ -151,20 +182,19 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 	}
 
 	curData += (readBytesLen);
+	if((size_t) (curData - pRxBuf) + decodedLen > rxBufLen) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
+
 	endData = curData + decodedLen;
-	if(endData - curData < 2) {
+	if(endData - curData < 3) {
 		FUNC_EXIT_RC(FAILURE);
 	}
 
 	*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curData);
 
-	*pGrantedQoSCount = 0;
-	while(curData < endData) {
-		if(*pGrantedQoSCount > maxExpectedQoSCount) {
-			FUNC_EXIT_RC(FAILURE);
-		}
-		pGrantedQoSs[(*pGrantedQoSCount)++] = (QoS) aws_iot_mqtt_internal_read_char(&curData);
-	}
+	*pGrantedQoSCount = (uint32_t) (endData - curData);
+	*ppGrantedQoSs = curData;
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -184,6 +214,81 @@ static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pCl
 	FUNC_EXIT_RC(itr);
 }
 
+/**
+ * @brief Register a message handler and index its topic filter
+ *
+ * Done before the SUBSCRIBE is sent, so that running out of handlers or trie nodes
+ * is reported without leaving a subscription on the broker with no handler.
+ *
+ * @param pIndex Set to the index of the registered handler
+ *
+ * @return An IoT Error Type defining successful/failed registration
+ */
+static IoT_Error_t _aws_iot_mqtt_add_message_handler(AWS_IoT_Client *pClient, const char *pTopicName,
+													 uint16_t topicNameLen, QoS qos,
+													 pApplicationHandler_t pApplicationHandler,
+													 pApplicationStreamHandler_t pApplicationStreamHandler,
+													 void *pApplicationHandlerData, uint32_t *pIndex) {
+	uint32_t indexOfFreeMessageHandler;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
+			pTopicName;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
+			topicNameLen;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
+			pApplicationHandler;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationStreamHandler =
+			pApplicationStreamHandler;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
+			pApplicationHandlerData;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
+	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].resubscribed = 0;
+
+	rc = aws_iot_mqtt_internal_topic_trie_insert(pClient, (uint16_t) indexOfFreeMessageHandler);
+	if(SUCCESS != rc) {
+		pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName = NULL;
+		FUNC_EXIT_RC(rc);
+	}
+
+	*pIndex = indexOfFreeMessageHandler;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+static void _aws_iot_mqtt_remove_message_handler(AWS_IoT_Client *pClient, uint32_t index) {
+	aws_iot_mqtt_internal_topic_trie_remove(pClient, (uint16_t) index);
+	pClient->clientData.messageHandlers[index].topicName = NULL;
+}
+
+/**
+ * @brief Remove the message handler registered for an entry of a batched subscribe
+ *
+ * Handlers are matched on topic name pointer, callback and callback data, an identical
+ * subscription made earlier is indistinguishable and equally fine to remove.
+ */
+static void _aws_iot_mqtt_remove_batch_message_handler(AWS_IoT_Client *pClient,
+													   const IoT_Subscribe_Topic_Params *pTopic) {
+	uint32_t itr;
+	MessageHandlers *pHandler;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		pHandler = &(pClient->clientData.messageHandlers[itr]);
+		if(pHandler->topicName == pTopic->pTopicName && pHandler->pApplicationHandler == pTopic->pApplicationHandler &&
+		   pHandler->pApplicationHandlerData == pTopic->pApplicationHandlerData) {
+			_aws_iot_mqtt_remove_message_handler(pClient, itr);
+			break;
+		}
+	}
+}
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -199,6 +304,8 @@ static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pCl
  *     no malloc are performed by the SDK
  * @param topicNameLen Length of the topic name
  * @param pApplicationHandler_t Reference to the handler function for this subscription
+ * @param pApplicationStreamHandler Reference to the streaming handler function for this subscription,
+ *     NULL unless called from the streaming subscribe API
  * @param pApplicationHandlerData Point to data passed to the callback.
  *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
  *
@@ -207,12 +314,13 @@ static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pCl
 static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const char *pTopicName,
 													uint16_t topicNameLen, QoS qos,
 													pApplicationHandler_t pApplicationHandler,
+													pApplicationStreamHandler_t pApplicationStreamHandler,
 													void *pApplicationHandlerData) {
 	uint16_t txPacketId, rxPacketId;
 	uint32_t serializedLen, indexOfFreeMessageHandler, count;
 	IoT_Error_t rc;
 	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	const unsigned char *pGrantedQoSs = NULL;
 
 	FUNC_ENTRY;
 	init_timer(&timer);
@@ -229,27 +337,28 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 		FUNC_EXIT_RC(rc);
 	}
 
-	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
-		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	rc = _aws_iot_mqtt_add_message_handler(pClient, pTopicName, topicNameLen, qos, pApplicationHandler,
+										   pApplicationStreamHandler, pApplicationHandlerData,
+										   &indexOfFreeMessageHandler);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
 	}
 
 	/* send the subscribe packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	if(SUCCESS == rc) {
+		/* wait for suback */
+		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
 	}
 
-	/* wait for suback */
-	rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	if(SUCCESS == rc) {
+		/* Granted QoS can be 0, 1 or 2 */
+		rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, &count, &pGrantedQoSs, pClient->clientData.readBuf,
+											  pClient->clientData.readBufSize);
 	}
 
-	/* Granted QoS can be 0, 1 or 2 */
-	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-										  pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
+		_aws_iot_mqtt_remove_message_handler(pClient, indexOfFreeMessageHandler);
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -260,30 +369,125 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	//	return RX_MESSAGE_INVALID_ERROR;
 	//}
 
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
-			pTopicName;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
-			topicNameLen;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
-			pApplicationHandler;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
-			pApplicationHandlerData;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
-
 	FUNC_EXIT_RC(SUCCESS);
 }
 
-IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
-								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
-	ClientState clientState;
-	IoT_Error_t rc, subRc;
+/**
+ * @brief Subscribe to several MQTT topics with one SUBSCRIBE packet.
+ *
+ * This is the internal function which is called by the subscribe batch API to perform
+ * the operation. Not meant to be called directly as it doesn't do validations or client
+ * state changes
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopics Topic filters to subscribe to, with their handlers
+ * @param topicCount Number of entries in pTopics
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_subscribe_batch(AWS_IoT_Client *pClient,
+														  const IoT_Subscribe_Topic_Params *pTopics,
+														  uint32_t topicCount) {
+	uint16_t rxPacketId;
+	uint32_t remLen, grantedCount, handlerIndex, itr;
+	unsigned char *ptr;
+	const unsigned char *pGrantedQoSs = NULL;
+	bool isRejected;
+	IoT_Error_t rc;
+	Timer timer;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationHandler) {
-		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	remLen = 2; /* packetId */
+	for(itr = 0; itr < topicCount; itr++) {
+		remLen += SUBSCRIBE_ENTRY_LEN(pTopics[itr].topicNameLen);
 	}
 
+	ptr = pClient->clientData.writeBuf;
+	rc = _aws_iot_mqtt_serialize_subscribe_header(&ptr, pClient->clientData.writeBufSize, 0,
+												  aws_iot_mqtt_get_next_packet_id(pClient), remLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	for(itr = 0; itr < topicCount; itr++) {
+		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopics[itr].pTopicName, pTopics[itr].topicNameLen);
+		aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) pTopics[itr].qos);
+	}
+
+	for(itr = 0; itr < topicCount; itr++) {
+		rc = _aws_iot_mqtt_add_message_handler(pClient, pTopics[itr].pTopicName, pTopics[itr].topicNameLen,
+											   pTopics[itr].qos, pTopics[itr].pApplicationHandler, NULL,
+											   pTopics[itr].pApplicationHandlerData, &handlerIndex);
+		if(SUCCESS != rc) {
+			break;
+		}
+	}
+
+	if(SUCCESS == rc) {
+		init_timer(&timer);
+		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+		rc = aws_iot_mqtt_internal_send_packet(pClient, (size_t) (ptr - pClient->clientData.writeBuf), &timer);
+	}
+
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
+	}
+
+	if(SUCCESS == rc) {
+		rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, &grantedCount, &pGrantedQoSs,
+											  pClient->clientData.readBuf, pClient->clientData.readBufSize);
+	}
+
+	if(SUCCESS == rc && grantedCount != topicCount) {
+		rc = FAILURE;
+	}
+
+	if(SUCCESS != rc) {
+		/* Only the handlers registered before the failure, all of them once the packet was sent */
+		while(itr > 0) {
+			itr--;
+			_aws_iot_mqtt_remove_batch_message_handler(pClient, &pTopics[itr]);
+		}
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Filters refused by the server keep no handler, the accepted ones stay subscribed */
+	isRejected = false;
+	for(itr = 0; itr < topicCount; itr++) {
+		if(SUBACK_RETURN_CODE_FAILURE == pGrantedQoSs[itr]) {
+			IOT_WARN("Subscription to topic filter %.*s refused by the server", pTopics[itr].topicNameLen,
+					 pTopics[itr].pTopicName);
+			_aws_iot_mqtt_remove_batch_message_handler(pClient, &pTopics[itr]);
+			isRejected = true;
+		}
+	}
+
+	FUNC_EXIT_RC(isRejected ? MQTT_SUBSCRIBE_REJECTED_ERROR : SUCCESS);
+}
+
+/**
+ * @brief Validate the client state and run the internal subscribe
+ *
+ * Shared by the subscribe, streaming subscribe and subscribe batch APIs. For a single topic
+ * exactly one of the two handlers is expected to be set, pTopics is set for a batch.
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_subscribe_with_handler(AWS_IoT_Client *pClient, const char *pTopicName,
+														uint16_t topicNameLen, QoS qos,
+														pApplicationHandler_t pApplicationHandler,
+														pApplicationStreamHandler_t pApplicationStreamHandler,
+														void *pApplicationHandlerData,
+														const IoT_Subscribe_Topic_Params *pTopics,
+														uint32_t topicCount) {
+	ClientState clientState;
+	IoT_Error_t rc, subRc;
+
+	FUNC_ENTRY;
+
 	if(!aws_iot_mqtt_is_client_connected(pClient)) {
 		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 	}
@@ -298,8 +502,13 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 		FUNC_EXIT_RC(rc);
 	}
 
-	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pTopicName, topicNameLen, qos,
-											 pApplicationHandler, pApplicationHandlerData);
+	if(NULL != pTopics) {
+		subRc = _aws_iot_mqtt_internal_subscribe_batch(pClient, pTopics, topicCount);
+	} else {
+		subRc = _aws_iot_mqtt_internal_subscribe(pClient, pTopicName, topicNameLen, qos,
+												 pApplicationHandler, pApplicationStreamHandler,
+												 pApplicationHandlerData);
+	}
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
 	if(SUCCESS == subRc && SUCCESS != rc) {
@@ -309,6 +518,67 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 	FUNC_EXIT_RC(subRc);
 }
 
+IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationHandler) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = _aws_iot_mqtt_subscribe_with_handler(pClient, pTopicName, topicNameLen, qos,
+											  pApplicationHandler, NULL, pApplicationHandlerData, NULL, 0);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_subscribe_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  QoS qos, pApplicationStreamHandler_t pApplicationStreamHandler,
+										  void *pApplicationHandlerData) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationStreamHandler) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = _aws_iot_mqtt_subscribe_with_handler(pClient, pTopicName, topicNameLen, qos,
+											  NULL, pApplicationStreamHandler, pApplicationHandlerData, NULL, 0);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Topic_Params *pTopics,
+										 uint32_t topicCount) {
+	uint32_t itr;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopics || 0 == topicCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(itr = 0; itr < topicCount; itr++) {
+		if(NULL == pTopics[itr].pTopicName || NULL == pTopics[itr].pApplicationHandler) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
+	rc = _aws_iot_mqtt_subscribe_with_handler(pClient, NULL, 0, QOS0, NULL, NULL, NULL, pTopics, topicCount);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/* Whether the handler at index still needs to be sent in the current re-subscribe attempt */
+static bool _aws_iot_mqtt_needs_resubscribe(AWS_IoT_Client *pClient, uint32_t index) {
+	return (NULL != pClient->clientData.messageHandlers[index].topicName &&
+			1 != pClient->clientData.messageHandlers[index].resubscribed);
+}
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -317,6 +587,9 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * This is the internal function which is called by the resubscribe API to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
  * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * As many topic filters as fit in the TX buffer, and whose SUBACK fits in the RX buffer,
+ * are sent in each SUBSCRIBE packet, so a reconnect costs one round trip per packet
+ * instead of one per subscription.
  *
  * @param pClient Reference to the IoT Client
  *
@@ -324,43 +597,65 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  */
 static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
 	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
+	uint32_t remLen, entryLen, count, grantedCount, firstIndex, endIndex, itr;
+	unsigned char *ptr;
+	const unsigned char *pGrantedQoSs = NULL;
 	IoT_Error_t rc;
 	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
 
 	FUNC_ENTRY;
 
 	packetId = 0;
-	len = 0;
-	count = 0;
-	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-
-	for(itr = 0; itr < existingSubCount; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
-			continue;
-		}
+	firstIndex = 0;
 
+	while(firstIndex < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS) {
 		/* Do not attempt to subscribe to topics which have already been subscribed
 		 to in the previous re-subscribe attempts. */
-		if(pClient->clientData.messageHandlers[itr].resubscribed == 1) {
-			continue;
+		remLen = 2; /* packetId */
+		count = 0;
+		for(endIndex = firstIndex; endIndex < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; endIndex++) {
+			if(!_aws_iot_mqtt_needs_resubscribe(pClient, endIndex)) {
+				continue;
+			}
+
+			/* Sending needs the packet to be shorter than the TX buffer */
+			entryLen = SUBSCRIBE_ENTRY_LEN(pClient->clientData.messageHandlers[endIndex].topicNameLen);
+			if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(remLen + entryLen) >=
+			   pClient->clientData.writeBufSize ||
+			   aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(2 + count + 1) >
+			   pClient->clientData.readBufSize) {
+				break;
+			}
+
+			remLen += entryLen;
+			count++;
 		}
 
-		init_timer(&timer);
-		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+		if(0 == count) {
+			/* Either everything has been sent or a single filter is too long for the TX buffer */
+			FUNC_EXIT_RC((AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS == endIndex) ? SUCCESS : MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+		}
 
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
+		ptr = pClient->clientData.writeBuf;
+		rc = _aws_iot_mqtt_serialize_subscribe_header(&ptr, pClient->clientData.writeBufSize, 0,
+													  aws_iot_mqtt_get_next_packet_id(pClient), remLen);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
+		for(itr = firstIndex; itr < endIndex; itr++) {
+			if(_aws_iot_mqtt_needs_resubscribe(pClient, itr)) {
+				aws_iot_mqtt_internal_write_utf8_string(&ptr, pClient->clientData.messageHandlers[itr].topicName,
+														pClient->clientData.messageHandlers[itr].topicNameLen);
+				aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) pClient->clientData.messageHandlers[itr].qos);
+			}
+		}
+
+		init_timer(&timer);
+		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
 		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+		rc = aws_iot_mqtt_internal_send_packet(pClient, (size_t) (ptr - pClient->clientData.writeBuf), &timer);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
@@ -372,15 +667,24 @@ static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
 		}
 
 		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
+		rc = _aws_iot_mqtt_deserialize_suback(&packetId, &grantedCount, &pGrantedQoSs, pClient->clientData.readBuf,
 											  pClient->clientData.readBufSize);
+		if(SUCCESS == rc && grantedCount != count) {
+			rc = FAILURE;
+		}
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* Record that this topic has been subscribed to, so that we do not
-		 * attempt to subscribe again to the same topic. */
-		pClient->clientData.messageHandlers[itr].resubscribed = 1;
+		/* Record that these topics have been subscribed to, so that we do not
+		 * attempt to subscribe again to the same topics. */
+		for(itr = firstIndex; itr < endIndex; itr++) {
+			if(_aws_iot_mqtt_needs_resubscribe(pClient, itr)) {
+				pClient->clientData.messageHandlers[itr].resubscribed = 1;
+			}
+		}
+
+		firstIndex = endIndex;
 	}
 
 	FUNC_EXIT_RC(SUCCESS);
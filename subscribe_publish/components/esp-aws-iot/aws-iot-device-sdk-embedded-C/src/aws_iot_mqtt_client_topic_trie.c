@@ -0,0 +1,349 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_topic_trie.c
+ * @brief MQTT client topic filter index used to dispatch incoming messages
+ *
+ * Every subscribed topic filter is stored as a path of levels in a trie, levels shared
+ * between filters are stored once. An incoming topic name is matched by walking the
+ * trie one level at a time, following the exact level, '+' and '#' children, so the
+ * cost of dispatch grows with the depth of the topic and not with the number of
+ * subscriptions. Nodes come from a fixed pool in ClientData since no malloc are
+ * performed by the SDK.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client_common_internal.h"
+
+#define TOPIC_TRIE_ROOT 0
+
+/**
+ * @brief Find the end of the topic level starting at pLevel
+ *
+ * @param pLevel Start of the level
+ * @param pEnd End of the topic name or filter
+ * @param pLevelLen Returns the length of the level
+ *
+ * @return Start of the following level, NULL if this is the last one
+ */
+static const char *_aws_iot_mqtt_topic_trie_next_level(const char *pLevel, const char *pEnd, uint16_t *pLevelLen) {
+	const char *pSeparator = (const char *) memchr(pLevel, '/', (size_t) (pEnd - pLevel));
+
+	if(NULL == pSeparator) {
+		*pLevelLen = (uint16_t) (pEnd - pLevel);
+		return NULL;
+	}
+
+	*pLevelLen = (uint16_t) (pSeparator - pLevel);
+	return pSeparator + 1;
+}
+
+/**
+ * @brief Find the end of the topic filter of a message handler
+ *
+ * Filters are matched up to the first NULL character, as topic names were previously
+ * compared as strings, or up to topicNameLen otherwise.
+ */
+static const char *_aws_iot_mqtt_topic_trie_filter_end(const MessageHandlers *pHandler) {
+	const char *pEnd = (const char *) memchr(pHandler->topicName, '\0', pHandler->topicNameLen);
+
+	return (NULL != pEnd) ? pEnd : pHandler->topicName + pHandler->topicNameLen;
+}
+
+static bool _aws_iot_mqtt_topic_trie_is_level(const TopicTrieNode *pNode, const char *pLevel, uint16_t levelLen) {
+	return (pNode->levelLen == levelLen) && (0 == memcmp(pNode->pLevel, pLevel, levelLen));
+}
+
+static uint16_t _aws_iot_mqtt_topic_trie_find_child(AWS_IoT_Client *pClient, uint16_t nodeIndex,
+													const char *pLevel, uint16_t levelLen) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	uint16_t childIndex;
+
+	for(childIndex = pNodes[nodeIndex].firstChild; AWS_IOT_MQTT_TOPIC_TRIE_NONE != childIndex;
+		childIndex = pNodes[childIndex].nextSibling) {
+		if(_aws_iot_mqtt_topic_trie_is_level(&pNodes[childIndex], pLevel, levelLen)) {
+			break;
+		}
+	}
+
+	return childIndex;
+}
+
+/**
+ * @brief Point a node at the same level in the topic filter of another handler below it
+ *
+ * Used when the handler the node was anchored to is removed while the node is still in use.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param nodeIndex Node to re-anchor, must have at least one handler in its subtree
+ * @param depth Depth of the node, the children of the root are at depth 1
+ */
+static void _aws_iot_mqtt_topic_trie_reanchor(AWS_IoT_Client *pClient, uint16_t nodeIndex, uint16_t depth) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	MessageHandlers *pHandler;
+	const char *pLevel;
+	const char *pEnd;
+	uint16_t levelLen;
+	uint16_t descendant = nodeIndex;
+
+	while(AWS_IOT_MQTT_TOPIC_TRIE_NONE == pNodes[descendant].firstHandler) {
+		descendant = pNodes[descendant].firstChild;
+	}
+
+	pHandler = &pClient->clientData.messageHandlers[pNodes[descendant].firstHandler];
+	pLevel = pHandler->topicName;
+	pEnd = _aws_iot_mqtt_topic_trie_filter_end(pHandler);
+	while(--depth > 0) {
+		pLevel = _aws_iot_mqtt_topic_trie_next_level(pLevel, pEnd, &levelLen);
+	}
+
+	pNodes[nodeIndex].pLevel = pLevel;
+	pNodes[nodeIndex].anchorHandler = pNodes[descendant].firstHandler;
+}
+
+/**
+ * @brief Walk from a node up to the root, releasing nodes that became empty
+ *
+ * Nodes that no longer have handlers or children are returned to the free list.
+ * Nodes kept in use that refer into the topic filter of handlerIndex are re-anchored.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param nodeIndex Deepest node of the path
+ * @param depth Depth of nodeIndex
+ * @param handlerIndex Handler whose topic filter is being dropped from the trie
+ */
+static void _aws_iot_mqtt_topic_trie_prune(AWS_IoT_Client *pClient, uint16_t nodeIndex, uint16_t depth,
+										   uint16_t handlerIndex) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	uint16_t parentIndex;
+	uint16_t *pLink;
+
+	while(TOPIC_TRIE_ROOT != nodeIndex) {
+		parentIndex = pNodes[nodeIndex].parent;
+
+		if(AWS_IOT_MQTT_TOPIC_TRIE_NONE == pNodes[nodeIndex].firstChild
+		   && AWS_IOT_MQTT_TOPIC_TRIE_NONE == pNodes[nodeIndex].firstHandler) {
+			for(pLink = &pNodes[parentIndex].firstChild; nodeIndex != *pLink; pLink = &pNodes[*pLink].nextSibling);
+			*pLink = pNodes[nodeIndex].nextSibling;
+
+			pNodes[nodeIndex].pLevel = NULL;
+			pNodes[nodeIndex].nextSibling = pClient->clientData.topicTrieFreeNode;
+			pClient->clientData.topicTrieFreeNode = nodeIndex;
+		} else if(handlerIndex == pNodes[nodeIndex].anchorHandler) {
+			_aws_iot_mqtt_topic_trie_reanchor(pClient, nodeIndex, depth);
+		}
+
+		nodeIndex = parentIndex;
+		depth--;
+	}
+}
+
+static void _aws_iot_mqtt_topic_trie_mark_handlers(AWS_IoT_Client *pClient, uint16_t nodeIndex,
+												   uint32_t *pMatchedHandlers) {
+	uint16_t handlerIndex;
+
+	for(handlerIndex = pClient->clientData.topicTrieNodes[nodeIndex].firstHandler;
+		AWS_IOT_MQTT_TOPIC_TRIE_NONE != handlerIndex;
+		handlerIndex = pClient->clientData.messageHandlers[handlerIndex].nextHandler) {
+		pMatchedHandlers[handlerIndex / 32] |= (uint32_t) 1 << (handlerIndex % 32);
+	}
+}
+
+/**
+ * @brief Collect the handlers below nodeIndex whose topic filter matches the rest of the topic name
+ *
+ * @param pClient Reference to the IoT Client
+ * @param nodeIndex Node matched by the previous levels of the topic name
+ * @param pLevel Start of the next level of the topic name, NULL once all levels are matched
+ * @param pEnd End of the topic name
+ * @param pMatchedHandlers Bitmap of handlers, bits of matching handlers are set
+ */
+static void _aws_iot_mqtt_topic_trie_match_level(AWS_IoT_Client *pClient, uint16_t nodeIndex, const char *pLevel,
+												 const char *pEnd, uint32_t *pMatchedHandlers) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	const char *pNextLevel = NULL;
+	uint16_t levelLen = 0;
+	uint16_t childIndex;
+	bool skipWildcards;
+
+	if(NULL == pLevel) {
+		_aws_iot_mqtt_topic_trie_mark_handlers(pClient, nodeIndex, pMatchedHandlers);
+	} else {
+		pNextLevel = _aws_iot_mqtt_topic_trie_next_level(pLevel, pEnd, &levelLen);
+	}
+
+	/* Wildcards at the first level do not match topic names starting with '$' */
+	skipWildcards = (TOPIC_TRIE_ROOT == nodeIndex) && (NULL != pLevel) && (pLevel < pEnd) && ('$' == *pLevel);
+
+	for(childIndex = pNodes[nodeIndex].firstChild; AWS_IOT_MQTT_TOPIC_TRIE_NONE != childIndex;
+		childIndex = pNodes[childIndex].nextSibling) {
+		if(_aws_iot_mqtt_topic_trie_is_level(&pNodes[childIndex], "#", 1)) {
+			/* '#' also matches the parent level, "a/#" receives messages published to "a" */
+			if(!skipWildcards) {
+				_aws_iot_mqtt_topic_trie_mark_handlers(pClient, childIndex, pMatchedHandlers);
+			}
+		} else if(NULL != pLevel) {
+			if(_aws_iot_mqtt_topic_trie_is_level(&pNodes[childIndex], pLevel, levelLen)
+			   || (!skipWildcards && _aws_iot_mqtt_topic_trie_is_level(&pNodes[childIndex], "+", 1))) {
+				_aws_iot_mqtt_topic_trie_match_level(pClient, childIndex, pNextLevel, pEnd, pMatchedHandlers);
+			}
+		}
+	}
+}
+
+void aws_iot_mqtt_internal_topic_trie_init(AWS_IoT_Client *pClient) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	uint16_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES; ++itr) {
+		pNodes[itr].pLevel = NULL;
+		pNodes[itr].levelLen = 0;
+		pNodes[itr].anchorHandler = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+		pNodes[itr].parent = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+		pNodes[itr].firstChild = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+		pNodes[itr].firstHandler = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+		pNodes[itr].nextSibling = (uint16_t) (itr + 1);
+	}
+	pNodes[AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES - 1].nextSibling = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+
+	/* Node 0 is the root and never released */
+	pNodes[TOPIC_TRIE_ROOT].nextSibling = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+	pClient->clientData.topicTrieFreeNode = (AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES > 1) ? 1 : AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
+		pClient->clientData.messageHandlers[itr].nextHandler = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+	}
+}
+
+/**
+ * @brief Add the topic filter of a message handler to the trie
+ *
+ * The handler must already hold its topic name and length.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param handlerIndex Index of the handler in messageHandlers
+ *
+ * @return SUCCESS, or MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR if the node pool is exhausted
+ */
+IoT_Error_t aws_iot_mqtt_internal_topic_trie_insert(AWS_IoT_Client *pClient, uint16_t handlerIndex) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	MessageHandlers *pHandler = &pClient->clientData.messageHandlers[handlerIndex];
+	const char *pLevel = pHandler->topicName;
+	const char *pEnd = _aws_iot_mqtt_topic_trie_filter_end(pHandler);
+	const char *pNextLevel;
+	uint16_t levelLen;
+	uint16_t depth = 0;
+	uint16_t nodeIndex = TOPIC_TRIE_ROOT;
+	uint16_t childIndex;
+
+	FUNC_ENTRY;
+
+	do {
+		pNextLevel = _aws_iot_mqtt_topic_trie_next_level(pLevel, pEnd, &levelLen);
+
+		childIndex = _aws_iot_mqtt_topic_trie_find_child(pClient, nodeIndex, pLevel, levelLen);
+		if(AWS_IOT_MQTT_TOPIC_TRIE_NONE == childIndex) {
+			childIndex = pClient->clientData.topicTrieFreeNode;
+			if(AWS_IOT_MQTT_TOPIC_TRIE_NONE == childIndex) {
+				/* Release the levels already added for this filter */
+				_aws_iot_mqtt_topic_trie_prune(pClient, nodeIndex, depth, handlerIndex);
+				FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+			}
+			pClient->clientData.topicTrieFreeNode = pNodes[childIndex].nextSibling;
+
+			pNodes[childIndex].pLevel = pLevel;
+			pNodes[childIndex].levelLen = levelLen;
+			pNodes[childIndex].anchorHandler = handlerIndex;
+			pNodes[childIndex].parent = nodeIndex;
+			pNodes[childIndex].firstChild = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+			pNodes[childIndex].firstHandler = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+			pNodes[childIndex].nextSibling = pNodes[nodeIndex].firstChild;
+			pNodes[nodeIndex].firstChild = childIndex;
+		}
+
+		nodeIndex = childIndex;
+		depth++;
+		pLevel = pNextLevel;
+	} while(NULL != pLevel);
+
+	pHandler->nextHandler = pNodes[nodeIndex].firstHandler;
+	pNodes[nodeIndex].firstHandler = handlerIndex;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Remove the topic filter of a message handler from the trie
+ *
+ * Must be called before the topic name of the handler is cleared.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param handlerIndex Index of the handler in messageHandlers
+ */
+void aws_iot_mqtt_internal_topic_trie_remove(AWS_IoT_Client *pClient, uint16_t handlerIndex) {
+	TopicTrieNode *pNodes = pClient->clientData.topicTrieNodes;
+	MessageHandlers *pHandlers = pClient->clientData.messageHandlers;
+	const char *pLevel = pHandlers[handlerIndex].topicName;
+	const char *pEnd = _aws_iot_mqtt_topic_trie_filter_end(&pHandlers[handlerIndex]);
+	const char *pNextLevel;
+	uint16_t levelLen;
+	uint16_t depth = 0;
+	uint16_t nodeIndex = TOPIC_TRIE_ROOT;
+	uint16_t *pLink;
+
+	do {
+		pNextLevel = _aws_iot_mqtt_topic_trie_next_level(pLevel, pEnd, &levelLen);
+		nodeIndex = _aws_iot_mqtt_topic_trie_find_child(pClient, nodeIndex, pLevel, levelLen);
+		depth++;
+		pLevel = pNextLevel;
+	} while(NULL != pLevel && AWS_IOT_MQTT_TOPIC_TRIE_NONE != nodeIndex);
+
+	if(AWS_IOT_MQTT_TOPIC_TRIE_NONE == nodeIndex) {
+		return;
+	}
+
+	for(pLink = &pNodes[nodeIndex].firstHandler; AWS_IOT_MQTT_TOPIC_TRIE_NONE != *pLink;
+		pLink = &pHandlers[*pLink].nextHandler) {
+		if(handlerIndex == *pLink) {
+			*pLink = pHandlers[handlerIndex].nextHandler;
+			pHandlers[handlerIndex].nextHandler = AWS_IOT_MQTT_TOPIC_TRIE_NONE;
+			_aws_iot_mqtt_topic_trie_prune(pClient, nodeIndex, depth, handlerIndex);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Find every message handler whose topic filter matches a topic name
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic name of the incoming message
+ * @param topicNameLen Length of the topic name
+ * @param pMatchedHandlers Bitmap of AWS_IOT_MQTT_HANDLER_BITMAP_WORDS words, bit i is set when
+ *     messageHandlers[i] matches. The caller clears it beforehand.
+ */
+void aws_iot_mqtt_internal_topic_trie_match(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+											uint32_t *pMatchedHandlers) {
+	_aws_iot_mqtt_topic_trie_match_level(pClient, TOPIC_TRIE_ROOT, pTopicName, pTopicName + topicNameLen,
+										 pMatchedHandlers);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -115,23 +115,38 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_unsuback(uint16_t *pPacketId, unsig
 	FUNC_EXIT_RC(rc);
 }
 
+/* Returns AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS if no handler is registered for the topic filter */
+static uint32_t _aws_iot_mqtt_find_message_handler_index(AWS_IoT_Client *pClient, const char *pTopicFilter) {
+	uint32_t i;
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
+		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
+		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
+			break;
+		}
+	}
+
+	return i;
+}
+
 /**
- * @brief Unsubscribe to an MQTT topic.
+ * @brief Unsubscribe to MQTT topics.
  *
- * Called to send an unsubscribe message to the broker requesting removal of a subscription
- * to an MQTT topic.
+ * Called to send an unsubscribe message to the broker requesting removal of the subscriptions
+ * to one or more MQTT topics.
  * @note Call is blocking.  The call returns after the receipt of the UNSUBACK control packet.
- * This is the internal function which is called by the unsubscribe API to perform the operation.
+ * This is the internal function which is called by the unsubscribe APIs to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to
- * @param topicNameLen Length of the topic name
+ * @param pTopicFilters Topic filters to unsubscribe from
+ * @param pTopicFilterLens Lengths of the topic filters
+ * @param count Number of topic filters, all of them are sent in a single UNSUBSCRIBE packet
  *
  * @return An IoT Error Type defining successful/failed unsubscribe call
  */
-static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, const char *pTopicFilter,
-													  uint16_t topicFilterLen) {
+static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, const char **pTopicFilters,
+													  uint16_t *pTopicFilterLens, uint32_t count) {
 	/* No NULL checks because this is a static internal function */
 
 	Timer timer;
@@ -139,30 +154,24 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 	uint16_t packet_id;
 	uint32_t serializedLen = 0;
 	uint32_t i = 0;
+	uint32_t itr = 0;
 	IoT_Error_t rc;
-	bool subscriptionExists = false;
 
 	FUNC_ENTRY;
 
-	/* Remove from message handler array */
-	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
-		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
-		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
-			subscriptionExists = true;
-            break;
+	/* Every topic filter must have been subscribed to */
+	for(itr = 0; itr < count; ++itr) {
+		if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS == _aws_iot_mqtt_find_message_handler_index(pClient, pTopicFilters[itr])) {
+			FUNC_EXIT_RC(FAILURE);
 		}
 	}
 
-	if(false == subscriptionExists) {
-		FUNC_EXIT_RC(FAILURE);
-	}
-
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
 	rc = _aws_iot_mqtt_serialize_unsubscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											 aws_iot_mqtt_get_next_packet_id(pClient), 1, &pTopicFilter,
-											 &topicFilterLen, &serializedLen);
+											 aws_iot_mqtt_get_next_packet_id(pClient), count, pTopicFilters,
+											 pTopicFilterLens, &serializedLen);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -184,26 +193,33 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 	}
 
 	/* Remove from message handler array */
-	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
-		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
-		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
-			pClient->clientData.messageHandlers[i].topicName = NULL;
-			/* We don't want to break here, in case the same topic is registered
-             * with 2 callbacks. Unlikely scenario */
+	for(itr = 0; itr < count; ++itr) {
+		for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
+			if(pClient->clientData.messageHandlers[i].topicName != NULL &&
+			   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilters[itr]) == 0)) {
+				aws_iot_mqtt_internal_topic_trie_remove(pClient, (uint16_t) i);
+				pClient->clientData.messageHandlers[i].topicName = NULL;
+				/* We don't want to break here, in case the same topic is registered
+				 * with 2 callbacks. Unlikely scenario */
+			}
 		}
 	}
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
-IoT_Error_t aws_iot_mqtt_unsubscribe(AWS_IoT_Client *pClient, const char *pTopicFilter, uint16_t topicFilterLen) {
+/**
+ * @brief Validate the client state and run the internal unsubscribe
+ *
+ * Shared by the unsubscribe and unsubscribe batch APIs.
+ *
+ * @return An IoT Error Type defining successful/failed unsubscribe call
+ */
+static IoT_Error_t _aws_iot_mqtt_unsubscribe_with_state(AWS_IoT_Client *pClient, const char **pTopicFilters,
+														uint16_t *pTopicFilterLens, uint32_t count) {
 	IoT_Error_t rc, unsubRc;
 	ClientState clientState;
 
-	if(NULL == pClient || NULL == pTopicFilter) {
-		return NULL_VALUE_ERROR;
-	}
-
 	if(!aws_iot_mqtt_is_client_connected(pClient)) {
 		return NETWORK_DISCONNECTED_ERROR;
 	}
@@ -219,7 +235,7 @@ IoT_Error_t aws_iot_mqtt_unsubscribe(AWS_IoT_Client *pClient, const char *pTopic
 		return rc;
 	}
 
-	unsubRc = _aws_iot_mqtt_internal_unsubscribe(pClient, pTopicFilter, topicFilterLen);
+	unsubRc = _aws_iot_mqtt_internal_unsubscribe(pClient, pTopicFilters, pTopicFilterLens, count);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_UNSUBSCRIBE_IN_PROGRESS, clientState);
 	if(SUCCESS == unsubRc && SUCCESS != rc) {
@@ -229,6 +245,31 @@ IoT_Error_t aws_iot_mqtt_unsubscribe(AWS_IoT_Client *pClient, const char *pTopic
 	return unsubRc;
 }
 
+IoT_Error_t aws_iot_mqtt_unsubscribe(AWS_IoT_Client *pClient, const char *pTopicFilter, uint16_t topicFilterLen) {
+	if(NULL == pClient || NULL == pTopicFilter) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return _aws_iot_mqtt_unsubscribe_with_state(pClient, &pTopicFilter, &topicFilterLen, 1);
+}
+
+IoT_Error_t aws_iot_mqtt_unsubscribe_batch(AWS_IoT_Client *pClient, const char **pTopicFilters,
+										   uint16_t *pTopicFilterLens, uint32_t count) {
+	uint32_t i;
+
+	if(NULL == pClient || NULL == pTopicFilters || NULL == pTopicFilterLens || 0 == count) {
+		return NULL_VALUE_ERROR;
+	}
+
+	for(i = 0; i < count; ++i) {
+		if(NULL == pTopicFilters[i]) {
+			return NULL_VALUE_ERROR;
+		}
+	}
+
+	return _aws_iot_mqtt_unsubscribe_with_state(pClient, pTopicFilters, pTopicFilterLens, count);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -75,12 +75,108 @@ static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
 }
 
 
+/**
+ * Decorrelated jitter: a random wait between the minimum and three times the previous wait.
+ * Unlike plain doubling, clients that lost the same server drift apart instead of retrying
+ * in waves.
+ */
+static uint32_t _aws_iot_mqtt_decorrelated_jitter(AWS_IoT_Client *pClient, uint32_t previousWait_ms) {
+	uint32_t state = pClient->clientData.reconnectJitterState;
+	uint64_t upperWait_ms;
+	uint16_t itr;
+
+	if(0 == state) {
+		/* The client ID is unique per device, so each device draws its own sequence */
+		state = 2166136261U;
+		for(itr = 0; NULL != pClient->clientData.options.pClientID && itr < pClient->clientData.options.clientIDLen; itr++) {
+			state = (state ^ (uint8_t) pClient->clientData.options.pClientID[itr]) * 16777619U;
+		}
+		state ^= (uint32_t) (uintptr_t) pClient;
+		if(0 == state) {
+			state = 1;
+		}
+	}
+
+	/* xorshift32 */
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	pClient->clientData.reconnectJitterState = state;
+
+	if(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL > previousWait_ms) {
+		previousWait_ms = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
+	}
+	upperWait_ms = (uint64_t) previousWait_ms * 3;
+	if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < upperWait_ms) {
+		upperWait_ms = AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL;
+	}
+	if(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL >= upperWait_ms) {
+		return (uint32_t) upperWait_ms;
+	}
+
+	return AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL +
+		   state % (uint32_t) (upperWait_ms - AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL + 1);
+}
+
+static void _aws_iot_mqtt_schedule_reconnect(AWS_IoT_Client *pClient) {
+	IoT_Reconnect_Policy *pPolicy = &(pClient->clientData.reconnectPolicy);
+
+	if(NULL != pPolicy->nextWait) {
+		pClient->clientData.currentReconnectWaitInterval =
+				pPolicy->nextWait(pPolicy->pPolicyData, pClient->clientData.currentReconnectWaitInterval);
+	} else {
+		pClient->clientData.currentReconnectWaitInterval =
+				_aws_iot_mqtt_decorrelated_jitter(pClient, pClient->clientData.currentReconnectWaitInterval);
+	}
+	countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+}
+
+static void _aws_iot_mqtt_record_reconnect(AWS_IoT_Client *pClient) {
+	IoT_Reconnect_Stats *pStats = &(pClient->clientData.reconnectStats);
+	uint32_t latency_ms = AWS_IOT_MQTT_RECONNECT_LATENCY_TIMER_MS - left_ms(&(pClient->reconnectLatencyTimer));
+	uint32_t seconds = latency_ms / 1000;
+	uint8_t bucket = 0;
+
+	while(0 < seconds && (AWS_IOT_MQTT_RECONNECT_LATENCY_BUCKETS - 1) > bucket) {
+		seconds >>= 1;
+		bucket++;
+	}
+
+	pStats->reconnectCount++;
+	pStats->lastLatency_ms = latency_ms;
+	if(latency_ms > pStats->maxLatency_ms) {
+		pStats->maxLatency_ms = latency_ms;
+	}
+	pStats->latencyHistogram[bucket]++;
+}
+
+/* Reads and clears the link up flag, which aws_iot_mqtt_autoreconnect_link_up sets from any thread */
+static bool _aws_iot_mqtt_take_link_up(AWS_IoT_Client *pClient) {
+	bool isLinkUpReported;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	if(SUCCESS != aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.state_change_mutex))) {
+		return false;
+	}
+#endif
+	isLinkUpReported = pClient->clientStatus.isLinkUpReported;
+	pClient->clientStatus.isLinkUpReported = false;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.state_change_mutex));
+#endif
+
+	return isLinkUpReported;
+}
+
 static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	if(!has_timer_expired(&(pClient->reconnectDelayTimer))) {
+	if(_aws_iot_mqtt_take_link_up(pClient)) {
+		/* The link is back, skip the wait and start the backoff over */
+		pClient->clientData.currentReconnectWaitInterval = 0;
+	} else if(!has_timer_expired(&(pClient->reconnectDelayTimer))) {
 		/* Timer has not expired. Not time to attempt reconnect yet.
 		 * Return attempting reconnect */
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
@@ -92,8 +188,10 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 	}
 
 	if(NETWORK_PHYSICAL_LAYER_CONNECTED == rc) {
+		pClient->clientData.reconnectStats.attemptCount++;
 		rc = aws_iot_mqtt_attempt_reconnect(pClient);
 		if(NETWORK_RECONNECTED == rc) {
+			_aws_iot_mqtt_record_reconnect(pClient);
 			rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_IDLE,
 											   CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS);
 			if(SUCCESS != rc) {
@@ -103,12 +201,8 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 		}
 	}
 
-	pClient->clientData.currentReconnectWaitInterval *= 2;
-
-	if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < pClient->clientData.currentReconnectWaitInterval) {
-		FUNC_EXIT_RC(NETWORK_RECONNECT_TIMED_OUT_ERROR);
-	}
-	countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+	/* Keep retrying, at most AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL apart with the default policy */
+	_aws_iot_mqtt_schedule_reconnect(pClient);
 	FUNC_EXIT_RC(rc);
 }
 
@@ -177,6 +271,71 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * Sleep on the network until it has data for us or until the earliest of the yield,
+ * keep alive, in-flight PUBACK and offline queue deadlines, so an idle connection costs
+ * no CPU time.
+ * Returns SUCCESS straight away when the network layer cannot wait, in which case
+ * the caller polls the socket as before.
+ */
+static IoT_Error_t _aws_iot_mqtt_wait_for_data(AWS_IoT_Client *pClient, Timer *pYieldTimer) {
+	IoT_Error_t rc;
+	Timer waitTimer;
+	uint32_t waitMs;
+	uint32_t deadlineMs;
+	uint16_t itr;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient->networkStack.waitForData) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	waitMs = left_ms(pYieldTimer);
+
+	if(0 != pClient->clientData.keepAliveInterval) {
+		if(pClient->clientStatus.isPingOutstanding) {
+			deadlineMs = left_ms(&(pClient->pingRespTimer));
+		} else {
+			deadlineMs = left_ms(&(pClient->pingReqTimer));
+		}
+		if(deadlineMs < waitMs) {
+			waitMs = deadlineMs;
+		}
+	}
+
+	if(0 != pClient->clientData.inflightPublishCount) {
+		for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; itr++) {
+			if(0 != pClient->clientData.inflightPublishes[itr].packetId) {
+				deadlineMs = left_ms(&(pClient->clientData.inflightPublishes[itr].ackTimer));
+				if(deadlineMs < waitMs) {
+					waitMs = deadlineMs;
+				}
+			}
+		}
+	}
+
+	deadlineMs = aws_iot_mqtt_internal_offline_queue_drain_wait_ms(pClient);
+	if(deadlineMs < waitMs) {
+		waitMs = deadlineMs;
+	}
+
+	/* Timers count in whole milliseconds, a deadline less than 1 ms away would
+	 * otherwise turn the last millisecond into a busy loop */
+	if(0 == waitMs) {
+		waitMs = 1;
+	}
+
+	init_timer(&waitTimer);
+	countdown_ms(&waitTimer, waitMs);
+	rc = pClient->networkStack.waitForData(&(pClient->networkStack), &waitTimer);
+	if(NETWORK_SSL_NOTHING_TO_READ == rc) {
+		rc = MQTT_NOTHING_TO_READ;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 /**
  * @brief Yield to the MQTT client
  *
@@ -211,6 +370,9 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 
 	// evaluate timeout at the end of the loop to make sure the actual yield runs at least once
 	do {
+		/* Fail asynchronous publishes whose PUBACK is overdue, even while reconnecting */
+		aws_iot_mqtt_internal_expire_inflight_publishes(pClient);
+
 		clientState = aws_iot_mqtt_get_client_state(pClient);
 
 		/* If the client state is pending reconnect or resubscribe in progress,
@@ -219,17 +381,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 		 subsequent invocations only attempt remaining subscribes.  */
 		if((CLIENT_STATE_PENDING_RECONNECT == clientState) ||
 			(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS == clientState)) {
-			if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < pClient->clientData.currentReconnectWaitInterval) {
-				yieldRc = NETWORK_RECONNECT_TIMED_OUT_ERROR;
-				break;
-			}
 			yieldRc = _aws_iot_mqtt_handle_reconnect(pClient);
 			/* Network reconnect attempted, check if yield timer expired before
 			 * doing anything else */
 			continue;
 		}
 
-		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		yieldRc = _aws_iot_mqtt_wait_for_data(pClient, &timer);
+		if(NETWORK_WAIT_INTERRUPTED == yieldRc) {
+			/* Another thread asked for the yield to return early */
+			yieldRc = SUCCESS;
+			break;
+		} else if(SUCCESS == yieldRc) {
+			yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		} else if(MQTT_NOTHING_TO_READ == yieldRc) {
+			/* A deadline was reached without any incoming data, only the keep alive is due */
+			yieldRc = SUCCESS;
+		}
+
+		if(SUCCESS == yieldRc) {
+			/* Messages published while disconnected go out once the connection is back */
+			yieldRc = aws_iot_mqtt_internal_offline_queue_drain(pClient);
+		}
+
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
 		} else {
@@ -247,14 +421,13 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 			}
 
 			if(1 == pClient->clientStatus.isAutoReconnectEnabled) {
-				yieldRc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR,
-														CLIENT_STATE_PENDING_RECONNECT);
+				yieldRc = aws_iot_mqtt_internal_enter_pending_reconnect(pClient);
 				if(SUCCESS != yieldRc) {
 					FUNC_EXIT_RC(yieldRc);
 				}
 
-				pClient->clientData.currentReconnectWaitInterval = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
-				countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+				pClient->clientData.currentReconnectWaitInterval = 0;
+				_aws_iot_mqtt_schedule_reconnect(pClient);
 
 				/* Depending on timer values, it is possible that yield timer has expired
 				 * Set to rc to attempting reconnect to inform client that autoreconnect
@@ -320,6 +493,63 @@ IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms) {
 	FUNC_EXIT_RC(yieldRc);
 }
 
+IoT_Error_t aws_iot_mqtt_yield_wakeup(AWS_IoT_Client *pClient) {
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL == pClient->networkStack.wakeup) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	FUNC_EXIT_RC(pClient->networkStack.wakeup(&(pClient->networkStack)));
+}
+
+IoT_Error_t aws_iot_mqtt_autoreconnect_link_up(AWS_IoT_Client *pClient) {
+	ClientState clientState;
+	bool isReconnectPending;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Only a flag is written, _aws_iot_mqtt_handle_reconnect picks it up in the yielding thread.
+	 * The state lock keeps it from being lost to a disconnect being handled at the same time */
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.state_change_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	isReconnectPending = (CLIENT_STATE_PENDING_RECONNECT == clientState
+						  || CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS == clientState);
+	if(isReconnectPending) {
+		pClient->clientStatus.isLinkUpReported = true;
+	}
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.state_change_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	/* A yield blocked in the network wait would only see the flag once its timeout runs out.
+	 * Without a wait running, the next one returns early, which yield treats as a normal return */
+	if(isReconnectPending && NULL != pClient->networkStack.wakeup) {
+		(void) pClient->networkStack.wakeup(&(pClient->networkStack));
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,52 +31,52 @@ extern "C" {
 #include "aws_iot_shadow_json.h"
 #include "aws_iot_shadow_key.h"
 #include "aws_iot_shadow_records.h"
+#include "aws_iot_shadow_cache.h"
 
 const ShadowInitParameters_t ShadowInitParametersDefault = {(char *) AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, NULL, NULL,
 															NULL, false, NULL};
 
 const ShadowConnectParameters_t ShadowConnectParametersDefault = {(char *) AWS_IOT_MY_THING_NAME,
-								  (char *) AWS_IOT_MQTT_CLIENT_ID, 0, NULL};
+								  (char *) AWS_IOT_MQTT_CLIENT_ID, 0, NULL, false};
 
-static char deleteAcceptedTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
-
-void aws_iot_shadow_reset_last_received_version(void) {
-	shadowJsonVersionNum = 0;
+void aws_iot_shadow_reset_last_received_version(AWS_IoT_Shadow_Context *pShadow) {
+	pShadow->shadowJsonVersionNum = 0;
 }
 
-uint32_t aws_iot_shadow_get_last_received_version(void) {
-	return shadowJsonVersionNum;
+uint32_t aws_iot_shadow_get_last_received_version(AWS_IoT_Shadow_Context *pShadow) {
+	return pShadow->shadowJsonVersionNum;
 }
 
-void aws_iot_shadow_enable_discard_old_delta_msgs(void) {
-	shadowDiscardOldDeltaFlag = true;
+void aws_iot_shadow_enable_discard_old_delta_msgs(AWS_IoT_Shadow_Context *pShadow) {
+	pShadow->shadowDiscardOldDeltaFlag = true;
 }
 
-void aws_iot_shadow_disable_discard_old_delta_msgs(void) {
-	shadowDiscardOldDeltaFlag = false;
+void aws_iot_shadow_disable_discard_old_delta_msgs(AWS_IoT_Shadow_Context *pShadow) {
+	pShadow->shadowDiscardOldDeltaFlag = false;
 }
 
-IoT_Error_t aws_iot_shadow_free(AWS_IoT_Client *pClient)
+IoT_Error_t aws_iot_shadow_free(AWS_IoT_Shadow_Context *pShadow)
 {
     IoT_Error_t rc;
 
-    if (NULL == pClient) {
+    if (NULL == pShadow || NULL == pShadow->pMqttClient) {
         FUNC_EXIT_RC(NULL_VALUE_ERROR);
     }
 
-    rc = aws_iot_mqtt_free(pClient);
+    rc = aws_iot_mqtt_free(pShadow->pMqttClient);
 
     FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_init(AWS_IoT_Client *pClient, const ShadowInitParameters_t *pParams) {
+IoT_Error_t aws_iot_shadow_init(AWS_IoT_Shadow_Context *pShadow, AWS_IoT_Client *pClient,
+								const ShadowInitParameters_t *pParams) {
 	IoT_Client_Init_Params mqttInitParams = IoT_Client_Init_Params_initializer;
 
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient || NULL == pParams) {
+	if(NULL == pShadow || NULL == pClient || NULL == pParams) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
@@ -97,26 +97,34 @@ IoT_Error_t aws_iot_shadow_init(AWS_IoT_Client *pClient, const ShadowInitParamet
 		FUNC_EXIT_RC(rc);
 	}
 
-	resetClientTokenSequenceNum();
-	aws_iot_shadow_reset_last_received_version();
-	initDeltaTokens();
+	pShadow->pMqttClient = pClient;
+	pShadow->myThingName[0] = '\0';
+	pShadow->mqttClientID[0] = '\0';
+	pShadow->shadowDiscardOldDeltaFlag = true;
+	resetClientTokenSequenceNum(pShadow);
+	aws_iot_shadow_reset_last_received_version(pShadow);
+	initializeRecords(pShadow);
+	initDeltaTokens(pShadow);
+	initReportedFields(pShadow);
+	initCoalescedUpdates(pShadow);
+	initShadowCache(pShadow);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
-IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Client *pClient, const ShadowConnectParameters_t *pParams) {
+IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Shadow_Context *pShadow, const ShadowConnectParameters_t *pParams) {
 	IoT_Error_t rc = SUCCESS;
 	uint16_t deleteAcceptedTopicLen;
 	IoT_Client_Connect_Params ConnectParams = iotClientConnectParamsDefault;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient || NULL == pParams || NULL == pParams->pMqttClientId) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient || NULL == pParams || NULL == pParams->pMqttClientId) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	snprintf(myThingName, MAX_SIZE_OF_THING_NAME, "%s", pParams->pMyThingName);
-	snprintf(mqttClientID, MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES, "%s", pParams->pMqttClientId);
+	snprintf(pShadow->myThingName, MAX_SIZE_OF_THING_NAME, "%s", pParams->pMyThingName);
+	snprintf(pShadow->mqttClientID, MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES, "%s", pParams->pMqttClientId);
 
 	ConnectParams.keepAliveIntervalInSec = 600; // NOTE: Temporary fix
 	ConnectParams.MQTTVersion = MQTT_3_1_1;
@@ -127,122 +135,289 @@ IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Client *pClient, const ShadowConnectP
 	ConnectParams.pPassword = NULL;
 	ConnectParams.pUsername = NULL;
 
-	rc = aws_iot_mqtt_connect(pClient, &ConnectParams);
+	rc = aws_iot_mqtt_connect(pShadow->pMqttClient, &ConnectParams);
 
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	initializeRecords(pClient);
+	restartRecords(pShadow);
+
+	if(pParams->enablePersistentAckSubscriptions) {
+		rc = subscribeToAllShadowActionAcks(pShadow);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
 
 	if(NULL != pParams->deleteActionHandler) {
-		snprintf(deleteAcceptedTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES,
-				 "$aws/things/%s/shadow/delete/accepted", myThingName);
-		deleteAcceptedTopicLen = (uint16_t) strlen(deleteAcceptedTopic);
-		rc = aws_iot_mqtt_subscribe(pClient, deleteAcceptedTopic, deleteAcceptedTopicLen, QOS1,
-									pParams->deleteActionHandler, (void *) myThingName);
+		snprintf(pShadow->deleteAcceptedTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES,
+				 "$aws/things/%s/shadow/delete/accepted", pShadow->myThingName);
+		deleteAcceptedTopicLen = (uint16_t) strlen(pShadow->deleteAcceptedTopic);
+		rc = aws_iot_mqtt_subscribe(pShadow->pMqttClient, pShadow->deleteAcceptedTopic, deleteAcceptedTopicLen, QOS1,
+									pParams->deleteActionHandler, (void *) pShadow->myThingName);
 	}
 
 	FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_register_delta(AWS_IoT_Client *pMqttClient, jsonStruct_t *pStruct) {
-	if(NULL == pMqttClient || NULL == pStruct) {
+IoT_Error_t aws_iot_shadow_register_delta(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient || NULL == pStruct) {
 		return NULL_VALUE_ERROR;
 	}
 
-	if(!aws_iot_mqtt_is_client_connected(pMqttClient)) {
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
 		return MQTT_CONNECTION_ERROR;
 	}
 
-	return registerJsonTokenOnDelta(pStruct);
+	return registerJsonTokenOnDelta(pShadow, pStruct);
+}
+
+static IoT_Error_t flushCoalescedUpdate(AWS_IoT_Shadow_Context *pShadow) {
+	ShadowJsonWriter_t writer;
+	ShadowCoalescedBatch_t *pBatch;
+	uint8_t timeout_seconds = pShadow->coalescedTimeoutSec;
+	bool isPersistentSubscribe = pShadow->coalescedPersistentSubscribe;
+	IoT_Error_t rc;
+	uint32_t i;
+
+	if(0 == pShadow->coalescedFieldsCount) {
+		return SUCCESS;
+	}
+
+	aws_iot_shadow_json_writer_init(&writer, pShadow->coalescedJsonDocument, AWS_IOT_MQTT_TX_BUF_LEN);
+	aws_iot_shadow_json_writer_begin_section(&writer, "reported");
+	for(i = 0; i < pShadow->coalescedFieldsCount; i++) {
+		aws_iot_shadow_json_writer_add(&writer, &(pShadow->coalescedFields[i]));
+	}
+	rc = aws_iot_shadow_json_writer_end_section(&writer);
+	if(SUCCESS == rc) {
+		rc = aws_iot_finalize_json_document(pShadow, pShadow->coalescedJsonDocument, AWS_IOT_MQTT_TX_BUF_LEN);
+	}
+	if(SUCCESS != rc) {
+		/* The fields stay collected, a later change of the same keys may make them fit, tried again next window */
+		countdown_ms(&(pShadow->coalesceTimer), SHADOW_COALESCE_WINDOW_MS);
+		return rc;
+	}
+
+	/* When all the batches wait for their response the fields stay collected and are sent on a later yield */
+	rc = startCoalescedBatch(pShadow, &pBatch);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+
+	rc = aws_iot_shadow_internal_action(pShadow, pShadow->myThingName, SHADOW_UPDATE,
+										pShadow->coalescedJsonDocument, strlen(pShadow->coalescedJsonDocument),
+										(NULL == pBatch) ? NULL : coalescedUpdateCallback, pBatch,
+										timeout_seconds, isPersistentSubscribe);
+
+	/* No response will come for an update that was not published */
+	if(SUCCESS != rc && NULL != pBatch) {
+		coalescedUpdateCallback(pShadow->myThingName, SHADOW_UPDATE, SHADOW_ACK_TIMEOUT, NULL, pBatch);
+	}
+
+	return rc;
 }
 
-IoT_Error_t aws_iot_shadow_yield(AWS_IoT_Client *pClient, uint32_t timeout) {
-	if(NULL == pClient) {
+IoT_Error_t aws_iot_shadow_yield(AWS_IoT_Shadow_Context *pShadow, uint32_t timeout) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
 		return NULL_VALUE_ERROR;
 	}
 
-	HandleExpiredResponseCallbacks();
-	return aws_iot_mqtt_yield(pClient, timeout);
+	HandleExpiredResponseCallbacks(pShadow);
+	if(0 < pShadow->coalescedFieldsCount && has_timer_expired(&(pShadow->coalesceTimer))
+	   && aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
+		/* A failed publish is reported to the callers of the update through their callbacks */
+		IoT_Error_t flushRc = flushCoalescedUpdate(pShadow);
+		if(SHADOW_JSON_BUFFER_TRUNCATED == flushRc || SHADOW_JSON_ERROR == flushRc) {
+			IOT_ERROR("Coalesced update does not fit in the TX buffer, error %d", flushRc);
+		}
+	}
+	return aws_iot_mqtt_yield(pShadow->pMqttClient, timeout);
 }
 
-IoT_Error_t aws_iot_shadow_disconnect(AWS_IoT_Client *pClient) {
-	return aws_iot_mqtt_disconnect(pClient);
+IoT_Error_t aws_iot_shadow_disconnect(AWS_IoT_Shadow_Context *pShadow) {
+	if(NULL == pShadow) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return aws_iot_mqtt_disconnect(pShadow->pMqttClient);
 }
 
-IoT_Error_t aws_iot_shadow_update(AWS_IoT_Client *pClient, const char *pThingName, char *pJsonString,
+IoT_Error_t aws_iot_shadow_update(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, char *pJsonString,
 								  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds,
 								  bool isPersistentSubscribe) {
 	IoT_Error_t rc;
 
-	if(NULL == pClient) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
 		FUNC_EXIT_RC(MQTT_CONNECTION_ERROR);
 	}
 
-	rc = aws_iot_shadow_internal_action(pThingName, SHADOW_UPDATE, pJsonString, strlen(pJsonString), callback, pContextData,
-										timeout_seconds, isPersistentSubscribe);
+	rc = aws_iot_shadow_internal_action(pShadow, pThingName, SHADOW_UPDATE, pJsonString, strlen(pJsonString), callback,
+										pContextData, timeout_seconds, isPersistentSubscribe);
 
 	FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_delete(AWS_IoT_Client *pClient, const char *pThingName, fpActionCallback_t callback,
+IoT_Error_t aws_iot_shadow_update_changed(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										  char *pJsonDocument, size_t maxSizeOfJsonDocument, double floatEpsilon,
+										  bool forceFullReport, fpActionCallback_t callback, void *pContextData,
+										  uint8_t timeout_seconds, bool isPersistentSubscribe) {
+	ShadowJsonWriter_t writer;
+	ShadowReportedUpdate_t *pUpdate;
+	uint32_t changedCount;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pShadow->pMqttClient || NULL == pThingName || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
+		FUNC_EXIT_RC(MQTT_CONNECTION_ERROR);
+	}
+
+	rc = startReportedUpdate(pShadow, callback, pContextData, &pUpdate);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	aws_iot_shadow_json_writer_init(&writer, pJsonDocument, maxSizeOfJsonDocument);
+	aws_iot_shadow_json_writer_begin_section(&writer, "reported");
+	changedCount = addChangedReportedFields(pUpdate, &writer, floatEpsilon, forceFullReport);
+	rc = aws_iot_shadow_json_writer_end_section(&writer);
+	if(SUCCESS == rc) {
+		rc = (changedCount > 0) ? aws_iot_finalize_json_document(pShadow, pJsonDocument, maxSizeOfJsonDocument)
+								: SHADOW_NO_CHANGED_FIELDS;
+	}
+
+	if(SUCCESS == rc) {
+		/* The values sent are committed by the callback once the update is accepted */
+		rc = aws_iot_shadow_internal_action(pShadow, pThingName, SHADOW_UPDATE, pJsonDocument, strlen(pJsonDocument),
+											reportedUpdateCallback, pUpdate, timeout_seconds, isPersistentSubscribe);
+	}
+
+	if(SUCCESS != rc) {
+		cancelReportedUpdate(pUpdate);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_update_coalesced(AWS_IoT_Shadow_Context *pShadow, const jsonStruct_t *pFields,
+											uint32_t fieldCount, fpActionCallback_t callback, void *pContextData,
+											uint8_t timeout_seconds, bool isPersistentSubscribe) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pShadow->pMqttClient || NULL == pFields || 0 == fieldCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = addCoalescedFields(pShadow, pFields, fieldCount, callback, pContextData, timeout_seconds,
+							isPersistentSubscribe);
+	if(FAILURE == rc && 0 < pShadow->coalescedFieldsCount) {
+		/* Size threshold reached, send what was collected and start a new window */
+		rc = aws_iot_shadow_flush_coalesced(pShadow);
+		if(SUCCESS == rc) {
+			rc = addCoalescedFields(pShadow, pFields, fieldCount, callback, pContextData, timeout_seconds,
+									isPersistentSubscribe);
+		}
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_flush_coalesced(AWS_IoT_Shadow_Context *pShadow) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
+		FUNC_EXIT_RC(MQTT_CONNECTION_ERROR);
+	}
+
+	rc = flushCoalescedUpdate(pShadow);
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_register_reported(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct) {
+	if(NULL == pShadow || NULL == pStruct || NULL == pStruct->pKey || NULL == pStruct->pData) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return registerReportedField(pShadow, pStruct);
+}
+
+IoT_Error_t aws_iot_shadow_delete(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, fpActionCallback_t callback,
 								  void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscribe) {
 	char deleteRequestJsonBuf[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
 		FUNC_EXIT_RC(MQTT_CONNECTION_ERROR);
 	}
 
-	rc = aws_iot_shadow_internal_delete_request_json(deleteRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE );
+	rc = aws_iot_shadow_internal_delete_request_json(pShadow, deleteRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE );
     if ( SUCCESS != rc ) {
         FUNC_EXIT_RC( rc );
     }
 
-	rc = aws_iot_shadow_internal_action(pThingName, SHADOW_DELETE, deleteRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE, callback, pContextData,
+	rc = aws_iot_shadow_internal_action(pShadow, pThingName, SHADOW_DELETE, deleteRequestJsonBuf,
+										MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE, callback, pContextData,
 										timeout_seconds, isPersistentSubscribe);
 
 	FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_get(AWS_IoT_Client *pClient, const char *pThingName, fpActionCallback_t callback,
+IoT_Error_t aws_iot_shadow_get(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, fpActionCallback_t callback,
 							   void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscribe) {
 	char getRequestJsonBuf[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient) {
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+	if(!aws_iot_mqtt_is_client_connected(pShadow->pMqttClient)) {
 		FUNC_EXIT_RC(MQTT_CONNECTION_ERROR);
 	}
 
-    rc = aws_iot_shadow_internal_get_request_json(getRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE );
+    rc = aws_iot_shadow_internal_get_request_json(pShadow, getRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE );
     if (SUCCESS != rc) {
         FUNC_EXIT_RC(rc);
     }
 
-	rc = aws_iot_shadow_internal_action(pThingName, SHADOW_GET, getRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE, callback, pContextData,
+	rc = aws_iot_shadow_internal_action(pShadow, pThingName, SHADOW_GET, getRequestJsonBuf,
+										MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE, callback, pContextData,
 										timeout_seconds, isPersistentSubscribe);
 	FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_set_autoreconnect_status(AWS_IoT_Client *pClient, bool newStatus) {
-	return aws_iot_mqtt_autoreconnect_set_status(pClient, newStatus);
+IoT_Error_t aws_iot_shadow_set_autoreconnect_status(AWS_IoT_Shadow_Context *pShadow, bool newStatus) {
+	if(NULL == pShadow) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return aws_iot_mqtt_autoreconnect_set_status(pShadow->pMqttClient, newStatus);
 }
 
 #ifdef __cplusplus
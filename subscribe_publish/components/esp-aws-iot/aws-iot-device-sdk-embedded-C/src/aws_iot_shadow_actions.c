@@ -29,33 +29,37 @@ extern "C" {
 #include "aws_iot_shadow_records.h"
 #include "aws_iot_config.h"
 
-IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions_t action,
-										   const char *pJsonDocumentToBeSent, size_t jsonSize, fpActionCallback_t callback,
-										   void *pCallbackContext, uint32_t timeout_seconds, bool isSticky) {
+IoT_Error_t aws_iot_shadow_internal_action(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										   ShadowActions_t action, const char *pJsonDocumentToBeSent, size_t jsonSize,
+										   fpActionCallback_t callback, void *pCallbackContext,
+										   uint32_t timeout_seconds, bool isSticky) {
 	IoT_Error_t ret_val = SUCCESS;
 	bool isClientTokenPresent = false;
 	bool isAckWaitListFree = false;
-	uint8_t indexAckWaitList;
 	char extractedClientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
 
 	FUNC_ENTRY;
 
-	if(NULL == pThingName || NULL == pJsonDocumentToBeSent) {
+	if(NULL == pShadow || NULL == pThingName || NULL == pJsonDocumentToBeSent) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	isClientTokenPresent = extractClientToken(pJsonDocumentToBeSent, jsonSize, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
+	isClientTokenPresent = extractClientToken(pJsonDocumentToBeSent, jsonSize, &pShadow->jsonHandler,
+											  extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
 
 	if(isClientTokenPresent && (NULL != callback)) {
-		if(getNextFreeIndexOfAckWaitList(&indexAckWaitList)) {
+		if(!isAckWaitListFull(pShadow)) {
 			isAckWaitListFree = true;
 		}
 
 		if(isAckWaitListFree) {
-			if(!isSubscriptionPresent(pThingName, action)) {
-				ret_val = subscribeToShadowActionAcks(pThingName, action, isSticky);
+			/* The acks may already arrive on the wildcard subscriptions made at connect */
+			if(isAllShadowActionAcksSubscribed(pShadow, pThingName)) {
+				ret_val = SUCCESS;
+			} else if(!isSubscriptionPresent(pShadow, pThingName, action)) {
+				ret_val = subscribeToShadowActionAcks(pShadow, pThingName, action, isSticky);
 			} else {
-				incrementSubscriptionCnt(pThingName, action, isSticky);
+				incrementSubscriptionCnt(pShadow, pThingName, action, isSticky);
 			}
 		}
 		else {
@@ -64,12 +68,16 @@ IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions
 	}
 
 	if(SUCCESS == ret_val) {
-		ret_val = publishToShadowAction(pThingName, action, pJsonDocumentToBeSent);
+		ret_val = publishToShadowAction(pShadow, pThingName, action, pJsonDocumentToBeSent);
 	}
 
 	if(isClientTokenPresent && (NULL != callback) && (SUCCESS == ret_val) && isAckWaitListFree) {
-		addToAckWaitList(indexAckWaitList, pThingName, action, extractedClientToken, callback, pCallbackContext,
-						 timeout_seconds);
+		if(!addToAckWaitList(pShadow, pThingName, action, extractedClientToken, callback, pCallbackContext,
+							 timeout_seconds)) {
+			/* Filled by the requests of callbacks dispatched while this one was sent */
+			IOT_WARN("Request sent, but no record is left to wait for its response");
+			ret_val = FAILURE;
+		}
 	}
 
 	FUNC_EXIT_RC(ret_val);
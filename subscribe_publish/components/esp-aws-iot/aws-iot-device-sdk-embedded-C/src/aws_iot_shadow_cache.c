@@ -0,0 +1,260 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_cache.c
+ * @brief Cache of the last shadow document of the Thing given at connect
+ *
+ * The cache buffer holds the last get/accepted document followed by the last delta newer than it, each null
+ * terminated. When a store is given, the buffer is mirrored at offset SHADOW_CACHE_HEADER_LEN and the header is
+ * written last, so a cache that was only partially written is never loaded. The header is stored field by field in
+ * big endian, so a store can be read back by a build with another layout of ShadowCacheHeader_t.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <stdio.h>
+
+#include "aws_iot_shadow_cache.h"
+#include "aws_iot_shadow_records.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_log.h"
+
+#define SHADOW_CACHE_MAGIC 0x53484332u
+
+/* Magic, document version and length, delta version and length, then the Thing Name */
+#define SHADOW_CACHE_HEADER_LEN (5 * sizeof(uint32_t) + MAX_SIZE_OF_THING_NAME)
+
+static void writeUint32(unsigned char *pBuf, uint32_t value) {
+	pBuf[0] = (unsigned char) (value >> 24);
+	pBuf[1] = (unsigned char) (value >> 16);
+	pBuf[2] = (unsigned char) (value >> 8);
+	pBuf[3] = (unsigned char) value;
+}
+
+static uint32_t readUint32(const unsigned char *pBuf) {
+	return ((uint32_t) pBuf[0] << 24) | ((uint32_t) pBuf[1] << 16) | ((uint32_t) pBuf[2] << 8) | (uint32_t) pBuf[3];
+}
+
+static bool hasCacheStore(const AWS_IoT_Shadow_Context *pShadow) {
+	return (NULL != pShadow->cacheStore.read && NULL != pShadow->cacheStore.write);
+}
+
+static size_t deltaOffsetOfCache(const ShadowCacheHeader_t *pHeader) {
+	return (size_t) pHeader->documentLength + 1;
+}
+
+/* Writes the bytes of the cache buffer in [offset, offset + length), then the header that makes them valid */
+static void storeCache(AWS_IoT_Shadow_Context *pShadow, size_t offset, size_t length) {
+	const ShadowCacheHeader_t *pHeader = &(pShadow->cacheHeader);
+	unsigned char header[SHADOW_CACHE_HEADER_LEN];
+
+	if(!hasCacheStore(pShadow)) {
+		return;
+	}
+
+	writeUint32(&header[0], pHeader->magic);
+	writeUint32(&header[4], pHeader->documentVersion);
+	writeUint32(&header[8], pHeader->documentLength);
+	writeUint32(&header[12], pHeader->deltaVersion);
+	writeUint32(&header[16], pHeader->deltaLength);
+	memcpy(&header[20], pHeader->thingName, MAX_SIZE_OF_THING_NAME);
+
+	if(SUCCESS != pShadow->cacheStore.write(pShadow->cacheStore.pStoreData, SHADOW_CACHE_HEADER_LEN + offset,
+											(const unsigned char *) &(pShadow->pCacheBuffer[offset]), length)
+	   || SUCCESS != pShadow->cacheStore.write(pShadow->cacheStore.pStoreData, 0, header, SHADOW_CACHE_HEADER_LEN)) {
+		IOT_WARN("Shadow cache could not be written to its store");
+	}
+}
+
+static bool loadCache(AWS_IoT_Shadow_Context *pShadow) {
+	ShadowCacheHeader_t *pHeader = &(pShadow->cacheHeader);
+	unsigned char header[SHADOW_CACHE_HEADER_LEN];
+	size_t length;
+
+	if(SUCCESS != pShadow->cacheStore.read(pShadow->cacheStore.pStoreData, 0, header, SHADOW_CACHE_HEADER_LEN)) {
+		return false;
+	}
+
+	pHeader->magic = readUint32(&header[0]);
+	pHeader->documentVersion = readUint32(&header[4]);
+	pHeader->documentLength = readUint32(&header[8]);
+	pHeader->deltaVersion = readUint32(&header[12]);
+	pHeader->deltaLength = readUint32(&header[16]);
+	memcpy(pHeader->thingName, &header[20], MAX_SIZE_OF_THING_NAME);
+
+	/* Each length is checked on its own against what is left of the buffer, their sum can not wrap around */
+	if(SHADOW_CACHE_MAGIC != pHeader->magic || '\0' != pHeader->thingName[MAX_SIZE_OF_THING_NAME - 1]
+	   || 0 == pHeader->documentLength || pHeader->documentLength >= pShadow->cacheBufferSize
+	   || pHeader->deltaLength >= pShadow->cacheBufferSize - pHeader->documentLength - 1) {
+		return false;
+	}
+
+	length = deltaOffsetOfCache(pHeader) + pHeader->deltaLength + 1;
+	if(SUCCESS != pShadow->cacheStore.read(pShadow->cacheStore.pStoreData, SHADOW_CACHE_HEADER_LEN,
+										   (unsigned char *) pShadow->pCacheBuffer, length)) {
+		return false;
+	}
+
+	return ('\0' == pShadow->pCacheBuffer[pHeader->documentLength] && '\0' == pShadow->pCacheBuffer[length - 1]);
+}
+
+static void clearCache(AWS_IoT_Shadow_Context *pShadow) {
+	memset(&(pShadow->cacheHeader), 0, sizeof(ShadowCacheHeader_t));
+	pShadow->cacheHeader.magic = SHADOW_CACHE_MAGIC;
+}
+
+void initShadowCache(AWS_IoT_Shadow_Context *pShadow) {
+	pShadow->pCacheBuffer = NULL;
+	pShadow->cacheBufferSize = 0;
+	pShadow->cacheStore.read = NULL;
+	pShadow->cacheStore.write = NULL;
+	pShadow->cacheStore.pStoreData = NULL;
+	clearCache(pShadow);
+}
+
+void cacheShadowDocument(AWS_IoT_Shadow_Context *pShadow, const char *pDocument, size_t length, uint32_t version) {
+	ShadowCacheHeader_t *pHeader = &(pShadow->cacheHeader);
+	bool isDeltaKept;
+	size_t cachedLength;
+
+	if(NULL == pShadow->pCacheBuffer) {
+		return;
+	}
+
+	/* Only a delta that arrived before this document but is newer than it is still worth applying */
+	isDeltaKept = (0 < pHeader->deltaLength && pHeader->deltaVersion > version
+				   && 0 == strcmp(pHeader->thingName, pShadow->myThingName));
+	cachedLength = length + 1 + (isDeltaKept ? pHeader->deltaLength : 0) + 1;
+	if(cachedLength > pShadow->cacheBufferSize) {
+		IOT_WARN("Shadow document too big for the cache");
+		return;
+	}
+
+	if(isDeltaKept) {
+		memmove(&(pShadow->pCacheBuffer[length + 1]), &(pShadow->pCacheBuffer[deltaOffsetOfCache(pHeader)]),
+				pHeader->deltaLength + 1);
+	} else {
+		pHeader->deltaVersion = 0;
+		pHeader->deltaLength = 0;
+		pShadow->pCacheBuffer[length + 1] = '\0';
+	}
+	memcpy(pShadow->pCacheBuffer, pDocument, length);
+	pShadow->pCacheBuffer[length] = '\0';
+
+	snprintf(pHeader->thingName, MAX_SIZE_OF_THING_NAME, "%s", pShadow->myThingName);
+	pHeader->documentVersion = version;
+	pHeader->documentLength = (uint32_t) length;
+	storeCache(pShadow, 0, cachedLength);
+}
+
+void cacheShadowDelta(AWS_IoT_Shadow_Context *pShadow, const char *pDelta, size_t length, uint32_t version) {
+	ShadowCacheHeader_t *pHeader = &(pShadow->cacheHeader);
+	size_t offset = deltaOffsetOfCache(pHeader);
+
+	/* A delta is only kept on top of a document of the same Thing */
+	if(NULL == pShadow->pCacheBuffer || 0 == pHeader->documentLength
+	   || 0 != strcmp(pHeader->thingName, pShadow->myThingName)
+	   || version <= pHeader->documentVersion || version <= pHeader->deltaVersion) {
+		return;
+	}
+
+	if(offset + length + 1 > pShadow->cacheBufferSize) {
+		IOT_WARN("Shadow delta too big for the cache");
+		return;
+	}
+
+	memcpy(&(pShadow->pCacheBuffer[offset]), pDelta, length);
+	pShadow->pCacheBuffer[offset + length] = '\0';
+	pHeader->deltaVersion = version;
+	pHeader->deltaLength = (uint32_t) length;
+	storeCache(pShadow, offset, length + 1);
+}
+
+IoT_Error_t aws_iot_shadow_enable_cache(AWS_IoT_Shadow_Context *pShadow, const IoT_Byte_Store *pStore,
+										char *pCacheBuffer, size_t cacheBufferSize) {
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pCacheBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL != pStore && (NULL == pStore->read || NULL == pStore->write)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(2 > cacheBufferSize || 0xFFFFFFFFu < (uint64_t) cacheBufferSize) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	initShadowCache(pShadow);
+	pShadow->pCacheBuffer = pCacheBuffer;
+	pShadow->cacheBufferSize = cacheBufferSize;
+
+	if(NULL != pStore) {
+		pShadow->cacheStore = *pStore;
+		if(!loadCache(pShadow)) {
+			IOT_DEBUG("No valid shadow cache in store, starting empty");
+			clearCache(pShadow);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_get_cached(AWS_IoT_Shadow_Context *pShadow, fpActionCallback_t callback,
+									  void *pContextData, uint8_t timeout_seconds, bool isPersistentSubscribe) {
+	ShadowCacheHeader_t *pHeader;
+	const char *pDelta;
+	uint32_t cachedVersion;
+	int32_t tokenCount;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pShadow->pMqttClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pHeader = &(pShadow->cacheHeader);
+	cachedVersion = (pHeader->deltaVersion > pHeader->documentVersion) ? pHeader->deltaVersion
+																		: pHeader->documentVersion;
+	if(NULL != pShadow->pCacheBuffer && 0 < pHeader->documentLength
+	   && 0 == strcmp(pHeader->thingName, pShadow->myThingName) && cachedVersion >= pShadow->shadowJsonVersionNum) {
+		pShadow->shadowJsonVersionNum = cachedVersion;
+		if(NULL != callback) {
+			callback(pShadow->myThingName, SHADOW_GET, SHADOW_ACK_CACHED, pShadow->pCacheBuffer, pContextData);
+		}
+
+		if(0 < pHeader->deltaLength) {
+			pDelta = &(pShadow->pCacheBuffer[deltaOffsetOfCache(pHeader)]);
+			if(isJsonValidAndParse(pDelta, pHeader->deltaLength, &(pShadow->jsonHandler), &tokenCount)) {
+				dispatchShadowDelta(pShadow, pDelta, tokenCount);
+			}
+		}
+	}
+
+	/* The cache may be of any age, the document is fetched as well so the device catches up with what it missed */
+	rc = aws_iot_shadow_get(pShadow, pShadow->myThingName, callback, pContextData, timeout_seconds,
+							isPersistentSubscribe);
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -26,35 +26,42 @@ extern "C" {
 
 #include <string.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "aws_iot_json_utils.h"
 #include "aws_iot_log.h"
+#include "aws_iot_shadow_interface.h"
 #include "aws_iot_shadow_key.h"
 #include "aws_iot_config.h"
 
-extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
 #define AWS_IOT_SHADOW_CLIENT_TOKEN_KEY "{\"clientToken\":\""
-static uint32_t clientTokenNum = 0;
 
-//helper functions
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData);
+/* Longest number written by the JSON writer: 17 significant digits, sign, point and exponent */
+#define SHADOW_JSON_NUMBER_MAX_LENGTH 32
 
-void resetClientTokenSequenceNum(void) {
-	clientTokenNum = 0;
+//helper functions
+static size_t formatUnsignedToJson(char *pBuffer, uint64_t value);
+static void writeToJson(ShadowJsonWriter_t *pWriter, const char *pData, size_t length);
+static void writeDataToJson(ShadowJsonWriter_t *pWriter, JsonPrimitiveType type, const void *pData);
+static IoT_Error_t addSectionToJsonDocument(char *pJsonDocument, size_t maxSizeOfJsonDocument,
+											const char *pSectionName, uint8_t count, va_list *pArgs);
+
+void resetClientTokenSequenceNum(AWS_IoT_Shadow_Context *pShadow) {
+	pShadow->clientTokenNum = 0;
 }
 
-static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
+static IoT_Error_t emptyJsonWithClientToken(AWS_IoT_Shadow_Context *pShadow, char *pBuffer, size_t bufferSize) {
 
     IoT_Error_t rc = SUCCESS;
     size_t dataLenInBuffer = 0;
 
-	if(pBuffer != NULL)
+	if(pShadow != NULL && pBuffer != NULL)
     {
         dataLenInBuffer = (size_t)snprintf(pBuffer, bufferSize, AWS_IOT_SHADOW_CLIENT_TOKEN_KEY);
     }else
 	{
-	    IOT_ERROR("NULL buffer in emptyJsonWithClientToken\n");
+	    IOT_ERROR("NULL shadow or buffer in emptyJsonWithClientToken\n");
         rc = FAILURE;
 	}
 
@@ -62,7 +69,7 @@ static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
 	{
 	    if ( dataLenInBuffer < bufferSize )
 	    {
-	        dataLenInBuffer += (size_t)snprintf(pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "%s-%d", mqttClientID, ( int )clientTokenNum++);
+	        dataLenInBuffer += (size_t)snprintf(pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "%s-%d", pShadow->mqttClientID, ( int )pShadow->clientTokenNum++);
 	    }
 	    else
 	    {
@@ -92,12 +99,14 @@ static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
     FUNC_EXIT_RC(rc);
 }
 
-IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize) {
-	return emptyJsonWithClientToken( pBuffer, bufferSize);
+IoT_Error_t aws_iot_shadow_internal_get_request_json(AWS_IoT_Shadow_Context *pShadow, char *pBuffer,
+													 size_t bufferSize) {
+	return emptyJsonWithClientToken(pShadow, pBuffer, bufferSize);
 }
 
-IoT_Error_t aws_iot_shadow_internal_delete_request_json(char *pBuffer, size_t bufferSize ) {
-	return emptyJsonWithClientToken( pBuffer, bufferSize);
+IoT_Error_t aws_iot_shadow_internal_delete_request_json(AWS_IoT_Shadow_Context *pShadow, char *pBuffer,
+														size_t bufferSize ) {
+	return emptyJsonWithClientToken(pShadow, pBuffer, bufferSize);
 }
 
 static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, size_t maxSizeOfJsonDocument) {
@@ -110,281 +119,372 @@ static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, siz
 }
 
 IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	ShadowJsonWriter_t writer;
 
-	IoT_Error_t ret_val = SUCCESS;
-	int32_t snPrintfReturn = 0;
+	return aws_iot_shadow_json_writer_init(&writer, pJsonDocument, maxSizeOfJsonDocument);
+}
 
-	if(pJsonDocument == NULL) {
-		return NULL_VALUE_ERROR;
+static IoT_Error_t addSectionToJsonDocument(char *pJsonDocument, size_t maxSizeOfJsonDocument,
+											const char *pSectionName, uint8_t count, va_list *pArgs) {
+	ShadowJsonWriter_t writer;
+	uint8_t i;
+
+	if(SUCCESS != aws_iot_shadow_json_writer_resume(&writer, pJsonDocument, maxSizeOfJsonDocument)) {
+		return writer.error;
 	}
-	snPrintfReturn = snprintf(pJsonDocument, maxSizeOfJsonDocument, "{\"state\":{");
 
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizeOfJsonDocument);
+	aws_iot_shadow_json_writer_begin_section(&writer, pSectionName);
+	for(i = 0; i < count && SUCCESS == writer.error; i++) {
+		aws_iot_shadow_json_writer_add(&writer, va_arg(*pArgs, jsonStruct_t *));
+	}
+	return aws_iot_shadow_json_writer_end_section(&writer);
+}
 
-	return ret_val;
+IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
+	va_list pArgs;
 
+	va_start(pArgs, count);
+	ret_val = addSectionToJsonDocument(pJsonDocument, maxSizeOfJsonDocument, "desired", count, &pArgs);
+	va_end(pArgs);
+
+	return ret_val;
 }
 
-IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
-	size_t tempSize = 0;
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
+IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
 	va_list pArgs;
-	jsonStruct_t *pTemporary = NULL;
+
 	va_start(pArgs, count);
+	ret_val = addSectionToJsonDocument(pJsonDocument, maxSizeOfJsonDocument, "reported", count, &pArgs);
+	va_end(pArgs);
+
+	return ret_val;
+}
+
+int32_t FillWithClientTokenSize(AWS_IoT_Shadow_Context *pShadow, char *pBufferToBeUpdatedWithClientToken,
+								size_t maxSizeOfJsonDocument) {
+	int32_t snPrintfReturn;
+	snPrintfReturn = snprintf(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument, "%s-%d", pShadow->mqttClientID,
+				  (int) pShadow->clientTokenNum++);
+
+	return snPrintfReturn;
+}
+
+IoT_Error_t aws_iot_fill_with_client_token(AWS_IoT_Shadow_Context *pShadow, char *pBufferToBeUpdatedWithClientToken,
+										   size_t maxSizeOfJsonDocument) {
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
+	int32_t snPrintfRet = 0;
+
+	if(pShadow == NULL || pBufferToBeUpdatedWithClientToken == NULL) {
 		return NULL_VALUE_ERROR;
 	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
+	snPrintfRet = FillWithClientTokenSize(pShadow, pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument);
+	return checkReturnValueOfSnPrintf(snPrintfRet, maxSizeOfJsonDocument);
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"desired\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+}
+
+IoT_Error_t aws_iot_finalize_json_document(AWS_IoT_Shadow_Context *pShadow, char *pJsonDocument,
+										   size_t maxSizeOfJsonDocument) {
+	ShadowJsonWriter_t writer;
+	char number[SHADOW_JSON_NUMBER_MAX_LENGTH];
+	uint32_t tokenNum;
 
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+	if(pShadow == NULL || pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
 	}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
-		}
+	if(SUCCESS != aws_iot_shadow_json_writer_resume(&writer, pJsonDocument, maxSizeOfJsonDocument)) {
+		return writer.error;
 	}
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	// the last ,(comma) that was added closes the state
+	if(writer.length > 0 && writer.pBuffer[writer.length - 1] == ',') {
+		writer.length--;
+	}
+	writeToJson(&writer, "}, \"" SHADOW_CLIENT_TOKEN_STRING "\":\"", strlen("}, \"" SHADOW_CLIENT_TOKEN_STRING "\":\""));
+	writeToJson(&writer, pShadow->mqttClientID, strlen(pShadow->mqttClientID));
+	tokenNum = pShadow->clientTokenNum++;
+	number[0] = '-';
+	writeToJson(&writer, number, 1 + formatUnsignedToJson(number + 1, tokenNum));
+	writeToJson(&writer, "\"}", 2);
+
+	return writer.error;
 }
 
-IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
+IoT_Error_t aws_iot_shadow_json_writer_init(ShadowJsonWriter_t *pWriter, char *pJsonDocument,
+											size_t maxSizeOfJsonDocument) {
+	if(pWriter == NULL || pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
 
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	jsonStruct_t *pTemporary;
-	va_list pArgs;
-	va_start(pArgs, count);
+	pWriter->pBuffer = pJsonDocument;
+	pWriter->size = maxSizeOfJsonDocument;
+	pWriter->length = 0;
+	pWriter->error = (maxSizeOfJsonDocument > 0) ? SUCCESS : SHADOW_JSON_ERROR;
+	writeToJson(pWriter, "{\"state\":{", strlen("{\"state\":{"));
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
+	return pWriter->error;
+}
+
+IoT_Error_t aws_iot_shadow_json_writer_resume(ShadowJsonWriter_t *pWriter, char *pJsonDocument,
+											  size_t maxSizeOfJsonDocument) {
+	if(pWriter == NULL || pJsonDocument == NULL) {
+		if(pWriter != NULL) {
+			pWriter->error = NULL_VALUE_ERROR;
+		}
 		return NULL_VALUE_ERROR;
 	}
 
+	pWriter->pBuffer = pJsonDocument;
+	pWriter->size = maxSizeOfJsonDocument;
+	pWriter->length = strlen(pJsonDocument);
+	pWriter->error = (maxSizeOfJsonDocument > pWriter->length + 1) ? SUCCESS : SHADOW_JSON_ERROR;
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
+	return pWriter->error;
+}
+
+IoT_Error_t aws_iot_shadow_json_writer_begin_section(ShadowJsonWriter_t *pWriter, const char *pSectionName) {
+	if(pWriter == NULL || pSectionName == NULL) {
+		return NULL_VALUE_ERROR;
 	}
-	remSizeOfJsonBuffer = tempSize;
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"reported\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	writeToJson(pWriter, "\"", 1);
+	writeToJson(pWriter, pSectionName, strlen(pSectionName));
+	writeToJson(pWriter, "\":{", 3);
+
+	return pWriter->error;
+}
 
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+IoT_Error_t aws_iot_shadow_json_writer_add(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
 	}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
-		}
+	if(pWriter->error == SUCCESS && (pStruct == NULL || pStruct->pKey == NULL || pStruct->pData == NULL)) {
+		pWriter->error = NULL_VALUE_ERROR;
 	}
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	if(pWriter->error == SUCCESS) {
+		writeToJson(pWriter, "\"", 1);
+		writeToJson(pWriter, pStruct->pKey, strlen(pStruct->pKey));
+		writeToJson(pWriter, "\":", 2);
+		writeDataToJson(pWriter, pStruct->type, pStruct->pData);
+		writeToJson(pWriter, ",", 1);
+	}
+
+	return pWriter->error;
 }
 
+IoT_Error_t aws_iot_shadow_json_writer_end_section(ShadowJsonWriter_t *pWriter) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
 
-int32_t FillWithClientTokenSize(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
-	int32_t snPrintfReturn;
-	snPrintfReturn = snprintf(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument, "%s-%d", mqttClientID,
-				  (int) clientTokenNum++);
+	if(pWriter->error == SUCCESS && pWriter->length > 0 && pWriter->pBuffer[pWriter->length - 1] == ',') {
+		pWriter->length--;
+	}
+	writeToJson(pWriter, "},", 2);
 
-	return snPrintfReturn;
+	return pWriter->error;
 }
 
-IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
+/* Copies what fits and keeps the document null terminated, like snprintf */
+static void writeToJson(ShadowJsonWriter_t *pWriter, const char *pData, size_t length) {
+	size_t available;
 
-	int32_t snPrintfRet = 0;
-	snPrintfRet = FillWithClientTokenSize(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument);
-	return checkReturnValueOfSnPrintf(snPrintfRet, maxSizeOfJsonDocument);
+	if(pWriter->error != SUCCESS) {
+		return;
+	}
 
+	available = pWriter->size - pWriter->length - 1;
+	if(length > available) {
+		length = available;
+		pWriter->error = SHADOW_JSON_BUFFER_TRUNCATED;
+	}
+	memcpy(pWriter->pBuffer + pWriter->length, pData, length);
+	pWriter->length += length;
+	pWriter->pBuffer[pWriter->length] = '\0';
 }
 
-IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	IoT_Error_t ret_val = SUCCESS;
+static size_t formatUnsignedToJson(char *pBuffer, uint64_t value) {
+	char digits[20];
+	size_t count = 0;
+	size_t i;
 
-	if(pJsonDocument == NULL) {
-		return NULL_VALUE_ERROR;
+	do {
+		digits[count++] = (char) ('0' + (value % 10));
+		value /= 10;
+	} while(value > 0);
+
+	for(i = 0; i < count; i++) {
+		pBuffer[i] = digits[count - 1 - i];
 	}
+	return count;
+}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+static size_t formatSignedToJson(char *pBuffer, int64_t value) {
+	if(value < 0) {
+		pBuffer[0] = '-';
+		return 1 + formatUnsignedToJson(pBuffer + 1, (uint64_t) (-(value + 1)) + 1);
 	}
-	remSizeOfJsonBuffer = tempSize;
+	return formatUnsignedToJson(pBuffer, (uint64_t) value);
+}
 
-	// strlen(ShadowTxBuffer) - 1 is to ensure we remove the last ,(comma) that was added
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "}, \"%s\":\"",
-							  SHADOW_CLIENT_TOKEN_STRING);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+/**
+ * Writes value with the fewest significant digits that convert back to the same float (isFloat) or double.
+ * The digits are found by rounding value at 1, 2, ... significant digits with exact powers of ten, where both the
+ * scaled integer and the power of ten are exactly representable, so converting back is correctly rounded and the
+ * check is exact. Returns 0 outside of that range, the caller then uses snprintf.
+ */
+static size_t formatShortestToJson(char *pBuffer, double value, bool isFloat) {
+	static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+										 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	char digits[SHADOW_JSON_NUMBER_MAX_LENGTH];
+	double magnitude = (value < 0) ? -value : value;
+	double scaled, roundTrip;
+	uint64_t mantissa = 0;
+	int32_t exponent, scale = 0, precision, digitCount, length = 0, i;
+	bool isExact = false;
+
+	if(magnitude < 1e-7 || magnitude >= 1e15) {
+		return 0;
+	}
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
+	/* Decimal exponent of the leading digit, approximate: the round trip check catches an error */
+	exponent = 0;
+	if(magnitude >= 1.0) {
+		while(exponent < 14 && powersOfTen[exponent + 1] <= magnitude) {
+			exponent++;
+		}
+	} else {
+		while(exponent > -7 && magnitude * powersOfTen[-exponent] < 1.0) {
+			exponent--;
+		}
 	}
-	// refactor this XXX repeated code
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+
+	for(precision = 1; precision <= (isFloat ? 9 : 15) && !isExact; precision++) {
+		scale = precision - 1 - exponent;
+		scaled = (scale >= 0) ? magnitude * powersOfTen[scale] : magnitude / powersOfTen[-scale];
+		mantissa = (uint64_t) (scaled + 0.5);
+		roundTrip = (scale >= 0) ? (double) mantissa / powersOfTen[scale] : (double) mantissa * powersOfTen[-scale];
+		isExact = isFloat ? ((float) roundTrip == (float) magnitude) : (roundTrip == magnitude);
 	}
-	remSizeOfJsonBuffer = tempSize;
 
+	if(!isExact) {
+		return 0;
+	}
 
-	snPrintfReturn = FillWithClientTokenSize(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	if(value < 0) {
+		pBuffer[length++] = '-';
+	}
+	digitCount = (int32_t) formatUnsignedToJson(digits, mantissa);
+	if(scale <= 0) {
+		memcpy(pBuffer + length, digits, (size_t) digitCount);
+		length += digitCount;
+		for(i = 0; i < -scale; i++) {
+			pBuffer[length++] = '0';
+		}
+		return (size_t) length;
+	}
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
+	if(digitCount > scale) {
+		memcpy(pBuffer + length, digits, (size_t) (digitCount - scale));
+		length += digitCount - scale;
+	} else {
+		pBuffer[length++] = '0';
 	}
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+	pBuffer[length++] = '.';
+	for(i = digitCount; i < scale; i++) {
+		pBuffer[length++] = '0';
 	}
-	remSizeOfJsonBuffer = tempSize;
+	memcpy(pBuffer + length, digits + ((digitCount > scale) ? digitCount - scale : 0),
+		   (size_t) ((digitCount > scale) ? scale : digitCount));
+	length += (digitCount > scale) ? scale : digitCount;
 
+	/* The mantissa may have been rounded up to a power of ten */
+	while(pBuffer[length - 1] == '0') {
+		length--;
+	}
+	if(pBuffer[length - 1] == '.') {
+		length--;
+	}
+	return (size_t) length;
+}
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"}");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+static size_t formatFloatingToJson(char *pBuffer, double value, bool isFloat) {
+	size_t length;
+	int32_t precision;
 
-	return ret_val;
-}
+	if(value != value || value > 1.7976931348623157e308 || value < -1.7976931348623157e308) {
+		/* JSON has no NaN or infinity */
+		memcpy(pBuffer, "null", 4);
+		return 4;
+	}
+	if(value == 0) {
+		pBuffer[0] = '0';
+		return 1;
+	}
 
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData) {
-	int32_t snPrintfReturn = 0;
-	IoT_Error_t ret_val = SUCCESS;
+	length = formatShortestToJson(pBuffer, value, isFloat);
+	if(length > 0) {
+		return length;
+	}
 
-	if(maxSizoStringBuffer == 0) {
-		return SHADOW_JSON_ERROR;
+	/* Very large or small values, and doubles that need more than 15 digits */
+	for(precision = isFloat ? 9 : 16; ; precision++) {
+		length = (size_t) snprintf(pBuffer, SHADOW_JSON_NUMBER_MAX_LENGTH, "%.*g", (int) precision, value);
+		if(precision >= (isFloat ? 9 : 17)
+		   || (isFloat ? ((float) strtod(pBuffer, NULL) == (float) value) : (strtod(pBuffer, NULL) == value))) {
+			return length;
+		}
 	}
+}
+
+static void writeDataToJson(ShadowJsonWriter_t *pWriter, JsonPrimitiveType type, const void *pData) {
+	char number[SHADOW_JSON_NUMBER_MAX_LENGTH];
 
 	if(type == SHADOW_JSON_INT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%i,", *(int32_t *) (pData));
+		writeToJson(pWriter, number, formatSignedToJson(number, *(const int32_t *) pData));
 	} else if(type == SHADOW_JSON_INT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hi,", *(int16_t *) (pData));
+		writeToJson(pWriter, number, formatSignedToJson(number, *(const int16_t *) pData));
 	} else if(type == SHADOW_JSON_INT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhi,", *(int8_t *) (pData));
+		writeToJson(pWriter, number, formatSignedToJson(number, *(const int8_t *) pData));
 	} else if(type == SHADOW_JSON_UINT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%u,", *(uint32_t *) (pData));
+		writeToJson(pWriter, number, formatUnsignedToJson(number, *(const uint32_t *) pData));
 	} else if(type == SHADOW_JSON_UINT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hu,", *(uint16_t *) (pData));
+		writeToJson(pWriter, number, formatUnsignedToJson(number, *(const uint16_t *) pData));
 	} else if(type == SHADOW_JSON_UINT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhu,", *(uint8_t *) (pData));
+		writeToJson(pWriter, number, formatUnsignedToJson(number, *(const uint8_t *) pData));
 	} else if(type == SHADOW_JSON_DOUBLE) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(double *) (pData));
+		writeToJson(pWriter, number, formatFloatingToJson(number, *(const double *) pData, false));
 	} else if(type == SHADOW_JSON_FLOAT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(float *) (pData));
+		writeToJson(pWriter, number, formatFloatingToJson(number, *(const float *) pData, true));
 	} else if(type == SHADOW_JSON_BOOL) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", *(bool *) (pData) ? "true" : "false");
+		if(*(const bool *) pData) {
+			writeToJson(pWriter, "true", 4);
+		} else {
+			writeToJson(pWriter, "false", 5);
+		}
 	} else if(type == SHADOW_JSON_STRING) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "\"%s\",", (char *) (pData));
+		writeToJson(pWriter, "\"", 1);
+		writeToJson(pWriter, (const char *) pData, strlen((const char *) pData));
+		writeToJson(pWriter, "\"", 1);
 	} else if(type == SHADOW_JSON_OBJECT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", (char *) (pData));
+		writeToJson(pWriter, (const char *) pData, strlen((const char *) pData));
 	}
-
-
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizoStringBuffer);
-
-	return ret_val;
 }
 
-static jsmn_parser shadowJsonParser;
-static jsmntok_t jsonTokenStruct[MAX_JSON_TOKEN_EXPECTED];
-
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount) {
 	int32_t tokenCount;
+	ShadowJsonHandler_t *pHandler = (ShadowJsonHandler_t *) pJsonHandler;
+	jsmntok_t *jsonTokenStruct = pHandler->tokens;
 
-	IOT_UNUSED(pJsonHandler);
-
-	jsmn_init(&shadowJsonParser);
+	jsmn_init(&pHandler->parser);
 
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = jsmn_parse(&pHandler->parser, pJsonDocument, jsonSize, jsonTokenStruct,
+							sizeof(pHandler->tokens) / sizeof(pHandler->tokens[0]));
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -434,8 +534,7 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 	int32_t i, metadataEnd;
 	uint32_t dataLength;
 	jsmntok_t dataToken;
-
-	IOT_UNUSED(pJsonHandler);
+	jsmntok_t *jsonTokenStruct = ((ShadowJsonHandler_t *) pJsonHandler)->tokens;
 
 	for(i = 1; i < tokenCount; ) {
 		if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), pDataStruct->pKey) == 0) {
@@ -477,13 +576,45 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 	return false;
 }
 
-bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
+/**
+ * Returns the index of the first key token after index, or tokenCount when there is none. Keys are the strings
+ * followed by a value (jsmn gives them a size of 1), the keys of the "metadata" objects are skipped.
+ */
+int32_t nextJsonKeyIndex(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, int32_t index) {
+	int32_t i, metadataEnd;
+	jsmntok_t *jsonTokenStruct = ((ShadowJsonHandler_t *) pJsonHandler)->tokens;
+
+	for(i = index + 1; i + 1 < tokenCount; ) {
+		if(jsonTokenStruct[i].type != JSMN_STRING || jsonTokenStruct[i].size != 1) {
+			i++;
+		} else if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), "metadata") == 0) {
+			metadataEnd = jsonTokenStruct[i + 1].end;
+			for(i += 2; i < tokenCount && jsonTokenStruct[i].end < metadataEnd; i++);
+		} else {
+			return i;
+		}
+	}
+	return tokenCount;
+}
+
+void updateValueOfJsonKey(const char *pJsonDocument, void *pJsonHandler, int32_t keyIndex, jsonStruct_t *pDataStruct,
+						  uint32_t *pDataLength, int32_t *pDataPosition) {
+	jsmntok_t dataToken = ((ShadowJsonHandler_t *) pJsonHandler)->tokens[keyIndex + 1];
+
+	UpdateValueIfNoObject(pJsonDocument, pDataStruct, dataToken);
+	*pDataPosition = dataToken.start;
+	*pDataLength = (uint32_t) (dataToken.end - dataToken.start);
+}
+
+bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler) {
 	int32_t tokenCount;
+	ShadowJsonHandler_t *pHandler = (ShadowJsonHandler_t *) pJsonHandler;
+	jsmntok_t *jsonTokenStruct = pHandler->tokens;
 
-	jsmn_init(&shadowJsonParser);
+	jsmn_init(&pHandler->parser);
 
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = jsmn_parse(&pHandler->parser, pJsonDocument, jsonSize, jsonTokenStruct,
+							sizeof(pHandler->tokens) / sizeof(pHandler->tokens[0]));
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -498,14 +629,16 @@ bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
 	return true;
 }
 
-bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtractedClientToken, size_t clientTokenSize) {
-	int32_t tokenCount, i;
-	size_t length;
-	jsmntok_t ClientJsonToken;
-	jsmn_init(&shadowJsonParser);
+bool extractClientToken(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, char *pExtractedClientToken,
+						size_t clientTokenSize) {
+	int32_t tokenCount;
+	ShadowJsonHandler_t *pHandler = (ShadowJsonHandler_t *) pJsonHandler;
+	jsmntok_t *jsonTokenStruct = pHandler->tokens;
 
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	jsmn_init(&pHandler->parser);
+
+	tokenCount = jsmn_parse(&pHandler->parser, pJsonDocument, jsonSize, jsonTokenStruct,
+							sizeof(pHandler->tokens) / sizeof(pHandler->tokens[0]));
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -517,7 +650,18 @@ bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtra
 		return false;
 	}
 
-	for(i = 1; i < tokenCount; i++) {
+	return extractParsedClientToken(pJsonDocument, pJsonHandler, tokenCount, pExtractedClientToken, clientTokenSize);
+}
+
+/* Reads the client token from a document already parsed into pJsonHandler, as left by isJsonValidAndParse */
+bool extractParsedClientToken(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
+							  char *pExtractedClientToken, size_t clientTokenSize) {
+	int32_t i;
+	size_t length;
+	jsmntok_t ClientJsonToken;
+	jsmntok_t *jsonTokenStruct = ((ShadowJsonHandler_t *) pJsonHandler)->tokens;
+
+	for(i = 1; i + 1 < tokenCount; i++) {
 		if(jsoneq(pJsonDocument, &jsonTokenStruct[i], SHADOW_CLIENT_TOKEN_STRING) == 0) {
 			ClientJsonToken = jsonTokenStruct[i + 1];
 			length = (size_t) (ClientJsonToken.end - ClientJsonToken.start);
@@ -539,8 +683,7 @@ bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtra
 bool extractVersionNumber(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, uint32_t *pVersionNumber) {
 	int32_t i;
 	IoT_Error_t ret_val = SUCCESS;
-
-	IOT_UNUSED(pJsonHandler);
+	jsmntok_t *jsonTokenStruct = ((ShadowJsonHandler_t *) pJsonHandler)->tokens;
 
 	for(i = 1; i < tokenCount; i++) {
 		if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), SHADOW_VERSION_STRING) == 0) {
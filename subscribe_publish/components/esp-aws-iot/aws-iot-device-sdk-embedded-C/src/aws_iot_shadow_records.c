@@ -23,6 +23,7 @@ extern "C" {
 #endif
 
 #include "aws_iot_shadow_records.h"
+#include "aws_iot_shadow_cache.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -33,54 +34,18 @@ extern "C" {
 #include "aws_iot_shadow_json.h"
 #include "aws_iot_config.h"
 
-typedef struct {
-	char clientTokenID[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
-	char thingName[MAX_SIZE_OF_THING_NAME];
-	ShadowActions_t action;
-	fpActionCallback_t callback;
-	void *pCallbackContext;
-	bool isFree;
-	Timer timer;
-} ToBeReceivedAckRecord_t;
-
-typedef struct {
-	const char *pKey;
-	void *pStruct;
-	jsonStructCallback_t callback;
-	bool isFree;
-} JsonTokenTable_t;
-
-typedef struct {
-	char Topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
-	uint8_t count;
-	bool isFree;
-	bool isSticky;
-} SubscriptionRecord_t;
-
 typedef enum {
 	SHADOW_ACCEPTED, SHADOW_REJECTED, SHADOW_ACTION
 } ShadowAckTopicTypes_t;
 
-ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
-
-AWS_IoT_Client *pMqttClient;
-
-char myThingName[MAX_SIZE_OF_THING_NAME];
-char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
-
-char shadowDeltaTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
-
-#define MAX_TOPICS_AT_ANY_GIVEN_TIME 2*MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME
-SubscriptionRecord_t SubscriptionList[MAX_TOPICS_AT_ANY_GIVEN_TIME];
-
 #define SUBSCRIBE_SETTLING_TIME 2
-char shadowRxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER];
 
-static JsonTokenTable_t tokenTable[MAX_JSON_TOKEN_EXPECTED];
-static uint32_t tokenTableIndex = 0;
-static bool deltaTopicSubscribedFlag = false;
-uint32_t shadowJsonVersionNum = 0;
-bool shadowDiscardOldDeltaFlag = true;
+#define SHADOW_TOPIC_THING_OFFSET (sizeof("$aws/things/") - 1)
+#define SHADOW_TOPIC_ACTION_OFFSET (sizeof("/shadow/") - 1)
+
+/* ackRoutes holds the accepted and rejected routes of each action, then those of the wildcard subscriptions */
+#define ACK_ROUTE_INDEX(action, ackType) ((uint8_t) (action) * 2 + (uint8_t) (ackType))
+#define ACK_ROUTE_ANY_ACTION_INDEX(ackType) ACK_ROUTE_INDEX(SHADOW_DELETE + 1, ackType)
 
 // local helper functions
 static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName,
@@ -92,68 +57,474 @@ static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 static void topicNameFromThingAndAction(char *pTopic, const char *pThingName, ShadowActions_t action,
 										ShadowAckTopicTypes_t ackType);
 
-static int16_t getNextFreeIndexOfSubscriptionList(void);
+static int16_t getNextFreeIndexOfSubscriptionList(AWS_IoT_Shadow_Context *pShadow);
+
+static void unsubscribeFromAcceptedAndRejected(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+											   ShadowActions_t action);
 
-static void unsubscribeFromAcceptedAndRejected(uint8_t index);
+/* Orders the registered keys by length first, so most comparisons stop before reading the key */
+static int compareDeltaKey(const char *pKey, size_t keyLen, const JsonTokenTable_t *pEntry) {
+	if(keyLen != pEntry->keyLen) {
+		return (keyLen < pEntry->keyLen) ? -1 : 1;
+	}
+	return memcmp(pKey, pEntry->pLeafKey, keyLen);
+}
 
-void initDeltaTokens(void) {
+/**
+ * Checks the segments of a path before its leaf against the keys enclosing the key that matched the leaf,
+ * innermost first. The path may end at any depth, the first segment does not have to be at the root.
+ */
+static bool isDeltaPathMatching(AWS_IoT_Shadow_Context *pShadow, const char *pJsonDocument,
+								const JsonTokenTable_t *pEntry, uint16_t pathLen) {
+	const char *pPathStart = pEntry->pKey + ((pEntry->pathSeparator == '/') ? 1 : 0);
+	const char *pSegmentEnd = pEntry->pLeafKey - 1;
+	const char *pSegment;
+	jsmntok_t *pKeyToken;
+	uint8_t remaining;
+
+	if(pEntry->pathDepth - 1 > pathLen) {
+		return false;
+	}
+
+	for(remaining = (uint8_t) (pEntry->pathDepth - 1); remaining > 0; remaining--) {
+		for(pSegment = pSegmentEnd; pSegment > pPathStart && *(pSegment - 1) != pEntry->pathSeparator; pSegment--);
+		pKeyToken = &pShadow->jsonHandler.tokens[pShadow->deltaKeyPath[--pathLen]];
+		if((size_t) (pKeyToken->end - pKeyToken->start) != (size_t) (pSegmentEnd - pSegment)
+		   || memcmp(pJsonDocument + pKeyToken->start, pSegment, (size_t) (pSegmentEnd - pSegment)) != 0) {
+			return false;
+		}
+		pSegmentEnd = pSegment - 1;
+	}
+	return true;
+}
+
+/* Position in deltaKeyOrder of the first entry not ordered before pKey */
+static uint32_t lowerBoundOfDeltaKey(AWS_IoT_Shadow_Context *pShadow, const char *pKey, size_t keyLen) {
+	uint32_t low = 0;
+	uint32_t high = pShadow->tokenTableIndex;
+	uint32_t middle;
+
+	while(low < high) {
+		middle = (low + high) / 2;
+		if(compareDeltaKey(pKey, keyLen, &pShadow->tokenTable[pShadow->deltaKeyOrder[middle]]) > 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+void initDeltaTokens(AWS_IoT_Shadow_Context *pShadow) {
 	uint32_t i;
 	for(i = 0; i < MAX_JSON_TOKEN_EXPECTED; i++) {
-		tokenTable[i].isFree = true;
+		pShadow->tokenTable[i].isFree = true;
 	}
-	tokenTableIndex = 0;
-	deltaTopicSubscribedFlag = false;
+	pShadow->tokenTableIndex = 0;
+	pShadow->deltaTopicSubscribedFlag = false;
 }
 
-IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
+IoT_Error_t registerJsonTokenOnDelta(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct) {
 
 	IoT_Error_t rc = SUCCESS;
-
-	if(!deltaTopicSubscribedFlag) {
-		snprintf(shadowDeltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/delta", myThingName);
-		rc = aws_iot_mqtt_subscribe(pMqttClient, shadowDeltaTopic, (uint16_t) strlen(shadowDeltaTopic), QOS0,
-									shadow_delta_callback, NULL);
-		deltaTopicSubscribedFlag = true;
+	JsonTokenTable_t *pEntry;
+	const char *pSeparator;
+	uint32_t position;
+
+	if(!pShadow->deltaTopicSubscribedFlag) {
+		snprintf(pShadow->shadowDeltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/delta",
+				 pShadow->myThingName);
+		rc = aws_iot_mqtt_subscribe(pShadow->pMqttClient, pShadow->shadowDeltaTopic,
+									(uint16_t) strlen(pShadow->shadowDeltaTopic), QOS0, shadow_delta_callback,
+									(void *) pShadow);
+		pShadow->deltaTopicSubscribedFlag = true;
 	}
 
-	if(tokenTableIndex >= MAX_JSON_TOKEN_EXPECTED) {
+	if(pShadow->tokenTableIndex >= MAX_JSON_TOKEN_EXPECTED) {
 		return FAILURE;
 	}
 
-	tokenTable[tokenTableIndex].pKey = pStruct->pKey;
-	tokenTable[tokenTableIndex].callback = pStruct->cb;
-	tokenTable[tokenTableIndex].pStruct = pStruct;
-	tokenTable[tokenTableIndex].isFree = false;
-	tokenTableIndex++;
+	pEntry = &pShadow->tokenTable[pShadow->tokenTableIndex];
+	pEntry->pKey = pStruct->pKey;
+	pEntry->pathSeparator = (pStruct->pKey[0] == '/') ? '/' : '.';
+	pEntry->pLeafKey = pStruct->pKey + ((pEntry->pathSeparator == '/') ? 1 : 0);
+	pEntry->pathDepth = 1;
+	for(pSeparator = strchr(pEntry->pLeafKey, pEntry->pathSeparator); NULL != pSeparator;
+		pSeparator = strchr(pSeparator + 1, pEntry->pathSeparator)) {
+		pEntry->pLeafKey = pSeparator + 1;
+		pEntry->pathDepth++;
+	}
+	pEntry->keyLen = strlen(pEntry->pLeafKey);
+	pEntry->callback = pStruct->cb;
+	pEntry->pStruct = pStruct;
+	pEntry->isFree = false;
+
+	/* Keys with the same name stay in registration order */
+	position = lowerBoundOfDeltaKey(pShadow, pEntry->pLeafKey, pEntry->keyLen);
+	while(position < pShadow->tokenTableIndex
+		  && compareDeltaKey(pEntry->pLeafKey, pEntry->keyLen, &pShadow->tokenTable[pShadow->deltaKeyOrder[position]]) == 0) {
+		position++;
+	}
+	memmove(&pShadow->deltaKeyOrder[position + 1], &pShadow->deltaKeyOrder[position],
+			(pShadow->tokenTableIndex - position) * sizeof(pShadow->deltaKeyOrder[0]));
+	pShadow->deltaKeyOrder[position] = (uint16_t) pShadow->tokenTableIndex;
+	pShadow->tokenTableIndex++;
 
 	return rc;
 }
 
-static int16_t getNextFreeIndexOfSubscriptionList(void) {
+/* State of a ReportedFieldRecord_t that is not waiting for the response of an update */
+#define REPORTED_FIELD_IDLE 0xFF
+
+void initReportedFields(AWS_IoT_Shadow_Context *pShadow) {
+	uint32_t i;
+
+	pShadow->reportedFieldsCount = 0;
+	for(i = 0; i < SHADOW_REPORTED_UPDATE_COUNT; i++) {
+		pShadow->reportedUpdates[i].pShadow = pShadow;
+		pShadow->reportedUpdates[i].isFree = true;
+	}
+}
+
+IoT_Error_t registerReportedField(AWS_IoT_Shadow_Context *pShadow, jsonStruct_t *pStruct) {
+	ReportedFieldRecord_t *pField;
+
+	if(pShadow->reportedFieldsCount >= MAX_SHADOW_REPORTED_FIELDS) {
+		return FAILURE;
+	}
+
+	pField = &pShadow->reportedFields[pShadow->reportedFieldsCount];
+	pField->pStruct = pStruct;
+	pField->isReported = false;
+	pField->update = REPORTED_FIELD_IDLE;
+	pShadow->reportedFieldsCount++;
+
+	return SUCCESS;
+}
+
+/* Reads the current value of a number field in the form kept by ReportedFieldRecord_t */
+static ReportedFieldValue_t readReportedValue(const jsonStruct_t *pStruct) {
+	ReportedFieldValue_t value;
+
+	switch(pStruct->type) {
+		case SHADOW_JSON_INT32:
+			value.integer = *(const int32_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_INT16:
+			value.integer = *(const int16_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_INT8:
+			value.integer = *(const int8_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_UINT32:
+			value.integer = *(const uint32_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_UINT16:
+			value.integer = *(const uint16_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_UINT8:
+			value.integer = *(const uint8_t *) pStruct->pData;
+			break;
+		case SHADOW_JSON_BOOL:
+			value.integer = *(const bool *) pStruct->pData ? 1 : 0;
+			break;
+		case SHADOW_JSON_FLOAT:
+			value.floating = *(const float *) pStruct->pData;
+			break;
+		case SHADOW_JSON_DOUBLE:
+		default:
+			value.floating = *(const double *) pStruct->pData;
+			break;
+	}
+
+	return value;
+}
+
+static bool isReportedTextField(const ReportedFieldRecord_t *pField) {
+	return (SHADOW_JSON_STRING == pField->pStruct->type || SHADOW_JSON_OBJECT == pField->pStruct->type);
+}
+
+/* Compares the current value of a field with the value last accepted, without touching the value of an update */
+static bool isReportedValueChanged(const ReportedFieldRecord_t *pField, double floatEpsilon) {
+	ReportedFieldValue_t value;
+	double difference;
+
+	if(isReportedTextField(pField)) {
+		return (strlen((const char *) pField->pStruct->pData) >= MAX_SHADOW_REPORTED_TEXT_LENGTH
+				|| 0 != strcmp((const char *) pField->pStruct->pData, pField->lastText));
+	}
+
+	value = readReportedValue(pField->pStruct);
+	switch(pField->pStruct->type) {
+		case SHADOW_JSON_FLOAT:
+		case SHADOW_JSON_DOUBLE:
+			difference = value.floating - pField->lastValue.floating;
+			return (difference > floatEpsilon || difference < -floatEpsilon);
+		default:
+			return (value.integer != pField->lastValue.integer);
+	}
+}
+
+/* Keeps the value of a field sent in an update, committed if the update is accepted */
+static void keepReportedValue(ReportedFieldRecord_t *pField) {
+	size_t length;
+
+	if(isReportedTextField(pField)) {
+		length = strlen((const char *) pField->pStruct->pData);
+		pField->isPendingTextKept = (length < MAX_SHADOW_REPORTED_TEXT_LENGTH);
+		if(pField->isPendingTextKept) {
+			memcpy(pField->pendingText, pField->pStruct->pData, length + 1);
+		}
+	} else {
+		pField->pendingValue = readReportedValue(pField->pStruct);
+	}
+}
+
+IoT_Error_t startReportedUpdate(AWS_IoT_Shadow_Context *pShadow, fpActionCallback_t callback, void *pContextData,
+								ShadowReportedUpdate_t **ppUpdate) {
+	uint8_t update;
+
+	for(update = 0; update < SHADOW_REPORTED_UPDATE_COUNT && !pShadow->reportedUpdates[update].isFree; update++);
+	if(SHADOW_REPORTED_UPDATE_COUNT == update) {
+		return FAILURE;
+	}
+
+	pShadow->reportedUpdates[update].callback = callback;
+	pShadow->reportedUpdates[update].pContextData = pContextData;
+	pShadow->reportedUpdates[update].isFree = false;
+	*ppUpdate = &(pShadow->reportedUpdates[update]);
+
+	return SUCCESS;
+}
+
+uint32_t addChangedReportedFields(ShadowReportedUpdate_t *pUpdate, ShadowJsonWriter_t *pWriter, double floatEpsilon,
+								  bool forceFullReport) {
+	AWS_IoT_Shadow_Context *pShadow = pUpdate->pShadow;
+	uint32_t i;
+	uint32_t count = 0;
+	ReportedFieldRecord_t *pField;
+
+	for(i = 0; i < pShadow->reportedFieldsCount; i++) {
+		pField = &pShadow->reportedFields[i];
+		if(forceFullReport || !pField->isReported || isReportedValueChanged(pField, floatEpsilon)) {
+			/* An earlier update still waiting for its response no longer carries the value to commit. A field
+			 * left out keeps the value of that update, which is what the service holds once it is accepted */
+			keepReportedValue(pField);
+			pField->update = (uint8_t) (pUpdate - pShadow->reportedUpdates);
+			aws_iot_shadow_json_writer_add(pWriter, pField->pStruct);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* Commits the values of the fields sent in the update when it was accepted, and releases the update */
+static void endReportedUpdate(ShadowReportedUpdate_t *pUpdate, bool isAccepted) {
+	AWS_IoT_Shadow_Context *pShadow = pUpdate->pShadow;
+	uint8_t update = (uint8_t) (pUpdate - pShadow->reportedUpdates);
+	uint32_t i;
+	ReportedFieldRecord_t *pField;
+
+	for(i = 0; i < pShadow->reportedFieldsCount; i++) {
+		pField = &pShadow->reportedFields[i];
+		if(update != pField->update) {
+			continue;
+		}
+		if(isAccepted) {
+			pField->lastValue = pField->pendingValue;
+			if(isReportedTextField(pField)) {
+				if(pField->isPendingTextKept) {
+					strcpy(pField->lastText, pField->pendingText);
+				}
+				pField->isReported = pField->isPendingTextKept;
+			} else {
+				pField->isReported = true;
+			}
+		}
+		pField->update = REPORTED_FIELD_IDLE;
+	}
+	pUpdate->isFree = true;
+}
+
+void cancelReportedUpdate(ShadowReportedUpdate_t *pUpdate) {
+	endReportedUpdate(pUpdate, false);
+}
+
+void reportedUpdateCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							const char *pReceivedJsonDocument, void *pContextData) {
+	ShadowReportedUpdate_t *pUpdate = (ShadowReportedUpdate_t *) pContextData;
+	fpActionCallback_t callback = pUpdate->callback;
+	void *pCallerContextData = pUpdate->pContextData;
+
+	/* Released before the callback, which may send the fields that are still changed again */
+	endReportedUpdate(pUpdate, SHADOW_ACK_ACCEPTED == status);
+	if(NULL != callback) {
+		callback(pThingName, action, status, pReceivedJsonDocument, pCallerContextData);
+	}
+}
+
+/* States of a ShadowCoalescedCaller_t that is not part of a sent update */
+#define COALESCED_CALLER_FREE 0xFF
+#define COALESCED_CALLER_PENDING 0xFE
+
+void initCoalescedUpdates(AWS_IoT_Shadow_Context *pShadow) {
+	uint32_t i;
+
+	pShadow->coalescedFieldsCount = 0;
+	pShadow->coalescedTimeoutSec = 0;
+	pShadow->coalescedPersistentSubscribe = false;
+	for(i = 0; i < MAX_SHADOW_COALESCED_CALLBACKS; i++) {
+		pShadow->coalescedCallers[i].batch = COALESCED_CALLER_FREE;
+	}
+	for(i = 0; i < SHADOW_COALESCED_BATCH_COUNT; i++) {
+		pShadow->coalescedBatches[i].pShadow = pShadow;
+		pShadow->coalescedBatches[i].isFree = true;
+	}
+}
+
+static int32_t findCoalescedField(const jsonStruct_t *pFields, uint32_t fieldCount, const char *pKey) {
+	uint32_t i;
+
+	for(i = 0; i < fieldCount; i++) {
+		if(0 == strcmp(pFields[i].pKey, pKey)) {
+			return (int32_t) i;
+		}
+	}
+
+	return -1;
+}
+
+static int32_t findCoalescedCaller(AWS_IoT_Shadow_Context *pShadow, uint8_t batch) {
+	uint32_t i;
+
+	for(i = 0; i < MAX_SHADOW_COALESCED_CALLBACKS; i++) {
+		if(batch == pShadow->coalescedCallers[i].batch) {
+			return (int32_t) i;
+		}
+	}
+
+	return -1;
+}
+
+IoT_Error_t addCoalescedFields(AWS_IoT_Shadow_Context *pShadow, const jsonStruct_t *pFields, uint32_t fieldCount,
+							   fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds,
+							   bool isPersistentSubscribe) {
+	uint32_t i;
+	uint32_t newFieldCount = 0;
+	int32_t index;
+	int32_t callerIndex = -1;
+
+	/* Nothing is merged unless all the fields and the callback fit */
+	for(i = 0; i < fieldCount; i++) {
+		if(findCoalescedField(pShadow->coalescedFields, pShadow->coalescedFieldsCount, pFields[i].pKey) < 0
+		   && findCoalescedField(pFields, i, pFields[i].pKey) < 0) {
+			newFieldCount++;
+		}
+	}
+	if(pShadow->coalescedFieldsCount + newFieldCount > MAX_SHADOW_COALESCED_FIELDS) {
+		return FAILURE;
+	}
+	if(NULL != callback) {
+		callerIndex = findCoalescedCaller(pShadow, COALESCED_CALLER_FREE);
+		if(callerIndex < 0) {
+			return FAILURE;
+		}
+	}
+
+	if(0 == pShadow->coalescedFieldsCount) {
+		countdown_ms(&(pShadow->coalesceTimer), SHADOW_COALESCE_WINDOW_MS);
+	}
+
+	for(i = 0; i < fieldCount; i++) {
+		index = findCoalescedField(pShadow->coalescedFields, pShadow->coalescedFieldsCount, pFields[i].pKey);
+		if(index < 0) {
+			index = (int32_t) pShadow->coalescedFieldsCount++;
+		}
+		pShadow->coalescedFields[index] = pFields[i];
+	}
+
+	if(callerIndex >= 0) {
+		pShadow->coalescedCallers[callerIndex].callback = callback;
+		pShadow->coalescedCallers[callerIndex].pContextData = pContextData;
+		pShadow->coalescedCallers[callerIndex].batch = COALESCED_CALLER_PENDING;
+	}
+	if(timeout_seconds > pShadow->coalescedTimeoutSec) {
+		pShadow->coalescedTimeoutSec = timeout_seconds;
+	}
+	pShadow->coalescedPersistentSubscribe = pShadow->coalescedPersistentSubscribe || isPersistentSubscribe;
+
+	return SUCCESS;
+}
+
+IoT_Error_t startCoalescedBatch(AWS_IoT_Shadow_Context *pShadow, ShadowCoalescedBatch_t **ppBatch) {
+	uint8_t batch;
+	int32_t callerIndex;
+
+	*ppBatch = NULL;
+	if(findCoalescedCaller(pShadow, COALESCED_CALLER_PENDING) >= 0) {
+		for(batch = 0; batch < SHADOW_COALESCED_BATCH_COUNT && !pShadow->coalescedBatches[batch].isFree; batch++);
+		if(SHADOW_COALESCED_BATCH_COUNT == batch) {
+			return FAILURE;
+		}
+
+		while((callerIndex = findCoalescedCaller(pShadow, COALESCED_CALLER_PENDING)) >= 0) {
+			pShadow->coalescedCallers[callerIndex].batch = batch;
+		}
+		pShadow->coalescedBatches[batch].isFree = false;
+		*ppBatch = &(pShadow->coalescedBatches[batch]);
+	}
+
+	pShadow->coalescedFieldsCount = 0;
+	pShadow->coalescedTimeoutSec = 0;
+	pShadow->coalescedPersistentSubscribe = false;
+
+	return SUCCESS;
+}
+
+void coalescedUpdateCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							 const char *pReceivedJsonDocument, void *pContextData) {
+	ShadowCoalescedBatch_t *pBatch = (ShadowCoalescedBatch_t *) pContextData;
+	AWS_IoT_Shadow_Context *pShadow = pBatch->pShadow;
+	uint8_t batch = (uint8_t) (pBatch - pShadow->coalescedBatches);
+	ShadowCoalescedCaller_t caller;
+	int32_t callerIndex;
+
+	/* The batch is released last so that a callback coalescing new fields can not reuse it while this runs */
+	while((callerIndex = findCoalescedCaller(pShadow, batch)) >= 0) {
+		caller = pShadow->coalescedCallers[callerIndex];
+		pShadow->coalescedCallers[callerIndex].batch = COALESCED_CALLER_FREE;
+		caller.callback(pThingName, action, status, pReceivedJsonDocument, caller.pContextData);
+	}
+	pBatch->isFree = true;
+}
+
+static int16_t getNextFreeIndexOfSubscriptionList(AWS_IoT_Shadow_Context *pShadow) {
 	uint8_t i;
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
-		if(SubscriptionList[i].isFree) {
-			SubscriptionList[i].isFree = false;
+		if(pShadow->SubscriptionList[i].isFree) {
+			pShadow->SubscriptionList[i].isFree = false;
 			return i;
 		}
 	}
 	return -1;
 }
 
+static const char *actionName(ShadowActions_t action) {
+	if(SHADOW_GET == action) {
+		return "get";
+	} else if(SHADOW_UPDATE == action) {
+		return "update";
+	}
+	return "delete";
+}
+
 static void topicNameFromThingAndAction(char *pTopic, const char *pThingName, ShadowActions_t action,
 										ShadowAckTopicTypes_t ackType) {
 
-	char actionBuf[10];
+	const char *actionBuf = actionName(action);
 	char ackTypeBuf[10];
 
-	if(SHADOW_GET == action) {
-		strncpy(actionBuf, "get", 10);
-	} else if(SHADOW_UPDATE == action) {
-		strncpy(actionBuf, "update", 10);
-	} else if(SHADOW_DELETE == action) {
-		strncpy(actionBuf, "delete", 10);
-	}
-
 	if(SHADOW_ACCEPTED == ackType) {
 		strncpy(ackTypeBuf, "accepted", 10);
 	} else if(SHADOW_REJECTED == ackType) {
@@ -168,78 +539,195 @@ static void topicNameFromThingAndAction(char *pTopic, const char *pThingName, Sh
 	}
 }
 
-static bool isValidShadowVersionUpdate(const char *pTopicName) {
-	if(strstr(pTopicName, myThingName) != NULL &&
-	   ((strstr(pTopicName, "get/accepted") != NULL) ||
-		(strstr(pTopicName, "delta") != NULL))) {
+/**
+ * Checks that an ack topic "$aws/things/<thing>/shadow/<action>/<accepted|rejected>" belongs to pThingName
+ * and reads its action. The subscription that delivered it already fixed the layout and the ack type, so only
+ * the thing name, and the action segment for the wildcard subscriptions, are compared at their known offsets.
+ */
+static bool ackTopicAction(const ShadowAckRoute_t *pRoute, const char *pTopicName, uint16_t topicNameLen,
+						   const char *pThingName, ShadowActions_t *pAction) {
+	size_t thingNameLen = strlen(pThingName);
+	size_t offset = SHADOW_TOPIC_THING_OFFSET + thingNameLen;
+	const char *pActionName;
+	size_t actionNameLen;
+	uint8_t i;
+
+	if(topicNameLen <= offset || pTopicName[offset] != '/'
+	   || strncmp(pTopicName + SHADOW_TOPIC_THING_OFFSET, pThingName, thingNameLen) != 0) {
+		return false;
+	}
+
+	if(!pRoute->isAnyAction) {
+		*pAction = pRoute->action;
 		return true;
 	}
+
+	offset += SHADOW_TOPIC_ACTION_OFFSET;
+	for(i = SHADOW_GET; i <= SHADOW_DELETE; i++) {
+		pActionName = actionName((ShadowActions_t) i);
+		actionNameLen = strlen(pActionName);
+		if(topicNameLen > offset + actionNameLen && pTopicName[offset + actionNameLen] == '/'
+		   && strncmp(pTopicName + offset, pActionName, actionNameLen) == 0) {
+			*pAction = (ShadowActions_t) i;
+			return true;
+		}
+	}
+
 	return false;
 }
 
+/**
+ * The tokens generated by this client are "<client id>-<sequence number>", the sequence number is unique among
+ * the pending requests and is used as the key as is. Tokens supplied by the application fall back to a hash.
+ */
+static uint32_t ackKeyFromClientToken(AWS_IoT_Shadow_Context *pShadow, const char *pClientToken) {
+	size_t clientIdLen = strlen(pShadow->mqttClientID);
+	const char *pSequence = pClientToken + clientIdLen + 1;
+	uint32_t key = 0;
+	const char *p;
+
+	if(strncmp(pClientToken, pShadow->mqttClientID, clientIdLen) == 0 && pClientToken[clientIdLen] == '-'
+	   && *pSequence != '\0') {
+		for(p = pSequence; *p >= '0' && *p <= '9'; p++) {
+			key = key * 10 + (uint32_t) (*p - '0');
+		}
+		if(*p == '\0') {
+			return key;
+		}
+	}
+
+	/* FNV-1a */
+	key = 2166136261u;
+	for(p = pClientToken; *p != '\0'; p++) {
+		key ^= (uint8_t) *p;
+		key *= 16777619u;
+	}
+	return key;
+}
+
+/**
+ * Open addressing with linear probing. A freed record is filled with the records probed past it (backward
+ * shift deletion), so every record in use follows its home slot with no free record in between and a lookup
+ * stops at the first free record.
+ */
+static int16_t findIndexOfAckWaitList(AWS_IoT_Shadow_Context *pShadow, const char *pClientToken) {
+	uint32_t key = ackKeyFromClientToken(pShadow, pClientToken);
+	uint8_t home = (uint8_t) (key % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+	uint8_t probe, index;
+	ToBeReceivedAckRecord_t *pAck;
+
+	for(probe = 0; probe < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; probe++) {
+		index = (uint8_t) ((home + probe) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+		pAck = &pShadow->AckWaitList[index];
+		if(pAck->isFree) {
+			break;
+		}
+		if(pAck->key == key && strcmp(pAck->clientTokenID, pClientToken) == 0) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+static void freeAckWaitListEntry(AWS_IoT_Shadow_Context *pShadow, uint8_t index) {
+	uint8_t hole = index;
+	uint8_t next = (uint8_t) ((index + 1) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+	uint8_t home;
+
+	pShadow->AckWaitList[hole].isFree = true;
+	if(pShadow->ackWaitListCount > 0) {
+		pShadow->ackWaitListCount--;
+	}
+
+	/* A following record moves into the hole unless its home slot lies between the hole and itself */
+	while(!pShadow->AckWaitList[next].isFree) {
+		home = (uint8_t) (pShadow->AckWaitList[next].key % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+		if((next + MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME - home) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME
+		   >= (next + MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME - hole) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME) {
+			pShadow->AckWaitList[hole] = pShadow->AckWaitList[next];
+			pShadow->AckWaitList[next].isFree = true;
+			hole = next;
+		}
+		next = (uint8_t) ((next + 1) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+	}
+}
+
+/* Freed first, the unsubscribe may dispatch other publishes while it waits for the UNSUBACK */
+static void releaseAckWaitListEntry(AWS_IoT_Shadow_Context *pShadow, uint8_t index) {
+	char thingName[MAX_SIZE_OF_THING_NAME];
+	ShadowActions_t action = pShadow->AckWaitList[index].action;
+
+	/* Copied, a following record may be shifted into the slot */
+	memcpy(thingName, pShadow->AckWaitList[index].thingName, MAX_SIZE_OF_THING_NAME);
+	freeAckWaitListEntry(pShadow, index);
+	unsubscribeFromAcceptedAndRejected(pShadow, thingName, action);
+}
+
 static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
 							  IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
-	uint8_t i;
-	void *pJsonHandler = NULL;
+	int16_t index;
+	ShadowAckRoute_t *pRoute = (ShadowAckRoute_t *) pData;
+	AWS_IoT_Shadow_Context *pShadow = pRoute->pShadow;
+	void *pJsonHandler = &pShadow->jsonHandler;
+	ToBeReceivedAckRecord_t *pAck;
+	ShadowActions_t action;
 	char temporaryClientToken[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	/* Parsed in place in the MQTT RX buffer, which also null terminates it for the action callbacks */
+	const char *pJsonDocument = (const char *) params->payload;
 
 	IOT_UNUSED(pClient);
-	IOT_UNUSED(topicNameLen);
-	IOT_UNUSED(pData);
 
 	if(params->payloadLen >= SHADOW_MAX_SIZE_OF_RX_BUFFER) {
 		IOT_WARN("Payload larger than RX Buffer");
 		return;
 	}
 
-	memcpy(shadowRxBuf, params->payload, params->payloadLen);
-	shadowRxBuf[params->payloadLen] = '\0';    // jsmn_parse relies on a string
-
-	if(!isJsonValidAndParse(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, pJsonHandler, &tokenCount)) {
+	if(!isJsonValidAndParse(pJsonDocument, params->payloadLen, pJsonHandler, &tokenCount)) {
 		IOT_WARN("Received JSON is not valid");
 		return;
 	}
 
-	if(isValidShadowVersionUpdate(topicName)) {
+	if(SHADOW_ACK_ACCEPTED == pRoute->status
+	   && ackTopicAction(pRoute, topicName, topicNameLen, pShadow->myThingName, &action) && SHADOW_GET == action) {
 		uint32_t tempVersionNumber = 0;
-		if(extractVersionNumber(shadowRxBuf, pJsonHandler, tokenCount, &tempVersionNumber)) {
-			if(tempVersionNumber > shadowJsonVersionNum) {
-				shadowJsonVersionNum = tempVersionNumber;
+		if(extractVersionNumber(pJsonDocument, pJsonHandler, tokenCount, &tempVersionNumber)) {
+			if(tempVersionNumber > pShadow->shadowJsonVersionNum) {
+				pShadow->shadowJsonVersionNum = tempVersionNumber;
 			}
+			cacheShadowDocument(pShadow, pJsonDocument, params->payloadLen, tempVersionNumber);
 		}
 	}
 
-	if(extractClientToken(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, temporaryClientToken, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE)) {
-		for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-			if(!AckWaitList[i].isFree) {
-				if(strcmp(AckWaitList[i].clientTokenID, temporaryClientToken) == 0) {
-					Shadow_Ack_Status_t status = SHADOW_ACK_REJECTED;
-					if(strstr(topicName, "accepted") != NULL) {
-						status = SHADOW_ACK_ACCEPTED;
-					} else if(strstr(topicName, "rejected") != NULL) {
-						status = SHADOW_ACK_REJECTED;
-					}
-					if(status == SHADOW_ACK_ACCEPTED || status == SHADOW_ACK_REJECTED) {
-						if(AckWaitList[i].callback != NULL) {
-							AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
-													shadowRxBuf, AckWaitList[i].pCallbackContext);
-						}
-						unsubscribeFromAcceptedAndRejected(i);
-						AckWaitList[i].isFree = true;
-						return;
-					}
-				}
-			}
-		}
+	/* The tokens of the parse above are reused, the document is not parsed again */
+	if(!extractParsedClientToken(pJsonDocument, pJsonHandler, tokenCount, temporaryClientToken,
+								 MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE)) {
+		return;
 	}
+
+	index = findIndexOfAckWaitList(pShadow, temporaryClientToken);
+	if(index < 0) {
+		return;
+	}
+
+	/* The wildcard subscriptions deliver the acks of every action, only those of the action that was
+	 * requested complete the record */
+	pAck = &pShadow->AckWaitList[index];
+	if(!ackTopicAction(pRoute, topicName, topicNameLen, pAck->thingName, &action) || action != pAck->action) {
+		return;
+	}
+
+	if(pAck->callback != NULL) {
+		pAck->callback(pAck->thingName, pAck->action, pRoute->status, pJsonDocument, pAck->pCallbackContext);
+	}
+	releaseAckWaitListEntry(pShadow, (uint8_t) index);
 }
 
-static int16_t findIndexOfSubscriptionList(const char *pTopic) {
+static int16_t findIndexOfSubscriptionList(AWS_IoT_Shadow_Context *pShadow, const char *pTopic) {
 	uint8_t i;
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
-		if(!SubscriptionList[i].isFree) {
-			if((strcmp(pTopic, SubscriptionList[i].Topic) == 0)) {
+		if(!pShadow->SubscriptionList[i].isFree) {
+			if((strcmp(pTopic, pShadow->SubscriptionList[i].Topic) == 0)) {
 				return i;
 			}
 		}
@@ -247,61 +735,91 @@ static int16_t findIndexOfSubscriptionList(const char *pTopic) {
 	return -1;
 }
 
-static void unsubscribeFromAcceptedAndRejected(uint8_t index) {
+static void unsubscribeFromAcceptedAndRejected(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+											   ShadowActions_t action) {
 
 	char TemporaryTopicNameAccepted[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	char TemporaryTopicNameRejected[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	IoT_Error_t ret_val = SUCCESS;
 
 	int16_t indexSubList;
+	SubscriptionRecord_t *pSubscription;
 
-	topicNameFromThingAndAction(TemporaryTopicNameAccepted, AckWaitList[index].thingName, AckWaitList[index].action,
-								SHADOW_ACCEPTED);
-	topicNameFromThingAndAction(TemporaryTopicNameRejected, AckWaitList[index].thingName, AckWaitList[index].action,
-								SHADOW_REJECTED);
+	topicNameFromThingAndAction(TemporaryTopicNameAccepted, pThingName, action, SHADOW_ACCEPTED);
+	topicNameFromThingAndAction(TemporaryTopicNameRejected, pThingName, action, SHADOW_REJECTED);
 
-	indexSubList = findIndexOfSubscriptionList(TemporaryTopicNameAccepted);
+	indexSubList = findIndexOfSubscriptionList(pShadow, TemporaryTopicNameAccepted);
 	if((indexSubList >= 0)) {
-		if(!SubscriptionList[indexSubList].isSticky && (SubscriptionList[indexSubList].count == 1)) {
-			ret_val = aws_iot_mqtt_unsubscribe(pMqttClient, TemporaryTopicNameAccepted,
+		pSubscription = &pShadow->SubscriptionList[indexSubList];
+		if(!pSubscription->isSticky && (pSubscription->count == 1)) {
+			ret_val = aws_iot_mqtt_unsubscribe(pShadow->pMqttClient, TemporaryTopicNameAccepted,
 											   (uint16_t) strlen(TemporaryTopicNameAccepted));
 			if(ret_val == SUCCESS) {
-				SubscriptionList[indexSubList].isFree = true;
+				pSubscription->isFree = true;
 			}
-		} else if(SubscriptionList[indexSubList].count > 1) {
-			SubscriptionList[indexSubList].count--;
+		} else if(pSubscription->count > 1) {
+			pSubscription->count--;
 		}
 	}
 
-	indexSubList = findIndexOfSubscriptionList(TemporaryTopicNameRejected);
+	indexSubList = findIndexOfSubscriptionList(pShadow, TemporaryTopicNameRejected);
 	if((indexSubList >= 0)) {
-		if(!SubscriptionList[indexSubList].isSticky && (SubscriptionList[indexSubList].count == 1)) {
-			ret_val = aws_iot_mqtt_unsubscribe(pMqttClient, TemporaryTopicNameRejected,
+		pSubscription = &pShadow->SubscriptionList[indexSubList];
+		if(!pSubscription->isSticky && (pSubscription->count == 1)) {
+			ret_val = aws_iot_mqtt_unsubscribe(pShadow->pMqttClient, TemporaryTopicNameRejected,
 											   (uint16_t) strlen(TemporaryTopicNameRejected));
 			if(ret_val == SUCCESS) {
-				SubscriptionList[indexSubList].isFree = true;
+				pSubscription->isFree = true;
 			}
-		} else if(SubscriptionList[indexSubList].count > 1) {
-			SubscriptionList[indexSubList].count--;
+		} else if(pSubscription->count > 1) {
+			pSubscription->count--;
 		}
 	}
 }
 
-void initializeRecords(AWS_IoT_Client *pClient) {
+static void resetSubscriptionRecords(AWS_IoT_Shadow_Context *pShadow) {
 	uint8_t i;
+	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
+		pShadow->SubscriptionList[i].isFree = true;
+		pShadow->SubscriptionList[i].count = 0;
+		pShadow->SubscriptionList[i].isSticky = false;
+	}
+	pShadow->allActionAcksSubscribedFlag = false;
+}
+
+void initializeRecords(AWS_IoT_Shadow_Context *pShadow) {
+	uint8_t i;
+	ShadowAckRoute_t *pRoute;
 	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		AckWaitList[i].isFree = true;
+		pShadow->AckWaitList[i].isFree = true;
 	}
-	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
-		SubscriptionList[i].isFree = true;
-		SubscriptionList[i].count = 0;
-		SubscriptionList[i].isSticky = false;
+	pShadow->ackWaitListCount = 0;
+	for(i = 0; i < SHADOW_ACK_ROUTE_COUNT; i++) {
+		pRoute = &pShadow->ackRoutes[i];
+		pRoute->pShadow = pShadow;
+		pRoute->isAnyAction = (i >= ACK_ROUTE_ANY_ACTION_INDEX(SHADOW_ACCEPTED));
+		pRoute->action = pRoute->isAnyAction ? SHADOW_GET : (ShadowActions_t) (i / 2);
+		pRoute->status = (i % 2 == SHADOW_ACCEPTED) ? SHADOW_ACK_ACCEPTED : SHADOW_ACK_REJECTED;
 	}
+	resetSubscriptionRecords(pShadow);
+}
 
-	pMqttClient = pClient;
+/**
+ * The clean session dropped the subscriptions, so no response is expected for the actions still waiting.
+ * Their records are kept and expired, the next yield times them out through their callbacks, which
+ * releases the reported and coalesced updates they belong to.
+ */
+void restartRecords(AWS_IoT_Shadow_Context *pShadow) {
+	uint8_t i;
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		if(!pShadow->AckWaitList[i].isFree) {
+			countdown_ms(&(pShadow->AckWaitList[i].timer), 0);
+		}
+	}
+	resetSubscriptionRecords(pShadow);
 }
 
-bool isSubscriptionPresent(const char *pThingName, ShadowActions_t action) {
+bool isSubscriptionPresent(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action) {
 
 	uint8_t i = 0;
 	bool isAcceptedPresent = false;
@@ -313,10 +831,10 @@ bool isSubscriptionPresent(const char *pThingName, ShadowActions_t action) {
 	topicNameFromThingAndAction(TemporaryTopicNameRejected, pThingName, action, SHADOW_REJECTED);
 
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
-		if(!SubscriptionList[i].isFree) {
-			if((strcmp(TemporaryTopicNameAccepted, SubscriptionList[i].Topic) == 0)) {
+		if(!pShadow->SubscriptionList[i].isFree) {
+			if((strcmp(TemporaryTopicNameAccepted, pShadow->SubscriptionList[i].Topic) == 0)) {
 				isAcceptedPresent = true;
-			} else if((strcmp(TemporaryTopicNameRejected, SubscriptionList[i].Topic) == 0)) {
+			} else if((strcmp(TemporaryTopicNameRejected, pShadow->SubscriptionList[i].Topic) == 0)) {
 				isRejectedPresent = true;
 			}
 		}
@@ -329,32 +847,36 @@ bool isSubscriptionPresent(const char *pThingName, ShadowActions_t action) {
 	return false;
 }
 
-IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t action, bool isSticky) {
+IoT_Error_t subscribeToShadowActionAcks(AWS_IoT_Shadow_Context *pShadow, const char *pThingName,
+										ShadowActions_t action, bool isSticky) {
 	IoT_Error_t ret_val = SUCCESS;
 
 	bool clearBothEntriesFromList = true;
 	int16_t indexAcceptedSubList = 0;
 	int16_t indexRejectedSubList = 0;
+	SubscriptionRecord_t *pAccepted;
+	SubscriptionRecord_t *pRejected;
 	Timer subSettlingtimer;
-	indexAcceptedSubList = getNextFreeIndexOfSubscriptionList();
-	indexRejectedSubList = getNextFreeIndexOfSubscriptionList();
+	indexAcceptedSubList = getNextFreeIndexOfSubscriptionList(pShadow);
+	indexRejectedSubList = getNextFreeIndexOfSubscriptionList(pShadow);
 
 	if(indexAcceptedSubList >= 0 && indexRejectedSubList >= 0) {
-		topicNameFromThingAndAction(SubscriptionList[indexAcceptedSubList].Topic, pThingName, action, SHADOW_ACCEPTED);
-		ret_val = aws_iot_mqtt_subscribe(pMqttClient, SubscriptionList[indexAcceptedSubList].Topic,
-										 (uint16_t) strlen(SubscriptionList[indexAcceptedSubList].Topic), QOS0,
-										 AckStatusCallback, NULL);
+		pAccepted = &pShadow->SubscriptionList[indexAcceptedSubList];
+		pRejected = &pShadow->SubscriptionList[indexRejectedSubList];
+		topicNameFromThingAndAction(pAccepted->Topic, pThingName, action, SHADOW_ACCEPTED);
+		ret_val = aws_iot_mqtt_subscribe(pShadow->pMqttClient, pAccepted->Topic, (uint16_t) strlen(pAccepted->Topic),
+										 QOS0, AckStatusCallback,
+										 (void *) &pShadow->ackRoutes[ACK_ROUTE_INDEX(action, SHADOW_ACCEPTED)]);
 		if(ret_val == SUCCESS) {
-			SubscriptionList[indexAcceptedSubList].count = 1;
-			SubscriptionList[indexAcceptedSubList].isSticky = isSticky;
-			topicNameFromThingAndAction(SubscriptionList[indexRejectedSubList].Topic, pThingName, action,
-										SHADOW_REJECTED);
-			ret_val = aws_iot_mqtt_subscribe(pMqttClient, SubscriptionList[indexRejectedSubList].Topic,
-											 (uint16_t) strlen(SubscriptionList[indexRejectedSubList].Topic), QOS0,
-											 AckStatusCallback, NULL);
+			pAccepted->count = 1;
+			pAccepted->isSticky = isSticky;
+			topicNameFromThingAndAction(pRejected->Topic, pThingName, action, SHADOW_REJECTED);
+			ret_val = aws_iot_mqtt_subscribe(pShadow->pMqttClient, pRejected->Topic,
+											 (uint16_t) strlen(pRejected->Topic), QOS0, AckStatusCallback,
+											 (void *) &pShadow->ackRoutes[ACK_ROUTE_INDEX(action, SHADOW_REJECTED)]);
 			if(ret_val == SUCCESS) {
-				SubscriptionList[indexRejectedSubList].count = 1;
-				SubscriptionList[indexRejectedSubList].isSticky = isSticky;
+				pRejected->count = 1;
+				pRejected->isSticky = isSticky;
 				clearBothEntriesFromList = false;
 
 				// wait for SUBSCRIBE_SETTLING_TIME seconds to let the subscription take effect
@@ -368,15 +890,15 @@ IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t
 
 	if(clearBothEntriesFromList) {
 		if(indexAcceptedSubList >= 0) {
-			SubscriptionList[indexAcceptedSubList].isFree = true;
+			pShadow->SubscriptionList[indexAcceptedSubList].isFree = true;
 			
-			if(SubscriptionList[indexAcceptedSubList].count == 1) {
-			    aws_iot_mqtt_unsubscribe(pMqttClient, SubscriptionList[indexAcceptedSubList].Topic,
-				(uint16_t) strlen(SubscriptionList[indexAcceptedSubList].Topic));
+			if(pShadow->SubscriptionList[indexAcceptedSubList].count == 1) {
+			    aws_iot_mqtt_unsubscribe(pShadow->pMqttClient, pShadow->SubscriptionList[indexAcceptedSubList].Topic,
+				(uint16_t) strlen(pShadow->SubscriptionList[indexAcceptedSubList].Topic));
 		    }
 		}
 		if(indexRejectedSubList >= 0) {
-			SubscriptionList[indexRejectedSubList].isFree = true;
+			pShadow->SubscriptionList[indexRejectedSubList].isFree = true;
 		}
 
 	}
@@ -384,7 +906,46 @@ IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t
 	return ret_val;
 }
 
-void incrementSubscriptionCnt(const char *pThingName, ShadowActions_t action, bool isSticky) {
+IoT_Error_t subscribeToAllShadowActionAcks(AWS_IoT_Shadow_Context *pShadow) {
+	IoT_Subscribe_Topic_Params topics[2];
+	IoT_Error_t ret_val;
+
+	snprintf(pShadow->allAcceptedTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/+/accepted",
+			 pShadow->myThingName);
+	snprintf(pShadow->allRejectedTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/+/rejected",
+			 pShadow->myThingName);
+
+	topics[0].pTopicName = pShadow->allAcceptedTopic;
+	topics[0].topicNameLen = (uint16_t) strlen(pShadow->allAcceptedTopic);
+	topics[0].qos = QOS0;
+	topics[0].pApplicationHandler = AckStatusCallback;
+	topics[0].pApplicationHandlerData = (void *) &pShadow->ackRoutes[ACK_ROUTE_ANY_ACTION_INDEX(SHADOW_ACCEPTED)];
+	topics[1] = topics[0];
+	topics[1].pTopicName = pShadow->allRejectedTopic;
+	topics[1].topicNameLen = (uint16_t) strlen(pShadow->allRejectedTopic);
+	topics[1].pApplicationHandlerData = (void *) &pShadow->ackRoutes[ACK_ROUTE_ANY_ACTION_INDEX(SHADOW_REJECTED)];
+
+	/* Both filters go in one SUBSCRIBE, no settling time is needed as nothing is published before the SUBACK */
+	ret_val = aws_iot_mqtt_subscribe_batch(pShadow->pMqttClient, topics, 2);
+	if(SUCCESS == ret_val) {
+		pShadow->allActionAcksSubscribedFlag = true;
+	} else if(MQTT_SUBSCRIBE_REJECTED_ERROR == ret_val) {
+		/* Do not keep half of the pair, the actions fall back to their own subscriptions */
+		IOT_WARN("Wildcard shadow ack subscriptions refused, subscribing per action");
+		aws_iot_mqtt_unsubscribe(pShadow->pMqttClient, pShadow->allAcceptedTopic, topics[0].topicNameLen);
+		aws_iot_mqtt_unsubscribe(pShadow->pMqttClient, pShadow->allRejectedTopic, topics[1].topicNameLen);
+		ret_val = SUCCESS;
+	}
+
+	return ret_val;
+}
+
+bool isAllShadowActionAcksSubscribed(AWS_IoT_Shadow_Context *pShadow, const char *pThingName) {
+	return (pShadow->allActionAcksSubscribedFlag && strcmp(pThingName, pShadow->myThingName) == 0);
+}
+
+void incrementSubscriptionCnt(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
+							  bool isSticky) {
 	char TemporaryTopicNameAccepted[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	char TemporaryTopicNameRejected[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	uint8_t i;
@@ -392,17 +953,18 @@ void incrementSubscriptionCnt(const char *pThingName, ShadowActions_t action, bo
 	topicNameFromThingAndAction(TemporaryTopicNameRejected, pThingName, action, SHADOW_REJECTED);
 
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
-		if(!SubscriptionList[i].isFree) {
-			if((strcmp(TemporaryTopicNameAccepted, SubscriptionList[i].Topic) == 0)
-			   || (strcmp(TemporaryTopicNameRejected, SubscriptionList[i].Topic) == 0)) {
-				SubscriptionList[i].count++;
-				SubscriptionList[i].isSticky = isSticky;
+		if(!pShadow->SubscriptionList[i].isFree) {
+			if((strcmp(TemporaryTopicNameAccepted, pShadow->SubscriptionList[i].Topic) == 0)
+			   || (strcmp(TemporaryTopicNameRejected, pShadow->SubscriptionList[i].Topic) == 0)) {
+				pShadow->SubscriptionList[i].count++;
+				pShadow->SubscriptionList[i].isSticky = isSticky;
 			}
 		}
 	}
 }
 
-IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action, const char *pJsonDocumentToBeSent) {
+IoT_Error_t publishToShadowAction(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
+								  const char *pJsonDocumentToBeSent) {
 	IoT_Error_t ret_val = SUCCESS;
 	char TemporaryTopicName[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	IoT_Publish_Message_Params msgParams;
@@ -417,55 +979,113 @@ IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action
 	msgParams.isRetained = 0;
 	msgParams.payloadLen = strlen(pJsonDocumentToBeSent);
 	msgParams.payload = (char *) pJsonDocumentToBeSent;
-	ret_val = aws_iot_mqtt_publish(pMqttClient, TemporaryTopicName, (uint16_t) strlen(TemporaryTopicName), &msgParams);
+	ret_val = aws_iot_mqtt_publish(pShadow->pMqttClient, TemporaryTopicName, (uint16_t) strlen(TemporaryTopicName),
+								   &msgParams);
 
 	return ret_val;
 }
 
-bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex) {
-	uint8_t i;
-	bool rc = false;
-
-	if(NULL == pIndex) {
-		return false;
-	}
+bool isAckWaitListFull(AWS_IoT_Shadow_Context *pShadow) {
+	return pShadow->ackWaitListCount >= MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME;
+}
 
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(AckWaitList[i].isFree) {
-			*pIndex = i;
-			rc = true;
+bool addToAckWaitList(AWS_IoT_Shadow_Context *pShadow, const char *pThingName, ShadowActions_t action,
+					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
+					  uint32_t timeout_seconds) {
+	uint32_t key = ackKeyFromClientToken(pShadow, pExtractedClientToken);
+	uint8_t home = (uint8_t) (key % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+	uint8_t probe, index;
+	ToBeReceivedAckRecord_t *pAck;
+
+	/* The first free record, records freed while the request was sent may have moved the others */
+	for(probe = 0; probe < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; probe++) {
+		index = (uint8_t) ((home + probe) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME);
+		if(pShadow->AckWaitList[index].isFree) {
 			break;
 		}
 	}
+	if(MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME == probe) {
+		return false;
+	}
 
-	return rc;
+	pAck = &pShadow->AckWaitList[index];
+	pAck->callback = callback;
+	memcpy(pAck->clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
+	pAck->key = key;
+	memcpy(pAck->thingName, pThingName, MAX_SIZE_OF_THING_NAME);
+	pAck->pCallbackContext = pCallbackContext;
+	pAck->action = action;
+	init_timer(&(pAck->timer));
+	countdown_sec(&(pAck->timer), timeout_seconds);
+	pAck->isFree = false;
+	pShadow->ackWaitListCount++;
+
+	return true;
 }
 
-void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
-					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
-					  uint32_t timeout_seconds) {
-	AckWaitList[indexAckWaitList].callback = callback;
-	memcpy(AckWaitList[indexAckWaitList].clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
-	memcpy(AckWaitList[indexAckWaitList].thingName, pThingName, MAX_SIZE_OF_THING_NAME);
-	AckWaitList[indexAckWaitList].pCallbackContext = pCallbackContext;
-	AckWaitList[indexAckWaitList].action = action;
-	init_timer(&(AckWaitList[indexAckWaitList].timer));
-	countdown_sec(&(AckWaitList[indexAckWaitList].timer), timeout_seconds);
-	AckWaitList[indexAckWaitList].isFree = false;
+void HandleExpiredResponseCallbacks(AWS_IoT_Shadow_Context *pShadow) {
+	uint8_t i = 0;
+	ToBeReceivedAckRecord_t *pAck;
+	while(i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME) {
+		pAck = &pShadow->AckWaitList[i];
+		if(!pAck->isFree && has_timer_expired(&(pAck->timer))) {
+			if(pAck->callback != NULL) {
+				pAck->callback(pAck->thingName, pAck->action, SHADOW_ACK_TIMEOUT, NULL, pAck->pCallbackContext);
+			}
+			releaseAckWaitListEntry(pShadow, i);
+			/* A following record may have been shifted into this slot */
+			continue;
+		}
+		i++;
+	}
 }
 
-void HandleExpiredResponseCallbacks(void) {
-	uint8_t i;
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(!AckWaitList[i].isFree) {
-			if(has_timer_expired(&(AckWaitList[i].timer))) {
-				if(AckWaitList[i].callback != NULL) {
-					AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, SHADOW_ACK_TIMEOUT,
-											shadowRxBuf, AckWaitList[i].pCallbackContext);
-				}
-				AckWaitList[i].isFree = true;
-				unsubscribeFromAcceptedAndRejected(i);
+void dispatchShadowDelta(AWS_IoT_Shadow_Context *pShadow, const char *pJsonDocument, int32_t tokenCount) {
+	uint32_t i = 0;
+	void *pJsonHandler = &pShadow->jsonHandler;
+	JsonTokenTable_t *pEntry;
+	jsmntok_t *pKeyToken;
+	const char *pKey;
+	size_t keyLen;
+	int32_t keyIndex;
+	uint16_t entryIndex;
+	uint16_t pathLen;
+	int32_t DataPosition;
+	uint32_t dataLength;
+
+	/* One walk over the keys of the delta, each looked up in the sorted registrations. Like the per key scans it
+	 * replaces, only the first occurrence of a key is dispatched. deltaKeyPath holds the keys whose values
+	 * enclose the current key, to resolve the registered paths. */
+	memset(pShadow->deltaKeyDispatched, 0, sizeof(pShadow->deltaKeyDispatched));
+	pathLen = 0;
+	for(keyIndex = nextJsonKeyIndex(pJsonDocument, pJsonHandler, tokenCount, 0); keyIndex < tokenCount;
+		keyIndex = nextJsonKeyIndex(pJsonDocument, pJsonHandler, tokenCount, keyIndex)) {
+		pKeyToken = &pShadow->jsonHandler.tokens[keyIndex];
+		while(pathLen > 0
+			  && pKeyToken->start >= pShadow->jsonHandler.tokens[pShadow->deltaKeyPath[pathLen - 1] + 1].end) {
+			pathLen--;
+		}
+		pKey = pJsonDocument + pKeyToken->start;
+		keyLen = (size_t) (pKeyToken->end - pKeyToken->start);
+		for(i = lowerBoundOfDeltaKey(pShadow, pKey, keyLen); i < pShadow->tokenTableIndex; i++) {
+			entryIndex = pShadow->deltaKeyOrder[i];
+			pEntry = &pShadow->tokenTable[entryIndex];
+			if(compareDeltaKey(pKey, keyLen, pEntry) != 0) {
+				break;
+			}
+			if(pEntry->isFree || pShadow->deltaKeyDispatched[entryIndex]
+			   || !isDeltaPathMatching(pShadow, pJsonDocument, pEntry, pathLen)) {
+				continue;
 			}
+			pShadow->deltaKeyDispatched[entryIndex] = true;
+			updateValueOfJsonKey(pJsonDocument, pJsonHandler, keyIndex, (jsonStruct_t *) pEntry->pStruct,
+								 &dataLength, &DataPosition);
+			if(pEntry->callback != NULL) {
+				pEntry->callback(pJsonDocument + DataPosition, dataLength, (jsonStruct_t *) pEntry->pStruct);
+			}
+		}
+		if(pathLen < sizeof(pShadow->deltaKeyPath) / sizeof(pShadow->deltaKeyPath[0])) {
+			pShadow->deltaKeyPath[pathLen++] = (uint16_t) keyIndex;
 		}
 	}
 }
@@ -473,55 +1093,45 @@ void HandleExpiredResponseCallbacks(void) {
 static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 								  uint16_t topicNameLen, IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
-	uint32_t i = 0;
-	void *pJsonHandler = NULL;
-	int32_t DataPosition;
-	uint32_t dataLength;
+	AWS_IoT_Shadow_Context *pShadow = (AWS_IoT_Shadow_Context *) pData;
+	void *pJsonHandler = &pShadow->jsonHandler;
 	uint32_t tempVersionNumber = 0;
+	bool isVersioned;
+	/* Parsed in place in the MQTT RX buffer, the delta callbacks get pointers into it */
+	const char *pJsonDocument = (const char *) params->payload;
 
 	FUNC_ENTRY;
 
 	IOT_UNUSED(pClient);
 	IOT_UNUSED(topicName);
 	IOT_UNUSED(topicNameLen);
-	IOT_UNUSED(pData);
 
 	if(params->payloadLen >= SHADOW_MAX_SIZE_OF_RX_BUFFER) {
 		IOT_WARN("Payload larger than RX Buffer");
 		return;
 	}
 
-	memcpy(shadowRxBuf, params->payload, params->payloadLen);
-	shadowRxBuf[params->payloadLen] = '\0';    // jsmn_parse relies on a string
-
-	if(!isJsonValidAndParse(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, pJsonHandler, &tokenCount)) {
+	if(!isJsonValidAndParse(pJsonDocument, params->payloadLen, pJsonHandler, &tokenCount)) {
 		IOT_WARN("Received JSON is not valid");
 		return;
 	}
 
-	if(shadowDiscardOldDeltaFlag) {
-		if(extractVersionNumber(shadowRxBuf, pJsonHandler, tokenCount, &tempVersionNumber)) {
-			if(tempVersionNumber > shadowJsonVersionNum) {
-				shadowJsonVersionNum = tempVersionNumber;
-			} else {
-				IOT_WARN("Old Delta Message received - Ignoring rx: %d local: %d", tempVersionNumber,
-						 shadowJsonVersionNum);
-				return;
-			}
+	isVersioned = extractVersionNumber(pJsonDocument, pJsonHandler, tokenCount, &tempVersionNumber);
+	if(pShadow->shadowDiscardOldDeltaFlag && isVersioned) {
+		if(tempVersionNumber > pShadow->shadowJsonVersionNum) {
+			pShadow->shadowJsonVersionNum = tempVersionNumber;
+		} else {
+			IOT_WARN("Old Delta Message received - Ignoring rx: %d local: %d", tempVersionNumber,
+					 pShadow->shadowJsonVersionNum);
+			return;
 		}
 	}
 
-	for(i = 0; i < tokenTableIndex; i++) {
-		if(!tokenTable[i].isFree) {
-			if(isJsonKeyMatchingAndUpdateValue(shadowRxBuf, pJsonHandler, tokenCount,
-											   (jsonStruct_t *) tokenTable[i].pStruct, &dataLength, &DataPosition)) {
-				if(tokenTable[i].callback != NULL) {
-					tokenTable[i].callback(shadowRxBuf + DataPosition, dataLength,
-										   (jsonStruct_t *) tokenTable[i].pStruct);
-				}
-			}
-		}
+	if(isVersioned) {
+		cacheShadowDelta(pShadow, pJsonDocument, params->payloadLen, tempVersionNumber);
 	}
+
+	dispatchShadowDelta(pShadow, pJsonDocument, tokenCount);
 }
 
 #ifdef __cplusplus
@@ -43,4 +43,17 @@
 #define INTEGRATION_TEST_CLIENT_ID_PUB "EMB_C_SDK_INTEG_TESTER_PUB"
 #define INTEGRATION_TEST_CLIENT_ID_SUB "EMB_C_SDK_INTEG_TESTER_SUB"
 
+/* Loopback address and port of the server of the TLS benchmark and reconnect tests */
+#define TLS_LOOPBACK_HOST "127.0.0.1"
+#define TLS_LOOPBACK_PORT "18883"
+
+/* Connections made by the TLS benchmark for each cipher suite and curve policy */
+#define TLS_BENCHMARK_HANDSHAKES 200
+
+/* Megabytes sent by the TLS benchmark for each record layer */
+#define TLS_BENCHMARK_TRANSFER_MB 64
+
+/* Size of each TLS benchmark write */
+#define TLS_BENCHMARK_WRITE_SIZE 16384
+
 #endif /* TESTS_INTEGRATION_INTEG_TESTS_CONFIG_H_ */
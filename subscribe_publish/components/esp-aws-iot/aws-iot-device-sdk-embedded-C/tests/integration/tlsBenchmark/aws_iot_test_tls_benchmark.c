@@ -0,0 +1,249 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_tls_benchmark.c
+ * @brief TLS benchmark over the loopback
+ *
+ * Connects the TLS layer of the SDK to an mbedTLS server running in a thread of this program,
+ * see aws_iot_test_tls_loopback.h.
+ *
+ * The handshake benchmark reports the median and 99th percentile handshake time of each
+ * cipher suite and curve policy, with the median of the steps the handshake profile splits
+ * it into. The throughput benchmark measures the cost of sending data with records encrypted
+ * by mbedTLS and by kernel TLS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_interface.h"
+
+#include "aws_iot_integ_tests_config.h"
+#include "aws_iot_test_tls_loopback.h"
+
+typedef struct {
+	const char *pName;
+	const int *pCipherSuites;
+	const uint16_t *pCurves;
+	bool resume;
+} BenchmarkPolicy;
+
+static const int ecdsaAes128Gcm[] = { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, 0 };
+static const int rsaAes128Gcm[] = { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256, 0 };
+/* IANA named curves, P-256 stays in the X25519 policy for the ECDSA certificates */
+static const uint16_t p256[] = { 23, 0 };
+static const uint16_t x25519P256[] = { 29, 23, 0 };
+
+static const BenchmarkPolicy policies[] = {
+	{ "mbedTLS defaults", NULL, NULL, false },
+	{ "ECDHE-ECDSA P-256 AES-128-GCM", ecdsaAes128Gcm, p256, false },
+	{ "ECDHE-ECDSA X25519 AES-128-GCM", ecdsaAes128Gcm, x25519P256, false },
+	{ "ECDHE-RSA P-256 AES-128-GCM", rsaAes128Gcm, p256, false },
+	{ "ECDHE-ECDSA P-256, resumed", ecdsaAes128Gcm, p256, true },
+};
+
+/* Handshake steps reported next to the whole handshake, see TLSHandshakeProfile */
+static const int profiledSteps[] = { MBEDTLS_SSL_SERVER_CERTIFICATE, MBEDTLS_SSL_SERVER_KEY_EXCHANGE,
+									 MBEDTLS_SSL_CLIENT_KEY_EXCHANGE, MBEDTLS_SSL_CERTIFICATE_VERIFY };
+
+static unsigned char writeBuffer[TLS_BENCHMARK_WRITE_SIZE];
+
+/* Whole handshake, then the profiled steps, of each connection of a policy */
+static uint32_t handshakeSamples[1 + sizeof(profiledSteps) / sizeof(profiledSteps[0])][TLS_BENCHMARK_HANDSHAKES];
+
+static double elapsed_ms(const struct timespec *pStart, const struct timespec *pEnd) {
+	return (pEnd->tv_sec - pStart->tv_sec) * 1000.0 + (pEnd->tv_nsec - pStart->tv_nsec) / 1000000.0;
+}
+
+static int compare_samples(const void *pA, const void *pB) {
+	uint32_t a = *(const uint32_t *) pA;
+	uint32_t b = *(const uint32_t *) pB;
+
+	return (a > b) - (a < b);
+}
+
+/* Sorts the samples in us and returns the value below which percentile % of them fall, in ms */
+static double percentile_ms(uint32_t *pSamples, size_t count, unsigned int percentile) {
+	qsort(pSamples, count, sizeof(uint32_t), compare_samples);
+	return pSamples[(count * percentile) / 100] / 1000.0;
+}
+
+static void tls_benchmark_network_init(LoopbackServer *pServer, Network *pNetwork, const BenchmarkPolicy *pPolicy) {
+	tls_loopback_network_init(pServer, pNetwork);
+	pNetwork->tlsConnectParams.pCipherSuites = pPolicy->pCipherSuites;
+	pNetwork->tlsConnectParams.pCurves = pPolicy->pCurves;
+}
+
+/* Connects TLS_BENCHMARK_HANDSHAKES times with the policy and reports the handshake profiles */
+static int tls_benchmark_handshakes(LoopbackServer *pServer, const BenchmarkPolicy *pPolicy) {
+	LoopbackTransfer transfer;
+	pthread_t serverThread;
+	const char *pCipherSuite = "";
+	const TLSHandshakeProfile *pProfile;
+	uint32_t i, step, resumedCount;
+	Network network;
+	IoT_Error_t rc = SUCCESS;
+
+	/* Resumed handshakes need a first connection to get a session from */
+	if(0 != tls_loopback_server_start(pServer, &transfer, &serverThread,
+									   TLS_BENCHMARK_HANDSHAKES + (pPolicy->resume ? 1 : 0), false)) {
+		return -1;
+	}
+
+	tls_benchmark_network_init(pServer, &network, pPolicy);
+	pProfile = &(network.tlsDataParams.handshakeProfile);
+	if(pPolicy->resume) {
+		rc = iot_tls_connect(&network, NULL);
+		if(SUCCESS == rc) {
+			iot_tls_disconnect(&network);
+		}
+		iot_tls_destroy(&network);
+	}
+	resumedCount = network.tlsDataParams.resumed_handshake_count;
+
+	for(i = 0; i < TLS_BENCHMARK_HANDSHAKES && SUCCESS == rc; i++) {
+		/* Passing the connect parameters again drops the saved session, forcing a full handshake */
+		rc = iot_tls_connect(&network, pPolicy->resume ? NULL : &(network.tlsConnectParams));
+		if(SUCCESS == rc) {
+			pCipherSuite = mbedtls_ssl_get_ciphersuite(&(network.tlsDataParams.ssl));
+			handshakeSamples[0][i] = pProfile->handshake_us;
+			for(step = 0; step < sizeof(profiledSteps) / sizeof(profiledSteps[0]); step++) {
+				handshakeSamples[1 + step][i] = pProfile->step_us[profiledSteps[step]];
+			}
+			iot_tls_disconnect(&network);
+		}
+		iot_tls_destroy(&network);
+	}
+	resumedCount = network.tlsDataParams.resumed_handshake_count - resumedCount;
+	iot_tls_free(&network);
+
+	if(SUCCESS != rc) {
+		IOT_ERROR("Benchmark connect with %s failed, %d\n", pPolicy->pName, rc);
+		pthread_cancel(serverThread);
+		pthread_join(serverThread, NULL);
+		return -1;
+	}
+	pthread_join(serverThread, NULL);
+
+	printf("%-32s %-40s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8u\n", pPolicy->pName, pCipherSuite,
+		   percentile_ms(handshakeSamples[0], TLS_BENCHMARK_HANDSHAKES, 50),
+		   percentile_ms(handshakeSamples[0], TLS_BENCHMARK_HANDSHAKES, 99),
+		   percentile_ms(handshakeSamples[1], TLS_BENCHMARK_HANDSHAKES, 50),
+		   percentile_ms(handshakeSamples[2], TLS_BENCHMARK_HANDSHAKES, 50),
+		   percentile_ms(handshakeSamples[3], TLS_BENCHMARK_HANDSHAKES, 50),
+		   percentile_ms(handshakeSamples[4], TLS_BENCHMARK_HANDSHAKES, 50), resumedCount);
+
+	return 0;
+}
+
+/* Sends TLS_BENCHMARK_TRANSFER_MB to the server and reports the throughput and the CPU time of the sender */
+static int tls_benchmark_run(LoopbackServer *pServer, bool kernelOffload) {
+	LoopbackTransfer transfer;
+	pthread_t serverThread;
+	struct timespec wallStart, wallEnd, cpuStart, cpuEnd;
+	size_t total = (size_t) TLS_BENCHMARK_TRANSFER_MB * 1024 * 1024;
+	size_t sent = 0, writtenLen;
+	double wall_ms, cpu_ms;
+	bool offloaded;
+	Network network;
+	IoT_Error_t rc;
+
+	if(0 != tls_loopback_server_start(pServer, &transfer, &serverThread, 1, false)) {
+		return -1;
+	}
+
+	tls_benchmark_network_init(pServer, &network, &(policies[0]));
+	iot_tls_set_kernel_offload(&network, kernelOffload);
+	rc = iot_tls_connect(&network, NULL);
+	if(SUCCESS != rc) {
+		IOT_ERROR("Benchmark connect failed, %d\n", rc);
+		iot_tls_destroy(&network);
+		iot_tls_free(&network);
+		pthread_cancel(serverThread);
+		pthread_join(serverThread, NULL);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &wallStart);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+	while(sent < total && SUCCESS == rc) {
+		writtenLen = 0;
+		rc = iot_tls_write(&network, writeBuffer, sizeof(writeBuffer), NULL, &writtenLen);
+		sent += writtenLen;
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+
+	/* The server reads until the close_notify */
+	offloaded = network.tlsDataParams.ktls_tx;
+	iot_tls_disconnect(&network);
+	pthread_join(serverThread, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+	iot_tls_destroy(&network);
+	iot_tls_free(&network);
+
+	if(SUCCESS != rc || 0 != transfer.result || total != transfer.receivedBytes) {
+		IOT_ERROR("Benchmark transfer failed, %d\n", rc);
+		return -1;
+	}
+
+	wall_ms = elapsed_ms(&wallStart, &wallEnd);
+	cpu_ms = elapsed_ms(&cpuStart, &cpuEnd);
+	printf("%-22s %-30s %10.1f MB/s %10.2f ms CPU/MB\n", kernelOffload ? "kernel TLS requested" : "mbedTLS",
+		   offloaded ? "records encrypted by kernel" : "records encrypted by mbedTLS",
+		   TLS_BENCHMARK_TRANSFER_MB / (wall_ms / 1000.0), cpu_ms / TLS_BENCHMARK_TRANSFER_MB);
+
+	return 0;
+}
+
+int main() {
+	LoopbackServer server;
+	size_t i;
+	int rc;
+
+	memset(writeBuffer, 'x', sizeof(writeBuffer));
+
+	if(0 != tls_loopback_server_init(&server)) {
+		tls_loopback_server_free(&server);
+		return 1;
+	}
+
+	printf("\n%d handshakes per policy over %s:%s, medians and 99th percentile in ms\n\n", TLS_BENCHMARK_HANDSHAKES,
+		   TLS_LOOPBACK_HOST, TLS_LOOPBACK_PORT);
+	printf("%-32s %-40s %8s %8s %8s %8s %8s %8s %8s\n", "policy", "cipher suite", "median", "p99", "srv cert",
+		   "srv kx", "cli kx", "cert vfy", "resumed");
+	rc = 0;
+	for(i = 0; i < sizeof(policies) / sizeof(policies[0]) && 0 == rc; i++) {
+		rc = tls_benchmark_handshakes(&server, &(policies[i]));
+	}
+
+	if(0 == rc) {
+		printf("\nSending %d MB in writes of %d bytes\n\n", TLS_BENCHMARK_TRANSFER_MB, TLS_BENCHMARK_WRITE_SIZE);
+		rc = tls_benchmark_run(&server, false);
+	}
+	if(0 == rc) {
+		rc = tls_benchmark_run(&server, true);
+	}
+
+	tls_loopback_server_free(&server);
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_tls_loopback.c
+ * @brief mbedTLS server on the loopback for the TLS layer tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+
+#include "aws_iot_integ_tests_config.h"
+#include "aws_iot_test_tls_loopback.h"
+
+#define TLS_LOOPBACK_PEM_SIZE 4096
+
+static unsigned char readBuffer[16384];
+
+static int write_file(const char *pPath, const unsigned char *pData) {
+	FILE *pFile = fopen(pPath, "w");
+	int ret;
+
+	if(NULL == pFile) {
+		return -1;
+	}
+	ret = (1 == fwrite(pData, strlen((const char *) pData), 1, pFile)) ? 0 : -1;
+	fclose(pFile);
+
+	return ret;
+}
+
+static int generate_key(LoopbackServer *pServer, mbedtls_pk_context *pKey, mbedtls_pk_type_t type) {
+	int ret;
+
+	if((ret = mbedtls_pk_setup(pKey, mbedtls_pk_info_from_type(type))) != 0) {
+		return ret;
+	}
+	if(MBEDTLS_PK_RSA == type) {
+		return mbedtls_rsa_gen_key(mbedtls_pk_rsa(*pKey), mbedtls_ctr_drbg_random, &(pServer->ctr_drbg), 2048, 65537);
+	}
+	return mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(*pKey), mbedtls_ctr_drbg_random,
+							   &(pServer->ctr_drbg));
+}
+
+/* Issues a certificate for pKey signed by the CA, self-signed when pKey is the CA key */
+static int issue_certificate(LoopbackServer *pServer, mbedtls_pk_context *pKey, const char *pSubject, int serial,
+							 unsigned char *pPem, mbedtls_x509_crt *pCert) {
+	mbedtls_x509write_cert writer;
+	mbedtls_mpi serialNumber;
+	int isCa = (pKey == &(pServer->caKey)) ? 1 : 0;
+	int ret;
+
+	mbedtls_x509write_crt_init(&writer);
+	mbedtls_mpi_init(&serialNumber);
+
+	mbedtls_x509write_crt_set_version(&writer, MBEDTLS_X509_CRT_VERSION_3);
+	mbedtls_x509write_crt_set_md_alg(&writer, MBEDTLS_MD_SHA256);
+	mbedtls_x509write_crt_set_subject_key(&writer, pKey);
+	mbedtls_x509write_crt_set_issuer_key(&writer, &(pServer->caKey));
+	if((ret = mbedtls_mpi_lset(&serialNumber, serial)) == 0 &&
+	   (ret = mbedtls_x509write_crt_set_serial(&writer, &serialNumber)) == 0 &&
+	   (ret = mbedtls_x509write_crt_set_subject_name(&writer, pSubject)) == 0 &&
+	   (ret = mbedtls_x509write_crt_set_issuer_name(&writer, "CN=AWS IoT TLS Loopback CA")) == 0 &&
+	   (ret = mbedtls_x509write_crt_set_validity(&writer, "20200101000000", "20491231235959")) == 0 &&
+	   (ret = mbedtls_x509write_crt_set_basic_constraints(&writer, isCa, -1)) == 0 &&
+	   (ret = mbedtls_x509write_crt_pem(&writer, pPem, TLS_LOOPBACK_PEM_SIZE, mbedtls_ctr_drbg_random,
+										&(pServer->ctr_drbg))) == 0) {
+		ret = mbedtls_x509_crt_parse(pCert, pPem, strlen((const char *) pPem) + 1);
+	}
+
+	mbedtls_mpi_free(&serialNumber);
+	mbedtls_x509write_crt_free(&writer);
+	return ret;
+}
+
+/* Generates the credentials of both sides, those of the device are written to files for iot_tls_init */
+static int tls_loopback_credentials_init(LoopbackServer *pServer) {
+	static unsigned char pem[TLS_LOOPBACK_PEM_SIZE];
+	mbedtls_pk_context deviceKey;
+	mbedtls_x509_crt deviceCert;
+	int ret;
+
+	mbedtls_pk_init(&deviceKey);
+	mbedtls_x509_crt_init(&deviceCert);
+
+	if(NULL == mkdtemp(pServer->credentialDirectory)) {
+		IOT_ERROR("Unable to create %s\n", pServer->credentialDirectory);
+		pServer->credentialDirectory[0] = '\0';
+		return -1;
+	}
+	snprintf(pServer->rootCA, PATH_MAX + 1, "%s/%s", pServer->credentialDirectory, AWS_IOT_ROOT_CA_FILENAME);
+	snprintf(pServer->clientCRT, PATH_MAX + 1, "%s/%s", pServer->credentialDirectory, AWS_IOT_CERTIFICATE_FILENAME);
+	snprintf(pServer->clientKey, PATH_MAX + 1, "%s/%s", pServer->credentialDirectory, AWS_IOT_PRIVATE_KEY_FILENAME);
+
+	if((ret = generate_key(pServer, &(pServer->caKey), MBEDTLS_PK_ECKEY)) != 0 ||
+	   (ret = issue_certificate(pServer, &(pServer->caKey), "CN=AWS IoT TLS Loopback CA", 1, pem,
+								&(pServer->caCert))) != 0 ||
+	   (ret = write_file(pServer->rootCA, pem)) != 0 ||
+	   (ret = generate_key(pServer, &(pServer->ecdsaKey), MBEDTLS_PK_ECKEY)) != 0 ||
+	   (ret = issue_certificate(pServer, &(pServer->ecdsaKey), "CN=" TLS_LOOPBACK_HOST, 2, pem,
+								&(pServer->ecdsaCert))) != 0 ||
+	   (ret = generate_key(pServer, &(pServer->rsaKey), MBEDTLS_PK_RSA)) != 0 ||
+	   (ret = issue_certificate(pServer, &(pServer->rsaKey), "CN=" TLS_LOOPBACK_HOST, 3, pem,
+								&(pServer->rsaCert))) != 0 ||
+	   (ret = generate_key(pServer, &deviceKey, MBEDTLS_PK_ECKEY)) != 0 ||
+	   (ret = issue_certificate(pServer, &deviceKey, "CN=AWS IoT TLS Loopback Device", 4, pem, &deviceCert)) != 0 ||
+	   (ret = write_file(pServer->clientCRT, pem)) != 0 ||
+	   (ret = mbedtls_pk_write_key_pem(&deviceKey, pem, sizeof(pem))) != 0 ||
+	   (ret = write_file(pServer->clientKey, pem)) != 0) {
+		IOT_ERROR("Generating the loopback credentials failed, -0x%x\n", -ret);
+	}
+
+	mbedtls_x509_crt_free(&deviceCert);
+	mbedtls_pk_free(&deviceKey);
+	return ret;
+}
+
+static void tls_loopback_credentials_free(LoopbackServer *pServer) {
+	if('\0' != pServer->credentialDirectory[0]) {
+		unlink(pServer->rootCA);
+		unlink(pServer->clientCRT);
+		unlink(pServer->clientKey);
+		rmdir(pServer->credentialDirectory);
+	}
+
+	mbedtls_x509_crt_free(&(pServer->rsaCert));
+	mbedtls_pk_free(&(pServer->rsaKey));
+	mbedtls_x509_crt_free(&(pServer->ecdsaCert));
+	mbedtls_pk_free(&(pServer->ecdsaKey));
+	mbedtls_x509_crt_free(&(pServer->caCert));
+	mbedtls_pk_free(&(pServer->caKey));
+}
+
+int tls_loopback_server_init(LoopbackServer *pServer) {
+	const char *pers = "aws_iot_tls_loopback";
+	int ret;
+
+	snprintf(pServer->credentialDirectory, PATH_MAX + 1, "/tmp/aws_iot_tls_loopback_XXXXXX");
+	pServer->rootCA[0] = '\0';
+	pServer->clientCRT[0] = '\0';
+	pServer->clientKey[0] = '\0';
+
+	mbedtls_entropy_init(&(pServer->entropy));
+	mbedtls_ctr_drbg_init(&(pServer->ctr_drbg));
+	mbedtls_pk_init(&(pServer->caKey));
+	mbedtls_x509_crt_init(&(pServer->caCert));
+	mbedtls_pk_init(&(pServer->ecdsaKey));
+	mbedtls_x509_crt_init(&(pServer->ecdsaCert));
+	mbedtls_pk_init(&(pServer->rsaKey));
+	mbedtls_x509_crt_init(&(pServer->rsaCert));
+	mbedtls_ssl_cache_init(&(pServer->cache));
+	mbedtls_ssl_config_init(&(pServer->conf));
+	mbedtls_net_init(&(pServer->listen_fd));
+
+	if((ret = mbedtls_ctr_drbg_seed(&(pServer->ctr_drbg), mbedtls_entropy_func, &(pServer->entropy),
+									(const unsigned char *) pers, strlen(pers))) != 0 ||
+	   (ret = tls_loopback_credentials_init(pServer)) != 0 ||
+	   (ret = mbedtls_ssl_config_defaults(&(pServer->conf), MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+										  MBEDTLS_SSL_PRESET_DEFAULT)) != 0 ||
+	   (ret = mbedtls_ssl_conf_own_cert(&(pServer->conf), &(pServer->ecdsaCert), &(pServer->ecdsaKey))) != 0 ||
+	   (ret = mbedtls_ssl_conf_own_cert(&(pServer->conf), &(pServer->rsaCert), &(pServer->rsaKey))) != 0 ||
+	   (ret = mbedtls_net_bind(&(pServer->listen_fd), TLS_LOOPBACK_HOST, TLS_LOOPBACK_PORT,
+							   MBEDTLS_NET_PROTO_TCP)) != 0) {
+		IOT_ERROR("Setting up the loopback server failed, -0x%x\n", -ret);
+		return ret;
+	}
+
+	/* The device signs and sends its certificate, as it does with AWS IoT */
+	mbedtls_ssl_conf_authmode(&(pServer->conf), MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_ca_chain(&(pServer->conf), &(pServer->caCert), NULL);
+	mbedtls_ssl_conf_rng(&(pServer->conf), mbedtls_ctr_drbg_random, &(pServer->ctr_drbg));
+	mbedtls_ssl_conf_session_cache(&(pServer->conf), &(pServer->cache), mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+
+	return 0;
+}
+
+void tls_loopback_server_free(LoopbackServer *pServer) {
+	mbedtls_net_free(&(pServer->listen_fd));
+	mbedtls_ssl_config_free(&(pServer->conf));
+	mbedtls_ssl_cache_free(&(pServer->cache));
+	tls_loopback_credentials_free(pServer);
+	mbedtls_ctr_drbg_free(&(pServer->ctr_drbg));
+	mbedtls_entropy_free(&(pServer->entropy));
+}
+
+void tls_loopback_server_forget_sessions(LoopbackServer *pServer) {
+	/* The configuration keeps pointing to the same, now empty, cache */
+	mbedtls_ssl_cache_free(&(pServer->cache));
+	mbedtls_ssl_cache_init(&(pServer->cache));
+}
+
+/* Accepts connectionCount connections one after the other, and reads each until the client closes it */
+static void *tls_loopback_server_thread(void *pArg) {
+	LoopbackTransfer *pTransfer = (LoopbackTransfer *) pArg;
+	mbedtls_net_context client_fd;
+	mbedtls_ssl_context ssl;
+	uint32_t connection;
+	int ret;
+
+	mbedtls_net_init(&client_fd);
+	mbedtls_ssl_init(&ssl);
+	pTransfer->receivedBytes = 0;
+	pTransfer->result = -1;
+
+	if(0 != mbedtls_ssl_setup(&ssl, &(pTransfer->pServer->conf))) {
+		goto exit;
+	}
+
+	for(connection = 0; connection < pTransfer->connectionCount; connection++) {
+		if(0 != mbedtls_net_accept(&(pTransfer->pServer->listen_fd), &client_fd, NULL, 0, NULL) ||
+		   0 != mbedtls_ssl_session_reset(&ssl)) {
+			goto exit;
+		}
+		if(pTransfer->closeBeforeHandshake) {
+			mbedtls_net_free(&client_fd);
+			continue;
+		}
+		mbedtls_ssl_set_bio(&ssl, &client_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+		while((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+			if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+				IOT_ERROR("Loopback server handshake failed, -0x%x\n", -ret);
+				goto exit;
+			}
+		}
+
+		do {
+			ret = mbedtls_ssl_read(&ssl, readBuffer, sizeof(readBuffer));
+			if(0 < ret) {
+				pTransfer->receivedBytes += (size_t) ret;
+			}
+		} while(0 < ret || ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+		mbedtls_net_free(&client_fd);
+	}
+	pTransfer->result = 0;
+
+exit:
+	mbedtls_ssl_free(&ssl);
+	mbedtls_net_free(&client_fd);
+	return NULL;
+}
+
+int tls_loopback_server_start(LoopbackServer *pServer, LoopbackTransfer *pTransfer, pthread_t *pThread,
+							  uint32_t connectionCount, bool closeBeforeHandshake) {
+	pTransfer->pServer = pServer;
+	pTransfer->connectionCount = connectionCount;
+	pTransfer->closeBeforeHandshake = closeBeforeHandshake;
+
+	return pthread_create(pThread, NULL, tls_loopback_server_thread, pTransfer);
+}
+
+void tls_loopback_network_init(LoopbackServer *pServer, Network *pNetwork) {
+	iot_tls_init(pNetwork, pServer->rootCA, pServer->clientCRT, pServer->clientKey, TLS_LOOPBACK_HOST,
+				 (uint16_t) atoi(TLS_LOOPBACK_PORT), 10000, true);
+}
@@ -0,0 +1,102 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_tls_loopback.h
+ * @brief mbedTLS server on the loopback for the TLS layer tests
+ *
+ * The credentials of both sides are generated at startup: a P-256 CA, a P-256 and an RSA-2048
+ * server certificate, and a P-256 device certificate. Those of the device are written to files
+ * for iot_tls_init.
+ */
+
+#ifndef TESTS_INTEGRATION_TLS_LOOPBACK_H_
+#define TESTS_INTEGRATION_TLS_LOOPBACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "network_interface.h"
+
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/x509_crt.h"
+
+typedef struct {
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_pk_context caKey;
+	mbedtls_x509_crt caCert;
+	mbedtls_pk_context ecdsaKey;
+	mbedtls_x509_crt ecdsaCert;
+	mbedtls_pk_context rsaKey;
+	mbedtls_x509_crt rsaCert;
+	mbedtls_ssl_cache_context cache;
+	mbedtls_ssl_config conf;
+	mbedtls_net_context listen_fd;
+	char credentialDirectory[PATH_MAX + 1];
+	char rootCA[PATH_MAX + 1]; ///< Root CA file of the device
+	char clientCRT[PATH_MAX + 1]; ///< Certificate file of the device
+	char clientKey[PATH_MAX + 1]; ///< Private key file of the device
+} LoopbackServer;
+
+typedef struct {
+	LoopbackServer *pServer;
+	uint32_t connectionCount;
+	bool closeBeforeHandshake;
+	size_t receivedBytes;
+	int result;
+} LoopbackTransfer;
+
+/**
+ * @brief Generate the credentials and listen on TLS_LOOPBACK_HOST:TLS_LOOPBACK_PORT
+ *
+ * The server requires the device certificate and resumes sessions from its cache.
+ *
+ * @return 0 or an mbedTLS error, tls_loopback_server_free has to be called in both cases
+ */
+int tls_loopback_server_init(LoopbackServer *pServer);
+
+/**
+ * @brief Stop listening and remove the credential files
+ */
+void tls_loopback_server_free(LoopbackServer *pServer);
+
+/**
+ * @brief Accept connectionCount connections in a new thread, one after the other
+ *
+ * Each connection is read until the client closes it, or closed right away when closeBeforeHandshake
+ * is set. The thread ends once the last one is closed, with the result of the transfer set.
+ *
+ * @return 0 or a pthread_create error
+ */
+int tls_loopback_server_start(LoopbackServer *pServer, LoopbackTransfer *pTransfer, pthread_t *pThread,
+							  uint32_t connectionCount, bool closeBeforeHandshake);
+
+/**
+ * @brief Drop the sessions of the cache, refusing those the clients offer next
+ *
+ * Only to be called while no server thread runs.
+ */
+void tls_loopback_server_forget_sessions(LoopbackServer *pServer);
+
+/**
+ * @brief iot_tls_init with the device credentials of the server
+ */
+void tls_loopback_network_init(LoopbackServer *pServer, Network *pNetwork);
+
+#endif /* TESTS_INTEGRATION_TLS_LOOPBACK_H_ */
@@ -0,0 +1,197 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_tls_reconnect.c
+ * @brief Tests of what the TLS layer keeps across reconnects
+ *
+ * Connects the TLS layer of the SDK to an mbedTLS server running in a thread of this program,
+ * see aws_iot_test_tls_loopback.h, and checks the state kept in tlsDataParams between connects: the saved
+ * session and the parsed credentials.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_interface.h"
+
+#include "aws_iot_integ_tests_config.h"
+#include "aws_iot_test_tls_loopback.h"
+
+#define TLS_RECONNECT_CHECK(condition)                                     \
+	do {                                                                   \
+		if(!(condition)) {                                                 \
+			IOT_ERROR("Check failed at line %d: %s\n", __LINE__, #condition); \
+			return -1;                                                     \
+		}                                                                  \
+	} while(0)
+
+/* Runs connectionCount connects of the client against the server, each closed right away */
+static int tls_reconnect_connect(LoopbackServer *pServer, Network *pNetwork, uint32_t connectionCount,
+								 bool closeBeforeHandshake, IoT_Error_t *pRc) {
+	LoopbackTransfer transfer;
+	pthread_t serverThread;
+
+	if(0 != tls_loopback_server_start(pServer, &transfer, &serverThread, connectionCount, closeBeforeHandshake)) {
+		return -1;
+	}
+
+	*pRc = iot_tls_connect(pNetwork, NULL);
+	if(SUCCESS == *pRc) {
+		iot_tls_disconnect(pNetwork);
+	}
+	iot_tls_destroy(pNetwork);
+
+	pthread_join(serverThread, NULL);
+	return transfer.result;
+}
+
+/* The session of a connection is offered by the next one, and dropped when it cannot be resumed */
+static int tls_reconnect_session_test(LoopbackServer *pServer) {
+	TLSDataParams *pParams;
+	Network network;
+	IoT_Error_t rc;
+
+	printf("Session resumption ... ");
+	memset(&network, 0, sizeof(network));
+	tls_loopback_network_init(pServer, &network);
+	pParams = &(network.tlsDataParams);
+
+	/* A first connect has no session to offer */
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(1 == pParams->full_handshake_count && 0 == pParams->resumed_handshake_count);
+	TLS_RECONNECT_CHECK(!pParams->handshakeProfile.resumed && pParams->has_saved_session);
+
+	/* The server resumes the session from its cache */
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(1 == pParams->full_handshake_count && 1 == pParams->resumed_handshake_count);
+	TLS_RECONNECT_CHECK(pParams->handshakeProfile.resumed && pParams->has_saved_session);
+
+	/* A server which lost the session falls back to a full handshake, whose session is kept instead */
+	tls_loopback_server_forget_sessions(pServer);
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(2 == pParams->full_handshake_count && 1 == pParams->resumed_handshake_count);
+	TLS_RECONNECT_CHECK(!pParams->handshakeProfile.resumed && pParams->has_saved_session);
+
+	/* A failed handshake drops the session, the connect is retried once without it */
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 2, true, &rc));
+	TLS_RECONNECT_CHECK(SSL_CONNECTION_ERROR == rc);
+	TLS_RECONNECT_CHECK(!pParams->has_saved_session);
+
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(3 == pParams->full_handshake_count && 1 == pParams->resumed_handshake_count);
+	TLS_RECONNECT_CHECK(pParams->has_saved_session);
+
+	/* iot_tls_free releases the saved session, a Network initialized again starts without one */
+	TLS_RECONNECT_CHECK(SUCCESS == iot_tls_free(&network));
+	TLS_RECONNECT_CHECK(!pParams->has_saved_session);
+	tls_loopback_network_init(pServer, &network);
+	TLS_RECONNECT_CHECK(!pParams->has_saved_session && 0 == pParams->full_handshake_count);
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc && pParams->has_saved_session);
+
+	TLS_RECONNECT_CHECK(SUCCESS == iot_tls_free(&network));
+	TLS_RECONNECT_CHECK(!pParams->has_saved_session);
+
+	printf("ok\n");
+	return 0;
+}
+
+/* The parsed credentials are kept across reconnects, and parsed again when their files change */
+static int tls_reconnect_credentials_test(LoopbackServer *pServer) {
+	char rootCA[PATH_MAX + 1];
+	char clientCRT[PATH_MAX + 1];
+	char clientKey[PATH_MAX + 1];
+	TLSCredentials *pOwn;
+	unsigned char *pParsedCert;
+	Network network;
+	IoT_Error_t rc;
+
+	printf("Credentials reuse ... ");
+	memset(&network, 0, sizeof(network));
+	tls_loopback_network_init(pServer, &network);
+	pOwn = &(network.tlsDataParams.ownCredentials);
+	TLS_RECONNECT_CHECK(NULL == pOwn->pRootCALocation);
+
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	pParsedCert = pOwn->clicert.raw.p;
+	TLS_RECONNECT_CHECK(NULL != pParsedCert && pServer->clientCRT == pOwn->pDeviceCertLocation);
+
+	/* A reconnect uses the certificate parsed by the first connect */
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(pParsedCert == pOwn->clicert.raw.p);
+
+	/* Other paths are parsed again, even when they name the same files */
+	strcpy(rootCA, pServer->rootCA);
+	strcpy(clientCRT, pServer->clientCRT);
+	strcpy(clientKey, pServer->clientKey);
+	network.tlsConnectParams.pRootCALocation = rootCA;
+	network.tlsConnectParams.pDeviceCertLocation = clientCRT;
+	network.tlsConnectParams.pDevicePrivateKeyLocation = clientKey;
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc);
+	TLS_RECONNECT_CHECK(rootCA == pOwn->pRootCALocation && clientCRT == pOwn->pDeviceCertLocation
+						&& clientKey == pOwn->pDevicePrivateKeyLocation);
+	TLS_RECONNECT_CHECK(NULL != pOwn->clicert.raw.p);
+
+	/* iot_tls_free releases them, and a second call finds nothing left to release */
+	TLS_RECONNECT_CHECK(SUCCESS == iot_tls_free(&network));
+	TLS_RECONNECT_CHECK(NULL == pOwn->pRootCALocation);
+	TLS_RECONNECT_CHECK(SUCCESS == iot_tls_free(&network));
+
+	/* A Network initialized again parses them on its first connect */
+	tls_loopback_network_init(pServer, &network);
+	TLS_RECONNECT_CHECK(NULL == pOwn->pRootCALocation);
+	TLS_RECONNECT_CHECK(0 == tls_reconnect_connect(pServer, &network, 1, false, &rc));
+	TLS_RECONNECT_CHECK(SUCCESS == rc && pServer->rootCA == pOwn->pRootCALocation);
+
+	TLS_RECONNECT_CHECK(SUCCESS == iot_tls_free(&network));
+	TLS_RECONNECT_CHECK(NULL == pOwn->pRootCALocation);
+
+	printf("ok\n");
+	return 0;
+}
+
+int main() {
+	LoopbackServer server;
+	int rc;
+
+	/* The server closes connections the client is still writing to */
+	signal(SIGPIPE, SIG_IGN);
+
+	if(0 != tls_loopback_server_init(&server)) {
+		tls_loopback_server_free(&server);
+		return 1;
+	}
+
+	rc = tls_reconnect_session_test(&server);
+	if(0 == rc) {
+		rc = tls_reconnect_credentials_test(&server);
+	}
+
+	tls_loopback_server_free(&server);
+	return (0 == rc) ? 0 : 1;
+}
@@ -41,6 +41,9 @@
 #endif
 #define AWS_IOT_MQTT_TX_BUF_LEN 512 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS 5 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH 4 ///< Maximum number of asynchronous QoS1 publishes that can be awaiting a PUBACK at any given time
+#define AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES (AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS * 8) ///< Number of topic levels, shared between all subscribed topic filters, the MQTT client can index for dispatch
+#define AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS 10 ///< Minimum time between two messages sent from the offline queue, 10 ms stays below the AWS IoT limit of 100 publishes per second per connection
 
 // Shadow and Job common configs
 #define MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES 80  ///< Maximum size of the Unique Client Id. For More info on the Client Id refer \ref response "Acknowledgments"
@@ -53,6 +56,11 @@
 #define MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME 10 ///< At Any given time we will wait for this many responses. This will correlate to the rate at which the shadow actions are requested
 #define MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME 10 ///< We could perform shadow action on any thing Name and this is maximum Thing Names we can act on at any given time
 #define MAX_JSON_TOKEN_EXPECTED 120 ///< These are the max tokens that is expected to be in the Shadow JSON document. Include the metadata that gets published
+#define MAX_SHADOW_REPORTED_FIELDS 40 ///< Maximum number of reported fields whose last value is tracked for aws_iot_shadow_update_changed
+#define MAX_SHADOW_REPORTED_TEXT_LENGTH 64 ///< Longest string or object value, terminator included, whose last reported text is kept
+#define SHADOW_COALESCE_WINDOW_MS 200 ///< Time aws_iot_shadow_update_coalesced collects field changes before they are sent as one update
+#define MAX_SHADOW_COALESCED_FIELDS 16 ///< Maximum number of distinct fields in one coalesced update, the update is sent early when more are added
+#define MAX_SHADOW_COALESCED_CALLBACKS 8 ///< Maximum number of callers waiting on the response of coalesced updates
 #define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME 60 ///< All shadow actions have to be published or subscribed to a topic which is of the format $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
 #define MAX_SHADOW_TOPIC_LENGTH_BYTES MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME ///< This size includes the length of topic with Thing Name
 
@@ -67,7 +75,11 @@
 #endif
 
 // Auto Reconnect specific config
-#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL 1000 ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
-#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL 128000 ///< Maximum time interval after which exponential back-off will stop attempting to reconnect.
+#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL 1000 ///< Shortest wait between reconnect attempts, the first wait is drawn between this and three times this
+#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL 128000 ///< Longest wait between reconnect attempts, auto-reconnect keeps retrying at up to this interval
+
+// Network configs
+#define AWS_IOT_NET_DNS_CACHE_LIFETIME_SEC 300 ///< Time the addresses resolved for the endpoint are reused by reconnects before it is resolved again
+#define AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS 250 ///< Time a connection attempt to one address of the endpoint is given before the next address is tried alongside it
 
 #endif /* IOT_TESTS_UNIT_CONFIG_H_ */
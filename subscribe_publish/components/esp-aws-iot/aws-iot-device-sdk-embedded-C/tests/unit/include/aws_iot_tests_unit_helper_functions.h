@@ -55,10 +55,17 @@ void setTLSRxBufferForConnack(IoT_Client_Connect_Params *params, unsigned char s
 
 void setTLSRxBufferForPuback(void);
 
+void setTLSRxBufferForPubackWithId(uint16_t packetId);
+
 void setTLSRxBufferForSuback(char *topicName, size_t topicNameLen, QoS qos, IoT_Publish_Message_Params params);
 
 void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos, IoT_Publish_Message_Params params);
 
+void setTLSRxBufferForSubackWithReturnCodes(const unsigned char *pReturnCodes, uint32_t count);
+
+void setTLSRxBufferForConnackAndSubackWithReturnCodes(IoT_Client_Connect_Params *conParams,
+													  const unsigned char *pReturnCodes, uint32_t count);
+
 void setTLSRxBufferForSubFail(void);
 
 void setTLSRxBufferWithMsgOnSubscribedTopic(char *topicName, size_t topicNameLen, QoS qos,
@@ -84,3 +84,15 @@ TEST_GROUP_C_WRAPPER(ConnectTests, cleanSessionInitSubscribers)
 TEST_GROUP_C_WRAPPER(ConnectTests, PowerCycleWithCleanSessionFalse)
 /* B:29 - Reconnect attempt succeeds, but resubscribes fail */
 TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectAndResubscribe)
+/* B:30 - Resubscribe packs topic filters into as few SUBSCRIBE packets as fit in the TX buffer */
+TEST_GROUP_C_WRAPPER(ConnectTests, ResubscribePacksTopicsIntoTxBuffer)
+/* B:31 - Reconnect to a resumed persistent session, subscriptions are not sent again */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectWithSessionPresentSkipsResubscribe)
+/* B:32 - Reconnect to a resumed persistent session, unacknowledged QoS1 publish is replayed with DUP set */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectWithSessionPresentReplaysInflightPublish)
+/* B:33 - Init hands the cipher suite and curve policy to the network layer */
+TEST_GROUP_C_WRAPPER(ConnectTests, InitPassesHandshakePolicy)
+/* B:34 - Reconnect without a persistent session present, unacknowledged QoS1 publish is sent as a new message */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectWithoutSessionPresentRepublishesInflightPublish)
+/* B:35 - Reconnect with a clean session, unacknowledged QoS1 publish is failed instead of sent again */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectWithCleanSessionFailsInflightPublish)
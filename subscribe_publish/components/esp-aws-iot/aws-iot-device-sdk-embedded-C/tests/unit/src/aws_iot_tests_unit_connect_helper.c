@@ -62,6 +62,17 @@ static void iot_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicN
 	}
 }
 
+static uint16_t replayCompletedPacketId;
+static IoT_Error_t replayCompletedStatus;
+
+static void iot_publish_complete_handler(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t status, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pData);
+
+	replayCompletedPacketId = packetId;
+	replayCompletedStatus = status;
+}
+
 TEST_GROUP_C_SETUP(ConnectTests) {
 	unitTestIsMqttConnected = false;
 	( void ) aws_iot_mqtt_disconnect(&iotClient);
@@ -720,6 +731,12 @@ TEST_C(ConnectTests, PowerCycleWithCleanSessionFalse) {
 	IOT_DEBUG("-->Success - B:28 - Connect attempt, power cycle with clean session false \n");
 }
 
+/* Old exponential backoff, keeps the timing of B:29 deterministic */
+static uint32_t iot_tests_unit_doubling_reconnect_policy(void *pPolicyData, uint32_t previousWait_ms) {
+	IOT_UNUSED(pPolicyData);
+	return (0 == previousWait_ms) ? AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL : 2 * previousWait_ms;
+}
+
 /* B:29 - Reconnect attempt succeeds, but resubscribes fail.
  * This test verifies the behaviour that if a subscribe operation fails after
  * connect during the auto-reconnect sequence, the client must not disconnect
@@ -729,7 +746,8 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	int itr = 0;
 	char subTestTopic[12] = { 0 };
 	uint16_t subTestTopicLen = 0;
-	IoT_Publish_Message_Params publish = { 0 };
+	const unsigned char returnCodes[3] = {QOS0, QOS0, QOS0};
+	IoT_Reconnect_Policy doublingPolicy = {iot_tests_unit_doubling_reconnect_policy, NULL};
 
 	IOT_DEBUG("-->Running Connect Tests - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 
@@ -741,6 +759,8 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, true, NULL);
 	rc = aws_iot_mqtt_init(&iotClient, &initParams);
 	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_autoreconnect_set_policy(&iotClient, &doublingPolicy);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
 	ResetTLSBuffer();
 
 	// 2. Establish connection
@@ -770,18 +790,19 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	setTLSRxBufferForConnackAndSuback(&connectParams, 0, "sdk/topic0", 10, QOS0);
 	rc = aws_iot_mqtt_yield(&iotClient, AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
 
-	// 5. Check results of yield call. As only 1 SUBACK was present in the Rx
-	// buffer, 2 resubscribes must fail. Client should be in a pending
+	// 5. Check results of yield call. All 3 topics are resubscribed with a single
+	// SUBSCRIBE, the SUBACK in the Rx buffer only acknowledges 1 of them so the
+	// resubscribe must fail for all 3. Client should be in a pending
 	// resubscribe state and the auto reconnect interval should have doubled.
 	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[0].resubscribed);
 	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[1].resubscribed);
 	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[2].resubscribed);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, aws_iot_mqtt_get_client_state(&iotClient));
 	CHECK_EQUAL_C_INT(2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL, (int) iotClient.clientData.currentReconnectWaitInterval);
 
-	// 6. Add 2 more SUBACKs to the Rx buffer to complete the resubscribe.
-	setTLSRxBufferForDoubleSuback("sdk/topic1", 10, QOS0, publish);
+	// 6. Add a SUBACK for all 3 topics to the Rx buffer to complete the resubscribe.
+	setTLSRxBufferForSubackWithReturnCodes(returnCodes, 3);
 	rc = aws_iot_mqtt_yield(&iotClient, 2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
 	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
@@ -790,3 +811,292 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 
 	IOT_DEBUG("-->Success - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 }
+
+/* B:30 - Resubscribe packs topic filters into as few SUBSCRIBE packets as fit in the TX buffer */
+TEST_C(ConnectTests, ResubscribePacksTopicsIntoTxBuffer) {
+	IoT_Error_t rc = SUCCESS;
+	const unsigned char firstReturnCodes[2] = {QOS0, QOS0};
+	const unsigned char secondReturnCodes[1] = {QOS0};
+	static char resubTopic1[12] = "sdk/topicA";
+	static char resubTopic2[12] = "sdk/topicB";
+	static char resubTopic3[12] = "sdk/topicC";
+
+	IOT_DEBUG("-->Running Connect Tests - B:30 - Resubscribe packs topic filters into the TX buffer \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 500;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferForSuback(resubTopic1, 10, QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, resubTopic1, 10, QOS0, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setTLSRxBufferForSuback(resubTopic2, 10, QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, resubTopic2, 10, QOS0, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setTLSRxBufferForSuback(resubTopic3, 10, QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, resubTopic3, 10, QOS0, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// Room for the fixed header, packet id and two 10 byte topic filters only
+	iotClient.clientData.writeBufSize = 2 + 2 + 2 * (2 + 10 + 1) + 1;
+
+	// Only the SUBACK of the first packet arrives, the second packet times out
+	ResetTLSBuffer();
+	setTLSRxBufferForSubackWithReturnCodes(firstReturnCodes, 2);
+	rc = aws_iot_mqtt_resubscribe(&iotClient);
+	CHECK_C(SUCCESS != rc);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[1].resubscribed);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[2].resubscribed);
+	CHECK_EQUAL_C_STRING(resubTopic1, SecondLastSubscribeMessage);
+	CHECK_EQUAL_C_STRING(resubTopic3, LastSubscribeMessage);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, aws_iot_mqtt_get_client_state(&iotClient));
+
+	// The next attempt only sends the remaining topic filter
+	ResetTLSBuffer();
+	setTLSRxBufferForSubackWithReturnCodes(secondReturnCodes, 1);
+	rc = aws_iot_mqtt_resubscribe(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[2].resubscribed);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - B:30 - Resubscribe packs topic filters into the TX buffer \n");
+}
+
+/* B:31 - Reconnect to a resumed persistent session, subscriptions are not sent again */
+TEST_C(ConnectTests, ReconnectWithSessionPresentSkipsResubscribe) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Connect Tests - B:31 - Reconnect to a resumed session skips resubscribe \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = false;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(false == aws_iot_mqtt_is_session_present(&iotClient));
+
+	setTLSRxBufferForSuback(subTopic1, strlen(subTopic1), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic1, (uint16_t) strlen(subTopic1), QOS0,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// Only a CONNACK with session present is available, a SUBSCRIBE would time out
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 1, 0);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+	CHECK_C(true == aws_iot_mqtt_is_session_present(&iotClient));
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	// The last packet sent is the CONNECT
+	CHECK_EQUAL_C_INT(0x10, TxBuf[0]);
+
+	IOT_DEBUG("-->Success - B:31 - Reconnect to a resumed session skips resubscribe \n");
+}
+
+/* B:32 - Reconnect to a resumed persistent session, unacknowledged QoS1 publish is replayed with DUP set */
+TEST_C(ConnectTests, ReconnectWithSessionPresentReplaysInflightPublish) {
+	IoT_Error_t rc = SUCCESS;
+	uint16_t packetId;
+	size_t packetIdOffset;
+
+	IOT_DEBUG("-->Running Connect Tests - B:32 - Reconnect to a resumed session replays in-flight publish \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = false;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.isDup = 0;
+	testPubMsgParams.payload = (void *) "replay";
+	testPubMsgParams.payloadLen = 6;
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic2, (uint16_t) strlen(subTopic2), &testPubMsgParams,
+									iot_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	packetId = testPubMsgParams.id;
+
+	// The PUBACK is lost with the connection, the message is kept for the session
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_mqtt_internal_expire_inflight_publishes(&iotClient);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 1, 0);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+
+	// PUBLISH, DUP, QoS1 with the original packet id
+	CHECK_EQUAL_C_INT(0x3A, TxBuf[0]);
+	packetIdOffset = 2 + 2 + strlen(subTopic2);
+	CHECK_EQUAL_C_INT(packetId, (TxBuf[packetIdOffset] << 8) | TxBuf[packetIdOffset + 1]);
+	CHECK_EQUAL_C_STRING("replay", LastPublishMessagePayload);
+
+	replayCompletedPacketId = 0;
+	replayCompletedStatus = FAILURE;
+	setTLSRxBufferForPubackWithId(packetId);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(packetId, replayCompletedPacketId);
+	CHECK_EQUAL_C_INT(SUCCESS, replayCompletedStatus);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - B:32 - Reconnect to a resumed session replays in-flight publish \n");
+}
+
+/* B:33 - Init hands the cipher suite and curve policy to the network layer */
+TEST_C(ConnectTests, InitPassesHandshakePolicy) {
+	/* TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, P-256 */
+	static const int cipherSuites[] = { 0xC02B, 0 };
+	static const uint16_t curves[] = { 23, 0 };
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Connect Tests - B:33 - Init hands the handshake policy to the network layer \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(NULL == iotClient.networkStack.tlsConnectParams.pCipherSuites);
+	CHECK_C(NULL == iotClient.networkStack.tlsConnectParams.pCurves);
+
+	initParams.pTlsCipherSuites = cipherSuites;
+	initParams.pTlsCurves = curves;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(cipherSuites == iotClient.networkStack.tlsConnectParams.pCipherSuites);
+	CHECK_C(curves == iotClient.networkStack.tlsConnectParams.pCurves);
+
+	IOT_DEBUG("-->Success - B:33 - Init hands the handshake policy to the network layer \n");
+}
+
+/* B:34 - Reconnect without a persistent session present, unacknowledged QoS1 publish is sent as a new message */
+TEST_C(ConnectTests, ReconnectWithoutSessionPresentRepublishesInflightPublish) {
+	IoT_Error_t rc = SUCCESS;
+	uint16_t packetId;
+	size_t packetIdOffset;
+
+	IOT_DEBUG("-->Running Connect Tests - B:34 - Reconnect to a new session republishes in-flight publish \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = false;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.isDup = 0;
+	testPubMsgParams.payload = (void *) "replay";
+	testPubMsgParams.payloadLen = 6;
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic2, (uint16_t) strlen(subTopic2), &testPubMsgParams,
+									iot_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	packetId = testPubMsgParams.id;
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+
+	// The server lost the session, the message is unknown to it
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+	CHECK_C(!iotClient.clientStatus.isSessionPresent);
+
+	// PUBLISH, QoS1 without DUP
+	CHECK_EQUAL_C_INT(0x32, TxBuf[0]);
+	packetIdOffset = 2 + 2 + strlen(subTopic2);
+	CHECK_EQUAL_C_INT(packetId, (TxBuf[packetIdOffset] << 8) | TxBuf[packetIdOffset + 1]);
+	CHECK_EQUAL_C_STRING("replay", LastPublishMessagePayload);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+
+	replayCompletedPacketId = 0;
+	replayCompletedStatus = FAILURE;
+	setTLSRxBufferForPubackWithId(packetId);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(packetId, replayCompletedPacketId);
+	CHECK_EQUAL_C_INT(SUCCESS, replayCompletedStatus);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - B:34 - Reconnect to a new session republishes in-flight publish \n");
+}
+
+/* B:35 - Reconnect with a clean session, unacknowledged QoS1 publish is failed instead of sent again */
+TEST_C(ConnectTests, ReconnectWithCleanSessionFailsInflightPublish) {
+	IoT_Error_t rc = SUCCESS;
+	uint16_t packetId;
+
+	IOT_DEBUG("-->Running Connect Tests - B:35 - Reconnect with a clean session fails in-flight publish \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = true;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.isDup = 0;
+	testPubMsgParams.payload = (void *) "replay";
+	testPubMsgParams.payloadLen = 6;
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic2, (uint16_t) strlen(subTopic2), &testPubMsgParams,
+									iot_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	packetId = testPubMsgParams.id;
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+
+	replayCompletedPacketId = 0;
+	replayCompletedStatus = FAILURE;
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+
+	// The last packet sent is the CONNECT, the message is handed back to its owner
+	CHECK_EQUAL_C_INT(0x10, TxBuf[0]);
+	CHECK_EQUAL_C_INT(packetId, replayCompletedPacketId);
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, replayCompletedStatus);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - B:35 - Reconnect with a clean session fails in-flight publish \n");
+}
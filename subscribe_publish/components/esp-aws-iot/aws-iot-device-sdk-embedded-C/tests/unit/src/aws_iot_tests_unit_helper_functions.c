@@ -55,6 +55,8 @@ void InitMQTTParamsSetup(IoT_Client_Init_Params *params, char *pHost, uint16_t p
 	params->disconnectHandler = disconnectHandler;
 	params->disconnectHandlerData = NULL;
 	params->isSSLHostnameVerify = true;
+	params->pTlsCipherSuites = NULL;
+	params->pTlsCurves = NULL;
 	params->pDeviceCertLocation = AWS_IOT_ROOT_CA_FILENAME;
 	params->pDevicePrivateKeyLocation = AWS_IOT_CERTIFICATE_FILENAME;
 	params->pRootCALocation = AWS_IOT_PRIVATE_KEY_FILENAME;
@@ -169,6 +171,12 @@ void setTLSRxBufferForPuback(void) {
 	RxBuffer.NoMsgFlag = false;
 }
 
+void setTLSRxBufferForPubackWithId(uint16_t packetId) {
+	setTLSRxBufferForPuback();
+	RxBuffer.pBuffer[2] = (unsigned char) (packetId >> 8);
+	RxBuffer.pBuffer[3] = (unsigned char) (packetId & 0xFF);
+}
+
 void setTLSRxBufferForSubFail(void) {
 	RxBuffer.NoMsgFlag = false;
 	RxBuffer.pBuffer[0] = (unsigned char) (0x90);
@@ -209,6 +217,43 @@ void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos
 	RxIndex = 0;
 }
 
+void setTLSRxBufferForSubackWithReturnCodes(const unsigned char *pReturnCodes, uint32_t count) {
+	uint32_t i;
+
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[0] = (unsigned char) (0x90);
+	RxBuffer.pBuffer[1] = (unsigned char) (0x2 + count);
+	// Variable header - packet identifier
+	RxBuffer.pBuffer[2] = (unsigned char) (2);
+	RxBuffer.pBuffer[3] = (unsigned char) (0);
+	// payload, one return code per topic filter
+	for(i = 0; i < count; i++) {
+		RxBuffer.pBuffer[4 + i] = pReturnCodes[i];
+	}
+
+	RxBuffer.len = 4 + count;
+	RxIndex = 0;
+}
+
+void setTLSRxBufferForConnackAndSubackWithReturnCodes(IoT_Client_Connect_Params *conParams,
+													  const unsigned char *pReturnCodes, uint32_t count) {
+	uint32_t i;
+
+	setTLSRxBufferForConnack(conParams, 0, 0);
+
+	RxBuffer.pBuffer[CONNACK_PACKET_SIZE] = (unsigned char) (0x90);
+	RxBuffer.pBuffer[CONNACK_PACKET_SIZE + 1] = (unsigned char) (0x2 + count);
+	// Variable header - packet identifier
+	RxBuffer.pBuffer[CONNACK_PACKET_SIZE + 2] = (unsigned char) (2);
+	RxBuffer.pBuffer[CONNACK_PACKET_SIZE + 3] = (unsigned char) (0);
+	// payload, one return code per topic filter
+	for(i = 0; i < count; i++) {
+		RxBuffer.pBuffer[CONNACK_PACKET_SIZE + 4 + i] = pReturnCodes[i];
+	}
+
+	RxBuffer.len = CONNACK_PACKET_SIZE + 4 + count;
+}
+
 void setTLSRxBufferForSuback(char *topicName, size_t topicNameLen, QoS qos, IoT_Publish_Message_Params params) {
 	IOT_UNUSED(topicName);
 	IOT_UNUSED(topicNameLen);
@@ -271,6 +316,7 @@ void ResetTLSBuffer(void) {
 	for(i = 0; i < TxBuffer.BufMaxSize; i++) {
 		TxBuffer.pBuffer[i] = 0;
 	}
+	lastPublishMessagePayloadPending = 0;
 }
 
 void setTLSRxBufferDelay(int seconds, int microseconds) {
@@ -321,7 +367,7 @@ void setTLSRxBufferWithMsgOnSubscribedTopic(char *topicName, size_t topicNameLen
 		RxBuffer.pBuffer[payloadStartLoc + i] = (unsigned char) pMsg[i];
 	}
 
-	RxBuffer.len = VariableLen + PayloadLen + 2; // 2 for fixed header
+	RxBuffer.len = VarHeaderStartLoc + 1 + VariableLen + PayloadLen; // fixed header is 1 byte plus the remaining length
 	RxIndex = 0;
 	//printBuffer(RxBuffer.pBuffer, RxBuffer.len);
 }
@@ -89,3 +89,5 @@ TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitLargeInteger)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnNegativeInteger)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnBoolean)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnString)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParseValuesBoundedByToken)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParseLongestFixedNotationValues)
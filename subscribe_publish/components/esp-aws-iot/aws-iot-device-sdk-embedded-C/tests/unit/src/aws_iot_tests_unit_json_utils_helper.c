@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <float.h>
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_json_utils.h"
@@ -832,3 +833,60 @@ TEST_C(JsonUtils, ParseUnsignedInteger8bitErrorOnString) {
 	CHECK_EQUAL_C_INT(3, r);
 	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, rc);
 }
+
+/* Only the bytes covered by the token are read, the document does not have to end after the value */
+TEST_C(JsonUtils, ParseValuesBoundedByToken) {
+	const char json[] = {'1', '2', '3', '4', '5', 't', 'r', 'u', 'e', 'x'};
+	jsmntok_t token;
+	uint32_t parsedInteger;
+	double parsedDouble;
+	bool parsedBool;
+
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse values bounded by their token \n");
+
+	memset(&token, 0, sizeof(token));
+	token.type = JSMN_PRIMITIVE;
+	token.end = 2;
+	rc = parseUnsignedInteger32Value(&parsedInteger, json, &token);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(12, parsedInteger);
+
+	token.end = 4;
+	rc = parseDoubleValue(&parsedDouble, json, &token);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_REAL(1234.0, parsedDouble, 0.0);
+
+	token.start = 5;
+	token.end = 9;
+	rc = parseBooleanValue(&parsedBool, json, &token);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, (int) parsedBool);
+
+	token.end = 10;
+	rc = parseBooleanValue(&parsedBool, json, &token);
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, rc);
+}
+
+TEST_C(JsonUtils, ParseLongestFixedNotationValues) {
+	int r;
+	char json[400];
+	double parsedDouble;
+	float parsedFloat;
+
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse the longest values written with %%f \n");
+
+	snprintf(json, sizeof(json), "{\"x\":%lf}", -DBL_MAX);
+	r = jsmn_parse(&test_parser, json, strlen(json), t, sizeof(t) / sizeof(t[0]));
+	CHECK_EQUAL_C_INT(3, r);
+	rc = parseDoubleValue(&parsedDouble, json, t + 2);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_REAL(-DBL_MAX, parsedDouble, 0.0);
+
+	snprintf(json, sizeof(json), "{\"x\":%f}", -FLT_MAX);
+	jsmn_init(&test_parser);
+	r = jsmn_parse(&test_parser, json, strlen(json), t, sizeof(t) / sizeof(t[0]));
+	CHECK_EQUAL_C_INT(3, r);
+	rc = parseFloatValue(&parsedFloat, json, t + 2);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_REAL(-FLT_MAX, parsedFloat, 0.0);
+}
@@ -0,0 +1,36 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_network_connect.cpp
+ * @brief IoT Client Unit Testing - Network Connect Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(NetworkConnect) {
+  TEST_GROUP_C_SETUP_WRAPPER(NetworkConnect)
+  TEST_GROUP_C_TEARDOWN_WRAPPER(NetworkConnect)
+};
+
+TEST_GROUP_C_WRAPPER(NetworkConnect, ConnectToLocalListener)
+TEST_GROUP_C_WRAPPER(NetworkConnect, ReconnectUsesCachedAddresses)
+TEST_GROUP_C_WRAPPER(NetworkConnect, ExpiredAddressesAreResolvedAgain)
+TEST_GROUP_C_WRAPPER(NetworkConnect, PreferredAddressIsTriedFirst)
+TEST_GROUP_C_WRAPPER(NetworkConnect, RefusedAddressIsSkipped)
+TEST_GROUP_C_WRAPPER(NetworkConnect, SlowAddressDoesNotHoldUpOthers)
+TEST_GROUP_C_WRAPPER(NetworkConnect, AllAddressesRefusedEmptiesCache)
+TEST_GROUP_C_WRAPPER(NetworkConnect, UnknownHost)
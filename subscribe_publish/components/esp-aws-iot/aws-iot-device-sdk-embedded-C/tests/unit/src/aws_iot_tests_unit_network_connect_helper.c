@@ -0,0 +1,305 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_network_connect_helper.c
+ * @brief IoT Client Unit Testing - Network Connect Tests helper
+ */
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "network_connect.h"
+
+#define MAX_TEST_LISTENERS 4
+
+static const char *pLocalHost = "127.0.0.1";
+
+static NetworkAddressCache cache;
+static int listenFds[MAX_TEST_LISTENERS];
+static int listenCount;
+static int clientFd;
+
+/* Listening socket on the loopback, non-blocking so tests can check where connections arrived */
+static int openListener(int backlog, uint16_t *pPort) {
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(fd, (struct sockaddr *) &address, sizeof(address));
+	getsockname(fd, (struct sockaddr *) &address, &addressLength);
+	listen(fd, backlog);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+	*pPort = ntohs(address.sin_port);
+	listenFds[listenCount++] = fd;
+	return fd;
+}
+
+/* Port on the loopback where connections are refused */
+static uint16_t closedPort(void) {
+	uint16_t port;
+	int fd = openListener(1, &port);
+
+	close(fd);
+	listenFds[--listenCount] = -1;
+	return port;
+}
+
+static bool acceptConnection(int listenFd) {
+	int fd = accept(listenFd, NULL, NULL);
+
+	if(0 > fd) {
+		return false;
+	}
+	close(fd);
+	return true;
+}
+
+/* Fill the cache as if pLocalHost had resolved to loopback addresses on these ports */
+static void cacheLocalAddresses(const uint16_t *pPorts, uint8_t count) {
+	struct sockaddr_in *pAddress;
+	uint8_t i;
+
+	network_address_cache_init(&cache);
+	for(i = 0; i < count; i++) {
+		pAddress = (struct sockaddr_in *) &(cache.addresses[i].address);
+		memset(&(cache.addresses[i].address), 0, sizeof(cache.addresses[i].address));
+		pAddress->sin_family = AF_INET;
+		pAddress->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		pAddress->sin_port = htons(pPorts[i]);
+		cache.addresses[i].addressLength = sizeof(struct sockaddr_in);
+	}
+	cache.addressCount = count;
+	cache.pHost = pLocalHost;
+	cache.port = pPorts[0];
+	countdown_sec(&(cache.expiry), 60);
+}
+
+static uint16_t cachedPort(uint8_t index) {
+	return ntohs(((struct sockaddr_in *) &(cache.addresses[index].address))->sin_port);
+}
+
+static long elapsedMs(const struct timeval *pStart) {
+	struct timeval now, diff;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, pStart, &diff);
+	return diff.tv_sec * 1000 + diff.tv_usec / 1000;
+}
+
+TEST_GROUP_C_SETUP(NetworkConnect) {
+	uint8_t i;
+
+	network_address_cache_init(&cache);
+	for(i = 0; i < MAX_TEST_LISTENERS; i++) {
+		listenFds[i] = -1;
+	}
+	listenCount = 0;
+	clientFd = -1;
+}
+
+TEST_GROUP_C_TEARDOWN(NetworkConnect) {
+	uint8_t i;
+
+	for(i = 0; i < MAX_TEST_LISTENERS; i++) {
+		if(-1 != listenFds[i]) {
+			close(listenFds[i]);
+		}
+	}
+	if(-1 != clientFd) {
+		close(clientFd);
+	}
+}
+
+TEST_C(NetworkConnect, ConnectToLocalListener) {
+	IoT_Error_t rc;
+	uint16_t port;
+	int listenFd;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Connect to local listener \n");
+
+	listenFd = openListener(4, &port);
+	rc = network_connect(&cache, pLocalHost, port, 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	CHECK_EQUAL_C_INT(0, fcntl(clientFd, F_GETFL, 0) & O_NONBLOCK);
+	CHECK_C(pLocalHost == cache.pHost);
+	CHECK_EQUAL_C_INT(1, cache.addressCount);
+	CHECK_EQUAL_C_INT(port, cachedPort(0));
+}
+
+TEST_C(NetworkConnect, ReconnectUsesCachedAddresses) {
+	IoT_Error_t rc;
+	uint16_t port, otherPort;
+	int listenFd, otherListenFd;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Reconnect uses the cached addresses \n");
+
+	listenFd = openListener(4, &port);
+	otherListenFd = openListener(4, &otherPort);
+	rc = network_connect(&cache, pLocalHost, port, 1000, &clientFd);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	close(clientFd);
+
+	/* Only the cache knows about the other listener, the resolver would give the first one */
+	((struct sockaddr_in *) &(cache.addresses[0].address))->sin_port = htons(otherPort);
+	rc = network_connect(&cache, pLocalHost, port, 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(otherListenFd));
+	CHECK_C(!acceptConnection(listenFd));
+}
+
+TEST_C(NetworkConnect, ExpiredAddressesAreResolvedAgain) {
+	IoT_Error_t rc;
+	uint16_t port, otherPort;
+	int listenFd, otherListenFd;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Expired addresses are resolved again \n");
+
+	listenFd = openListener(4, &port);
+	otherListenFd = openListener(4, &otherPort);
+	rc = network_connect(&cache, pLocalHost, port, 1000, &clientFd);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	close(clientFd);
+
+	((struct sockaddr_in *) &(cache.addresses[0].address))->sin_port = htons(otherPort);
+	init_timer(&(cache.expiry));
+	rc = network_connect(&cache, pLocalHost, port, 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	CHECK_C(!acceptConnection(otherListenFd));
+	CHECK_EQUAL_C_INT(port, cachedPort(0));
+}
+
+TEST_C(NetworkConnect, PreferredAddressIsTriedFirst) {
+	IoT_Error_t rc;
+	uint16_t ports[2];
+	int listenFd, preferredListenFd;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Preferred address is tried first \n");
+
+	listenFd = openListener(4, &ports[0]);
+	preferredListenFd = openListener(4, &ports[1]);
+	cacheLocalAddresses(ports, 2);
+	cache.preferredIndex = 1;
+	rc = network_connect(&cache, pLocalHost, ports[0], 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(preferredListenFd));
+	CHECK_C(!acceptConnection(listenFd));
+	CHECK_EQUAL_C_INT(1, cache.preferredIndex);
+}
+
+TEST_C(NetworkConnect, RefusedAddressIsSkipped) {
+	IoT_Error_t rc;
+	uint16_t ports[2];
+	int listenFd;
+	struct timeval start;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Refused address is skipped \n");
+
+	ports[0] = closedPort();
+	listenFd = openListener(4, &ports[1]);
+	cacheLocalAddresses(ports, 2);
+	gettimeofday(&start, NULL);
+	rc = network_connect(&cache, pLocalHost, ports[0], 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	CHECK_EQUAL_C_INT(1, cache.preferredIndex);
+	/* The next address does not wait for the attempt delay when the previous one is refused */
+	CHECK_C(elapsedMs(&start) < AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS);
+}
+
+TEST_C(NetworkConnect, SlowAddressDoesNotHoldUpOthers) {
+	IoT_Error_t rc;
+	uint16_t ports[2];
+	struct sockaddr_in slowAddress;
+	struct timeval start;
+	int listenFd, queuedFd;
+	long elapsed;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Slow address does not hold up the others \n");
+
+	/* A listener with a full accept queue drops further SYNs, so connecting to it hangs */
+	openListener(0, &ports[0]);
+	memset(&slowAddress, 0, sizeof(slowAddress));
+	slowAddress.sin_family = AF_INET;
+	slowAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	slowAddress.sin_port = htons(ports[0]);
+	queuedFd = socket(AF_INET, SOCK_STREAM, 0);
+	connect(queuedFd, (struct sockaddr *) &slowAddress, sizeof(slowAddress));
+	listenFds[listenCount++] = queuedFd;
+
+	listenFd = openListener(4, &ports[1]);
+	cacheLocalAddresses(ports, 2);
+	gettimeofday(&start, NULL);
+	rc = network_connect(&cache, pLocalHost, ports[0], 5000, &clientFd);
+	elapsed = elapsedMs(&start);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(acceptConnection(listenFd));
+	CHECK_EQUAL_C_INT(1, cache.preferredIndex);
+	CHECK_C(elapsed >= AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS - 10);
+	CHECK_C(elapsed < 1000);
+}
+
+TEST_C(NetworkConnect, AllAddressesRefusedEmptiesCache) {
+	IoT_Error_t rc;
+	uint16_t ports[2];
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - All addresses refused empties the cache \n");
+
+	ports[0] = closedPort();
+	ports[1] = closedPort();
+	cacheLocalAddresses(ports, 2);
+	rc = network_connect(&cache, pLocalHost, ports[0], 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(NETWORK_ERR_NET_CONNECT_FAILED, rc);
+	CHECK_EQUAL_C_INT(-1, clientFd);
+	CHECK_C(NULL == cache.pHost);
+	CHECK_EQUAL_C_INT(0, cache.addressCount);
+}
+
+TEST_C(NetworkConnect, UnknownHost) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Network Connect Tests - Unknown host \n");
+
+	rc = network_connect(&cache, "unknown.invalid", 8883, 1000, &clientFd);
+
+	CHECK_EQUAL_C_INT(NETWORK_ERR_NET_UNKNOWN_HOST, rc);
+	CHECK_EQUAL_C_INT(-1, clientFd);
+	CHECK_C(NULL == cache.pHost);
+}
@@ -0,0 +1,204 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_network_ktls_helper.c
+ * @brief IoT Client Unit Testing - Kernel TLS Tests helper
+ */
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "network_ktls.h"
+
+static const unsigned char clientKey[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+static const unsigned char serverKey[16] = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+static const unsigned char clientSalt[NETWORK_KTLS_SALT_LEN] = {0xC1, 0xC2, 0xC3, 0xC4};
+static const unsigned char serverSalt[NETWORK_KTLS_SALT_LEN] = {0x51, 0x52, 0x53, 0x54};
+static const unsigned char firstSequence[NETWORK_KTLS_SEQUENCE_LEN] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static int clientFd;
+static int serverFd;
+
+/* Connected pair of TCP sockets on the loopback */
+static void openLoopbackPair(void) {
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	int listenFd;
+
+	listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(listenFd, (struct sockaddr *) &address, sizeof(address));
+	getsockname(listenFd, (struct sockaddr *) &address, &addressLength);
+	listen(listenFd, 1);
+
+	clientFd = socket(AF_INET, SOCK_STREAM, 0);
+	connect(clientFd, (struct sockaddr *) &address, sizeof(address));
+	serverFd = accept(listenFd, NULL, NULL);
+	close(listenFd);
+}
+
+TEST_GROUP_C_SETUP(KernelTls) {
+	openLoopbackPair();
+}
+
+TEST_GROUP_C_TEARDOWN(KernelTls) {
+	close(clientFd);
+	close(serverFd);
+}
+
+TEST_C(KernelTls, RecvTimesOutWithoutData) {
+	unsigned char buffer[16];
+	size_t readLen = 1;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Receive times out without data \n");
+
+	rc = network_ktls_recv(clientFd, buffer, sizeof(buffer), 20, &readLen);
+
+	CHECK_EQUAL_C_INT(NETWORK_SSL_NOTHING_TO_READ, rc);
+	CHECK_EQUAL_C_INT(0, readLen);
+}
+
+TEST_C(KernelTls, RecvReportsClosedConnection) {
+	unsigned char buffer[16];
+	size_t readLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Receive reports a closed connection \n");
+
+	close(serverFd);
+	serverFd = socket(AF_INET, SOCK_STREAM, 0);
+	rc = network_ktls_recv(clientFd, buffer, sizeof(buffer), 1000, &readLen);
+
+	CHECK_EQUAL_C_INT(NETWORK_SSL_READ_ERROR, rc);
+}
+
+TEST_C(KernelTls, SendGathersSegments) {
+	const char *pHeader = "head";
+	const char *pPayload = "payload";
+	struct iovec segments[3];
+	unsigned char buffer[32];
+	size_t sentLen, readLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Send gathers the segments \n");
+
+	segments[0].iov_base = (void *) pHeader;
+	segments[0].iov_len = strlen(pHeader);
+	segments[1].iov_base = NULL;
+	segments[1].iov_len = 0;
+	segments[2].iov_base = (void *) pPayload;
+	segments[2].iov_len = strlen(pPayload);
+	rc = network_ktls_send(clientFd, segments, 3, 100, &sentLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(11, sentLen);
+
+	rc = network_ktls_recv(serverFd, buffer, sizeof(buffer), 1000, &readLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(11, readLen);
+	CHECK_C(0 == memcmp("headpayload", buffer, 11));
+}
+
+TEST_C(KernelTls, SendTimesOutOnFullSocket) {
+	static unsigned char payload[1024 * 1024];
+	int bufferSize = 4096;
+	struct iovec segment;
+	size_t sentLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Send times out on a full socket \n");
+
+	/* The server does not read, so more than the socket buffers can hold is never accepted */
+	setsockopt(clientFd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+	setsockopt(serverFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+	fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL, 0) | O_NONBLOCK);
+	segment.iov_base = payload;
+	segment.iov_len = sizeof(payload);
+	rc = network_ktls_send(clientFd, &segment, 1, 50, &sentLen);
+
+	CHECK_EQUAL_C_INT(NETWORK_SSL_WRITE_TIMEOUT_ERROR, rc);
+	CHECK_C(0 < sentLen);
+	CHECK_C(sizeof(payload) > sentLen);
+}
+
+TEST_C(KernelTls, SetKeyRejectsNull) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Set key rejects NULL \n");
+
+	rc = network_ktls_set_key(clientFd, true, NETWORK_KTLS_AES_128_GCM, NULL, clientSalt, firstSequence);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = network_ktls_set_key(clientFd, true, NETWORK_KTLS_AES_128_GCM, clientKey, NULL, firstSequence);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = network_ktls_set_key(clientFd, true, NETWORK_KTLS_AES_128_GCM, clientKey, clientSalt, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+}
+
+TEST_C(KernelTls, OffloadedRecordsOrPlainFallback) {
+	unsigned char buffer[32];
+	size_t sentLen, readLen;
+	struct iovec segment;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("\n-->Running Kernel TLS Tests - Offloaded records, or plain TCP without kernel support \n");
+
+	segment.iov_base = (void *) "offloaded";
+	segment.iov_len = 9;
+
+	if(SUCCESS != network_ktls_attach(clientFd)) {
+		/* The socket is left usable for the TLS library to go on with */
+		rc = network_ktls_send(clientFd, &segment, 1, 100, &sentLen);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		rc = network_ktls_recv(serverFd, buffer, sizeof(buffer), 1000, &readLen);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		CHECK_EQUAL_C_INT(9, readLen);
+		return;
+	}
+
+	/* Both ends offloaded with matching keys, as after a handshake */
+	CHECK_EQUAL_C_INT(SUCCESS, network_ktls_attach(serverFd));
+	CHECK_EQUAL_C_INT(SUCCESS, network_ktls_set_key(clientFd, true, NETWORK_KTLS_AES_128_GCM, clientKey, clientSalt,
+													firstSequence));
+	CHECK_EQUAL_C_INT(SUCCESS, network_ktls_set_key(clientFd, false, NETWORK_KTLS_AES_128_GCM, serverKey, serverSalt,
+													firstSequence));
+	CHECK_EQUAL_C_INT(SUCCESS, network_ktls_set_key(serverFd, true, NETWORK_KTLS_AES_128_GCM, serverKey, serverSalt,
+													firstSequence));
+	CHECK_EQUAL_C_INT(SUCCESS, network_ktls_set_key(serverFd, false, NETWORK_KTLS_AES_128_GCM, clientKey, clientSalt,
+													firstSequence));
+
+	rc = network_ktls_send(clientFd, &segment, 1, 100, &sentLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = network_ktls_recv(serverFd, buffer, sizeof(buffer), 1000, &readLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(9, readLen);
+	CHECK_C(0 == memcmp("offloaded", buffer, 9));
+
+	/* An alert ends the connection for the receiver */
+	rc = network_ktls_send_alert(serverFd, NETWORK_KTLS_ALERT_LEVEL_WARNING, NETWORK_KTLS_ALERT_CLOSE_NOTIFY);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = network_ktls_recv(clientFd, buffer, sizeof(buffer), 1000, &readLen);
+	CHECK_EQUAL_C_INT(NETWORK_SSL_READ_ERROR, rc);
+}
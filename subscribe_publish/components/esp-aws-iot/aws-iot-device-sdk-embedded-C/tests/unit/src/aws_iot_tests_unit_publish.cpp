@@ -46,3 +46,37 @@ TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success10msDelayedPuback)
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS0NoPubackSuccess)
 /* E:10 - Publish with QoS1 send success, Puback received */
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success)
+/* E:11 - Async publish with Null/empty parameters */
+TEST_GROUP_C_WRAPPER(PublishTests, publishAsyncNullParams)
+/* E:12 - Async publish QoS1, Puback completes the message from yield */
+TEST_GROUP_C_WRAPPER(PublishTests, publishAsyncQoS1PubackCompletes)
+/* E:13 - Async publish QoS1, in-flight window full */
+TEST_GROUP_C_WRAPPER(PublishTests, publishAsyncQoS1WindowFull)
+/* E:14 - Async publish QoS1, Puback not received before command timeout */
+TEST_GROUP_C_WRAPPER(PublishTests, publishAsyncQoS1Timeout)
+/* E:15 - Publish QoS0 with a payload larger than the TX buffer, success */
+TEST_GROUP_C_WRAPPER(PublishTests, publishPayloadLargerThanTxBufferSuccess)
+/* E:16 - Publish with a network layer without writev, payload staged in the TX buffer */
+TEST_GROUP_C_WRAPPER(PublishTests, publishWithoutWritevUsesTxBuffer)
+/* E:17 - Streaming publish with Null/empty parameters */
+TEST_GROUP_C_WRAPPER(PublishTests, publishStreamNullParams)
+/* E:18 - Streaming publish QoS1 with a payload larger than the TX buffer, success */
+TEST_GROUP_C_WRAPPER(PublishTests, publishStreamQoS1LargePayloadSuccess)
+/* E:19 - Streaming publish, payload reader fails part way */
+TEST_GROUP_C_WRAPPER(PublishTests, publishStreamReaderFailure)
+/* E:20 - QoS1 publish while reconnecting is kept in the offline queue */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueuedWhileReconnecting)
+/* E:21 - Offline queue full */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueueFull)
+/* E:22 - Offline queue drained from yield once connected, records released on Puback */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueueDrainedOnYield)
+/* E:23 - Offline queue reloaded from its store */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueueReloadedFromStore)
+/* E:24 - Offline queue message which cannot be sent is dropped and reported */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueueDropReported)
+/* E:25 - Offline queue in a file, reloaded and drained, a torn write keeps the previous queue */
+TEST_GROUP_C_WRAPPER(PublishTests, publishOfflineQueueFileTornWrite)
+/* E:26 - Publish with a payload fitting in the TX buffer is sent in a single write */
+TEST_GROUP_C_WRAPPER(PublishTests, publishSmallPayloadSingleWrite)
+/* E:27 - Async publish QoS1 expiring while reconnecting, the client stays disconnected */
+TEST_GROUP_C_WRAPPER(PublishTests, publishAsyncQoS1TimeoutWhileReconnecting)
@@ -19,11 +19,16 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "byte_store_file.h"
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -35,6 +40,128 @@ static uint16_t subTopicLen = 8;
 static AWS_IoT_Client iotClient;
 char cPayload[100];
 
+static uint16_t completedPacketId;
+static IoT_Error_t completedStatus;
+static uint32_t completedCount;
+static ClientState completedClientState;
+
+static void iot_tests_unit_publish_complete_handler(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t status,
+													void *pData) {
+	IOT_UNUSED(pData);
+
+	completedClientState = aws_iot_mqtt_get_client_state(pClient);
+	completedPacketId = packetId;
+	completedStatus = status;
+	completedCount++;
+}
+
+static uint32_t readerCallCount;
+static size_t readerLargestChunk;
+
+/* Supplies a payload of repeating letters and fails at the offset given in pData, if any */
+static IoT_Error_t iot_tests_unit_publish_payload_reader(AWS_IoT_Client *pClient, unsigned char *pBuffer,
+														 size_t bufferLen, size_t payloadOffset, void *pData) {
+	size_t i;
+
+	IOT_UNUSED(pClient);
+
+	if(NULL != pData && payloadOffset >= *(size_t *) pData) {
+		return FAILURE;
+	}
+
+	for(i = 0; i < bufferLen; i++) {
+		pBuffer[i] = (unsigned char) ('a' + ((payloadOffset + i) % 26));
+	}
+
+	readerCallCount++;
+	if(bufferLen > readerLargestChunk) {
+		readerLargestChunk = bufferLen;
+	}
+
+	return SUCCESS;
+}
+
+static unsigned char offlineQueueBuffer[128];
+static unsigned char offlineQueueStoreMemory[sizeof(offlineQueueBuffer) + 32];
+
+/* Offline queue store backed by a static array, so a queue can be reloaded as if after a reboot */
+static IoT_Error_t iot_tests_unit_offline_store_read(void *pStoreData, size_t offset, unsigned char *pBuffer,
+													 size_t len) {
+	IOT_UNUSED(pStoreData);
+
+	if(offset + len > sizeof(offlineQueueStoreMemory)) {
+		return FAILURE;
+	}
+	memcpy(pBuffer, &offlineQueueStoreMemory[offset], len);
+	return SUCCESS;
+}
+
+static IoT_Error_t iot_tests_unit_offline_store_write(void *pStoreData, size_t offset, const unsigned char *pBuffer,
+													  size_t len) {
+	IOT_UNUSED(pStoreData);
+
+	if(offset + len > sizeof(offlineQueueStoreMemory)) {
+		return FAILURE;
+	}
+	memcpy(&offlineQueueStoreMemory[offset], pBuffer, len);
+	return SUCCESS;
+}
+
+static uint32_t droppedCount;
+static IoT_Error_t droppedStatus;
+static uint16_t droppedTopicLen;
+
+static void iot_tests_unit_offline_queue_drop_handler(AWS_IoT_Client *pClient, const char *pTopicName,
+													  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+													  IoT_Error_t status, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(pParams);
+	IOT_UNUSED(pData);
+
+	droppedCount++;
+	droppedStatus = status;
+	droppedTopicLen = topicNameLen;
+}
+
+/* File store which stops writing once writeBudget bytes were written, as if power was lost */
+typedef struct {
+	IoT_Byte_Store file;
+	size_t writeBudget;
+} TornOfflineQueueStore;
+
+static IoT_Error_t iot_tests_unit_torn_store_read(void *pStoreData, size_t offset, unsigned char *pBuffer,
+												  size_t len) {
+	TornOfflineQueueStore *pStore = (TornOfflineQueueStore *) pStoreData;
+
+	return pStore->file.read(pStore->file.pStoreData, offset, pBuffer, len);
+}
+
+static IoT_Error_t iot_tests_unit_torn_store_write(void *pStoreData, size_t offset, const unsigned char *pBuffer,
+												   size_t len) {
+	TornOfflineQueueStore *pStore = (TornOfflineQueueStore *) pStoreData;
+	size_t writeLen = (len < pStore->writeBudget) ? len : pStore->writeBudget;
+
+	if(0 != writeLen && SUCCESS != pStore->file.write(pStore->file.pStoreData, offset, pBuffer, writeLen)) {
+		return FAILURE;
+	}
+	pStore->writeBudget -= writeLen;
+
+	return (writeLen == len) ? SUCCESS : FAILURE;
+}
+
+static void iot_tests_unit_offline_queue_setup(void) {
+	IoT_Byte_Store store;
+	IoT_Error_t rc;
+
+	store.read = iot_tests_unit_offline_store_read;
+	store.write = iot_tests_unit_offline_store_write;
+	store.pStoreData = NULL;
+
+	rc = aws_iot_mqtt_offline_queue_init(&iotClient, offlineQueueBuffer, sizeof(offlineQueueBuffer), &store);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
 TEST_GROUP_C_SETUP(PublishTests) {
 	IoT_Error_t rc = SUCCESS;
 	ResetTLSBuffer();
@@ -55,6 +182,17 @@ TEST_GROUP_C_SETUP(PublishTests) {
 	testPubMsgParams.payload = (void *) cPayload;
 	testPubMsgParams.payloadLen = strlen(cPayload);
 
+	completedPacketId = 0;
+	completedStatus = FAILURE;
+	completedCount = 0;
+
+	readerCallCount = 0;
+	readerLargestChunk = 0;
+
+	droppedCount = 0;
+	droppedStatus = SUCCESS;
+	droppedTopicLen = 0;
+
 	ResetTLSBuffer();
 }
 
@@ -203,3 +341,474 @@ TEST_C(PublishTests, publishQoS1Success) {
 
 	IOT_DEBUG("-->Success - E:10 - Publish with QoS1 send success, Puback received \n");
 }
+
+/* E:11 - Async publish with Null/empty parameters */
+TEST_C(PublishTests, publishAsyncNullParams) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:11 - Async publish with Null/empty parameters \n");
+
+	rc = aws_iot_mqtt_publish_async(NULL, subTopic, subTopicLen, &testPubMsgParams, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, NULL, subTopicLen, &testPubMsgParams, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, NULL, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - E:11 - Async publish with Null/empty parameters \n");
+}
+
+/* E:12 - Async publish QoS1, Puback completes the message from yield */
+TEST_C(PublishTests, publishAsyncQoS1PubackCompletes) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:12 - Async publish QoS1, Puback completes the message from yield \n");
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									iot_tests_unit_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+	CHECK_EQUAL_C_INT(0, completedCount);
+
+	setTLSRxBufferForPubackWithId(testPubMsgParams.id);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, completedCount);
+	CHECK_EQUAL_C_INT(SUCCESS, completedStatus);
+	CHECK_EQUAL_C_INT(testPubMsgParams.id, completedPacketId);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - E:12 - Async publish QoS1, Puback completes the message from yield \n");
+}
+
+/* E:13 - Async publish QoS1, in-flight window full */
+TEST_C(PublishTests, publishAsyncQoS1WindowFull) {
+	IoT_Error_t rc = SUCCESS;
+	uint32_t itr;
+
+	IOT_DEBUG("-->Running Publish Tests - E:13 - Async publish QoS1, in-flight window full \n");
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; itr++) {
+		rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+										iot_tests_unit_publish_complete_handler, NULL);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+	}
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									iot_tests_unit_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(MQTT_MAX_INFLIGHT_PUBLISH_REACHED_ERROR, rc);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - E:13 - Async publish QoS1, in-flight window full \n");
+}
+
+/* E:14 - Async publish QoS1, Puback not received before command timeout */
+TEST_C(PublishTests, publishAsyncQoS1Timeout) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:14 - Async publish QoS1, Puback not received before command timeout \n");
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									iot_tests_unit_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_yield(&iotClient, iotClient.clientData.commandTimeoutMs + 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, completedCount);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, completedStatus);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - E:14 - Async publish QoS1, Puback not received before command timeout \n");
+}
+
+/* E:15 - Publish QoS0 with a payload larger than the TX buffer, success */
+TEST_C(PublishTests, publishPayloadLargerThanTxBufferSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	char largePayload[2 * AWS_IOT_MQTT_TX_BUF_LEN];
+
+	IOT_DEBUG("-->Running Publish Tests - E:15 - Publish QoS0 with a payload larger than the TX buffer, success \n");
+
+	memset(largePayload, 'p', sizeof(largePayload) - 1);
+	largePayload[sizeof(largePayload) - 1] = '\0';
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.payload = (void *) largePayload;
+	testPubMsgParams.payloadLen = strlen(largePayload);
+
+	// The payload is written from the application buffer, only the header goes through the TX buffer
+	writevCallCount = 0;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, writevCallCount);
+	CHECK_EQUAL_C_INT(strlen(largePayload), lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_STRING(largePayload, LastPublishMessagePayload);
+
+	IOT_DEBUG("-->Success - E:15 - Publish QoS0 with a payload larger than the TX buffer, success \n");
+}
+
+/* E:16 - Publish with a network layer without writev, payload staged in the TX buffer */
+TEST_C(PublishTests, publishWithoutWritevUsesTxBuffer) {
+	IoT_Error_t rc = SUCCESS;
+	char largePayload[2 * AWS_IOT_MQTT_TX_BUF_LEN];
+
+	IOT_DEBUG("-->Running Publish Tests - E:16 - Publish with a network layer without writev \n");
+
+	iotClient.networkStack.writev = NULL;
+	testPubMsgParams.qos = QOS0;
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(cPayload, LastPublishMessagePayload);
+
+	memset(largePayload, 'p', sizeof(largePayload) - 1);
+	largePayload[sizeof(largePayload) - 1] = '\0';
+	testPubMsgParams.payload = (void *) largePayload;
+	testPubMsgParams.payloadLen = strlen(largePayload);
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+
+	IOT_DEBUG("-->Success - E:16 - Publish with a network layer without writev \n");
+}
+
+/* E:17 - Streaming publish with Null/empty parameters */
+TEST_C(PublishTests, publishStreamNullParams) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:17 - Streaming publish with Null/empty parameters \n");
+
+	rc = aws_iot_mqtt_publish_stream(NULL, subTopic, subTopicLen, &testPubMsgParams,
+									 iot_tests_unit_publish_payload_reader, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_stream(&iotClient, NULL, subTopicLen, &testPubMsgParams,
+									 iot_tests_unit_publish_payload_reader, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_stream(&iotClient, subTopic, subTopicLen, NULL,
+									 iot_tests_unit_publish_payload_reader, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_stream(&iotClient, subTopic, subTopicLen, &testPubMsgParams, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - E:17 - Streaming publish with Null/empty parameters \n");
+}
+
+/* E:18 - Streaming publish QoS1 with a payload larger than the TX buffer, success */
+TEST_C(PublishTests, publishStreamQoS1LargePayloadSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	size_t payloadLen = 3 * AWS_IOT_MQTT_TX_BUF_LEN + 100;
+	size_t i;
+
+	IOT_DEBUG("-->Running Publish Tests - E:18 - Streaming publish QoS1 with a payload larger than the TX buffer \n");
+
+	iotClient.networkStack.writev = NULL;
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.payload = NULL;
+	testPubMsgParams.payloadLen = payloadLen;
+
+	setTLSRxBufferForPuback();
+	rc = aws_iot_mqtt_publish_stream(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									 iot_tests_unit_publish_payload_reader, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(1 < readerCallCount);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_TX_BUF_LEN, readerLargestChunk);
+
+	CHECK_EQUAL_C_STRING(subTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_INT(payloadLen, lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_INT(0, lastPublishMessagePayloadPending);
+	for(i = 0; i < payloadLen; i++) {
+		CHECK_EQUAL_C_CHAR('a' + (i % 26), LastPublishMessagePayload[i]);
+	}
+
+	IOT_DEBUG("-->Success - E:18 - Streaming publish QoS1 with a payload larger than the TX buffer \n");
+}
+
+/* E:19 - Streaming publish, payload reader fails part way */
+TEST_C(PublishTests, publishStreamReaderFailure) {
+	IoT_Error_t rc = SUCCESS;
+	size_t failOffset = AWS_IOT_MQTT_TX_BUF_LEN;
+
+	IOT_DEBUG("-->Running Publish Tests - E:19 - Streaming publish, payload reader fails part way \n");
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.payload = NULL;
+	testPubMsgParams.payloadLen = 2 * AWS_IOT_MQTT_TX_BUF_LEN;
+
+	rc = aws_iot_mqtt_publish_stream(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									 iot_tests_unit_publish_payload_reader, &failOffset);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+	CHECK_EQUAL_C_INT(1, readerCallCount);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_TX_BUF_LEN, lastPublishMessagePayloadLen);
+	// The client stays usable from the API's point of view, the caller is expected to disconnect
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - E:19 - Streaming publish, payload reader fails part way \n");
+}
+
+/* E:20 - QoS1 publish while reconnecting is kept in the offline queue */
+TEST_C(PublishTests, publishOfflineQueuedWhileReconnecting) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:20 - QoS1 publish while reconnecting is kept in the offline queue \n");
+
+	memset(offlineQueueStoreMemory, 0, sizeof(offlineQueueStoreMemory));
+	iot_tests_unit_offline_queue_setup();
+	iotClient.clientStatus.clientState = CLIENT_STATE_PENDING_RECONNECT;
+	lastPublishMessageTopicLen = 0;
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_offline_queue_count(&iotClient));
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+
+	// QoS0 messages are not worth keeping
+	testPubMsgParams.qos = QOS0;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	IOT_DEBUG("-->Success - E:20 - QoS1 publish while reconnecting is kept in the offline queue \n");
+}
+
+/* E:21 - Offline queue full */
+TEST_C(PublishTests, publishOfflineQueueFull) {
+	IoT_Error_t rc = SUCCESS;
+	uint32_t queued = 0;
+
+	IOT_DEBUG("-->Running Publish Tests - E:21 - Offline queue full \n");
+
+	memset(offlineQueueStoreMemory, 0, sizeof(offlineQueueStoreMemory));
+	iot_tests_unit_offline_queue_setup();
+	iotClient.clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+
+	do {
+		rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+		if(SUCCESS == rc) {
+			queued++;
+		}
+	} while(SUCCESS == rc && queued < sizeof(offlineQueueBuffer));
+
+	CHECK_EQUAL_C_INT(MQTT_OFFLINE_QUEUE_FULL_ERROR, rc);
+	CHECK_C(0 < queued);
+	CHECK_EQUAL_C_INT(queued, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	IOT_DEBUG("-->Success - E:21 - Offline queue full \n");
+}
+
+/* E:22 - Offline queue drained from yield once connected, records released on Puback */
+TEST_C(PublishTests, publishOfflineQueueDrainedOnYield) {
+	IoT_Error_t rc = SUCCESS;
+	uint32_t itr;
+
+	IOT_DEBUG("-->Running Publish Tests - E:22 - Offline queue drained from yield once connected \n");
+
+	memset(offlineQueueStoreMemory, 0, sizeof(offlineQueueStoreMemory));
+	iot_tests_unit_offline_queue_setup();
+	iotClient.clientStatus.clientState = CLIENT_STATE_PENDING_RECONNECT;
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	iotClient.clientStatus.clientState = CLIENT_STATE_CONNECTED_IDLE;
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(subTopicLen, lastPublishMessageTopicLen);
+	CHECK_EQUAL_C_INT(0, strncmp(subTopic, LastPublishMessageTopic, subTopicLen));
+	CHECK_EQUAL_C_INT(testPubMsgParams.payloadLen, lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_INT(0, strncmp(cPayload, LastPublishMessagePayload, testPubMsgParams.payloadLen));
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.inflightPublishCount);
+	// Sent but not yet acknowledged, the record stays queued
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; itr++) {
+		if(0 != iotClient.clientData.inflightPublishes[itr].packetId) {
+			setTLSRxBufferForPubackWithId(iotClient.clientData.inflightPublishes[itr].packetId);
+		}
+	}
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	IOT_DEBUG("-->Success - E:22 - Offline queue drained from yield once connected \n");
+}
+
+/* E:23 - Offline queue reloaded from its store */
+TEST_C(PublishTests, publishOfflineQueueReloadedFromStore) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:23 - Offline queue reloaded from its store \n");
+
+	memset(offlineQueueStoreMemory, 0, sizeof(offlineQueueStoreMemory));
+	iot_tests_unit_offline_queue_setup();
+	iotClient.clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// Simulate a restart, the RAM copy is lost and the store is all that remains
+	memset(offlineQueueBuffer, 0, sizeof(offlineQueueBuffer));
+	iotClient.clientData.offlineQueue.pBuffer = NULL;
+	iot_tests_unit_offline_queue_setup();
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	iotClient.clientStatus.clientState = CLIENT_STATE_CONNECTED_IDLE;
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, strncmp(cPayload, LastPublishMessagePayload, testPubMsgParams.payloadLen));
+	CHECK_EQUAL_C_INT(2, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - E:23 - Offline queue reloaded from its store \n");
+}
+
+/* E:24 - Offline queue message which cannot be sent is dropped and reported */
+TEST_C(PublishTests, publishOfflineQueueDropReported) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:24 - Offline queue message which cannot be sent is dropped and reported \n");
+
+	memset(offlineQueueStoreMemory, 0, sizeof(offlineQueueStoreMemory));
+	iot_tests_unit_offline_queue_setup();
+	rc = aws_iot_mqtt_offline_queue_set_drop_handler(&iotClient, iot_tests_unit_offline_queue_drop_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	iotClient.clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	// The PUBLISH header no longer fits the TX buffer, the message can never be sent
+	iotClient.clientData.writeBufSize = subTopicLen;
+	iotClient.clientStatus.clientState = CLIENT_STATE_CONNECTED_IDLE;
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	iotClient.clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, droppedCount);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, droppedStatus);
+	CHECK_EQUAL_C_INT(subTopicLen, droppedTopicLen);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	IOT_DEBUG("-->Success - E:24 - Offline queue message which cannot be sent is dropped and reported \n");
+}
+
+/* E:25 - Offline queue in a file, reloaded and drained, a torn write keeps the previous queue */
+TEST_C(PublishTests, publishOfflineQueueFileTornWrite) {
+	char path[] = "/tmp/aws_iot_offline_queue_XXXXXX";
+	IoT_Publish_Message_Params params = testPubMsgParams;
+	TornOfflineQueueStore tornStore;
+	IoT_Byte_Store store;
+	ByteStoreFile file;
+	unsigned char garbage = 0xFF;
+	IoT_Error_t rc = SUCCESS;
+	int fd;
+
+	IOT_DEBUG("-->Running Publish Tests - E:25 - Offline queue in a file, reloaded and drained, torn write \n");
+
+	fd = mkstemp(path);
+	CHECK_C(0 <= fd);
+	close(fd);
+
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_open(&file, path, &(tornStore.file)));
+	tornStore.writeBudget = (size_t) -1;
+	store.read = iot_tests_unit_torn_store_read;
+	store.write = iot_tests_unit_torn_store_write;
+	store.pStoreData = &tornStore;
+	rc = aws_iot_mqtt_offline_queue_init(&iotClient, offlineQueueBuffer, sizeof(offlineQueueBuffer), &store);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	iotClient.clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+
+	params.payload = "first";
+	params.payloadLen = 5;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &params));
+	params.payload = "second";
+	params.payloadLen = 6;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &params));
+
+	// Power is lost part way through the third record, before the position is written
+	tornStore.writeBudget = 5;
+	params.payload = "third";
+	params.payloadLen = 5;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &params);
+	CHECK_C(SUCCESS != rc);
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_close(&file));
+
+	// Restart from the file alone
+	memset(offlineQueueBuffer, 0, sizeof(offlineQueueBuffer));
+	iotClient.clientData.offlineQueue.pBuffer = NULL;
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_open(&file, path, &store));
+	rc = aws_iot_mqtt_offline_queue_init(&iotClient, offlineQueueBuffer, sizeof(offlineQueueBuffer), &store);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	iotClient.clientStatus.clientState = CLIENT_STATE_CONNECTED_IDLE;
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, iotClient.clientData.inflightPublishCount);
+	CHECK_EQUAL_C_INT(6, lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_INT(0, strncmp("second", LastPublishMessagePayload, 6));
+
+	// A position which does not match the records, as after a torn write of it, empties the queue
+	iotClient.clientData.offlineQueue.count = iotClient.clientData.offlineQueue.unsentCount;
+	CHECK_EQUAL_C_INT(1, pwrite(file.fd, &garbage, 1, 15));
+	memset(offlineQueueBuffer, 0, sizeof(offlineQueueBuffer));
+	iotClient.clientData.offlineQueue.pBuffer = NULL;
+	rc = aws_iot_mqtt_offline_queue_init(&iotClient, offlineQueueBuffer, sizeof(offlineQueueBuffer), &store);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_offline_queue_count(&iotClient));
+
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_close(&file));
+	unlink(path);
+
+	IOT_DEBUG("-->Success - E:25 - Offline queue in a file, reloaded and drained, torn write \n");
+}
+
+/* E:26 - Publish with a payload fitting in the TX buffer is sent in a single write */
+TEST_C(PublishTests, publishSmallPayloadSingleWrite) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:26 - Publish with a payload fitting in the TX buffer is sent in a single write \n");
+
+	testPubMsgParams.qos = QOS0;
+
+	writevCallCount = 0;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, writevCallCount);
+	CHECK_EQUAL_C_STRING(subTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_STRING(cPayload, LastPublishMessagePayload);
+	CHECK_EQUAL_C_INT(0, lastPublishMessagePayloadPending);
+
+	IOT_DEBUG("-->Success - E:26 - Publish with a payload fitting in the TX buffer is sent in a single write \n");
+}
+
+/* E:27 - Async publish QoS1 expiring while reconnecting, the client stays disconnected */
+TEST_C(PublishTests, publishAsyncQoS1TimeoutWhileReconnecting) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:27 - Async publish QoS1 expiring while reconnecting \n");
+
+	rc = aws_iot_mqtt_publish_async(&iotClient, subTopic, subTopicLen, &testPubMsgParams,
+									iot_tests_unit_publish_complete_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	iotClient.clientStatus.clientState = CLIENT_STATE_PENDING_RECONNECT;
+	usleep((iotClient.clientData.commandTimeoutMs + 100) * 1000);
+	aws_iot_mqtt_internal_expire_inflight_publishes(&iotClient);
+	CHECK_EQUAL_C_INT(1, completedCount);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, completedStatus);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_PENDING_RECONNECT, completedClientState);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_PENDING_RECONNECT, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.inflightPublishCount);
+
+	IOT_DEBUG("-->Success - E:27 - Async publish QoS1 expiring while reconnecting \n");
+}
@@ -49,3 +49,14 @@ TEST_GROUP_C_WRAPPER(ShadowActionTests, NoCallbackForShadowAction)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, GetAndDeleteRequest)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, ExtractClientToken)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, IsReceivedJsonValid)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, PersistentAckSubscriptionsRouteAcksByAction)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, ShadowContextsKeepSeparateState)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, OutOfOrderAcksCompleteTheirOwnRequests)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, UpdateChangedSendsOnlyDirtyFields)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, UpdateChangedRevertWhileInFlight)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, CoalescedUpdatesShareOneAck)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, PendingUpdatesTimeOutOnReconnect)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, CoalescedUpdateTooLargeStaysCollected)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, CachedDocumentAnswersBeforeGet)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, CachedDocumentInFileStore)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, AckWaitListShiftsBackFreedRecords)
@@ -20,6 +20,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <CppUTest/TestHarness_c.h>
 #include <aws_iot_tests_unit_mock_tls_params.h>
@@ -32,13 +33,20 @@
 #include "aws_iot_shadow_actions.h"
 #include "aws_iot_shadow_json.h"
 #include "aws_iot_log.h"
+#include "byte_store_file.h"
 
 #define SIZE_OF_UPDATE_DOCUMENT 200
 #define TEST_JSON_RESPONSE_FULL_DOCUMENT "{\"state\":{\"reported\":{\"sensor1\":98}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
 #define TEST_JSON_RESPONSE_DELETE_DOCUMENT "{\"version\":2,\"timestamp\":1443473857,\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
 #define TEST_JSON_RESPONSE_UPDATE_DOCUMENT "{\"state\":{\"reported\":{\"doubleData\":4.090800,\"floatData\":3.445000}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
+#define TEST_JSON_REQUEST_UPDATE_DOCUMENT "{\"state\":{\"reported\":{\"sensor1\":98}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-1\"}"
+#define TEST_JSON_RESPONSE_UPDATE_REJECTED_DOCUMENT "{\"code\":400,\"message\":\"Bad Request\", \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-1\"}"
+#define TEST_JSON_RESPONSE_VERSIONED_DOCUMENT "{\"state\":{\"reported\":{\"sensor1\":98}}, \"version\":5, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
+#define TEST_OTHER_THING_NAME "OtherThing"
+#define TEST_OTHER_CLIENT_ID "OtherClient"
 #define TEST_JSON_SIZE 120
 static AWS_IoT_Client client;
+static AWS_IoT_Shadow_Context shadow;
 static IoT_Client_Connect_Params connectParams;
 static IoT_Publish_Message_Params testPubMsgParams;
 static ShadowInitParameters_t shadowInitParams;
@@ -74,15 +82,16 @@ TEST_GROUP_C_SETUP(ShadowActionTests) {
 	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
 	shadowInitParams.disconnectHandler = NULL;
 	shadowInitParams.enableAutoReconnect = false;
-	ret_val = aws_iot_shadow_init(&client, &shadowInitParams);
+	ret_val = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
 	shadowConnectParams.pMqttClientId = AWS_IOT_MQTT_CLIENT_ID;
 	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	shadowConnectParams.enablePersistentAckSubscriptions = false;
 	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
 	setTLSRxBufferForConnack(&connectParams, 0, 0);
-	ret_val = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	setTLSRxBufferForPuback();
@@ -99,7 +108,7 @@ TEST_GROUP_C_TEARDOWN(ShadowActionTests) {
 	/* Clean up. Not checking return code here because this is common to all tests.
 	 * A test might have already caused a disconnect by this point.
 	 */
-	IoT_Error_t rc = aws_iot_shadow_disconnect(&client);
+	IoT_Error_t rc = aws_iot_shadow_disconnect(&shadow);
 	IOT_UNUSED(rc);
 }
 
@@ -107,10 +116,10 @@ static void actionCallback(const char *pThingName, ShadowActions_t action, Shado
 					const char *pReceivedJsonDocument, void *pContextData) {
 	IOT_UNUSED(pThingName);
 	IOT_UNUSED(pContextData);
-	IOT_DEBUG("%s", pReceivedJsonDocument);
 	actionRx = action;
 	ackStatusRx = status;
 	if(SHADOW_ACK_TIMEOUT != status) {
+		IOT_DEBUG("%s", pReceivedJsonDocument);
 		strcpy(jsonFullDocument, pReceivedJsonDocument);
 	}
 }
@@ -123,8 +132,8 @@ TEST_C(ShadowActionTests, GetTheFullJSONDocument) {
 
 	IOT_DEBUG("-->Running Shadow Action Tests - Get full json document \n");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -134,7 +143,7 @@ TEST_C(ShadowActionTests, GetTheFullJSONDocument) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_FULL_DOCUMENT, jsonFullDocument);
@@ -151,8 +160,8 @@ TEST_C(ShadowActionTests, DeleteTheJSONDocument) {
 
 	IOT_DEBUG("-->Running Shadow Action Tests - Delete json document \n");
 
-	aws_iot_shadow_internal_delete_request_json(deleteRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_DELETE, deleteRequestJson, TEST_JSON_SIZE, actionCallback,
+	aws_iot_shadow_internal_delete_request_json(&shadow, deleteRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_DELETE, deleteRequestJson, TEST_JSON_SIZE, actionCallback,
 											 NULL, 4, false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -161,7 +170,7 @@ TEST_C(ShadowActionTests, DeleteTheJSONDocument) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(DELETE_ACCEPTED_TOPIC, strlen(DELETE_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_DELETE_DOCUMENT, jsonFullDocument);
@@ -210,15 +219,15 @@ TEST_C(ShadowActionTests, UpdateTheJSONDocument) {
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	ret_val = aws_iot_shadow_add_desired(updateRequestJson, SIZE_OF_UPDATE_DOCUMENT, 1, &dataBoolHandler);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
-	ret_val = aws_iot_finalize_json_document(updateRequestJson, SIZE_OF_UPDATE_DOCUMENT);
+	ret_val = aws_iot_finalize_json_document(&shadow, updateRequestJson, SIZE_OF_UPDATE_DOCUMENT);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	snprintf(expectedUpdateRequestJson, SIZE_OF_UPDATE_DOCUMENT,
-			 "{\"state\":{\"reported\":{\"doubleData\":4.090800,\"floatData\":3.445000},\"desired\":{\"boolData\":true}}, \"clientToken\":\"%s-0\"}",
+			 "{\"state\":{\"reported\":{\"doubleData\":4.090799808502197,\"floatData\":3.445},\"desired\":{\"boolData\":true}}, \"clientToken\":\"%s-0\"}",
 			AWS_IOT_MQTT_CLIENT_ID);
 	CHECK_EQUAL_C_STRING(expectedUpdateRequestJson, updateRequestJson);
 
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_UPDATE, updateRequestJson, SIZE_OF_UPDATE_DOCUMENT, actionCallback,
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_UPDATE, updateRequestJson, SIZE_OF_UPDATE_DOCUMENT, actionCallback,
 											 NULL, 4, false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -229,7 +238,7 @@ TEST_C(ShadowActionTests, UpdateTheJSONDocument) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(UPDATE_ACCEPTED_TOPIC, strlen(UPDATE_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_UPDATE_DOCUMENT, jsonFullDocument);
@@ -246,8 +255,8 @@ TEST_C(ShadowActionTests, GetTheFullJSONDocumentTimeout) {
 
 	IOT_DEBUG("-->Running Shadow Action Tests - Get full json document timeout \n");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -258,7 +267,7 @@ TEST_C(ShadowActionTests, GetTheFullJSONDocumentTimeout) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_FULL_DOCUMENT, jsonFullDocument);
@@ -284,8 +293,8 @@ TEST_C(ShadowActionTests, SubscribeToAcceptedRejectedOnGet) {
 	secondLastSubscribeMsgLen = 11;
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -316,8 +325,8 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetResponse) {
 	secondLastSubscribeMsgLen = 11;
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -326,7 +335,7 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetResponse) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -349,8 +358,8 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetTimeout) {
 	secondLastSubscribeMsgLen = 11;
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -361,7 +370,7 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetTimeout) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("aa", jsonFullDocument);
@@ -386,8 +395,8 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetTimeoutWithSticky) {
 	secondLastSubscribeMsgLen = 11;
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 true);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -399,7 +408,7 @@ TEST_C(ShadowActionTests, UnSubscribeToAcceptedRejectedOnGetTimeoutWithSticky) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("timeout", jsonFullDocument);
@@ -422,8 +431,8 @@ TEST_C(ShadowActionTests, GetVersionFromAckStatus) {
 
 	snprintf(jsonFullDocument, 200, "timeout");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 true);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -433,10 +442,10 @@ TEST_C(ShadowActionTests, GetVersionFromAckStatus) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
-	CHECK_C(1u == aws_iot_shadow_get_last_received_version());
+	CHECK_C(1u == aws_iot_shadow_get_last_received_version(&shadow));
 
 	ResetTLSBuffer();
 	params2.payload = TEST_JSON_RESPONSE_FULL_DOCUMENT_WITH_VERSION(132387);
@@ -444,10 +453,10 @@ TEST_C(ShadowActionTests, GetVersionFromAckStatus) {
 	params2.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params2,
 										   params2.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
-	CHECK_C(132387u == aws_iot_shadow_get_last_received_version());
+	CHECK_C(132387u == aws_iot_shadow_get_last_received_version(&shadow));
 
 	IOT_DEBUG("-->Success - Get version from Ack status \n");
 }
@@ -463,8 +472,8 @@ TEST_C(ShadowActionTests, WrongTokenInGetResponse) {
 
 	snprintf(jsonFullDocument, 200, "timeout");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -475,7 +484,7 @@ TEST_C(ShadowActionTests, WrongTokenInGetResponse) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("timeout", jsonFullDocument);
@@ -496,8 +505,8 @@ TEST_C(ShadowActionTests, NoTokenInGetResponse) {
 
 	snprintf(jsonFullDocument, 200, "timeout");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -508,7 +517,7 @@ TEST_C(ShadowActionTests, NoTokenInGetResponse) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("timeout", jsonFullDocument);
@@ -527,8 +536,8 @@ TEST_C(ShadowActionTests, InvalidInboundJSONInGetResponse) {
 
 	snprintf(jsonFullDocument, 200, "NOT_VISITED");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -537,7 +546,7 @@ TEST_C(ShadowActionTests, InvalidInboundJSONInGetResponse) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("NOT_VISITED", jsonFullDocument);
@@ -555,8 +564,8 @@ TEST_C(ShadowActionTests, AcceptedSubFailsGetRequest) {
 	snprintf(jsonFullDocument, 200, "NOT_SENT");
 
 	ResetTLSBuffer();
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, ret_val); // Should never subscribe and publish
 
@@ -566,7 +575,7 @@ TEST_C(ShadowActionTests, AcceptedSubFailsGetRequest) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("NOT_SENT", jsonFullDocument); // Never called callback
@@ -589,15 +598,15 @@ TEST_C(ShadowActionTests, RejectedSubFailsGetRequest) {
 
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params);
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, ret_val); // Should never subscribe and publish
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_REJECTED_TOPIC, strlen(GET_REJECTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("NOT_SENT", jsonFullDocument); // Never called callback
@@ -616,8 +625,8 @@ TEST_C(ShadowActionTests, PublishFailsGetRequest) {
 
 	ResetTLSBuffer();
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, ret_val); // Should never subscribe and publish
 
@@ -627,7 +636,7 @@ TEST_C(ShadowActionTests, PublishFailsGetRequest) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING("NOT_SENT", jsonFullDocument); // Never called callback
@@ -647,8 +656,8 @@ TEST_C(ShadowActionTests, StickyNonStickyNeverConflict) {
 	secondLastSubscribeMsgLen = 11;
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 true);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -657,7 +666,7 @@ TEST_C(ShadowActionTests, StickyNonStickyNeverConflict) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_FULL_DOCUMENT, jsonFullDocument);
@@ -670,8 +679,8 @@ TEST_C(ShadowActionTests, StickyNonStickyNeverConflict) {
 	snprintf(SecondLastSubscribeMessage, secondLastSubscribeMsgLen, "No Message");
 
 	// Non-sticky shadow get, same thing name. Should never unsub since they are sticky
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -682,7 +691,7 @@ TEST_C(ShadowActionTests, StickyNonStickyNeverConflict) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_FULL_DOCUMENT, jsonFullDocument);
@@ -703,59 +712,59 @@ TEST_C(ShadowActionTests, ACKWaitingMoreThanAllowed) {
 	IOT_DEBUG("-->Running Shadow Action Tests - Ack waiting more than allowed wait time \n");
 
 	// 1st
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 2nd
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 3rd
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 4th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 5th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 6th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 7th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 8th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 9th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 10th
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// 11th
 	// Should return some error code, since we are running out of ACK space
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
 											 100, false); // 100 sec to timeout
 	CHECK_EQUAL_C_INT(FAILURE, ret_val);
 
@@ -773,8 +782,8 @@ TEST_C(ShadowActionTests, InboundDataTooBigForBuffer) {
 
 	snprintf(jsonFullDocument, 200, "NOT_VISITED");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -788,7 +797,7 @@ TEST_C(ShadowActionTests, InboundDataTooBigForBuffer) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 	CHECK_EQUAL_C_INT(MQTT_RX_BUFFER_TOO_SHORT_ERROR, ret_val);
 	CHECK_EQUAL_C_STRING("NOT_VISITED", jsonFullDocument);
 
@@ -811,7 +820,7 @@ TEST_C(ShadowActionTests, NoClientTokenForShadowAction) {
 	snprintf(getRequestJson, TEST_JSON_SIZE, "{}");
 	snprintf(jsonFullDocument, 200, "NOT_VISITED");
 
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL, 4,
 											 false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
@@ -820,7 +829,7 @@ TEST_C(ShadowActionTests, NoClientTokenForShadowAction) {
 	params.qos = QOS0;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// Should never subscribe to accepted/rejected topics since we have no token to track the response
@@ -848,11 +857,11 @@ TEST_C(ShadowActionTests, IsReceivedJsonValid)
 	snprintf(getRequestJson, TEST_JSON_SIZE, TEST_JSON_RESPONSE_FULL_DOCUMENT);	
 	
 	//Test by cutting the JSON document
-	ret_val = isReceivedJsonValid(getRequestJson, 3);
+	ret_val = isReceivedJsonValid(getRequestJson, 3, &shadow.jsonHandler);
 	CHECK_EQUAL_C_INT(false, ret_val);
 		
 	//Happy path
-	ret_val = isReceivedJsonValid(getRequestJson, TEST_JSON_SIZE);
+	ret_val = isReceivedJsonValid(getRequestJson, TEST_JSON_SIZE, &shadow.jsonHandler);
 	CHECK_EQUAL_C_INT(true, ret_val);
 	
 	IOT_DEBUG("-->Success - IsReceivedJsonValid");
@@ -868,16 +877,16 @@ TEST_C(ShadowActionTests, ExtractClientToken)
 
 	//Try JSON with no token
 	snprintf(getRequestJson, TEST_JSON_SIZE, "{}");
-	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
+	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, &shadow.jsonHandler, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
 	CHECK_EQUAL_C_INT(false, ret_val);
 	
 	//Try JSON with token but not enough memory
 	snprintf(getRequestJson, TEST_JSON_SIZE, TEST_JSON_RESPONSE_FULL_DOCUMENT);	
-	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, extractedClientToken, 1 );
+	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, &shadow.jsonHandler, extractedClientToken, 1 );
 	CHECK_EQUAL_C_INT(false, ret_val);
 	
 	//Happy path
-	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
+	ret_val = extractClientToken(getRequestJson, TEST_JSON_SIZE, &shadow.jsonHandler, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
 	CHECK_EQUAL_C_INT(true, ret_val);
 	
 	IOT_DEBUG("-->Success - ExtractClientToken");
@@ -889,16 +898,16 @@ TEST_C(ShadowActionTests, GetAndDeleteRequest) {
 	
 	IOT_DEBUG("-->Running Shadow Action Tests - GetAndDeleteRequest \n");
 		
-	ret_val = aws_iot_shadow_internal_get_request_json(NULL, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_get_request_json(&shadow, NULL, TEST_JSON_SIZE);
 	CHECK_EQUAL_C_INT(FAILURE, ret_val);
 	
-	ret_val = aws_iot_shadow_internal_get_request_json(getRequestJson, 1);
+	ret_val = aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, 1);
 	CHECK_EQUAL_C_INT(FAILURE, ret_val);
 	
-		ret_val = aws_iot_shadow_internal_delete_request_json(NULL, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_delete_request_json(&shadow, NULL, TEST_JSON_SIZE);
 	CHECK_EQUAL_C_INT(FAILURE, ret_val);
 	
-	ret_val = aws_iot_shadow_internal_delete_request_json(getRequestJson, 1);
+	ret_val = aws_iot_shadow_internal_delete_request_json(&shadow, getRequestJson, 1);
 	CHECK_EQUAL_C_INT(FAILURE, ret_val);
 	
 	IOT_DEBUG("-->Success - GetAndDeleteRequest");
@@ -917,15 +926,15 @@ TEST_C(ShadowActionTests, NoCallbackForShadowAction) {
 
 	snprintf(jsonFullDocument, 200, "NOT_VISITED");
 
-	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
-	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, NULL, NULL, 4, false);
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, NULL, NULL, 4, false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	params.payloadLen = strlen(TEST_JSON_RESPONSE_FULL_DOCUMENT);
 	params.payload = TEST_JSON_RESPONSE_FULL_DOCUMENT;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
 										   params.payload);
-	ret_val = aws_iot_shadow_yield(&client, 200);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
 
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	// Should never subscribe to accepted/rejected topics since we have no callback to track the response
@@ -942,3 +951,760 @@ TEST_C(ShadowActionTests, NoCallbackForShadowAction) {
 
 	IOT_DEBUG("-->Success - No callback for shadow action");
 }
+
+TEST_C(ShadowActionTests, PersistentAckSubscriptionsRouteAcksByAction) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	IoT_Publish_Message_Params params;
+	Timer actionTimer;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Persistent ack subscriptions route acks by action \n");
+
+	// Reconnect with the accepted/rejected wildcards subscribed in a single SUBSCRIBE
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING(AWS_THINGS_TOPIC AWS_IOT_MY_THING_NAME SHADOW_TOPIC "+" ACCEPTED_TOPIC, LastSubscribeMessage);
+
+	// Get is a single publish, without subscribing or waiting for the subscription to settle
+	snprintf(LastSubscribeMessage, TLSMaxBufferSize, "%s", "NOT_SUBSCRIBED");
+	init_timer(&actionTimer);
+	countdown_ms(&actionTimer, 1000);
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+											 actionCallback, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(!has_timer_expired(&actionTimer));
+	CHECK_EQUAL_C_STRING("NOT_SUBSCRIBED", LastSubscribeMessage);
+
+	ResetTLSBuffer();
+	params.payloadLen = strlen(TEST_JSON_RESPONSE_FULL_DOCUMENT);
+	params.payload = TEST_JSON_RESPONSE_FULL_DOCUMENT;
+	params.qos = QOS0;
+	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
+										   params.payload);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(SHADOW_GET, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	// The subscriptions are kept, nothing is sent when the ack arrives
+	CHECK_EQUAL_C_INT(0, TxBuf[0]);
+
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_UPDATE, TEST_JSON_REQUEST_UPDATE_DOCUMENT,
+											 strlen(TEST_JSON_REQUEST_UPDATE_DOCUMENT), actionCallback, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// An ack carrying the update token on a get topic does not complete the update
+	actionRx = SHADOW_GET;
+	ackStatusRx = SHADOW_ACK_TIMEOUT;
+	params.payloadLen = strlen(TEST_JSON_RESPONSE_UPDATE_REJECTED_DOCUMENT);
+	params.payload = TEST_JSON_RESPONSE_UPDATE_REJECTED_DOCUMENT;
+	setTLSRxBufferWithMsgOnSubscribedTopic(GET_REJECTED_TOPIC, strlen(GET_REJECTED_TOPIC), QOS0, params,
+										   params.payload);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, ackStatusRx);
+
+	setTLSRxBufferWithMsgOnSubscribedTopic(UPDATE_REJECTED_TOPIC, strlen(UPDATE_REJECTED_TOPIC), QOS0, params,
+										   params.payload);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx);
+	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_UPDATE_REJECTED_DOCUMENT, jsonFullDocument);
+
+	IOT_DEBUG("-->Success - Persistent ack subscriptions route acks by action \n");
+}
+
+TEST_C(ShadowActionTests, ShadowContextsKeepSeparateState) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	char otherRequestJson[TEST_JSON_SIZE];
+	static AWS_IoT_Client otherClient;
+	static AWS_IoT_Shadow_Context otherShadow;
+	ShadowConnectParameters_t otherConnectParams;
+	IoT_Publish_Message_Params params;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Shadow contexts keep separate state \n");
+
+	aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson,
+											 TEST_JSON_SIZE, actionCallback, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	ret_val = aws_iot_shadow_init(&otherShadow, &otherClient, &shadowInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	otherConnectParams = shadowConnectParams;
+	otherConnectParams.pMyThingName = TEST_OTHER_THING_NAME;
+	otherConnectParams.pMqttClientId = TEST_OTHER_CLIENT_ID;
+	otherConnectParams.mqttClientIdLen = (uint16_t) strlen(TEST_OTHER_CLIENT_ID);
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	ret_val = aws_iot_shadow_connect(&otherShadow, &otherConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// The other instance numbers its own client tokens
+	aws_iot_shadow_internal_get_request_json(&otherShadow, otherRequestJson, TEST_JSON_SIZE);
+	CHECK_EQUAL_C_STRING("{\"clientToken\":\"" TEST_OTHER_CLIENT_ID "-0\"}", otherRequestJson);
+
+	// The response completes the request and updates the version of the first instance only
+	ackStatusRx = SHADOW_ACK_TIMEOUT;
+	ResetTLSBuffer();
+	params.payloadLen = strlen(TEST_JSON_RESPONSE_VERSIONED_DOCUMENT);
+	params.payload = TEST_JSON_RESPONSE_VERSIONED_DOCUMENT;
+	params.qos = QOS0;
+	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
+										   params.payload);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(SHADOW_GET, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_get_last_received_version(&shadow));
+	CHECK_EQUAL_C_INT(0, aws_iot_shadow_get_last_received_version(&otherShadow));
+
+	ret_val = aws_iot_shadow_disconnect(&otherShadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	IOT_DEBUG("-->Success - Shadow contexts keep separate state \n");
+}
+
+#define TEST_JSON_RESPONSE_GET_DOCUMENT(seq) "{\"state\":{\"reported\":{\"sensor1\":98}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-" #seq "\"}"
+#define TEST_APPLICATION_TOKEN "ApplicationToken"
+#define TEST_JSON_REQUEST_UPDATE_APPLICATION_TOKEN "{\"state\":{\"reported\":{\"sensor1\":98}}, \"clientToken\":\"" TEST_APPLICATION_TOKEN "\"}"
+
+static void *pAckContextRx;
+
+static void contextCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							const char *pReceivedJsonDocument, void *pContextData) {
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(pReceivedJsonDocument);
+	actionRx = action;
+	ackStatusRx = status;
+	pAckContextRx = pContextData;
+}
+
+static void yieldAck(const char *pTopic, const char *pPayload) {
+	IoT_Error_t ret_val;
+	IoT_Publish_Message_Params params;
+
+	pAckContextRx = NULL;
+	ackStatusRx = SHADOW_ACK_TIMEOUT;
+	ResetTLSBuffer();
+	params.payloadLen = strlen(pPayload);
+	params.payload = (void *) pPayload;
+	params.qos = QOS0;
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, params, (char *) pPayload);
+	ret_val = aws_iot_shadow_yield(&shadow, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+}
+
+TEST_C(ShadowActionTests, OutOfOrderAcksCompleteTheirOwnRequests) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	int contexts[4];
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Out of order acks complete their own requests \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// Tokens -0 to -2, then one chosen by the application
+	for(i = 0; i < 3; i++) {
+		aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson,
+												 TEST_JSON_SIZE, contextCallback, &contexts[i], 4, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+	ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_UPDATE,
+											 TEST_JSON_REQUEST_UPDATE_APPLICATION_TOKEN,
+											 strlen(TEST_JSON_REQUEST_UPDATE_APPLICATION_TOKEN), contextCallback,
+											 &contexts[3], 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	yieldAck(GET_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_GET_DOCUMENT(2));
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_C(&contexts[2] == pAckContextRx);
+
+	// A token that was already acked is no longer waited for
+	yieldAck(GET_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_GET_DOCUMENT(2));
+	CHECK_C(NULL == pAckContextRx);
+
+	yieldAck(UPDATE_REJECTED_TOPIC, TEST_JSON_REQUEST_UPDATE_APPLICATION_TOKEN);
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx);
+	CHECK_C(&contexts[3] == pAckContextRx);
+
+	yieldAck(GET_REJECTED_TOPIC, TEST_JSON_RESPONSE_GET_DOCUMENT(0));
+	CHECK_EQUAL_C_INT(SHADOW_GET, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx);
+	CHECK_C(&contexts[0] == pAckContextRx);
+
+	yieldAck(GET_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_GET_DOCUMENT(1));
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_C(&contexts[1] == pAckContextRx);
+
+	IOT_DEBUG("-->Success - Out of order acks complete their own requests \n");
+}
+
+#define TEST_JSON_RESPONSE_UPDATE_ACCEPTED(sequence) \
+	"{\"state\":{}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-" #sequence "\"}"
+#define TEST_JSON_RESPONSE_UPDATE_REJECTED(sequence) \
+	"{\"code\":409,\"message\":\"Version conflict\", \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-" #sequence "\"}"
+
+TEST_C(ShadowActionTests, UpdateChangedSendsOnlyDirtyFields) {
+	IoT_Error_t ret_val = SUCCESS;
+	char updateJson[SIZE_OF_UPDATE_DOCUMENT];
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	int32_t counter = 1;
+	float temperature = 21.5f;
+	bool isOn = false;
+	char room[16] = "kitchen";
+	jsonStruct_t counterHandler = {"counter", &counter, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+	jsonStruct_t temperatureHandler = {"temperature", &temperature, sizeof(float), SHADOW_JSON_FLOAT, NULL};
+	jsonStruct_t isOnHandler = {"isOn", &isOn, sizeof(bool), SHADOW_JSON_BOOL, NULL};
+	jsonStruct_t roomHandler = {"room", room, sizeof(room), SHADOW_JSON_STRING, NULL};
+	int context;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Update changed sends only dirty fields \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &counterHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &temperatureHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &isOnHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &roomHandler));
+
+	// Nothing has been reported yet, so every field goes out
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":1,\"temperature\":21.5,\"isOn\":false,\"room\":\"kitchen\"}}, "
+						 "\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}", updateJson);
+
+	// The fields stay changed until their update is accepted
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":1,\"temperature\":21.5,\"isOn\":false,\"room\":\"kitchen\"}}, "
+						 "\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-1\"}", updateJson);
+
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(0));
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_C(&context == pAckContextRx);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(1));
+
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SHADOW_NO_CHANGED_FIELDS, ret_val);
+
+	// A float change within the epsilon is not reported
+	counter = 2;
+	temperature = 21.55f;
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":2}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-2\"}",
+						 updateJson);
+
+	// A rejected field is sent again with the next change
+	yieldAck(UPDATE_REJECTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_REJECTED(2));
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx);
+	CHECK_C(&context == pAckContextRx);
+
+	isOn = true;
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":2,\"isOn\":true}}, \"clientToken\":\""
+						 AWS_IOT_MQTT_CLIENT_ID "-3\"}", updateJson);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(3));
+
+	// Strings are compared with the text last accepted
+	strcpy(room, "hall");
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"room\":\"hall\"}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-4\"}",
+						 updateJson);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(4));
+
+	strcpy(room, "hall");
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SHADOW_NO_CHANGED_FIELDS, ret_val);
+
+	// A forced report resends everything, for example after a reconnect
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, true, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":2,\"temperature\":21.55,\"isOn\":true,\"room\":\"hall\"}}, "
+						 "\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-5\"}", updateJson);
+
+	IOT_DEBUG("-->Success - Update changed sends only dirty fields \n");
+}
+
+TEST_C(ShadowActionTests, UpdateChangedRevertWhileInFlight) {
+	IoT_Error_t ret_val = SUCCESS;
+	char updateJson[SIZE_OF_UPDATE_DOCUMENT];
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	int32_t counter = 1;
+	jsonStruct_t counterHandler = {"counter", &counter, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Update changed, value reverted while its update is in flight \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &counterHandler));
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(0));
+
+	counter = 2;
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":2}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-1\"}",
+						 updateJson);
+
+	// Back to the value last accepted before the update is: nothing to send yet
+	counter = 1;
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SHADOW_NO_CHANGED_FIELDS, ret_val);
+
+	// The service now holds the value of the accepted update, so the reverted value is sent
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(1));
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":1}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-2\"}",
+						 updateJson);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(2));
+
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, NULL, NULL, 4, false);
+	CHECK_EQUAL_C_INT(SHADOW_NO_CHANGED_FIELDS, ret_val);
+
+	IOT_DEBUG("-->Success - Update changed, value reverted while its update is in flight \n");
+}
+
+static void countingCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							 const char *pReceivedJsonDocument, void *pContextData) {
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(pReceivedJsonDocument);
+	actionRx = action;
+	ackStatusRx = status;
+	(*(int *) pContextData)++;
+}
+
+TEST_C(ShadowActionTests, CoalescedUpdatesShareOneAck) {
+	IoT_Error_t ret_val = SUCCESS;
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	int32_t counter = 1;
+	int32_t laterCounter = 5;
+	bool isOn = false;
+	jsonStruct_t firstFields[2] = {{"counter", &counter, sizeof(int32_t), SHADOW_JSON_INT32, NULL},
+								   {"isOn", &isOn, sizeof(bool), SHADOW_JSON_BOOL, NULL}};
+	jsonStruct_t laterField = {"counter", &laterCounter, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+	int firstCalls = 0;
+	int laterCalls = 0;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Coalesced updates share one ack \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, firstFields, 2, countingCallback, &firstCalls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, &laterField, 1, countingCallback, &laterCalls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(2, shadow.coalescedFieldsCount);
+
+	// The last writer of a key wins and both callers are answered by the one ack
+	ret_val = aws_iot_shadow_flush_coalesced(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"counter\":5,\"isOn\":false}}, \"clientToken\":\""
+						 AWS_IOT_MQTT_CLIENT_ID "-0\"}", shadow.coalescedJsonDocument);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, shadow.coalescedJsonDocument);
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, actionRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_EQUAL_C_INT(1, firstCalls);
+	CHECK_EQUAL_C_INT(1, laterCalls);
+
+	// Once the window ends the update is sent from the yield
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, firstFields, 2, countingCallback, &firstCalls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	usleep((SHADOW_COALESCE_WINDOW_MS + 50) * 1000);
+	yieldAck(UPDATE_REJECTED_TOPIC, TEST_JSON_RESPONSE_GET_DOCUMENT(1));
+	CHECK_EQUAL_C_INT(0, shadow.coalescedFieldsCount);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx);
+	CHECK_EQUAL_C_INT(2, firstCalls);
+	CHECK_EQUAL_C_INT(1, laterCalls);
+
+	IOT_DEBUG("-->Success - Coalesced updates share one ack \n");
+}
+
+static void reconnectWithPersistentAcks(void) {
+	IoT_Error_t ret_val;
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+}
+
+TEST_C(ShadowActionTests, PendingUpdatesTimeOutOnReconnect) {
+	IoT_Error_t ret_val = SUCCESS;
+	char updateJson[SIZE_OF_UPDATE_DOCUMENT];
+	int32_t counter = 1;
+	jsonStruct_t counterHandler = {"counter", &counter, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+	int reportedCalls = 0;
+	int coalescedCalls = 0;
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Pending updates time out on reconnect \n");
+
+	reconnectWithPersistentAcks();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_reported(&shadow, &counterHandler));
+	for(i = 0; i < SHADOW_REPORTED_UPDATE_COUNT; i++) {
+		ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+												0.1, false, countingCallback, &reportedCalls, 4, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+	ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+											0.1, false, countingCallback, &reportedCalls, 4, false);
+	CHECK_EQUAL_C_INT(FAILURE, ret_val);
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, &counterHandler, 1, countingCallback, &coalescedCalls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_flush_coalesced(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// The responses of the previous session will not come, the next yield times the updates out
+	reconnectWithPersistentAcks();
+	CHECK_EQUAL_C_INT(0, reportedCalls);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_UPDATE_ACCEPTED(99));
+	CHECK_EQUAL_C_INT(SHADOW_REPORTED_UPDATE_COUNT, reportedCalls);
+	CHECK_EQUAL_C_INT(1, coalescedCalls);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, ackStatusRx);
+	CHECK_EQUAL_C_INT(0, shadow.ackWaitListCount);
+
+	// Their slots are free again
+	for(i = 0; i < SHADOW_REPORTED_UPDATE_COUNT; i++) {
+		ret_val = aws_iot_shadow_update_changed(&shadow, AWS_IOT_MY_THING_NAME, updateJson, SIZE_OF_UPDATE_DOCUMENT,
+												0.1, false, countingCallback, &reportedCalls, 4, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, &counterHandler, 1, countingCallback, &coalescedCalls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_flush_coalesced(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(SHADOW_REPORTED_UPDATE_COUNT + 1, shadow.ackWaitListCount);
+
+	IOT_DEBUG("-->Success - Pending updates time out on reconnect \n");
+}
+
+TEST_C(ShadowActionTests, CoalescedUpdateTooLargeStaysCollected) {
+	IoT_Error_t ret_val = SUCCESS;
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	char longLabel[AWS_IOT_MQTT_TX_BUF_LEN];
+	char shortLabel[] = "door";
+	jsonStruct_t longField = {"label", longLabel, sizeof(longLabel), SHADOW_JSON_STRING, NULL};
+	jsonStruct_t shortField = {"label", shortLabel, sizeof(shortLabel), SHADOW_JSON_STRING, NULL};
+	int calls = 0;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Coalesced update too large stays collected \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	memset(longLabel, 'x', sizeof(longLabel) - 1);
+	longLabel[sizeof(longLabel) - 1] = '\0';
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, &longField, 1, countingCallback, &calls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// The document does not fit, nothing is sent and the caller is not answered yet
+	ret_val = aws_iot_shadow_flush_coalesced(&shadow);
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, ret_val);
+	CHECK_EQUAL_C_INT(1, shadow.coalescedFieldsCount);
+	CHECK_EQUAL_C_INT(0, calls);
+
+	// A later value of the key replaces it and the update goes out for both callers
+	ret_val = aws_iot_shadow_update_coalesced(&shadow, &shortField, 1, countingCallback, &calls, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_flush_coalesced(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(0, shadow.coalescedFieldsCount);
+	yieldAck(UPDATE_ACCEPTED_TOPIC, shadow.coalescedJsonDocument);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_EQUAL_C_INT(2, calls);
+
+	IOT_DEBUG("-->Success - Coalesced update too large stays collected \n");
+}
+
+static unsigned char cacheStoreData[600];
+static size_t cacheStoreUsed;
+
+static IoT_Error_t readCacheStore(void *pStoreData, size_t offset, unsigned char *pBuffer, size_t len) {
+	IOT_UNUSED(pStoreData);
+	if(offset + len > cacheStoreUsed) {
+		return FAILURE;
+	}
+	memcpy(pBuffer, &cacheStoreData[offset], len);
+	return SUCCESS;
+}
+
+static IoT_Error_t writeCacheStore(void *pStoreData, size_t offset, const unsigned char *pBuffer, size_t len) {
+	IOT_UNUSED(pStoreData);
+	if(offset + len > sizeof(cacheStoreData)) {
+		return FAILURE;
+	}
+	memcpy(&cacheStoreData[offset], pBuffer, len);
+	if(offset + len > cacheStoreUsed) {
+		cacheStoreUsed = offset + len;
+	}
+	return SUCCESS;
+}
+
+TEST_C(ShadowActionTests, CachedDocumentAnswersBeforeGet) {
+	IoT_Error_t ret_val = SUCCESS;
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	const IoT_Byte_Store store = {readCacheStore, writeCacheStore, NULL};
+	char cacheBuffer[400];
+	char deltaTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	int32_t sensor = 0;
+	jsonStruct_t sensorHandler = {"sensor1", &sensor, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+	IoT_Publish_Message_Params params;
+	int context;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Cached document answers before get \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	cacheStoreUsed = 0;
+	ret_val = aws_iot_shadow_enable_cache(&shadow, &store, cacheBuffer, sizeof(cacheBuffer));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// Nothing cached yet, the document is only fetched, and cached
+	pAckContextRx = NULL;
+	ret_val = aws_iot_shadow_get_cached(&shadow, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(NULL == pAckContextRx);
+	CHECK_EQUAL_C_INT(1, shadow.ackWaitListCount);
+	yieldAck(GET_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_VERSIONED_DOCUMENT);
+	CHECK_C(&context == pAckContextRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+
+	snprintf(deltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/delta", AWS_IOT_MY_THING_NAME);
+	params.qos = QOS0;
+	params.payload = "";
+	params.payloadLen = 0;
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(deltaTopic, strlen(deltaTopic), QOS0, params);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &sensorHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	yieldAck(deltaTopic, "{\"state\":{\"sensor1\":42},\"version\":6}");
+	CHECK_EQUAL_C_INT(42, sensor);
+
+	// After a restart the cache is loaded from the store, answers first and applies the cached delta
+	memset(cacheBuffer, 0, sizeof(cacheBuffer));
+	sensor = 0;
+	aws_iot_shadow_reset_last_received_version(&shadow);
+	ret_val = aws_iot_shadow_enable_cache(&shadow, &store, cacheBuffer, sizeof(cacheBuffer));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	pAckContextRx = NULL;
+	ret_val = aws_iot_shadow_get_cached(&shadow, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(&context == pAckContextRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_CACHED, ackStatusRx);
+	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_VERSIONED_DOCUMENT, cacheBuffer);
+	CHECK_EQUAL_C_INT(6, aws_iot_shadow_get_last_received_version(&shadow));
+	CHECK_EQUAL_C_INT(42, sensor);
+
+	// The cache may be of any age, so the document is fetched as well
+	CHECK_EQUAL_C_INT(1, shadow.ackWaitListCount);
+	yieldAck(GET_ACCEPTED_TOPIC, "{\"state\":{\"reported\":{\"sensor1\":42}}, \"version\":6, \"clientToken\":\""
+			 AWS_IOT_MQTT_CLIENT_ID "-1\"}");
+	CHECK_C(&context == pAckContextRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+
+	// A newer version was seen, the cache is stale and only the fetch answers
+	shadow.shadowJsonVersionNum = 7;
+	pAckContextRx = NULL;
+	ret_val = aws_iot_shadow_get_cached(&shadow, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(NULL == pAckContextRx);
+	CHECK_EQUAL_C_INT(1, shadow.ackWaitListCount);
+
+	// Lengths whose sum wraps around are not loaded
+	cacheStoreData[16] = 0xFF;
+	cacheStoreData[17] = 0xFF;
+	cacheStoreData[18] = 0xFF;
+	cacheStoreData[19] = 0xF0;
+	ret_val = aws_iot_shadow_enable_cache(&shadow, &store, cacheBuffer, sizeof(cacheBuffer));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(0, shadow.cacheHeader.documentLength);
+
+	IOT_DEBUG("-->Success - Cached document answers before get \n");
+}
+
+TEST_C(ShadowActionTests, CachedDocumentInFileStore) {
+	IoT_Error_t ret_val = SUCCESS;
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	char path[] = "/tmp/aws_iot_shadow_cache_XXXXXX";
+	char cacheBuffer[400];
+	IoT_Byte_Store store;
+	ByteStoreFile file;
+	int context;
+	int fd;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Cached document in file store \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	fd = mkstemp(path);
+	CHECK_C(0 <= fd);
+	close(fd);
+
+	// An empty file holds no cache
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_open(&file, path, &store));
+	ret_val = aws_iot_shadow_enable_cache(&shadow, &store, cacheBuffer, sizeof(cacheBuffer));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(0, shadow.cacheHeader.documentLength);
+
+	ret_val = aws_iot_shadow_get_cached(&shadow, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	yieldAck(GET_ACCEPTED_TOPIC, TEST_JSON_RESPONSE_VERSIONED_DOCUMENT);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx);
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_close(&file));
+
+	// Restart from the file alone
+	memset(cacheBuffer, 0, sizeof(cacheBuffer));
+	aws_iot_shadow_reset_last_received_version(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_open(&file, path, &store));
+	ret_val = aws_iot_shadow_enable_cache(&shadow, &store, cacheBuffer, sizeof(cacheBuffer));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_VERSIONED_DOCUMENT, cacheBuffer);
+	CHECK_EQUAL_C_INT(5, shadow.cacheHeader.documentVersion);
+
+	pAckContextRx = NULL;
+	ret_val = aws_iot_shadow_get_cached(&shadow, contextCallback, &context, 4, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(&context == pAckContextRx);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_CACHED, ackStatusRx);
+
+	CHECK_EQUAL_C_INT(SUCCESS, byte_store_file_close(&file));
+	unlink(path);
+
+	IOT_DEBUG("-->Success - Cached document in file store \n");
+}
+
+TEST_C(ShadowActionTests, AckWaitListShiftsBackFreedRecords) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	char response[TEST_JSON_SIZE];
+	char tokens[3][MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+	const unsigned char returnCodes[2] = {QOS0, QOS0};
+	int contexts[3];
+	uint8_t home = 0;
+	int i, skip;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Ack wait list shifts back freed records \n");
+
+	ret_val = aws_iot_shadow_disconnect(&shadow);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ResetTLSBuffer();
+	shadowConnectParams.enablePersistentAckSubscriptions = true;
+	setTLSRxBufferForConnackAndSubackWithReturnCodes(&connectParams, returnCodes, 2);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// Three tokens whose sequence numbers share a home slot, the second and third are displaced
+	for(i = 0; i < 3; i++) {
+		for(skip = 0; i > 0 && skip < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME - 1; skip++) {
+			aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+		}
+		aws_iot_shadow_internal_get_request_json(&shadow, getRequestJson, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson,
+												 TEST_JSON_SIZE, contextCallback, &contexts[i], 4, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+		if(0 == i) {
+			while(shadow.AckWaitList[home].isFree) {
+				home++;
+			}
+		}
+		strcpy(tokens[i], shadow.AckWaitList[(home + i) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME].clientTokenID);
+	}
+	CHECK_EQUAL_C_INT(3, shadow.ackWaitListCount);
+
+	// The records behind the acked one move back towards their home slot
+	snprintf(response, TEST_JSON_SIZE, "{\"state\":{}, \"clientToken\":\"%s\"}", tokens[0]);
+	yieldAck(GET_ACCEPTED_TOPIC, response);
+	CHECK_C(&contexts[0] == pAckContextRx);
+	CHECK_EQUAL_C_INT(2, shadow.ackWaitListCount);
+	CHECK_EQUAL_C_STRING(tokens[1], shadow.AckWaitList[home].clientTokenID);
+	CHECK_EQUAL_C_STRING(tokens[2], shadow.AckWaitList[(home + 1) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME].clientTokenID);
+	CHECK_C(shadow.AckWaitList[(home + 2) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME].isFree);
+
+	snprintf(response, TEST_JSON_SIZE, "{\"state\":{}, \"clientToken\":\"%s\"}", tokens[2]);
+	yieldAck(GET_ACCEPTED_TOPIC, response);
+	CHECK_C(&contexts[2] == pAckContextRx);
+	CHECK_C(shadow.AckWaitList[(home + 1) % MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME].isFree);
+
+	snprintf(response, TEST_JSON_SIZE, "{\"state\":{}, \"clientToken\":\"%s\"}", tokens[1]);
+	yieldAck(GET_ACCEPTED_TOPIC, response);
+	CHECK_C(&contexts[1] == pAckContextRx);
+	CHECK_EQUAL_C_INT(0, shadow.ackWaitListCount);
+
+	IOT_DEBUG("-->Success - Ack wait list shifts back freed records \n");
+}
@@ -27,6 +27,7 @@
 #include "aws_iot_log.h"
 
 static AWS_IoT_Client client;
+static AWS_IoT_Shadow_Context shadow;
 static IoT_Client_Connect_Params connectParams;
 static ShadowInitParameters_t shadowInitParams;
 static ShadowConnectParameters_t shadowConnectParams;
@@ -59,7 +60,7 @@ TEST_GROUP_C_SETUP(ShadowDeltaTest) {
 	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
 	shadowInitParams.disconnectHandler = NULL;
 	shadowInitParams.enableAutoReconnect = false;
-	ret_val = aws_iot_shadow_init(&client, &shadowInitParams);
+	ret_val = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
@@ -67,7 +68,7 @@ TEST_GROUP_C_SETUP(ShadowDeltaTest) {
 	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
 	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
 	setTLSRxBufferForConnack(&connectParams, 0, 0);
-	ret_val = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	snprintf(shadowDeltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, SHADOW_DELTA_UPDATE, AWS_IOT_MY_THING_NAME);
@@ -99,12 +100,12 @@ TEST_C(ShadowDeltaTest, registerDeltaSuccess) {
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
 
-	ret_val = aws_iot_shadow_register_delta(&client, &windowHandler);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &windowHandler);
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	ret_val = aws_iot_shadow_yield(&client, 3000);
+	ret_val = aws_iot_shadow_yield(&shadow, 3000);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	CHECK_EQUAL_C_INT(true, windowOpenData);
@@ -133,12 +134,12 @@ TEST_C(ShadowDeltaTest, registerDeltaInt) {
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
 
-	ret_val = aws_iot_shadow_register_delta(&client, &intHandler);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &intHandler);
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 3000);
+	aws_iot_shadow_yield(&shadow, 3000);
 	CHECK_EQUAL_C_INT(23, intData);
 }
 
@@ -164,12 +165,12 @@ TEST_C(ShadowDeltaTest, registerDeltaIntNoCallback) {
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
 
-	ret_val = aws_iot_shadow_register_delta(&client, &intHandler);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &intHandler);
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 3000);
+	aws_iot_shadow_yield(&shadow, 3000);
 	CHECK_EQUAL_C_INT(23, intData);
 }
 
@@ -197,12 +198,12 @@ TEST_C(ShadowDeltaTest, DeltaNestedObject) {
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
 
-	ret_val = aws_iot_shadow_register_delta(&client, &nestedObjectHandler);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &nestedObjectHandler);
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 3000);
+	aws_iot_shadow_yield(&shadow, 3000);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 }
 
@@ -232,12 +233,12 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
 
-	ret_val = aws_iot_shadow_register_delta(&client, &nestedObjectHandler);
+	ret_val = aws_iot_shadow_register_delta(&shadow, &nestedObjectHandler);
 
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 
 	snprintf(receivedNestedObject, 100, " ");
@@ -250,7 +251,7 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 
 	snprintf(receivedNestedObject, 100, " ");
@@ -263,7 +264,7 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(" ", receivedNestedObject);
 
 	snprintf(receivedNestedObject, 100, " ");
@@ -276,10 +277,10 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 
-	aws_iot_shadow_reset_last_received_version();
+	aws_iot_shadow_reset_last_received_version(&shadow);
 
 	snprintf(receivedNestedObject, 100, " ");
 	snprintf(deltaJSONString, 100, "{\"state\":{\"delta\":{\"%s\":%s}},\"version\":3}", nestedObjectHandler.pKey,
@@ -291,7 +292,7 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 
 	snprintf(receivedNestedObject, 100, " ");
@@ -304,10 +305,10 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(" ", receivedNestedObject);
 
-	aws_iot_shadow_disable_discard_old_delta_msgs();
+	aws_iot_shadow_disable_discard_old_delta_msgs(&shadow);
 
 	snprintf(receivedNestedObject, 100, " ");
 	snprintf(deltaJSONString, 100, "{\"state\":{\"delta\":{\"%s\":%s}},\"version\":3}", nestedObjectHandler.pKey,
@@ -319,6 +320,91 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	ResetTLSBuffer();
 	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
 
-	aws_iot_shadow_yield(&client, 100);
+	aws_iot_shadow_yield(&shadow, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 }
+
+TEST_C(ShadowDeltaTest, DeltaDispatchesAllRegisteredKeys) {
+	IoT_Error_t ret_val = SUCCESS;
+	IoT_Publish_Message_Params params;
+	const char *keys[4] = {"length", "a", "lengthy", "bb"};
+	jsonStruct_t handlers[4];
+	int32_t data[4] = {0, 0, 0, 0};
+	char deltaJSONString[] = "{\"state\":{\"lengthy\":4,\"a\":1,\"length\":3},"
+			"\"metadata\":{\"bb\":2,\"a\":{\"timestamp\":5}},\"version\":1}";
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Delta Tests - Delta dispatches all registered keys \n");
+
+	params.payloadLen = strlen(deltaJSONString);
+	params.payload = deltaJSONString;
+	params.qos = QOS0;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
+
+	// Registered out of order, the keys found in the delta are matched with a single walk
+	for(i = 0; i < 4; i++) {
+		handlers[i].cb = genericCallback;
+		handlers[i].pKey = keys[i];
+		handlers[i].type = SHADOW_JSON_INT32;
+		handlers[i].pData = &data[i];
+		handlers[i].dataLength = sizeof(int32_t);
+		ret_val = aws_iot_shadow_register_delta(&shadow, &handlers[i]);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+
+	ret_val = aws_iot_shadow_yield(&shadow, 3000);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(3, data[0]);
+	CHECK_EQUAL_C_INT(1, data[1]);
+	CHECK_EQUAL_C_INT(4, data[2]);
+	// The keys of the metadata are not values
+	CHECK_EQUAL_C_INT(0, data[3]);
+}
+
+TEST_C(ShadowDeltaTest, DeltaNestedPaths) {
+	IoT_Error_t ret_val = SUCCESS;
+	IoT_Publish_Message_Params params;
+	const char *paths[5] = {"config.radio.txPower", "/config/radio/channel", "config.mode", "radio.mode",
+							"other.txPower"};
+	jsonStruct_t handlers[5];
+	int32_t data[5] = {0, 0, 0, 0, 0};
+	char deltaJSONString[] = "{\"state\":{\"delta\":{\"config\":{\"radio\":{\"txPower\":5,\"channel\":11},"
+			"\"mode\":2}}},\"version\":1}";
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Delta Tests - Delta nested paths \n");
+
+	params.payloadLen = strlen(deltaJSONString);
+	params.payload = deltaJSONString;
+	params.qos = QOS0;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
+
+	for(i = 0; i < 5; i++) {
+		handlers[i].cb = genericCallback;
+		handlers[i].pKey = paths[i];
+		handlers[i].type = SHADOW_JSON_INT32;
+		handlers[i].pData = &data[i];
+		handlers[i].dataLength = sizeof(int32_t);
+		ret_val = aws_iot_shadow_register_delta(&shadow, &handlers[i]);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+
+	ret_val = aws_iot_shadow_yield(&shadow, 3000);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(5, data[0]);
+	CHECK_EQUAL_C_INT(11, data[1]);
+	CHECK_EQUAL_C_INT(2, data[2]);
+	// "mode" is not inside "radio", and no "txPower" is inside "other"
+	CHECK_EQUAL_C_INT(0, data[3]);
+	CHECK_EQUAL_C_INT(0, data[4]);
+}
@@ -31,6 +31,7 @@ static jsonStruct_t dataDoubleHandler;
 static double doubleData = 4.0908f;
 static float floatData = 3.445f;
 static AWS_IoT_Client iotClient;
+static AWS_IoT_Shadow_Context shadow;
 static IoT_Client_Connect_Params connectParams;
 static ShadowInitParameters_t shadowInitParams;
 static ShadowConnectParameters_t shadowConnectParams;
@@ -45,7 +46,7 @@ TEST_GROUP_C_SETUP(ShadowJsonBuilderTests) {
 	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
 	shadowInitParams.disconnectHandler = NULL;
 	shadowInitParams.enableAutoReconnect = false;
-	ret_val = aws_iot_shadow_init(&iotClient, &shadowInitParams);
+	ret_val = aws_iot_shadow_init(&shadow, &iotClient, &shadowInitParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
@@ -53,7 +54,7 @@ TEST_GROUP_C_SETUP(ShadowJsonBuilderTests) {
 	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
 	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
 	setTLSRxBufferForConnack(&connectParams, 0, 0);
-	ret_val = aws_iot_shadow_connect(&iotClient, &shadowConnectParams);
+	ret_val = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	dataFloatHandler.cb = NULL;
@@ -77,7 +78,8 @@ TEST_GROUP_C_TEARDOWN(ShadowJsonBuilderTests) {
 	IOT_UNUSED(rc);
 }
 
-#define TEST_JSON_RESPONSE_UPDATE_DOCUMENT "{\"state\":{\"reported\":{\"doubleData\":4.090800,\"floatData\":3.445000}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
+/* Numbers are written with the fewest digits that read back as the same value, doubleData holds a float literal */
+#define TEST_JSON_RESPONSE_UPDATE_DOCUMENT "{\"state\":{\"reported\":{\"doubleData\":4.090799808502197,\"floatData\":3.445}}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-0\"}"
 
 #define SIZE_OF_UPFATE_BUF 200
 
@@ -92,7 +94,7 @@ TEST_C(ShadowJsonBuilderTests, UpdateTheJSONDocumentBuilder) {
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 	ret_val = aws_iot_shadow_add_reported(updateRequestJson, jsonBufSize, 2, &dataDoubleHandler, &dataFloatHandler);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
-	ret_val = aws_iot_finalize_json_document(updateRequestJson, jsonBufSize);
+	ret_val = aws_iot_finalize_json_document(&shadow, updateRequestJson, jsonBufSize);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
 	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_UPDATE_DOCUMENT, updateRequestJson);
@@ -109,7 +111,7 @@ TEST_C(ShadowJsonBuilderTests, PassingNullValue) {
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, ret_val);
 	ret_val = aws_iot_shadow_add_desired(NULL, SIZE_OF_UPFATE_BUF, 2, &dataDoubleHandler, &dataFloatHandler);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, ret_val);
-	ret_val = aws_iot_finalize_json_document(NULL, SIZE_OF_UPFATE_BUF);
+	ret_val = aws_iot_finalize_json_document(&shadow, NULL, SIZE_OF_UPFATE_BUF);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, ret_val);
 }
 
@@ -126,6 +128,59 @@ TEST_C(ShadowJsonBuilderTests, SmallBuffer) {
 	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, ret_val);
 	ret_val = aws_iot_shadow_add_desired(updateRequestJson, jsonBufSize, 2, &dataDoubleHandler, &dataFloatHandler);
 	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, ret_val);
-	ret_val = aws_iot_finalize_json_document(updateRequestJson, jsonBufSize);
+	ret_val = aws_iot_finalize_json_document(&shadow, updateRequestJson, jsonBufSize);
 	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, ret_val);
 }
+
+TEST_C(ShadowJsonBuilderTests, JsonWriterNumbers) {
+	IoT_Error_t ret_val;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+	ShadowJsonWriter_t writer;
+	jsonStruct_t handler;
+	int32_t intData = -2147483647 - 1;
+	uint32_t uintData = 4294967295u;
+	float floatValues[4] = {0.1f, 100.0f, -0.00125f, 1e20f};
+	double doubleValues[3] = {0.1, 123456.789, 1.0 / 3.0};
+	char expected[SIZE_OF_UPFATE_BUF];
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Json writer numbers \n");
+
+	ret_val = aws_iot_shadow_json_writer_init(&writer, updateRequestJson, sizeof(updateRequestJson));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	aws_iot_shadow_json_writer_begin_section(&writer, "reported");
+
+	handler.cb = NULL;
+	handler.pKey = "i";
+	handler.type = SHADOW_JSON_INT32;
+	handler.pData = &intData;
+	aws_iot_shadow_json_writer_add(&writer, &handler);
+	handler.pKey = "u";
+	handler.type = SHADOW_JSON_UINT32;
+	handler.pData = &uintData;
+	aws_iot_shadow_json_writer_add(&writer, &handler);
+	handler.pKey = "f";
+	handler.type = SHADOW_JSON_FLOAT;
+	for(i = 0; i < 4; i++) {
+		handler.pData = &floatValues[i];
+		aws_iot_shadow_json_writer_add(&writer, &handler);
+	}
+	handler.pKey = "d";
+	handler.type = SHADOW_JSON_DOUBLE;
+	for(i = 0; i < 3; i++) {
+		handler.pData = &doubleValues[i];
+		aws_iot_shadow_json_writer_add(&writer, &handler);
+	}
+	ret_val = aws_iot_shadow_json_writer_end_section(&writer);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(strlen(updateRequestJson), writer.length);
+
+	ret_val = aws_iot_finalize_json_document(&shadow, updateRequestJson, sizeof(updateRequestJson));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	snprintf(expected, sizeof(expected), "{\"state\":{\"reported\":{\"i\":-2147483648,\"u\":4294967295,"
+			 "\"f\":0.1,\"f\":100,\"f\":-0.00125,\"f\":1.00000002e+20,"
+			 "\"d\":0.1,\"d\":123456.789,\"d\":0.3333333333333333}}, \"clientToken\":\"%s-0\"}",
+			 AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_STRING(expected, updateRequestJson);
+}
@@ -29,6 +29,7 @@
 #include "aws_iot_log.h"
 
 static AWS_IoT_Client client;
+static AWS_IoT_Shadow_Context shadow;
 static ShadowInitParameters_t shadowInitParams;
 static ShadowConnectParameters_t shadowConnectParams;
 
@@ -58,7 +59,7 @@ TEST_C(ShadowNullFields, NullHost) {
 	shadowInitParams.pHost = NULL;
 	shadowInitParams.port = AWS_IOT_MQTT_PORT;
 	shadowInitParams.disconnectHandler = NULL;
-	IoT_Error_t rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	IoT_Error_t rc = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
 }
 
@@ -66,7 +67,7 @@ TEST_C(ShadowNullFields, NullPort) {
 	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
 	shadowInitParams.port = 0;
 	shadowInitParams.disconnectHandler = NULL;
-	IoT_Error_t rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	IoT_Error_t rc = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
 }
 
@@ -78,12 +79,12 @@ TEST_C(ShadowNullFields, NullClientID) {
 	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
 	shadowInitParams.disconnectHandler = NULL;
 	shadowInitParams.enableAutoReconnect = false;
-	IoT_Error_t rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	IoT_Error_t rc = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(SUCCESS, rc);
 
 	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
 	shadowConnectParams.pMqttClientId = NULL;
-	rc = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	rc = aws_iot_shadow_connect(&shadow, &shadowConnectParams);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
 }
 
@@ -91,7 +92,7 @@ TEST_C(ShadowNullFields, NullClientInit) {
 	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
 	shadowInitParams.port = AWS_IOT_MQTT_PORT;
 	shadowInitParams.disconnectHandler = NULL;
-	IoT_Error_t rc = aws_iot_shadow_init(NULL, &shadowInitParams);
+	IoT_Error_t rc = aws_iot_shadow_init(NULL, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
 }
 
@@ -103,7 +104,7 @@ TEST_C(ShadowNullFields, NullClientConnect) {
 	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
 	shadowInitParams.disconnectHandler = NULL;
 	shadowInitParams.enableAutoReconnect = false;
-	IoT_Error_t rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	IoT_Error_t rc = aws_iot_shadow_init(&shadow, &client, &shadowInitParams);
 	CHECK_EQUAL_C_INT(SUCCESS, rc);
 
 	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
@@ -114,7 +115,7 @@ TEST_C(ShadowNullFields, NullClientConnect) {
 }
 
 TEST_C(ShadowNullFields, NullUpdateDocument) {
-	IoT_Error_t rc = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_UPDATE, NULL, 0, actionCallbackNullTest,
+	IoT_Error_t rc = aws_iot_shadow_internal_action(&shadow, AWS_IOT_MY_THING_NAME, SHADOW_UPDATE, NULL, 0, actionCallbackNullTest,
 													NULL, 4, false);
 	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
 }
@@ -77,3 +77,21 @@ TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicHashkeyMustBeTheLastFail)
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicWithPluskeySuccess)
 /* C:22 - Subscribe with '+' as last character in topic name, Success */
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicPluskeyComesLastSuccess)
+/* C:23 - Subscribe with '#' as last level, message on the parent level, Success */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicHashkeyMatchesParentLevelSuccess)
+/* C:24 - Subscribe with leading wildcard, message on a topic starting with '$', not delivered */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeLeadingWildcardSkipsDollarTopics)
+/* C:25 - Subscribe, topic filter deeper than the topic trie, Failure */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicTrieFullFailure)
+/* C:26 - Streaming subscribe, message larger than the RX buffer delivered in chunks */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeStreamLargeMessageInChunks)
+/* C:27 - Streaming subscribe, message that fits in the RX buffer delivered as one chunk */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeStreamSmallMessageSingleChunk)
+/* C:28 - Regular subscribe, message larger than the RX buffer dropped, next message delivered */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeLargeMessageWithoutStreamHandlerDropped)
+/* C:29 - Subscribe batch, all topic filters in one SUBSCRIBE, Success */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchSuccess)
+/* C:30 - Subscribe batch, one topic filter refused by the server */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchPartiallyRejected)
+/* C:31 - Subscribe batch, filters do not fit in the TX buffer or SUBACK missing, nothing subscribed */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchFailureRollsBack)
@@ -23,8 +23,12 @@
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
+/* Payload size larger than the RX buffer that still fits in the mocked TLS buffer */
+#define STREAM_TEST_PAYLOAD_LEN (TLSMaxBufferSize - 64)
+
 static IoT_Client_Init_Params initParams;
 static IoT_Client_Connect_Params connectParams;
 static IoT_Publish_Message_Params testPubMsgParams;
@@ -155,6 +159,78 @@ static void iot_subscribe_callback_handler6(AWS_IoT_Client *pClient, char *topic
 	}
 }
 
+static unsigned char StreamedPayload[STREAM_TEST_PAYLOAD_LEN];
+static size_t StreamedLen;
+static size_t StreamedTotalLen;
+static uint32_t StreamedChunkCount;
+static bool StreamedChunksInOrder;
+
+static void iot_subscribe_stream_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+										 IoT_Publish_Message_Params *params, size_t payloadOffset,
+										 size_t payloadTotalLen, void *pData) {
+	if(NULL == pClient || NULL == topicName || 0 == topicNameLen) {
+		return;
+	}
+
+	IOT_UNUSED(pData);
+
+	if(payloadOffset != StreamedLen || payloadOffset + params->payloadLen > sizeof(StreamedPayload)
+	   || params->payloadLen > AWS_IOT_MQTT_RX_BUF_LEN) {
+		StreamedChunksInOrder = false;
+		return;
+	}
+
+	memcpy(StreamedPayload + payloadOffset, params->payload, params->payloadLen);
+	StreamedLen += params->payloadLen;
+	StreamedTotalLen = payloadTotalLen;
+	StreamedChunkCount++;
+}
+
+static void resetStreamedMessage(void) {
+	memset(StreamedPayload, 0, sizeof(StreamedPayload));
+	StreamedLen = 0;
+	StreamedTotalLen = 0;
+	StreamedChunkCount = 0;
+	StreamedChunksInOrder = true;
+}
+
+/* Places a PUBLISH with a patterned payload of the given size in the mocked RX buffer */
+static void setTLSRxBufferWithPatternMsg(const char *topicName, QoS qos, size_t payloadLen) {
+	size_t topicNameLen = strlen(topicName);
+	size_t cursor = 1;
+	size_t i;
+
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[0] = (unsigned char) (0x30 | ((qos << 1) & 0xF));
+	encodeRemainingLength(RxBuffer.pBuffer, &cursor, 2 + topicNameLen + (QOS0 != qos ? 2 : 0) + payloadLen);
+
+	RxBuffer.pBuffer[cursor++] = (unsigned char) ((topicNameLen & 0xFF00) >> 8);
+	RxBuffer.pBuffer[cursor++] = (unsigned char) (topicNameLen & 0xFF);
+	memcpy(&RxBuffer.pBuffer[cursor], topicName, topicNameLen);
+	cursor += topicNameLen;
+	if(QOS0 != qos) {
+		RxBuffer.pBuffer[cursor++] = 2;
+		RxBuffer.pBuffer[cursor++] = 3;
+	}
+	for(i = 0; i < payloadLen; i++) {
+		RxBuffer.pBuffer[cursor++] = (unsigned char) (i % 251);
+	}
+
+	RxBuffer.len = cursor;
+	RxIndex = 0;
+}
+
+static bool isStreamedPayloadPattern(size_t payloadLen) {
+	size_t i;
+
+	for(i = 0; i < payloadLen; i++) {
+		if(StreamedPayload[i] != (unsigned char) (i % 251)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 TEST_GROUP_C_SETUP(SubscribeTests) {
 	IoT_Error_t rc;
 	ResetTLSBuffer();
@@ -604,3 +680,272 @@ TEST_C(SubscribeTests, subscribeTopicPluskeyComesLastSuccess) {
 
 	IOT_DEBUG("-->Success - C:22 - Subscribe with '+' as last character in topic name, Success \n");
 }
+/* C:23 - Subscribe with '#' as last level, message on the parent level, Success */
+TEST_C(SubscribeTests, subscribeTopicHashkeyMatchesParentLevelSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "New message: parent, Hashkey";
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:23 - Subscribe with '#' as last level, message on the parent level, Success \n");
+
+	setTLSRxBufferForSuback("sdk/Test/#", strlen("sdk/Test/#"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "sdk/Test/#", strlen("sdk/Test/#"), QOS1,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// '#' also matches the level it is appended to
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test", strlen("sdk/Test"), QOS1, testPubMsgParams,
+										   expectedCallbackString);
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+
+	IOT_DEBUG("-->Success - C:23 - Subscribe with '#' as last level, message on the parent level, Success \n");
+}
+
+/* C:24 - Subscribe with leading wildcard, message on a topic starting with '$', not delivered */
+TEST_C(SubscribeTests, subscribeLeadingWildcardSkipsDollarTopics) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "New message: dollar, Exact";
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:24 - Subscribe with leading wildcard, message on a topic starting with '$' \n");
+
+	setTLSRxBufferForSuback("#", strlen("#"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "#", strlen("#"), QOS1, iot_subscribe_callback_handler1, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback("+/things/sdk", strlen("+/things/sdk"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "+/things/sdk", strlen("+/things/sdk"), QOS1,
+								iot_subscribe_callback_handler2, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback("$aws/things/sdk", strlen("$aws/things/sdk"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "$aws/things/sdk", strlen("$aws/things/sdk"), QOS1,
+								iot_subscribe_callback_handler3, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	snprintf(CallbackMsgString1, 100, "NOT_VISITED");
+	snprintf(CallbackMsgString2, 100, "NOT_VISITED");
+	snprintf(CallbackMsgString3, 100, "NOT_VISITED");
+	setTLSRxBufferWithMsgOnSubscribedTopic("$aws/things/sdk", strlen("$aws/things/sdk"), QOS1, testPubMsgParams,
+										   expectedCallbackString);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", CallbackMsgString1);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", CallbackMsgString2);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString3);
+
+	IOT_DEBUG("-->Success - C:24 - Subscribe with leading wildcard, message on a topic starting with '$' \n");
+}
+
+/* C:25 - Subscribe, topic filter deeper than the topic trie, Failure */
+TEST_C(SubscribeTests, subscribeTopicTrieFullFailure) {
+	IoT_Error_t rc = SUCCESS;
+	char deepTopic[2 * AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES + 1];
+	int i;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:25 - Subscribe, topic filter deeper than the topic trie, Failure \n");
+
+	// One level per node, plus the root, can't fit
+	for(i = 0; i < AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES; i++) {
+		deepTopic[2 * i] = 'a';
+		deepTopic[2 * i + 1] = '/';
+	}
+	deepTopic[2 * AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES - 1] = '\0';
+
+	setTLSRxBufferForSuback(deepTopic, strlen(deepTopic), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, deepTopic, (uint16_t) strlen(deepTopic), QOS1,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR, rc);
+
+	// Nothing was left behind, the pool is still available for other filters
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(subTopic, subTopicLen, QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS1, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	IOT_DEBUG("-->Success - C:25 - Subscribe, topic filter deeper than the topic trie, Failure \n");
+}
+
+/* C:26 - Streaming subscribe, message larger than the RX buffer delivered in chunks */
+TEST_C(SubscribeTests, subscribeStreamLargeMessageInChunks) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:26 - Streaming subscribe, message larger than the RX buffer delivered in chunks \n");
+
+	setTLSRxBufferForSuback("sdk/Stream", strlen("sdk/Stream"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe_stream(&iotClient, "sdk/Stream", strlen("sdk/Stream"), QOS1,
+									   iot_subscribe_stream_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	resetStreamedMessage();
+	setTLSRxBufferWithPatternMsg("sdk/Stream", QOS1, STREAM_TEST_PAYLOAD_LEN);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(StreamedChunksInOrder);
+	CHECK_C(1 < StreamedChunkCount);
+	CHECK_EQUAL_C_INT(STREAM_TEST_PAYLOAD_LEN, StreamedLen);
+	CHECK_EQUAL_C_INT(STREAM_TEST_PAYLOAD_LEN, StreamedTotalLen);
+	CHECK_C(isStreamedPayloadPattern(STREAM_TEST_PAYLOAD_LEN));
+	// Acknowledged once the last chunk is delivered
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePuback());
+
+	IOT_DEBUG("-->Success - C:26 - Streaming subscribe, message larger than the RX buffer delivered in chunks \n");
+}
+
+/* C:27 - Streaming subscribe, message that fits in the RX buffer delivered as one chunk */
+TEST_C(SubscribeTests, subscribeStreamSmallMessageSingleChunk) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:27 - Streaming subscribe, message that fits in the RX buffer delivered as one chunk \n");
+
+	setTLSRxBufferForSuback("sdk/Stream", strlen("sdk/Stream"), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe_stream(&iotClient, "sdk/Stream", strlen("sdk/Stream"), QOS0,
+									   iot_subscribe_stream_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	resetStreamedMessage();
+	setTLSRxBufferWithPatternMsg("sdk/Stream", QOS0, 100);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(StreamedChunksInOrder);
+	CHECK_EQUAL_C_INT(1, StreamedChunkCount);
+	CHECK_EQUAL_C_INT(100, StreamedLen);
+	CHECK_EQUAL_C_INT(100, StreamedTotalLen);
+	CHECK_C(isStreamedPayloadPattern(100));
+
+	IOT_DEBUG("-->Success - C:27 - Streaming subscribe, message that fits in the RX buffer delivered as one chunk \n");
+}
+
+/* C:28 - Regular subscribe, message larger than the RX buffer dropped, next message delivered */
+TEST_C(SubscribeTests, subscribeLargeMessageWithoutStreamHandlerDropped) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "Message after a dropped one";
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:28 - Regular subscribe, message larger than the RX buffer dropped \n");
+
+	setTLSRxBufferForSuback(subTopic, subTopicLen, QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS1, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+	setTLSRxBufferWithPatternMsg(subTopic, QOS1, STREAM_TEST_PAYLOAD_LEN);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(MQTT_RX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", CallbackMsgString);
+
+	// The whole packet was consumed, the stream is still in sync
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(subTopic, subTopicLen, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+
+	IOT_DEBUG("-->Success - C:28 - Regular subscribe, message larger than the RX buffer dropped \n");
+}
+
+static uint32_t iot_tests_unit_count_message_handlers(void) {
+	uint32_t itr, count = 0;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		if(NULL != iotClient.clientData.messageHandlers[itr].topicName) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* C:29 - Subscribe batch, all topic filters in one SUBSCRIBE, Success */
+TEST_C(SubscribeTests, subscribeBatchSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "Message for the second topic";
+	const unsigned char returnCodes[3] = {QOS0, QOS1, QOS0};
+	IoT_Subscribe_Topic_Params topics[3] = {
+			{"sdk/Batch/1", 11, QOS0, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Batch/2", 11, QOS1, iot_subscribe_callback_handler2, NULL},
+			{"sdk/Batch/3", 11, QOS0, iot_subscribe_callback_handler3, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:29 - Subscribe batch, Success \n");
+
+	setTLSRxBufferForSubackWithReturnCodes(returnCodes, 3);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topics, 3);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(3, iot_tests_unit_count_message_handlers());
+	// One packet: header, remaining length, packet id and three filters with their QoS
+	CHECK_EQUAL_C_INT(0x82, TxBuf[0]);
+	CHECK_EQUAL_C_INT(2 + 3 * (2 + 11 + 1), TxBuf[1]);
+	CHECK_EQUAL_C_STRING("sdk/Batch/1", LastSubscribeMessage);
+
+	ResetTLSBuffer();
+	snprintf(CallbackMsgString2, 100, "NOT_VISITED");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Batch/2", 11, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString2);
+
+	IOT_DEBUG("-->Success - C:29 - Subscribe batch, Success \n");
+}
+
+/* C:30 - Subscribe batch, one topic filter refused by the server */
+TEST_C(SubscribeTests, subscribeBatchPartiallyRejected) {
+	IoT_Error_t rc = SUCCESS;
+	const unsigned char returnCodes[2] = {QOS0, 0x80};
+	IoT_Subscribe_Topic_Params topics[2] = {
+			{"sdk/Batch/1", 11, QOS0, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Denied", 10, QOS0, iot_subscribe_callback_handler2, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:30 - Subscribe batch, one topic filter refused \n");
+
+	setTLSRxBufferForSubackWithReturnCodes(returnCodes, 2);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topics, 2);
+	CHECK_EQUAL_C_INT(MQTT_SUBSCRIBE_REJECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(1, iot_tests_unit_count_message_handlers());
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - C:30 - Subscribe batch, one topic filter refused \n");
+}
+
+/* C:31 - Subscribe batch, filters do not fit in the TX buffer or SUBACK missing, nothing subscribed */
+TEST_C(SubscribeTests, subscribeBatchFailureRollsBack) {
+	IoT_Error_t rc = SUCCESS;
+	size_t writeBufSize = iotClient.clientData.writeBufSize;
+	IoT_Subscribe_Topic_Params topics[2] = {
+			{"sdk/Batch/1", 11, QOS0, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Batch/2", 11, QOS0, iot_subscribe_callback_handler2, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:31 - Subscribe batch, failures leave nothing subscribed \n");
+
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, NULL, 2);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topics, 0);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	iotClient.clientData.writeBufSize = 2 + 2 + (2 + 11 + 1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topics, 2);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, iot_tests_unit_count_message_handlers());
+	iotClient.clientData.writeBufSize = writeBufSize;
+
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topics, 2);
+	CHECK_EQUAL_C_INT(NETWORK_SSL_READ_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, iot_tests_unit_count_message_handlers());
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - C:31 - Subscribe batch, failures leave nothing subscribed \n");
+}
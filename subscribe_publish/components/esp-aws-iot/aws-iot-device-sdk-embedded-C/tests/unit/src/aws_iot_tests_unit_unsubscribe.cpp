@@ -53,3 +53,7 @@ TEST_GROUP_C_WRAPPER(UnsubscribeTests, MsgAfterUnsubscribe)
 TEST_GROUP_C_WRAPPER(UnsubscribeTests, MaxTopicsSubscription)
 /* D:12 - Repeated Subscribe and Unsubscribe */
 TEST_GROUP_C_WRAPPER(UnsubscribeTests, RepeatedSubUnSub)
+/* D:13 - Unsubscribe one of two topics sharing levels, message on the other topic received */
+TEST_GROUP_C_WRAPPER(UnsubscribeTests, UnsubscribeSharedLevelsKeepsSibling)
+/* D:14 - Unsubscribe batch, two topics removed with one UNSUBSCRIBE */
+TEST_GROUP_C_WRAPPER(UnsubscribeTests, UnsubscribeBatchSuccess)
@@ -341,3 +341,94 @@ TEST_C(UnsubscribeTests, RepeatedSubUnSub) {
 
 	IOT_DEBUG("-->Success - D:12 - Repeated Subscribe and Unsubscribe \n");
 }
+
+/* D:13 - Unsubscribe one of two topics sharing levels, message on the other topic received
+ * 1. subscribe to two topics which only differ by their last level
+ * 2. unsubscribe the first one and overwrite its topic name buffer
+ * 3. ensure the message on the second topic is still received
+ */
+TEST_C(UnsubscribeTests, UnsubscribeSharedLevelsKeepsSibling) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "New message: sibling";
+	char firstTopic[16] = "sdk/Test/first";
+	char secondTopic[16] = "sdk/Test/second";
+
+	IOT_DEBUG("-->Running Unsubscribe Tests - D:13 - Unsubscribe one of two topics sharing levels \n");
+
+	//1.
+	setTLSRxBufferForSuback(firstTopic, strlen(firstTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, firstTopic, (uint16_t) strlen(firstTopic), QOS0,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferForSuback(secondTopic, strlen(secondTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, secondTopic, (uint16_t) strlen(secondTopic), QOS0,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	//2.
+	setTLSRxBufferForUnsuback();
+	rc = aws_iot_mqtt_unsubscribe(&iotClient, firstTopic, (uint16_t) strlen(firstTopic));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	memset(firstTopic, 'x', sizeof(firstTopic) - 1);
+
+	//3.
+	setTLSRxBufferWithMsgOnSubscribedTopic(secondTopic, strlen(secondTopic), QOS1, testPubMsgParams,
+										   expectedCallbackString);
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+
+	IOT_DEBUG("-->Success - D:13 - Unsubscribe one of two topics sharing levels \n");
+}
+
+/* D:14 - Unsubscribe batch, two topics removed with one UNSUBSCRIBE
+ * 1. subscribe to two topics
+ * 2. unsubscribe from both in a single call
+ * 3. ensure no handler is left and a message on either topic is not delivered
+ */
+TEST_C(UnsubscribeTests, UnsubscribeBatchSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "Message after unsubscribe";
+	char firstTopic[16] = "sdk/Test/first";
+	char secondTopic[16] = "sdk/Test/second";
+	const char *topicFilters[2] = {firstTopic, secondTopic};
+	uint16_t topicFilterLens[2] = {14, 15};
+	uint32_t itr;
+
+	IOT_DEBUG("-->Running Unsubscribe Tests - D:14 - Unsubscribe batch \n");
+
+	//1.
+	setTLSRxBufferForSuback(firstTopic, strlen(firstTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, firstTopic, topicFilterLens[0], QOS0, iot_subscribe_callback_handler,
+								NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferForSuback(secondTopic, strlen(secondTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, secondTopic, topicFilterLens[1], QOS0, iot_subscribe_callback_handler,
+								NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	//2.
+	rc = aws_iot_mqtt_unsubscribe_batch(&iotClient, topicFilters, topicFilterLens, 0);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	setTLSRxBufferForUnsuback();
+	rc = aws_iot_mqtt_unsubscribe_batch(&iotClient, topicFilters, topicFilterLens, 2);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	//3.
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		CHECK_C(NULL == iotClient.clientData.messageHandlers[itr].topicName);
+	}
+
+	setTLSRxBufferWithMsgOnSubscribedTopic(secondTopic, strlen(secondTopic), QOS0, testPubMsgParams,
+										   expectedCallbackString);
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", CallbackMsgString);
+
+	IOT_DEBUG("-->Success - D:14 - Unsubscribe batch \n");
+}
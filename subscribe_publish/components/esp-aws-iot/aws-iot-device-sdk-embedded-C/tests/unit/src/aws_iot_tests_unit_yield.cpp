@@ -55,3 +55,22 @@ TEST_GROUP_C_WRAPPER(YieldTests, resubscribeSuccessfulReconnect)
 
 /* G:13 - Delayed Ping response. */
 TEST_GROUP_C_WRAPPER(YieldTests, delayedPingResponse)
+
+/* G:14 - Yield, network waits for data, no incoming messages */
+TEST_GROUP_C_WRAPPER(YieldTests, waitForDataNoMessages)
+/* G:15 - Yield, network waits for data, message on subscribed topic */
+TEST_GROUP_C_WRAPPER(YieldTests, waitForDataMessageOnSubscribedTopic)
+/* G:16 - Yield, network waits for data, wait ends at the keep alive deadline */
+TEST_GROUP_C_WRAPPER(YieldTests, waitForDataKeepAliveDeadline)
+/* G:17 - Yield wakeup */
+TEST_GROUP_C_WRAPPER(YieldTests, yieldWakeup)
+/* G:18 - Auto-reconnect, reported link up skips the backoff */
+TEST_GROUP_C_WRAPPER(YieldTests, autoReconnectLinkUp)
+/* G:19 - Auto-reconnect keeps retrying once the maximum wait is reached */
+TEST_GROUP_C_WRAPPER(YieldTests, autoReconnectRetriesAtMaxInterval)
+/* G:20 - Auto-reconnect waits are drawn with decorrelated jitter */
+TEST_GROUP_C_WRAPPER(YieldTests, autoReconnectDecorrelatedJitter)
+/* G:21 - Auto-reconnect with an application reconnect policy */
+TEST_GROUP_C_WRAPPER(YieldTests, autoReconnectPolicy)
+/* G:22 - Reconnect latency is measured from a disconnect that auto-reconnect did not handle */
+TEST_GROUP_C_WRAPPER(YieldTests, reconnectLatencyAfterManualReconnect)
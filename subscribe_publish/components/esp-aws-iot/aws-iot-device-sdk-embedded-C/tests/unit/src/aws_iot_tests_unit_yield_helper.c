@@ -38,6 +38,57 @@ static uint16_t subTopicLen = 8;
 
 static bool dcHandlerInvoked = false;
 
+static uint32_t policyCallCount = 0;
+static uint32_t policyPreviousWaitMs = 0;
+
+static uint32_t iot_tests_unit_fixed_reconnect_policy(void *pPolicyData, uint32_t previousWait_ms) {
+	policyCallCount++;
+	policyPreviousWaitMs = previousWait_ms;
+	return *((uint32_t *) pPolicyData);
+}
+
+static uint32_t waitForDataCallCount = 0;
+static uint32_t firstWaitForDataMs = 0;
+static bool wakeupPending = false;
+
+/* Stands in for a socket wait: returns as soon as the mock has data, otherwise sleeps the whole wait */
+static IoT_Error_t iot_tests_unit_wait_for_data(Network *pNetwork, Timer *pTimer) {
+	uint32_t waitMs = left_ms(pTimer);
+
+	IOT_UNUSED(pNetwork);
+
+	if(0 == waitForDataCallCount) {
+		firstWaitForDataMs = waitMs;
+	}
+	waitForDataCallCount++;
+
+	if(wakeupPending) {
+		wakeupPending = false;
+		return NETWORK_WAIT_INTERRUPTED;
+	}
+
+	if(RxBuffer.len > RxIndex) {
+		return SUCCESS;
+	}
+
+	usleep(waitMs * 1000);
+	return NETWORK_SSL_NOTHING_TO_READ;
+}
+
+static IoT_Error_t iot_tests_unit_wakeup(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	wakeupPending = true;
+	return SUCCESS;
+}
+
+static void iot_tests_unit_install_wait_for_data(void) {
+	waitForDataCallCount = 0;
+	firstWaitForDataMs = 0;
+	wakeupPending = false;
+	iotClient.networkStack.waitForData = iot_tests_unit_wait_for_data;
+	iotClient.networkStack.wakeup = iot_tests_unit_wakeup;
+}
+
 static void iot_tests_unit_acr_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicName,
 														  uint16_t topicNameLen,
 														  IoT_Publish_Message_Params *params, void *pData) {
@@ -313,7 +364,10 @@ TEST_C(YieldTests, disconnectAutoReconnectSuccess) {
 	rc = aws_iot_mqtt_yield(&iotClient, 100);
 	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
 
-	sleep(2); /* Default min reconnect delay is 1 sec */
+	/* The first wait is drawn between the minimum and three times the minimum */
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+	CHECK_C(3 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL >= iotClient.clientData.currentReconnectWaitInterval);
+	sleep(iotClient.clientData.currentReconnectWaitInterval / 1000 + 1);
 	printf("\nWakeup");
 	setTLSRxBufferForConnack(&connectParams, 0, 0);
 	rc = aws_iot_mqtt_yield(&iotClient, 100);
@@ -426,7 +480,10 @@ TEST_C(YieldTests, resubscribeSuccessfulReconnect) {
 	rc = aws_iot_mqtt_yield(&iotClient, 100);
 	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
 
-	sleep(2); /* Default min reconnect delay is 1 sec */
+	/* The first wait is drawn between the minimum and three times the minimum */
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+	CHECK_C(3 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL >= iotClient.clientData.currentReconnectWaitInterval);
+	sleep(iotClient.clientData.currentReconnectWaitInterval / 1000 + 1);
 
 	ResetTLSBuffer();
 	setTLSRxBufferForConnackAndSuback(&connectParams, 0, subTopic, subTopicLen, QOS1);
@@ -491,3 +548,309 @@ TEST_C(YieldTests, delayedPingResponse)
 
 	IOT_DEBUG("-->Success - G:13 - Delayed Ping response. \n");
 }
+
+/* G:14 - Yield, network waits for data, no incoming messages */
+TEST_C(YieldTests, waitForDataNoMessages) {
+	IoT_Error_t rc = FAILURE;
+
+	IOT_DEBUG("-->Running Yield Tests - G:14 - Yield, network waits for data, no incoming messages \n");
+
+	iot_tests_unit_install_wait_for_data();
+	ResetTLSBuffer();
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* The yield sleeps in the network instead of polling it for the whole timeout */
+	CHECK_C(0 < waitForDataCallCount);
+	CHECK_C(3 >= waitForDataCallCount);
+	CHECK_C(100 >= firstWaitForDataMs);
+	CHECK_EQUAL_C_INT(0, RxIndex);
+
+	IOT_DEBUG("-->Success - G:14 - Yield, network waits for data, no incoming messages \n");
+}
+
+/* G:15 - Yield, network waits for data, message on subscribed topic */
+TEST_C(YieldTests, waitForDataMessageOnSubscribedTopic) {
+	IoT_Error_t rc = FAILURE;
+	char expectedCallbackString[] = "0xA5A5A3";
+
+	IOT_DEBUG("-->Running Yield Tests - G:15 - Yield, network waits for data, message on subscribed topic \n");
+
+	setTLSRxBufferForSuback(subTopic, subTopicLen, QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS1, iot_tests_unit_acr_subscribe_callback_handler,
+								NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	iot_tests_unit_install_wait_for_data();
+	memset(CallbackMsgString, 0, sizeof(CallbackMsgString));
+	setTLSRxBufferWithMsgOnSubscribedTopic(subTopic, subTopicLen, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePuback());
+
+	IOT_DEBUG("-->Success - G:15 - Yield, network waits for data, message on subscribed topic \n");
+}
+
+/* G:16 - Yield, network waits for data, wait ends at the keep alive deadline */
+TEST_C(YieldTests, waitForDataKeepAliveDeadline) {
+	IoT_Error_t rc = FAILURE;
+
+	IOT_DEBUG("-->Running Yield Tests - G:16 - Yield, network waits for data, wait ends at the keep alive deadline \n");
+
+	iot_tests_unit_install_wait_for_data();
+	ResetTLSBuffer();
+
+	/* Next ping is due long before the yield timeout */
+	countdown_ms(&(iotClient.pingReqTimer), 50);
+	rc = aws_iot_mqtt_yield(&iotClient, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(50 >= firstWaitForDataMs);
+	CHECK_EQUAL_C_INT(true, isLastTLSTxMessagePingreq());
+
+	IOT_DEBUG("-->Success - G:16 - Yield, network waits for data, wait ends at the keep alive deadline \n");
+}
+
+/* G:17 - Yield wakeup */
+TEST_C(YieldTests, yieldWakeup) {
+	IoT_Error_t rc = FAILURE;
+	Timer elapsedTimer;
+
+	IOT_DEBUG("-->Running Yield Tests - G:17 - Yield wakeup \n");
+
+	rc = aws_iot_mqtt_yield_wakeup(NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	/* The mock network cannot be woken up */
+	rc = aws_iot_mqtt_yield_wakeup(&iotClient);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+
+	iot_tests_unit_install_wait_for_data();
+	ResetTLSBuffer();
+
+	/* A wakeup requested before the yield makes it return at its first wait */
+	rc = aws_iot_mqtt_yield_wakeup(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	init_timer(&elapsedTimer);
+	countdown_ms(&elapsedTimer, 1000);
+	rc = aws_iot_mqtt_yield(&iotClient, 2000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, waitForDataCallCount);
+	CHECK_EQUAL_C_INT(false, has_timer_expired(&elapsedTimer));
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - G:17 - Yield wakeup \n");
+}
+
+/* G:18 - Auto-reconnect, reported link up skips the backoff */
+TEST_C(YieldTests, autoReconnectLinkUp) {
+	IoT_Error_t rc = FAILURE;
+	IoT_Reconnect_Stats stats;
+
+	IOT_DEBUG("-->Running Yield Tests - G:18 - Auto-reconnect, reported link up skips the backoff \n");
+
+	rc = aws_iot_mqtt_autoreconnect_link_up(NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	wakeupPending = false;
+	iotClient.networkStack.wakeup = iot_tests_unit_wakeup;
+
+	/* Nothing to skip while connected */
+	rc = aws_iot_mqtt_autoreconnect_link_up(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, iotClient.clientStatus.isLinkUpReported);
+	CHECK_EQUAL_C_INT(false, wakeupPending);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+
+	/* The reconnect happens without waiting for the backoff, a waiting yield is woken up */
+	rc = aws_iot_mqtt_autoreconnect_link_up(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, wakeupPending);
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_client_connected(&iotClient));
+
+	rc = aws_iot_mqtt_get_reconnect_stats(&iotClient, &stats);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, stats.attemptCount);
+	CHECK_EQUAL_C_INT(1, stats.reconnectCount);
+	CHECK_C(1000 > stats.lastLatency_ms);
+	CHECK_EQUAL_C_INT(stats.lastLatency_ms, stats.maxLatency_ms);
+	CHECK_EQUAL_C_INT(1, stats.latencyHistogram[0]);
+
+	aws_iot_mqtt_reset_reconnect_stats(&iotClient);
+	rc = aws_iot_mqtt_get_reconnect_stats(&iotClient, &stats);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, stats.reconnectCount);
+	CHECK_EQUAL_C_INT(0, stats.latencyHistogram[0]);
+
+	IOT_DEBUG("-->Success - G:18 - Auto-reconnect, reported link up skips the backoff \n");
+}
+
+/* G:19 - Auto-reconnect keeps retrying once the maximum wait is reached */
+TEST_C(YieldTests, autoReconnectRetriesAtMaxInterval) {
+	IoT_Error_t rc = FAILURE;
+	IoT_Reconnect_Stats stats;
+
+	IOT_DEBUG("-->Running Yield Tests - G:19 - Auto-reconnect keeps retrying once the maximum wait is reached \n");
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+
+	/* As after a long outage, the last wait was the maximum and it is over */
+	iotClient.clientData.currentReconnectWaitInterval = AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL;
+	init_timer(&(iotClient.reconnectDelayTimer));
+	setTLSRxBufferForConnack(&connectParams, 0, 5);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_PENDING_RECONNECT, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+	CHECK_C(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL >= iotClient.clientData.currentReconnectWaitInterval);
+
+	init_timer(&(iotClient.reconnectDelayTimer));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_client_connected(&iotClient));
+
+	rc = aws_iot_mqtt_get_reconnect_stats(&iotClient, &stats);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, stats.attemptCount);
+	CHECK_EQUAL_C_INT(1, stats.reconnectCount);
+
+	IOT_DEBUG("-->Success - G:19 - Auto-reconnect keeps retrying once the maximum wait is reached \n");
+}
+
+/* G:20 - Auto-reconnect waits are drawn with decorrelated jitter */
+TEST_C(YieldTests, autoReconnectDecorrelatedJitter) {
+	IoT_Error_t rc = FAILURE;
+	uint32_t previousWaitMs, upperWaitMs, firstWaitMs;
+	bool isJittered = false;
+	int itr;
+
+	IOT_DEBUG("-->Running Yield Tests - G:20 - Auto-reconnect waits are drawn with decorrelated jitter \n");
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	firstWaitMs = iotClient.clientData.currentReconnectWaitInterval;
+
+	/* Each refused attempt draws the next wait from the previous one */
+	for(itr = 0; itr < 20; itr++) {
+		previousWaitMs = iotClient.clientData.currentReconnectWaitInterval;
+		upperWaitMs = 3 * previousWaitMs;
+		if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < upperWaitMs) {
+			upperWaitMs = AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL;
+		}
+
+		init_timer(&(iotClient.reconnectDelayTimer));
+		setTLSRxBufferForConnack(&connectParams, 0, 5);
+		rc = aws_iot_mqtt_yield(&iotClient, 10);
+		CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+		CHECK_C(upperWaitMs >= iotClient.clientData.currentReconnectWaitInterval);
+		if(firstWaitMs != iotClient.clientData.currentReconnectWaitInterval) {
+			isJittered = true;
+		}
+	}
+	CHECK_C(isJittered);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_PENDING_RECONNECT, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - G:20 - Auto-reconnect waits are drawn with decorrelated jitter \n");
+}
+
+/* G:21 - Auto-reconnect with an application reconnect policy */
+TEST_C(YieldTests, autoReconnectPolicy) {
+	IoT_Error_t rc = FAILURE;
+	uint32_t waitMs = 300;
+	IoT_Reconnect_Policy policy = {iot_tests_unit_fixed_reconnect_policy, &waitMs};
+
+	IOT_DEBUG("-->Running Yield Tests - G:21 - Auto-reconnect with an application reconnect policy \n");
+
+	rc = aws_iot_mqtt_autoreconnect_set_policy(NULL, &policy);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	policyCallCount = 0;
+	rc = aws_iot_mqtt_autoreconnect_set_policy(&iotClient, &policy);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	CHECK_EQUAL_C_INT(1, policyCallCount);
+	CHECK_EQUAL_C_INT(0, policyPreviousWaitMs);
+	CHECK_EQUAL_C_INT(300, iotClient.clientData.currentReconnectWaitInterval);
+
+	/* The attempt is made once the wait chosen by the policy is over */
+	setTLSRxBufferForConnack(&connectParams, 0, 5);
+	usleep(350 * 1000);
+	rc = aws_iot_mqtt_yield(&iotClient, 10);
+	CHECK_EQUAL_C_INT(2, policyCallCount);
+	CHECK_EQUAL_C_INT(300, policyPreviousWaitMs);
+
+	rc = aws_iot_mqtt_autoreconnect_set_policy(&iotClient, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(NULL == iotClient.clientData.reconnectPolicy.nextWait);
+
+	IOT_DEBUG("-->Success - G:21 - Auto-reconnect with an application reconnect policy \n");
+}
+
+/* G:22 - Reconnect latency is measured from a disconnect that auto-reconnect did not handle */
+TEST_C(YieldTests, reconnectLatencyAfterManualReconnect) {
+	IoT_Error_t rc = FAILURE;
+	IoT_Reconnect_Stats stats;
+
+	IOT_DEBUG("-->Running Yield Tests - G:22 - Reconnect latency is measured from a disconnect that auto-reconnect did not handle \n");
+
+	aws_iot_mqtt_autoreconnect_set_status(&iotClient, false);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(false, iotClient.clientStatus.isReconnectTimed);
+
+	/* The failed attempt leaves the client pending reconnect, with the latency timer running */
+	setTLSRxBufferForConnack(&connectParams, 0, 5);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_PENDING_RECONNECT, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_EQUAL_C_INT(true, iotClient.clientStatus.isReconnectTimed);
+	CHECK_C(0 < left_ms(&(iotClient.reconnectLatencyTimer)));
+
+	init_timer(&(iotClient.reconnectDelayTimer));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_client_connected(&iotClient));
+	CHECK_EQUAL_C_INT(false, iotClient.clientStatus.isReconnectTimed);
+
+	rc = aws_iot_mqtt_get_reconnect_stats(&iotClient, &stats);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, stats.reconnectCount);
+	CHECK_C(1000 > stats.lastLatency_ms);
+
+	IOT_DEBUG("-->Success - G:22 - Reconnect latency is measured from a disconnect that auto-reconnect did not handle \n");
+}
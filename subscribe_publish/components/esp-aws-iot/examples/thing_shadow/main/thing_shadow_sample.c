@@ -215,6 +215,7 @@ void aws_iot_task(void *param) {
 
     // initialize the mqtt client
     AWS_IoT_Client mqttClient;
+    static AWS_IoT_Shadow_Context shadowContext;
 
     ShadowInitParameters_t sp = ShadowInitParametersDefault;
     sp.pHost = AWS_IOT_MQTT_HOST;
@@ -253,7 +254,7 @@ void aws_iot_task(void *param) {
                         false, true, portMAX_DELAY);
 
     ESP_LOGI(TAG, "Shadow Init");
-    rc = aws_iot_shadow_init(&mqttClient, &sp);
+    rc = aws_iot_shadow_init(&shadowContext, &mqttClient, &sp);
     if(SUCCESS != rc) {
         ESP_LOGE(TAG, "aws_iot_shadow_init returned error %d, aborting...", rc);
         abort();
@@ -265,7 +266,7 @@ void aws_iot_task(void *param) {
     scp.mqttClientIdLen = (uint16_t) strlen(CONFIG_AWS_EXAMPLE_CLIENT_ID);
 
     ESP_LOGI(TAG, "Shadow Connect");
-    rc = aws_iot_shadow_connect(&mqttClient, &scp);
+    rc = aws_iot_shadow_connect(&shadowContext, &scp);
     if(SUCCESS != rc) {
         ESP_LOGE(TAG, "aws_iot_shadow_connect returned error %d, aborting...", rc);
         abort();
@@ -276,13 +277,13 @@ void aws_iot_task(void *param) {
      *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
      *  #AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL
      */
-    rc = aws_iot_shadow_set_autoreconnect_status(&mqttClient, true);
+    rc = aws_iot_shadow_set_autoreconnect_status(&shadowContext, true);
     if(SUCCESS != rc) {
         ESP_LOGE(TAG, "Unable to set Auto Reconnect to true - %d, aborting...", rc);
         abort();
     }
 
-    rc = aws_iot_shadow_register_delta(&mqttClient, &windowActuator);
+    rc = aws_iot_shadow_register_delta(&shadowContext, &windowActuator);
 
     if(SUCCESS != rc) {
         ESP_LOGE(TAG, "Shadow Register Delta Error");
@@ -291,9 +292,9 @@ void aws_iot_task(void *param) {
 
     // loop and publish a change in temperature
     while(NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc) {
-        rc = aws_iot_shadow_yield(&mqttClient, 200);
+        rc = aws_iot_shadow_yield(&shadowContext, 200);
         if(NETWORK_ATTEMPTING_RECONNECT == rc || shadowUpdateInProgress) {
-            rc = aws_iot_shadow_yield(&mqttClient, 1000);
+            rc = aws_iot_shadow_yield(&shadowContext, 1000);
             // If the client is attempting to reconnect, or already waiting on a shadow update,
             // we will skip the rest of the loop.
             continue;
@@ -307,10 +308,10 @@ void aws_iot_task(void *param) {
             rc = aws_iot_shadow_add_reported(JsonDocumentBuffer, sizeOfJsonDocumentBuffer, 2, &temperatureHandler,
                                              &windowActuator);
             if(SUCCESS == rc) {
-                rc = aws_iot_finalize_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
+                rc = aws_iot_finalize_json_document(&shadowContext, JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
                 if(SUCCESS == rc) {
                     ESP_LOGI(TAG, "Update Shadow: %s", JsonDocumentBuffer);
-                    rc = aws_iot_shadow_update(&mqttClient, CONFIG_AWS_EXAMPLE_THING_NAME, JsonDocumentBuffer,
+                    rc = aws_iot_shadow_update(&shadowContext, CONFIG_AWS_EXAMPLE_THING_NAME, JsonDocumentBuffer,
                                                ShadowUpdateStatusCallback, NULL, 4, true);
                     shadowUpdateInProgress = true;
                 }
@@ -327,7 +328,7 @@ void aws_iot_task(void *param) {
     }
 
     ESP_LOGI(TAG, "Disconnecting");
-    rc = aws_iot_shadow_disconnect(&mqttClient);
+    rc = aws_iot_shadow_disconnect(&shadowContext);
 
     if(SUCCESS != rc) {
         ESP_LOGE(TAG, "Disconnect error %d", rc);
@@ -40,6 +40,9 @@
 #define AWS_IOT_MQTT_TX_BUF_LEN CONFIG_AWS_IOT_MQTT_TX_BUF_LEN ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_RX_BUF_LEN CONFIG_AWS_IOT_MQTT_RX_BUF_LEN ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS CONFIG_AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH CONFIG_AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH ///< Maximum number of asynchronous QoS1 publishes that can be awaiting a PUBACK at any given time
+#define AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES CONFIG_AWS_IOT_MQTT_NUM_TOPIC_TRIE_NODES ///< Number of topic levels, shared between all subscribed topic filters, the MQTT client can index for dispatch
+#define AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS CONFIG_AWS_IOT_MQTT_OFFLINE_QUEUE_DRAIN_INTERVAL_MS ///< Minimum time between two messages sent from the offline queue
 
 // Thing Shadow specific configs
 #ifdef CONFIG_AWS_IOT_OVERRIDE_THING_SHADOW_RX_BUFFER
@@ -54,17 +57,26 @@
 #define MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME CONFIG_AWS_IOT_SHADOW_MAX_SIMULTANEOUS_ACKS ///< At Any given time we will wait for this many responses. This will correlate to the rate at which the shadow actions are requested
 #define MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME CONFIG_AWS_IOT_SHADOW_MAX_SIMULTANEOUS_THINGNAMES ///< We could perform shadow action on any thing Name and this is maximum Thing Names we can act on at any given time
 #define MAX_JSON_TOKEN_EXPECTED CONFIG_AWS_IOT_SHADOW_MAX_JSON_TOKEN_EXPECTED ///< These are the max tokens that is expected to be in the Shadow JSON document. Include the metadata that gets published
+#define MAX_SHADOW_REPORTED_FIELDS CONFIG_AWS_IOT_SHADOW_MAX_REPORTED_FIELDS ///< Maximum number of reported fields whose last value is tracked for aws_iot_shadow_update_changed
+#define MAX_SHADOW_REPORTED_TEXT_LENGTH CONFIG_AWS_IOT_SHADOW_MAX_REPORTED_TEXT_LENGTH ///< Longest string or object value, terminator included, whose last reported text is kept
+#define SHADOW_COALESCE_WINDOW_MS CONFIG_AWS_IOT_SHADOW_COALESCE_WINDOW_MS ///< Time aws_iot_shadow_update_coalesced collects field changes before they are sent as one update
+#define MAX_SHADOW_COALESCED_FIELDS CONFIG_AWS_IOT_SHADOW_MAX_COALESCED_FIELDS ///< Maximum number of distinct fields in one coalesced update, the update is sent early when more are added
+#define MAX_SHADOW_COALESCED_CALLBACKS CONFIG_AWS_IOT_SHADOW_MAX_COALESCED_CALLBACKS ///< Maximum number of callers waiting on the response of coalesced updates
 #define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME CONFIG_AWS_IOT_SHADOW_MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME ///< All shadow actions have to be published or subscribed to a topic which is of the formablogt $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
 #define MAX_SIZE_OF_THING_NAME CONFIG_AWS_IOT_SHADOW_MAX_SIZE_OF_THING_NAME ///< The Thing Name should not be bigger than this value. Modify this if the Thing Name needs to be bigger
 #define MAX_SHADOW_TOPIC_LENGTH_BYTES (MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME) ///< This size includes the length of topic with Thing Name
 
 // Auto Reconnect specific config
-#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
-#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL ///< Maximum time interval after which exponential back-off will stop attempting to reconnect.
+#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL ///< Shortest wait between reconnect attempts, the first wait is drawn between this and three times this
+#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL ///< Longest wait between reconnect attempts, auto-reconnect keeps retrying at up to this interval
 
 // TLS configs
 #define IOT_SSL_READ_TIMEOUT_MS 3 ///< Timeout associated with underlying socket of TLS connection (set by mbedtls_ssl_conf_read_timeout)
 #define IOT_SSL_READ_RETRY_TIMEOUT_MS 10 ///< Minimum elapsed time before returning from iot_tls_read when pending data has not yet been received
 #define IOT_SSL_WRITE_RETRY_TIMEOUT_MS 10 ///< Minimum elapsed time before returning from iot_tls_write when pending data has not yet been written
 
+// Network configs
+#define AWS_IOT_NET_DNS_CACHE_LIFETIME_SEC CONFIG_AWS_IOT_NET_DNS_CACHE_LIFETIME_SEC ///< Time the addresses resolved for the endpoint are reused by reconnects before it is resolved again
+#define AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS CONFIG_AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS ///< Time a connection attempt to one address of the endpoint is given before the next address is tried alongside it
+
 #endif /* _AWS_IOT_CONFIG_H_ */
@@ -42,10 +42,58 @@
 #include "mbedtls/debug.h"
 #include "mbedtls/timing.h"
 
+#include "aws_iot_error.h"
+#include "network_connect.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief TLS Credentials
+ *
+ * Root CA, device certificate and private key in parsed form, with the random generator
+ * seeded for them. They are loaded once and kept across connections, several Network
+ * instances may share them.
+ */
+typedef struct _TLSCredentials {
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_x509_crt cacert;
+    mbedtls_x509_crt clicert;
+    mbedtls_pk_context pkey;
+    const char *pRootCALocation; ///< Root CA the credentials were loaded from, NULL while they are not loaded
+    const char *pDeviceCertLocation; ///< Device certificate the credentials were loaded from
+    const char *pDevicePrivateKeyLocation; ///< Device private key the credentials were loaded from
+}TLSCredentials;
+
+#ifdef MBEDTLS_2_X_COMPAT
+/* Number of handshake states, the last one being MBEDTLS_SSL_SERVER_HELLO_VERIFY_REQUEST_SENT */
+#define TLS_HANDSHAKE_STEP_COUNT (MBEDTLS_SSL_SERVER_HELLO_VERIFY_REQUEST_SENT + 1)
+#else
+/* Mbed TLS 3.x adds the TLS 1.3 states, steps past these are not profiled */
+#define TLS_HANDSHAKE_STEP_COUNT 32
+#endif
+
+/**
+ * @brief TLS Handshake Profile
+ *
+ * Where the time of the last connect went. Each handshake step is charged to the mbedTLS
+ * handshake state it started in, including the time it waited for the server. In a full
+ * TLS 1.2 handshake with an ECDHE cipher suite:
+ *  - MBEDTLS_SSL_SERVER_HELLO holds the round trip and the work of the server on its first flight
+ *  - MBEDTLS_SSL_SERVER_CERTIFICATE the parsing and verification of the server certificate chain
+ *  - MBEDTLS_SSL_SERVER_KEY_EXCHANGE the check of the ECDHE parameters signed by the server
+ *  - MBEDTLS_SSL_CLIENT_KEY_EXCHANGE the ECDHE key pair of the client and the shared secret
+ *  - MBEDTLS_SSL_CERTIFICATE_VERIFY the signature made with the device private key
+ */
+typedef struct {
+    uint32_t connect_us; ///< TCP connect, including the name lookup
+    uint32_t handshake_us; ///< Whole handshake
+    uint32_t step_us[TLS_HANDSHAKE_STEP_COUNT]; ///< Time spent in each handshake state, indexed by mbedtls_ssl_states
+    bool resumed; ///< Whether the server resumed the offered session instead of sending its certificate
+}TLSHandshakeProfile;
+
 /**
  * @brief TLS Connection Parameters
  *
@@ -53,17 +101,67 @@ extern "C" {
  * TLS networking layer to create a TLS secured socket.
  */
 typedef struct _TLSDataParams {
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
     mbedtls_ssl_context ssl;
     mbedtls_ssl_config conf;
     uint32_t flags;
-    mbedtls_x509_crt cacert;
-    mbedtls_x509_crt clicert;
-    mbedtls_pk_context pkey;
+    TLSCredentials ownCredentials; ///< Loaded from tlsConnectParams on the first connect, kept across iot_tls_destroy until iot_tls_free
+    TLSCredentials *pCredentials; ///< Credentials used to connect, ownCredentials unless iot_tls_set_credentials was called
     mbedtls_net_context server_fd;
+    NetworkAddressCache addressCache; ///< Addresses of the endpoint, kept across iot_tls_destroy so reconnects skip the resolver
+    int wakeup_fd; ///< Event descriptor used to interrupt iot_tls_wait_for_data, -1 if unavailable
+    mbedtls_ssl_session saved_session; ///< Session of the last connection, kept across iot_tls_destroy for resumption
+    bool has_saved_session; ///< Whether saved_session holds a session to offer on the next connect
+    uint32_t full_handshake_count; ///< Number of connects that performed a full handshake
+    uint32_t resumed_handshake_count; ///< Number of connects that resumed the saved session
+#if defined(MBEDTLS_2_X_COMPAT) && defined(MBEDTLS_ECP_C)
+    mbedtls_ecp_group_id curve_list[MBEDTLS_ECP_DP_MAX]; ///< Curves of tlsConnectParams.pCurves known to mbedTLS, terminated by MBEDTLS_ECP_DP_NONE
+#endif
+    TLSHandshakeProfile handshakeProfile; ///< Timings of the last connect
 }TLSDataParams;
 
+struct Network;
+
+/**
+ * @brief Load TLS credentials
+ *
+ * Seeds the random generator and parses the root CA, device certificate and private key.
+ * Each location is a path when it starts with '/', otherwise PEM or DER data. The strings
+ * are not copied and must stay valid while the credentials are used.
+ *
+ * @param pCredentials Credentials to load, released with iot_tls_free_credentials
+ * @param pRootCALocation Root CA
+ * @param pDeviceCertLocation Device certificate
+ * @param pDevicePrivateKeyLocation Device private key
+ * @return SUCCESS or the TLS error of the part that failed, nothing stays allocated then
+ */
+IoT_Error_t iot_tls_load_credentials(TLSCredentials *pCredentials, const char *pRootCALocation,
+                                     const char *pDeviceCertLocation, const char *pDevicePrivateKeyLocation);
+
+/**
+ * @brief Release TLS credentials
+ *
+ * Frees what iot_tls_load_credentials parsed. The ownCredentials of a Network are kept by
+ * iot_tls_destroy for the next connect, and released by iot_tls_free.
+ *
+ * @param pCredentials Credentials to release, nothing is done when they are not loaded
+ */
+void iot_tls_free_credentials(TLSCredentials *pCredentials);
+
+/**
+ * @brief Connect with shared TLS credentials
+ *
+ * The next connects of the Network use pCredentials instead of parsing the locations of
+ * its connect parameters. The credentials the Network loaded itself are released, so it
+ * must not be connected. Networks used from different tasks can only share credentials
+ * when mbedTLS is built with MBEDTLS_THREADING_C, which serializes the shared random
+ * generator.
+ *
+ * @param pNetwork Network that will use the credentials
+ * @param pCredentials Loaded credentials that outlive the Network, NULL to load its own again
+ * @return SUCCESS, NULL_VALUE_ERROR when pNetwork is NULL or pCredentials is not loaded
+ */
+IoT_Error_t iot_tls_set_credentials(struct Network *pNetwork, TLSCredentials *pCredentials);
+
 #define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
 
 #ifdef __cplusplus
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file network_connect.c
+ * @brief lwIP TCP connect with a cache of resolved addresses.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+
+#include "aws_iot_config.h"
+#include "network_connect.h"
+
+#include "esp_log.h"
+
+static const char *TAG = "aws_iot";
+
+void network_address_cache_init(NetworkAddressCache *pCache) {
+    pCache->pHost = NULL;
+    pCache->port = 0;
+    pCache->addressCount = 0;
+    pCache->preferredIndex = 0;
+    init_timer(&(pCache->expiry));
+}
+
+static bool _network_address_equal(const NetworkAddress *pA, const NetworkAddress *pB) {
+    return pA->addressLength == pB->addressLength && 0 == memcmp(&(pA->address), &(pB->address), pA->addressLength);
+}
+
+static IoT_Error_t _network_resolve(NetworkAddressCache *pCache, const char *pHost, uint16_t port) {
+    struct addrinfo hints;
+    struct addrinfo *pList, *pCur;
+    struct addrinfo *pFirstFamily[NETWORK_CONNECT_MAX_ADDRESSES];
+    struct addrinfo *pOtherFamily[NETWORK_CONNECT_MAX_ADDRESSES];
+    uint8_t firstCount = 0, otherCount = 0, firstTaken = 0, otherTaken = 0;
+    bool isCached = (pCache->pHost == pHost && pCache->port == port && 0 < pCache->addressCount);
+    NetworkAddress preferred;
+    NetworkAddress *pAddress;
+    char portBuffer[6];
+    int ret;
+
+    if(isCached && !has_timer_expired(&(pCache->expiry))) {
+        return SUCCESS;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    snprintf(portBuffer, sizeof(portBuffer), "%u", (unsigned) port);
+
+    ret = getaddrinfo(pHost, portBuffer, &hints, &pList);
+    if(0 != ret || NULL == pList) {
+        if(isCached) {
+            ESP_LOGW(TAG, "Resolving %s failed (%d), using the expired addresses", pHost, ret);
+            return SUCCESS;
+        }
+        ESP_LOGE(TAG, "Resolving %s failed (%d)", pHost, ret);
+        return NETWORK_ERR_NET_UNKNOWN_HOST;
+    }
+
+    /* Alternate between the families, so a broken IPv6 path only delays every other attempt */
+    for(pCur = pList; NULL != pCur; pCur = pCur->ai_next) {
+        if(sizeof(struct sockaddr_storage) < pCur->ai_addrlen) {
+            continue;
+        }
+        if(pCur->ai_family == pList->ai_family) {
+            if(firstCount < NETWORK_CONNECT_MAX_ADDRESSES) {
+                pFirstFamily[firstCount++] = pCur;
+            }
+        } else if(otherCount < NETWORK_CONNECT_MAX_ADDRESSES) {
+            pOtherFamily[otherCount++] = pCur;
+        }
+    }
+
+    if(isCached) {
+        preferred = pCache->addresses[pCache->preferredIndex];
+    }
+    pCache->addressCount = 0;
+    pCache->preferredIndex = 0;
+    while(pCache->addressCount < NETWORK_CONNECT_MAX_ADDRESSES && (firstTaken < firstCount || otherTaken < otherCount)) {
+        if(otherTaken >= otherCount || (firstTaken < firstCount && firstTaken <= otherTaken)) {
+            pCur = pFirstFamily[firstTaken++];
+        } else {
+            pCur = pOtherFamily[otherTaken++];
+        }
+        pAddress = &(pCache->addresses[pCache->addressCount]);
+        memset(&(pAddress->address), 0, sizeof(pAddress->address));
+        memcpy(&(pAddress->address), pCur->ai_addr, pCur->ai_addrlen);
+        pAddress->addressLength = (socklen_t) pCur->ai_addrlen;
+        /* Keep preferring the address that worked if the host still resolves to it */
+        if(isCached && _network_address_equal(pAddress, &preferred)) {
+            pCache->preferredIndex = pCache->addressCount;
+        }
+        pCache->addressCount++;
+    }
+    freeaddrinfo(pList);
+
+    if(0 == pCache->addressCount) {
+        network_address_cache_init(pCache);
+        ESP_LOGE(TAG, "No usable address for %s", pHost);
+        return NETWORK_ERR_NET_UNKNOWN_HOST;
+    }
+
+    pCache->pHost = pHost;
+    pCache->port = port;
+    countdown_sec(&(pCache->expiry), AWS_IOT_NET_DNS_CACHE_LIFETIME_SEC);
+
+    return SUCCESS;
+}
+
+static IoT_Error_t _network_connect_start(const NetworkAddress *pAddress, int *pFd) {
+    int fd, flags;
+
+    fd = socket(pAddress->address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if(0 > fd) {
+        return NETWORK_ERR_NET_SOCKET_FAILED;
+    }
+
+    flags = fcntl(fd, F_GETFL, 0);
+    if(0 > flags || 0 > fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+        close(fd);
+        return NETWORK_ERR_NET_SOCKET_FAILED;
+    }
+
+    /* An immediate success is reported as writable by the next select, like a completed connect */
+    if(0 != connect(fd, (const struct sockaddr *) &(pAddress->address), pAddress->addressLength) &&
+       EINPROGRESS != errno) {
+        close(fd);
+        return NETWORK_ERR_NET_CONNECT_FAILED;
+    }
+
+    *pFd = fd;
+    return SUCCESS;
+}
+
+IoT_Error_t network_connect(NetworkAddressCache *pCache, const char *pHost, uint16_t port, uint32_t timeout_ms,
+                            int *pFd) {
+    int pendingFd[NETWORK_CONNECT_MAX_ADDRESSES];
+    uint8_t pendingIndex[NETWORK_CONNECT_MAX_ADDRESSES];
+    uint8_t pendingCount = 0, startedCount = 0, index, i;
+    Timer connectTimer, attemptTimer;
+    fd_set writeFds;
+    struct timeval timeout;
+    uint32_t wait_ms;
+    socklen_t errorLength;
+    int fd, maxFd, socketError, ret, flags;
+    IoT_Error_t rc;
+
+    if(NULL == pCache || NULL == pHost || NULL == pFd) {
+        return NULL_VALUE_ERROR;
+    }
+
+    rc = _network_resolve(pCache, pHost, port);
+    if(SUCCESS != rc) {
+        return rc;
+    }
+
+    init_timer(&connectTimer);
+    countdown_ms(&connectTimer, timeout_ms);
+    init_timer(&attemptTimer);
+    rc = NETWORK_ERR_NET_CONNECT_FAILED;
+    fd = -1;
+
+    while(-1 == fd) {
+        /* Start the next address once the previous attempts failed or had their head start */
+        if(startedCount < pCache->addressCount && (0 == pendingCount || has_timer_expired(&attemptTimer))) {
+            if(0 == startedCount) {
+                index = pCache->preferredIndex;
+            } else {
+                index = (uint8_t) (startedCount <= pCache->preferredIndex ? startedCount - 1 : startedCount);
+            }
+            startedCount++;
+
+            rc = _network_connect_start(&(pCache->addresses[index]), &(pendingFd[pendingCount]));
+            if(SUCCESS == rc) {
+                pendingIndex[pendingCount++] = index;
+                countdown_ms(&attemptTimer, AWS_IOT_NET_CONNECT_ATTEMPT_DELAY_MS);
+            }
+            continue;
+        }
+
+        if(0 == pendingCount) {
+            break;
+        }
+        if(has_timer_expired(&connectTimer)) {
+            ESP_LOGE(TAG, "Connecting to %s timed out", pHost);
+            rc = NETWORK_ERR_NET_CONNECT_FAILED;
+            break;
+        }
+
+        wait_ms = left_ms(&connectTimer);
+        if(startedCount < pCache->addressCount && left_ms(&attemptTimer) < wait_ms) {
+            wait_ms = left_ms(&attemptTimer);
+        }
+        timeout.tv_sec = wait_ms / 1000;
+        timeout.tv_usec = (wait_ms % 1000) * 1000;
+
+        FD_ZERO(&writeFds);
+        maxFd = -1;
+        for(i = 0; i < pendingCount; i++) {
+            FD_SET(pendingFd[i], &writeFds);
+            if(pendingFd[i] > maxFd) {
+                maxFd = pendingFd[i];
+            }
+        }
+
+        ret = select(maxFd + 1, NULL, &writeFds, NULL, &timeout);
+        if(0 > ret && EINTR != errno) {
+            rc = NETWORK_ERR_NET_CONNECT_FAILED;
+            break;
+        }
+        if(0 >= ret) {
+            continue;
+        }
+
+        for(i = 0; i < pendingCount;) {
+            if(!FD_ISSET(pendingFd[i], &writeFds)) {
+                i++;
+                continue;
+            }
+
+            socketError = 0;
+            errorLength = sizeof(socketError);
+            if(-1 == fd && 0 == getsockopt(pendingFd[i], SOL_SOCKET, SO_ERROR, &socketError, &errorLength) &&
+               0 == socketError) {
+                fd = pendingFd[i];
+                pCache->preferredIndex = pendingIndex[i];
+            } else {
+                close(pendingFd[i]);
+                /* A refused address hands its turn to the next one straight away */
+                init_timer(&attemptTimer);
+                rc = NETWORK_ERR_NET_CONNECT_FAILED;
+            }
+
+            pendingCount--;
+            pendingFd[i] = pendingFd[pendingCount];
+            pendingIndex[i] = pendingIndex[pendingCount];
+        }
+    }
+
+    for(i = 0; i < pendingCount; i++) {
+        close(pendingFd[i]);
+    }
+
+    if(-1 == fd) {
+        ESP_LOGE(TAG, "No address of %s accepted the connection", pHost);
+        /* The host may have moved, resolve it again on the next connect */
+        network_address_cache_init(pCache);
+        return rc;
+    }
+
+    flags = fcntl(fd, F_GETFL, 0);
+    if(0 > flags || 0 > fcntl(fd, F_SETFL, flags & ~O_NONBLOCK)) {
+        close(fd);
+        return NETWORK_ERR_NET_SOCKET_FAILED;
+    }
+
+    *pFd = fd;
+    return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
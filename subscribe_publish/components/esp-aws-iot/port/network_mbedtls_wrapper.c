@@ -16,6 +16,7 @@
 #include <sys/param.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
 #include "aws_iot_config.h"
 
 #include <timer_platform.h>
@@ -36,6 +37,13 @@
 
 #include "esp_log.h"
 
+#ifdef CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD
+#include <errno.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include "esp_vfs_eventfd.h"
+#endif
+
 static const char *TAG = "aws_iot";
 
 /* This is the value used for ssl read timeout */
@@ -57,6 +65,13 @@ static const char *TAG = "aws_iot";
 	#define IOT_SSL_READ_RETRY_TIMEOUT_MS 10
 #endif
 
+static uint64_t _iot_tls_now_us(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+}
+
 /*
  * This is a function to do further verification if needed on the cert received.
  *
@@ -81,75 +96,50 @@ static int _iot_tls_verify_cert(void *data, mbedtls_x509_crt *crt, int depth, ui
     return 0;
 }
 
-static void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
-                                 const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
-                                 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
-    pNetwork->tlsConnectParams.DestinationPort = destinationPort;
-    pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
-    pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
-    pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
-    pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
-    pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
-    pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
-}
-
-IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
-                         const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
-                         uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
-    _iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
-                                pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
-
-    pNetwork->connect = iot_tls_connect;
-    pNetwork->read = iot_tls_read;
-    pNetwork->write = iot_tls_write;
-    pNetwork->disconnect = iot_tls_disconnect;
-    pNetwork->isConnected = iot_tls_is_connected;
-    pNetwork->destroy = iot_tls_destroy;
-
-    pNetwork->tlsDataParams.flags = 0;
-
-    return SUCCESS;
-}
-
-IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
-    /* Use this to add implementation which can check for physical layer disconnect */
-    return NETWORK_PHYSICAL_LAYER_CONNECTED;
+/*
+ * Releases the session kept for resumption, the next connect performs a full handshake.
+ */
+static void _iot_tls_discard_session(TLSDataParams *tlsDataParams) {
+    if(tlsDataParams->has_saved_session) {
+        mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+        tlsDataParams->has_saved_session = false;
+    }
 }
 
-IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
-    int ret = SUCCESS;
-    TLSDataParams *tlsDataParams = NULL;
-    char portBuffer[6];
-    char info_buf[256];
+/*
+ * Counts the handshake that just completed and keeps its session for the next connect.
+ */
+static void _iot_tls_save_session(TLSDataParams *tlsDataParams) {
+    int ret = 0;
 
-    if(NULL == pNetwork) {
-        return NULL_VALUE_ERROR;
+    if(tlsDataParams->handshakeProfile.resumed) {
+        tlsDataParams->resumed_handshake_count++;
+        ESP_LOGD(TAG, "TLS session resumed");
+    } else {
+        tlsDataParams->full_handshake_count++;
     }
 
-    if(NULL != params) {
-        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
-                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
-                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    _iot_tls_discard_session(tlsDataParams);
+    if((ret = mbedtls_ssl_get_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) != 0) {
+        ESP_LOGD(TAG, "mbedtls_ssl_get_session returned -0x%x, the next connect performs a full handshake", -ret);
+        mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+        return;
     }
-
-    tlsDataParams = &(pNetwork->tlsDataParams);
-
-    mbedtls_net_init(&(tlsDataParams->server_fd));
-    mbedtls_ssl_init(&(tlsDataParams->ssl));
-    mbedtls_ssl_config_init(&(tlsDataParams->conf));
-
-#ifdef CONFIG_MBEDTLS_DEBUG
-    mbedtls_esp_enable_debug_log(&(tlsDataParams->conf), 4);
+    tlsDataParams->has_saved_session = true;
+#else
+    (void) ret;
 #endif
+}
 
-    mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
-    mbedtls_x509_crt_init(&(tlsDataParams->cacert));
-    mbedtls_x509_crt_init(&(tlsDataParams->clicert));
-    mbedtls_pk_init(&(tlsDataParams->pkey));
+/*
+ * Seeds the random generator and parses the locations recorded in pCredentials.
+ */
+static IoT_Error_t _iot_tls_parse_credentials(TLSCredentials *pCredentials) {
+    int ret;
 
     ESP_LOGD(TAG, "Seeding the random number generator...");
-    mbedtls_entropy_init(&(tlsDataParams->entropy));
-    if((ret = mbedtls_ctr_drbg_seed(&(tlsDataParams->ctr_drbg), mbedtls_entropy_func, &(tlsDataParams->entropy),
+    if((ret = mbedtls_ctr_drbg_seed(&(pCredentials->ctr_drbg), mbedtls_entropy_func, &(pCredentials->entropy),
                                     (const unsigned char *) TAG, strlen(TAG))) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ctr_drbg_seed returned -0x%x", -ret);
         return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
@@ -161,13 +151,13 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
        very basic heuristic: if the cert starts with '/' then it's a
        path, if it's longer than this then it's raw cert data (PEM or DER,
        neither of which can start with a slash. */
-    if (pNetwork->tlsConnectParams.pRootCALocation[0] == '/') {
+    if (pCredentials->pRootCALocation[0] == '/') {
         ESP_LOGD(TAG, "Loading CA root certificate from file ...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->cacert), pNetwork->tlsConnectParams.pRootCALocation);
+        ret = mbedtls_x509_crt_parse_file(&(pCredentials->cacert), pCredentials->pRootCALocation);
     } else {
         ESP_LOGD(TAG, "Loading embedded CA root certificate ...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->cacert), (const unsigned char *)pNetwork->tlsConnectParams.pRootCALocation,
-                                 strlen(pNetwork->tlsConnectParams.pRootCALocation)+1);
+        ret = mbedtls_x509_crt_parse(&(pCredentials->cacert), (const unsigned char *)pCredentials->pRootCALocation,
+                                 strlen(pCredentials->pRootCALocation)+1);
     }
 
     if(ret < 0) {
@@ -178,26 +168,26 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     /* Load client certificate... */
 #ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
-    if (pNetwork->tlsConnectParams.pDeviceCertLocation[0] == '#') {
+    if (pCredentials->pDeviceCertLocation[0] == '#') {
         const atcacert_def_t* cert_def = NULL;
         ESP_LOGD(TAG, "Using certificate stored in ATECC608A");
         ret = tng_get_device_cert_def(&cert_def);
         if (ret == 0) {
-            ret = atca_mbedtls_cert_add(&(tlsDataParams->clicert), cert_def);
+            ret = atca_mbedtls_cert_add(&(pCredentials->clicert), cert_def);
         } else {
             ESP_LOGE(TAG, "failed! could not load cert from ATECC608A, tng_get_device_cert_def returned %02x", ret);
         }
     } else
 #endif
-    if (pNetwork->tlsConnectParams.pDeviceCertLocation[0] == '/') {
+    if (pCredentials->pDeviceCertLocation[0] == '/') {
         ESP_LOGD(TAG, "Loading client cert from file...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->clicert),
-                                          pNetwork->tlsConnectParams.pDeviceCertLocation);
+        ret = mbedtls_x509_crt_parse_file(&(pCredentials->clicert),
+                                          pCredentials->pDeviceCertLocation);
     } else {
         ESP_LOGD(TAG, "Loading embedded client certificate...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->clicert),
-                                     (const unsigned char *)pNetwork->tlsConnectParams.pDeviceCertLocation,
-                                     strlen(pNetwork->tlsConnectParams.pDeviceCertLocation)+1);
+        ret = mbedtls_x509_crt_parse(&(pCredentials->clicert),
+                                     (const unsigned char *)pCredentials->pDeviceCertLocation,
+                                     strlen(pCredentials->pDeviceCertLocation)+1);
     }
     if(ret != 0) {
         ESP_LOGE(TAG, "failed!  mbedtls_x509_crt_parse returned -0x%x while parsing device cert", -ret);
@@ -206,43 +196,44 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     /* Parse client private key... */
 #ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
-    if (pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[0] == '#') {
-        int8_t slot_id = pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[1] - '0';
+    if (pCredentials->pDevicePrivateKeyLocation[0] == '#') {
+        int8_t slot_id = pCredentials->pDevicePrivateKeyLocation[1] - '0';
         if (slot_id < 0 || slot_id > 9) {
             ESP_LOGE(TAG, "Invalid ATECC608A slot ID.");
             ret = NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
         } else {
             ESP_LOGD(TAG, "Using ATECC608A private key from slot %d", slot_id);
-            ret = atca_mbedtls_pk_init(&(tlsDataParams->pkey), slot_id);
+            ret = atca_mbedtls_pk_init(&(pCredentials->pkey), slot_id);
             if (ret != 0) {
                 ESP_LOGE(TAG, "failed !  atca_mbedtls_pk_init returned %02x", ret);
             }
         }
     } else
 #endif
-    if (pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[0] == '/') {
+    if (pCredentials->pDevicePrivateKeyLocation[0] == '/') {
         ESP_LOGD(TAG, "Loading client private key from file...");
 #ifdef MBEDTLS_2_X_COMPAT
-        ret = mbedtls_pk_parse_keyfile(&(tlsDataParams->pkey),
-                                       pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
+        ret = mbedtls_pk_parse_keyfile(&(pCredentials->pkey),
+                                       pCredentials->pDevicePrivateKeyLocation,
                                        "");
 #else
-        ret = mbedtls_pk_parse_keyfile(&(tlsDataParams->pkey),
-                                       pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                       "", mbedtls_ctr_drbg_random, NULL);
+        ret = mbedtls_pk_parse_keyfile(&(pCredentials->pkey),
+                                       pCredentials->pDevicePrivateKeyLocation,
+                                       "", mbedtls_ctr_drbg_random, &(pCredentials->ctr_drbg));
 #endif
     } else {
         ESP_LOGD(TAG, "Loading embedded client private key...");
 #ifdef MBEDTLS_2_X_COMPAT
-        ret = mbedtls_pk_parse_key(&(tlsDataParams->pkey),
-                                   (const unsigned char *)pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                   strlen(pNetwork->tlsConnectParams.pDevicePrivateKeyLocation)+1,
+        ret = mbedtls_pk_parse_key(&(pCredentials->pkey),
+                                   (const unsigned char *)pCredentials->pDevicePrivateKeyLocation,
+                                   strlen(pCredentials->pDevicePrivateKeyLocation)+1,
                                    (const unsigned char *)"", 0);
 #else
-        ret = mbedtls_pk_parse_key(&(tlsDataParams->pkey),
-                                   (const unsigned char *)pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                   strlen(pNetwork->tlsConnectParams.pDevicePrivateKeyLocation)+1,
-                                   (const unsigned char *)"", 0, mbedtls_ctr_drbg_random, NULL);
+        ret = mbedtls_pk_parse_key(&(pCredentials->pkey),
+                                   (const unsigned char *)pCredentials->pDevicePrivateKeyLocation,
+                                   strlen(pCredentials->pDevicePrivateKeyLocation)+1,
+                                   (const unsigned char *)"", 0, mbedtls_ctr_drbg_random,
+                                   &(pCredentials->ctr_drbg));
 #endif
     }
     if(ret != 0) {
@@ -252,28 +243,327 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     /* Done parsing certs */
     ESP_LOGD(TAG, "ok");
-    snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
-    ESP_LOGD(TAG, "Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
-    if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
-                                  portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
-        ESP_LOGE(TAG, "failed! mbedtls_net_connect returned -0x%x", -ret);
-        switch(ret) {
-            case MBEDTLS_ERR_NET_SOCKET_FAILED:
-                return NETWORK_ERR_NET_SOCKET_FAILED;
-            case MBEDTLS_ERR_NET_UNKNOWN_HOST:
-                return NETWORK_ERR_NET_UNKNOWN_HOST;
-            case MBEDTLS_ERR_NET_CONNECT_FAILED:
-            default:
-                return NETWORK_ERR_NET_CONNECT_FAILED;
-        };
-    }
-
-    ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
-    if(ret != 0) {
-        ESP_LOGE(TAG, "failed! net_set_(non)block() returned -0x%x", -ret);
-        return SSL_CONNECTION_ERROR;
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_load_credentials(TLSCredentials *pCredentials, const char *pRootCALocation,
+                                     const char *pDeviceCertLocation, const char *pDevicePrivateKeyLocation) {
+    IoT_Error_t rc;
+
+    if(NULL == pCredentials || NULL == pRootCALocation || NULL == pDeviceCertLocation ||
+       NULL == pDevicePrivateKeyLocation) {
+        return NULL_VALUE_ERROR;
+    }
+
+    mbedtls_entropy_init(&(pCredentials->entropy));
+    mbedtls_ctr_drbg_init(&(pCredentials->ctr_drbg));
+    mbedtls_x509_crt_init(&(pCredentials->cacert));
+    mbedtls_x509_crt_init(&(pCredentials->clicert));
+    mbedtls_pk_init(&(pCredentials->pkey));
+    pCredentials->pRootCALocation = pRootCALocation;
+    pCredentials->pDeviceCertLocation = pDeviceCertLocation;
+    pCredentials->pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+
+    rc = _iot_tls_parse_credentials(pCredentials);
+    if(SUCCESS != rc) {
+        iot_tls_free_credentials(pCredentials);
+    }
+
+    return rc;
+}
+
+void iot_tls_free_credentials(TLSCredentials *pCredentials) {
+    if(NULL == pCredentials || NULL == pCredentials->pRootCALocation) {
+        return;
+    }
+
+    mbedtls_x509_crt_free(&(pCredentials->clicert));
+    mbedtls_x509_crt_free(&(pCredentials->cacert));
+    mbedtls_pk_free(&(pCredentials->pkey));
+    mbedtls_ctr_drbg_free(&(pCredentials->ctr_drbg));
+    mbedtls_entropy_free(&(pCredentials->entropy));
+    pCredentials->pRootCALocation = NULL;
+}
+
+IoT_Error_t iot_tls_set_credentials(Network *pNetwork, TLSCredentials *pCredentials) {
+    if(NULL == pNetwork || (NULL != pCredentials && NULL == pCredentials->pRootCALocation)) {
+        return NULL_VALUE_ERROR;
+    }
+
+    iot_tls_free_credentials(&(pNetwork->tlsDataParams.ownCredentials));
+    pNetwork->tlsDataParams.pCredentials = (NULL != pCredentials) ? pCredentials
+                                                                   : &(pNetwork->tlsDataParams.ownCredentials);
+
+    return SUCCESS;
+}
+
+/*
+ * Loads the credentials named by the connect parameters, unless shared credentials are set
+ * or the same locations were already loaded by a previous connect.
+ */
+static IoT_Error_t _iot_tls_load_own_credentials(Network *pNetwork) {
+    TLSCredentials *pOwn = &(pNetwork->tlsDataParams.ownCredentials);
+    TLSConnectParams *pParams = &(pNetwork->tlsConnectParams);
+
+    if(pOwn != pNetwork->tlsDataParams.pCredentials) {
+        return SUCCESS;
+    }
+
+    if(NULL != pOwn->pRootCALocation) {
+        if(pOwn->pRootCALocation == pParams->pRootCALocation &&
+           pOwn->pDeviceCertLocation == pParams->pDeviceCertLocation &&
+           pOwn->pDevicePrivateKeyLocation == pParams->pDevicePrivateKeyLocation) {
+            ESP_LOGD(TAG, "Reusing the parsed certificates and key");
+            return SUCCESS;
+        }
+        iot_tls_free_credentials(pOwn);
+    }
+
+    return iot_tls_load_credentials(pOwn, pParams->pRootCALocation, pParams->pDeviceCertLocation,
+                                    pParams->pDevicePrivateKeyLocation);
+}
+
+/*
+ * Restricts and orders the cipher suites and curves the handshake offers, as set in the connect parameters
+ */
+static IoT_Error_t _iot_tls_conf_policy(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    const int *pSuite = pNetwork->tlsConnectParams.pCipherSuites;
+    const uint16_t *pCurve = pNetwork->tlsConnectParams.pCurves;
+    bool hasSuite = false;
+#if defined(MBEDTLS_2_X_COMPAT) && defined(MBEDTLS_ECP_C)
+    const mbedtls_ecp_curve_info *pCurveInfo;
+    size_t curveCount = 0;
+#endif
+
+    if(NULL != pSuite) {
+        /* mbedTLS leaves the suites it does not know out of the ClientHello */
+        for(; 0 != *pSuite; pSuite++) {
+            if(NULL != mbedtls_ssl_ciphersuite_from_id(*pSuite)) {
+                hasSuite = true;
+            } else {
+                ESP_LOGW(TAG, "Cipher suite 0x%04x is not supported by mbedTLS", *pSuite);
+            }
+        }
+        if(!hasSuite) {
+            ESP_LOGE(TAG, "failed! None of the cipher suites of the connect parameters is supported");
+            return SSL_CONNECTION_ERROR;
+        }
+        mbedtls_ssl_conf_ciphersuites(&(tlsDataParams->conf), pNetwork->tlsConnectParams.pCipherSuites);
+    }
+
+    if(NULL != pCurve) {
+#if !defined(MBEDTLS_2_X_COMPAT)
+        /* Mbed TLS 3.x takes the IANA numbers as they are */
+        mbedtls_ssl_conf_groups(&(tlsDataParams->conf), pCurve);
+#elif defined(MBEDTLS_ECP_C)
+        /* The list also limits the curves accepted for ECDSA keys in the server certificate chain */
+        for(; 0 != *pCurve && curveCount < MBEDTLS_ECP_DP_MAX - 1; pCurve++) {
+            if(NULL != (pCurveInfo = mbedtls_ecp_curve_info_from_tls_id(*pCurve))) {
+                tlsDataParams->curve_list[curveCount++] = pCurveInfo->grp_id;
+            } else {
+                ESP_LOGW(TAG, "Curve %u is not supported by mbedTLS", *pCurve);
+            }
+        }
+        if(0 == curveCount) {
+            ESP_LOGE(TAG, "failed! None of the curves of the connect parameters is supported");
+            return SSL_CONNECTION_ERROR;
+        }
+        tlsDataParams->curve_list[curveCount] = MBEDTLS_ECP_DP_NONE;
+        mbedtls_ssl_conf_curves(&(tlsDataParams->conf), tlsDataParams->curve_list);
+#else
+        ESP_LOGW(TAG, "mbedTLS is built without MBEDTLS_ECP_C, the curves of the connect parameters are ignored");
+#endif
+    }
+
+    return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_net_connect(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    uint64_t start;
+    IoT_Error_t rc;
+
+    /* A connect starts a new profile, including the one retried without the saved session */
+    memset(&(tlsDataParams->handshakeProfile), 0, sizeof(tlsDataParams->handshakeProfile));
+
+    ESP_LOGD(TAG, "Connecting to %s/%d...", pNetwork->tlsConnectParams.pDestinationURL,
+             pNetwork->tlsConnectParams.DestinationPort);
+    /* Resolves through the address cache and races the addresses, the socket comes back blocking */
+    start = _iot_tls_now_us();
+    rc = network_connect(&(tlsDataParams->addressCache), pNetwork->tlsConnectParams.pDestinationURL,
+                         pNetwork->tlsConnectParams.DestinationPort, pNetwork->tlsConnectParams.timeout_ms,
+                         &(tlsDataParams->server_fd.fd));
+    tlsDataParams->handshakeProfile.connect_us = (uint32_t) (_iot_tls_now_us() - start);
+    if(SUCCESS != rc) {
+        ESP_LOGE(TAG, "failed! network_connect returned %d", rc);
+        return rc;
     } ESP_LOGD(TAG, "ok");
 
+    return SUCCESS;
+}
+
+/*
+ * Runs the handshake one state at a time, as mbedtls_ssl_handshake does, timing each state for the profile
+ */
+static int _iot_tls_handshake(TLSDataParams *tlsDataParams) {
+    TLSHandshakeProfile *pProfile = &(tlsDataParams->handshakeProfile);
+    uint64_t start, stepStart, now;
+    int state;
+    int ret;
+
+    ESP_LOGD(TAG, "Performing the SSL/TLS handshake...");
+    start = _iot_tls_now_us();
+    /* The server skips its certificate only when it resumes the offered session, with TLS 1.2 and 1.3 alike */
+    pProfile->resumed = true;
+    while(MBEDTLS_SSL_HANDSHAKE_OVER != tlsDataParams->ssl.state) {
+        state = tlsDataParams->ssl.state;
+        if(MBEDTLS_SSL_SERVER_CERTIFICATE == state) {
+            pProfile->resumed = false;
+        }
+        stepStart = _iot_tls_now_us();
+        ret = mbedtls_ssl_handshake_step(&(tlsDataParams->ssl));
+        now = _iot_tls_now_us();
+        if(0 <= state && TLS_HANDSHAKE_STEP_COUNT > state) {
+            pProfile->step_us[state] += (uint32_t) (now - stepStart);
+        }
+        pProfile->handshake_us = (uint32_t) (now - start);
+        if(0 != ret && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake returned -0x%x", -ret);
+            if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
+                ESP_LOGE(TAG, "    Unable to verify the server's certificate. ");
+            }
+            return ret;
+        }
+    }
+
+    ESP_LOGD(TAG, "Handshake took %u us: server certificate %u, server key exchange %u, "
+             "client key exchange %u, certificate verify %u", (unsigned int) pProfile->handshake_us,
+             (unsigned int) pProfile->step_us[MBEDTLS_SSL_SERVER_CERTIFICATE],
+             (unsigned int) pProfile->step_us[MBEDTLS_SSL_SERVER_KEY_EXCHANGE],
+             (unsigned int) pProfile->step_us[MBEDTLS_SSL_CLIENT_KEY_EXCHANGE],
+             (unsigned int) pProfile->step_us[MBEDTLS_SSL_CERTIFICATE_VERIFY]);
+
+    return 0;
+}
+
+static void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+                                 const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
+                                 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+    pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+    pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+    pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+    pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+    pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+    pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+    pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+                         const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
+                         uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+#ifdef CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err;
+#endif
+
+    _iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
+                                pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
+    pNetwork->tlsConnectParams.pCipherSuites = NULL;
+    pNetwork->tlsConnectParams.pCurves = NULL;
+
+    pNetwork->connect = iot_tls_connect;
+    pNetwork->read = iot_tls_read;
+    pNetwork->write = iot_tls_write;
+    pNetwork->writev = iot_tls_writev;
+    pNetwork->disconnect = iot_tls_disconnect;
+    pNetwork->isConnected = iot_tls_is_connected;
+    pNetwork->destroy = iot_tls_destroy;
+
+    pNetwork->tlsDataParams.flags = 0;
+    pNetwork->tlsDataParams.wakeup_fd = -1;
+
+    /* Loaded on the first connect */
+    pNetwork->tlsDataParams.ownCredentials.pRootCALocation = NULL;
+    pNetwork->tlsDataParams.pCredentials = &(pNetwork->tlsDataParams.ownCredentials);
+
+    network_address_cache_init(&(pNetwork->tlsDataParams.addressCache));
+
+    mbedtls_ssl_session_init(&(pNetwork->tlsDataParams.saved_session));
+    pNetwork->tlsDataParams.has_saved_session = false;
+    pNetwork->tlsDataParams.full_handshake_count = 0;
+    pNetwork->tlsDataParams.resumed_handshake_count = 0;
+    memset(&(pNetwork->tlsDataParams.handshakeProfile), 0, sizeof(pNetwork->tlsDataParams.handshakeProfile));
+
+#ifdef CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD
+    pNetwork->waitForData = iot_tls_wait_for_data;
+    pNetwork->wakeup = iot_tls_wakeup;
+
+    /* The eventfd VFS may already have been registered by the application */
+    err = esp_vfs_eventfd_register(&eventfd_config);
+    if(ESP_OK == err || ESP_ERR_INVALID_STATE == err) {
+        /* Created once and kept across reconnects until iot_tls_free, so a wakeup can never
+         * hit a recycled descriptor */
+        pNetwork->tlsDataParams.wakeup_fd = eventfd(0, 0);
+    }
+    if(0 > pNetwork->tlsDataParams.wakeup_fd) {
+        ESP_LOGW(TAG, "Unable to create the yield wakeup descriptor, aws_iot_mqtt_yield_wakeup will fail");
+    }
+#else
+    pNetwork->waitForData = NULL;
+    pNetwork->wakeup = NULL;
+#endif
+
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+    /* Use this to add implementation which can check for physical layer disconnect */
+    return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+    int ret = SUCCESS;
+    TLSDataParams *tlsDataParams = NULL;
+    TLSCredentials *pCredentials = NULL;
+    bool sessionOffered = false;
+    char info_buf[256];
+
+    if(NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    tlsDataParams = &(pNetwork->tlsDataParams);
+
+    if(NULL != params) {
+        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
+                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+        pNetwork->tlsConnectParams.pCipherSuites = params->pCipherSuites;
+        pNetwork->tlsConnectParams.pCurves = params->pCurves;
+        /* The saved session belongs to the previous server */
+        _iot_tls_discard_session(tlsDataParams);
+    }
+
+    mbedtls_net_init(&(tlsDataParams->server_fd));
+    mbedtls_ssl_init(&(tlsDataParams->ssl));
+    mbedtls_ssl_config_init(&(tlsDataParams->conf));
+
+#ifdef CONFIG_MBEDTLS_DEBUG
+    mbedtls_esp_enable_debug_log(&(tlsDataParams->conf), 4);
+#endif
+
+    ret = _iot_tls_load_own_credentials(pNetwork);
+    if(SUCCESS != ret) {
+        return (IoT_Error_t) ret;
+    }
+    pCredentials = tlsDataParams->pCredentials;
+
+    ret = _iot_tls_net_connect(pNetwork);
+    if(SUCCESS != ret) {
+        return (IoT_Error_t) ret;
+    }
+
     ESP_LOGD(TAG, "Setting up the SSL/TLS structure...");
     if((ret = mbedtls_ssl_config_defaults(&(tlsDataParams->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
@@ -288,10 +578,14 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
     } else {
         mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
     }
-    mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(tlsDataParams->ctr_drbg));
+    mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(pCredentials->ctr_drbg));
+    ret = _iot_tls_conf_policy(pNetwork);
+    if(SUCCESS != ret) {
+        return (IoT_Error_t) ret;
+    }
 
-    mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(tlsDataParams->cacert), NULL);
-    ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(tlsDataParams->clicert), &(tlsDataParams->pkey));
+    mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(pCredentials->cacert), NULL);
+    ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(pCredentials->clicert), &(pCredentials->pkey));
     if(ret != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_conf_own_cert returned %d", ret);
         return SSL_CONNECTION_ERROR;
@@ -323,16 +617,37 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
                         mbedtls_net_recv_timeout);
     ESP_LOGD(TAG, "ok");
 
+    /* Offer the session of the last connection, the server falls back to a full handshake if it refuses it */
+    if(tlsDataParams->has_saved_session) {
+        if((ret = mbedtls_ssl_set_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) == 0) {
+            sessionOffered = true;
+        } else {
+            ESP_LOGW(TAG, "mbedtls_ssl_set_session returned -0x%x, performing a full handshake", -ret);
+            _iot_tls_discard_session(tlsDataParams);
+        }
+    }
+
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
-    ESP_LOGD(TAG, "Performing the SSL/TLS handshake...");
-    while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
-        if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake returned -0x%x", -ret);
-            if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
-                ESP_LOGE(TAG, "    Unable to verify the server's certificate. ");
-            }
+    ret = _iot_tls_handshake(tlsDataParams);
+    if(ret != 0 && sessionOffered) {
+        /* Some servers close the connection on a session they no longer know, retry once without it */
+        ESP_LOGW(TAG, "Resuming the TLS session failed, retrying with a full handshake");
+        _iot_tls_discard_session(tlsDataParams);
+        sessionOffered = false;
+
+        mbedtls_net_free(&(tlsDataParams->server_fd));
+        ret = _iot_tls_net_connect(pNetwork);
+        if(SUCCESS != ret) {
+            return (IoT_Error_t) ret;
+        }
+        if((ret = mbedtls_ssl_session_reset(&(tlsDataParams->ssl))) != 0) {
+            ESP_LOGE(TAG, "failed! mbedtls_ssl_session_reset returned -0x%x", -ret);
             return SSL_CONNECTION_ERROR;
         }
+        ret = _iot_tls_handshake(tlsDataParams);
+    }
+    if(ret != 0) {
+        return SSL_CONNECTION_ERROR;
     }
 
     ESP_LOGD(TAG, "ok    [ Protocol is %s ]    [ Ciphersuite is %s ]", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
@@ -360,6 +675,10 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         ret = SUCCESS;
     }
 
+    if(SUCCESS == ret) {
+        _iot_tls_save_session(tlsDataParams);
+    }
+
     if(LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG) {
         if (mbedtls_ssl_get_peer_cert(&(tlsDataParams->ssl)) != NULL) {
             ESP_LOGD(TAG, "Peer certificate information:");
@@ -425,6 +744,24 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_writev(Network *pNetwork, const IoT_Network_Segment *pSegments, size_t segmentCount, Timer *timer,
+						   size_t *written_len) {
+	size_t itr;
+	size_t segmentLen;
+	IoT_Error_t rc = SUCCESS;
+
+	/* Each segment is handed to mbedtls_ssl_write in place, so a large payload
+	 * goes straight from the caller's buffer into the TLS records */
+	*written_len = 0U;
+	for(itr = 0U; itr < segmentCount && SUCCESS == rc; itr++) {
+		segmentLen = 0U;
+		rc = iot_tls_write(pNetwork, (unsigned char *) pSegments[itr].pData, pSegments[itr].len, timer, &segmentLen);
+		*written_len += segmentLen;
+	}
+
+	return rc;
+}
+
 IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
     TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 	mbedtls_ssl_context *pSsl = &(pNetwork->tlsDataParams.ssl);
@@ -491,6 +828,73 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	return SUCCESS;
 }
 
+#ifdef CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD
+IoT_Error_t iot_tls_wait_for_data(Network *pNetwork, Timer *timer) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    int socket_fd = tlsDataParams->server_fd.fd;
+    int wakeup_fd = tlsDataParams->wakeup_fd;
+    struct timeval tv;
+    fd_set read_fds;
+    uint32_t wait_ms;
+    uint64_t wakeups;
+    int ret;
+
+    /* Data already received by mbedTLS does not show up on the socket any more */
+    if(0 < mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) || mbedtls_ssl_check_pending(&(tlsDataParams->ssl))) {
+        return SUCCESS;
+    }
+
+    if(0 > socket_fd) {
+        return NETWORK_SSL_READ_ERROR;
+    }
+
+    FD_ZERO(&read_fds);
+    FD_SET(socket_fd, &read_fds);
+    if(0 <= wakeup_fd) {
+        FD_SET(wakeup_fd, &read_fds);
+    }
+
+    wait_ms = left_ms(timer);
+    tv.tv_sec = wait_ms / 1000;
+    tv.tv_usec = (wait_ms % 1000) * 1000;
+
+    /* The task sleeps here instead of spinning on short mbedtls_ssl_read timeouts */
+    ret = select(MAX(socket_fd, wakeup_fd) + 1, &read_fds, NULL, NULL, &tv);
+    if(0 > ret) {
+        ESP_LOGE(TAG, "select on the TLS socket failed, errno %d", errno);
+        return NETWORK_SSL_READ_ERROR;
+    }
+
+    if(FD_ISSET(socket_fd, &read_fds)) {
+        return SUCCESS;
+    }
+
+    if(0 <= wakeup_fd && FD_ISSET(wakeup_fd, &read_fds)) {
+        /* Reading an eventfd resets its counter, so several wakeups are seen as one */
+        if(sizeof(wakeups) != (size_t) read(wakeup_fd, &wakeups, sizeof(wakeups))) {
+            ESP_LOGW(TAG, "Unable to clear the yield wakeup descriptor");
+        }
+        return NETWORK_WAIT_INTERRUPTED;
+    }
+
+    return NETWORK_SSL_NOTHING_TO_READ;
+}
+
+IoT_Error_t iot_tls_wakeup(Network *pNetwork) {
+    uint64_t wakeup = 1;
+
+    if(0 > pNetwork->tlsDataParams.wakeup_fd) {
+        return FAILURE;
+    }
+
+    if(sizeof(wakeup) != (size_t) write(pNetwork->tlsDataParams.wakeup_fd, &wakeup, sizeof(wakeup))) {
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+#endif /* CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD */
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
     mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
     int ret = 0;
@@ -509,13 +913,30 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 
     mbedtls_net_free(&(tlsDataParams->server_fd));
 
-    mbedtls_x509_crt_free(&(tlsDataParams->clicert));
-    mbedtls_x509_crt_free(&(tlsDataParams->cacert));
-    mbedtls_pk_free(&(tlsDataParams->pkey));
+    /* The credentials are kept, a reconnect only sets up a new SSL context */
     mbedtls_ssl_free(&(tlsDataParams->ssl));
     mbedtls_ssl_config_free(&(tlsDataParams->conf));
-    mbedtls_ctr_drbg_free(&(tlsDataParams->ctr_drbg));
-    mbedtls_entropy_free(&(tlsDataParams->entropy));
+
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_free(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = NULL;
+
+    if(NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    /* Everything is left released, so a second call does nothing */
+    tlsDataParams = &(pNetwork->tlsDataParams);
+    _iot_tls_discard_session(tlsDataParams);
+    iot_tls_free_credentials(&(tlsDataParams->ownCredentials));
+#ifdef CONFIG_AWS_IOT_EVENT_DRIVEN_YIELD
+    if(0 <= tlsDataParams->wakeup_fd) {
+        close(tlsDataParams->wakeup_fd);
+        tlsDataParams->wakeup_fd = -1;
+    }
+#endif
 
     return SUCCESS;
 }